@@ -0,0 +1,579 @@
+// Benchmark harness for System's public API.
+//
+// Every benchmark is run at each requested entity count and reports ops/sec,
+// p50/p99 latency and heap allocations per operation. Results are printed as a
+// table and, with --json FILE, appended as one JSON object per line so runs
+// can be compared over time.
+//
+// Usage: CloudResourceRentalSystemBench [--sizes 1000,100000] [--json results.jsonl] [--filter name]
+//                                       [--kdf-iterations N]
+//
+// Password hashing runs at 1 iteration unless --kdf-iterations is given, so the
+// numbers measure the data structures rather than PBKDF2.
+//
+// Calls that create rentals and bills have an allocation budget; the harness
+// exits with status 1 if one of them exceeded it, so CI can run it as a check.
+
+#include "System.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Global allocation counter: every operator new in the process goes through here
+static std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+typedef std::chrono::steady_clock Clock;
+
+// Budget for calls that create rentals and bills, checked by their benchmarks
+static const double MAX_STEADY_ALLOCATIONS_PER_OP = 0.1;
+static int budgetFailures = 0; // Benchmarks over the budget; main returns nonzero if any
+
+struct BenchResult {
+    std::string name;
+    size_t entities;
+    size_t ops;
+    double seconds;
+    double p50Nanos;
+    double p99Nanos;
+    double allocationsPerOp;
+};
+
+// Collects per-operation latencies. Storage is reserved up front so recording
+// does not allocate inside the measured region.
+class LatencyRecorder {
+private:
+    std::vector<uint64_t> samples;
+    unsigned long long allocationsAtStart;
+    Clock::time_point started;
+    double elapsed;
+    unsigned long long allocations;
+
+public:
+    explicit LatencyRecorder(size_t expectedOps) : allocationsAtStart(0), elapsed(0.0), allocations(0) {
+        samples.reserve(expectedOps);
+    }
+
+    void start() {
+        allocationsAtStart = allocationCount.load();
+        started = Clock::now();
+    }
+
+    void stop() {
+        elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+        allocations = allocationCount.load() - allocationsAtStart;
+    }
+
+    void record(Clock::time_point opStart) {
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - opStart).count());
+    }
+
+    BenchResult finish(const std::string& name, size_t entities) {
+        BenchResult result;
+        result.name = name;
+        result.entities = entities;
+        result.ops = samples.size();
+        result.seconds = elapsed;
+        std::sort(samples.begin(), samples.end());
+        result.p50Nanos = samples.empty() ? 0.0 : static_cast<double>(samples[samples.size() / 2]);
+        result.p99Nanos = samples.empty() ? 0.0 : static_cast<double>(samples[std::min(samples.size() - 1, samples.size() * 99 / 100)]);
+        result.allocationsPerOp = samples.empty() ? 0.0 : static_cast<double>(allocations) / samples.size();
+        return result;
+    }
+};
+
+// Builds a System with `users` students, `resources` CPUs and an admin, all silenced
+struct Fixture {
+    System system;
+    std::vector<std::string> usernames;
+    std::vector<std::string> resourceIds;
+
+    Fixture(size_t users, size_t resources) {
+        usernames.reserve(users);
+        for (size_t i = 0; i < users; ++i) {
+            usernames.push_back("bench_user_" + std::to_string(i));
+            system.registerUser(usernames.back(), "password", UserRole::STUDENT, "Bench User");
+        }
+        system.registerUser("bench_admin", "adminPass", UserRole::ADMIN, "Bench Admin");
+        resourceIds.reserve(resources);
+        for (size_t i = 0; i < resources; ++i) {
+            resourceIds.push_back("bench_cpu_" + std::to_string(i));
+            system.addResource(Resource(resourceIds.back(), ResourceType::CPU, "Bench CPU", {{"Cores", "8"}}, 1.5));
+        }
+    }
+
+    void loginAdmin() { system.loginUser("bench_admin", "adminPass"); }
+    void loginFirstUser() { system.loginUser(usernames.front(), "password"); }
+
+    // Requests one rental per resource as the first user and returns the rental IDs
+    std::vector<std::string> requestAll() {
+        loginFirstUser();
+        std::string userId = system.getCurrentUser()->getUserId();
+        for (const auto& id : resourceIds) {
+            system.requestResourceRental(id, 2);
+        }
+        std::vector<std::string> rentalIds;
+        rentalIds.reserve(resourceIds.size());
+        for (Rental* rental : system.getUserRentals(userId)) {
+            rentalIds.push_back(rental->getRentalId());
+        }
+        system.logoutUser();
+        return rentalIds;
+    }
+};
+
+static BenchResult benchRegisterUser(size_t n) {
+    System system;
+    std::vector<std::string> names;
+    names.reserve(n);
+    for (size_t i = 0; i < n; ++i) names.push_back("user_" + std::to_string(i));
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        system.registerUser(names[i], "password", UserRole::STUDENT, "Bench User");
+        recorder.record(t);
+    }
+    recorder.stop();
+    return recorder.finish("registerUser", n);
+}
+
+static BenchResult benchLoginUser(size_t n) {
+    Fixture fixture(n, 0);
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<size_t> order(n);
+    for (auto& index : order) index = pick(rng);
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        fixture.system.loginUser(fixture.usernames[order[i]], "password");
+        recorder.record(t);
+    }
+    recorder.stop();
+    return recorder.finish("loginUser", n);
+}
+
+static BenchResult benchFindResource(size_t n) {
+    Fixture fixture(1, n);
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<size_t> order(n);
+    for (auto& index : order) index = pick(rng);
+
+    LatencyRecorder recorder(n);
+    size_t found = 0;
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        found += fixture.system.findResource(fixture.resourceIds[order[i]]) != nullptr;
+        recorder.record(t);
+    }
+    recorder.stop();
+    if (found != n) std::cerr << "findResource: only " << found << " of " << n << " found" << std::endl;
+    return recorder.finish("findResource", n);
+}
+
+// The find_if pattern System used before it had indexes: a full scan comparing
+// usernames. With reference getters the comparison itself does not allocate.
+static BenchResult benchScanUsersByName(size_t n) {
+    std::vector<User> users;
+    std::vector<std::string> usernames;
+    users.reserve(n);
+    usernames.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        usernames.push_back("bench_user_" + std::to_string(i)); // Too long for the small-string buffer
+        users.emplace_back("user_" + std::to_string(i + 1), usernames.back(), "password", UserRole::STUDENT, "Bench User");
+    }
+    const size_t scans = 100;
+    size_t found = 0;
+
+    LatencyRecorder recorder(scans);
+    recorder.start();
+    for (size_t i = 0; i < scans; ++i) {
+        const std::string& wanted = usernames[(i * 7919) % n];
+        Clock::time_point t = Clock::now();
+        auto it = std::find_if(users.begin(), users.end(),
+                               [&wanted](const User& u) { return u.getUsername() == wanted; });
+        if (it != users.end()) ++found;
+        recorder.record(t);
+    }
+    recorder.stop();
+    if (found != scans) std::cerr << "scanUsersByName: only " << found << " of " << scans << " found" << std::endl;
+    return recorder.finish("scanUsersByName", n);
+}
+
+// Walks the catalog a page at a time and reads every resource's specs; the
+// only allocation left per page is the page's item vector
+static BenchResult benchListResources(size_t n) {
+    Fixture fixture(1, n);
+    const size_t pageSize = 100;
+    size_t specs = 0;
+
+    LatencyRecorder recorder(n / pageSize + 1);
+    recorder.start();
+    PageRequest request(pageSize);
+    do {
+        Clock::time_point t = Clock::now();
+        Page<Resource> page = fixture.system.listResources(request);
+        for (const Resource* resource : page.items) {
+            specs += resource->getAllSpecs().size();
+        }
+        request.cursor = page.nextCursor;
+        recorder.record(t);
+    } while (!request.cursor.empty());
+    recorder.stop();
+    if (specs != n) std::cerr << "listResources: read " << specs << " specs, expected " << n << std::endl;
+    return recorder.finish("listResources", n);
+}
+
+// Records a failure if a run allocated more per call than MAX_STEADY_ALLOCATIONS_PER_OP
+static void checkAllocationBudget(const BenchResult& result) {
+    if (result.allocationsPerOp <= MAX_STEADY_ALLOCATIONS_PER_OP) return;
+    std::cerr << result.name << " at " << result.entities << ": " << result.allocationsPerOp
+              << " allocations per call" << std::endl;
+    ++budgetFailures;
+}
+
+static BenchResult benchRequestResourceRental(size_t n) {
+    Fixture fixture(1, n);
+    fixture.loginFirstUser();
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        fixture.system.requestResourceRental(fixture.resourceIds[i], 2);
+        recorder.record(t);
+    }
+    recorder.stop();
+    BenchResult result = recorder.finish("requestResourceRental", n);
+    // IDs fit in the small-string buffer and index nodes come from the System's pool,
+    // so only the amortized growth of vectors and bucket tables should be left
+    checkAllocationBudget(result);
+    return result;
+}
+
+// Rejection path: every request hits a resource that is already allocated.
+// Console messages are off, as for a caller that branches on lastError().
+static BenchResult benchRequestBusyResource(size_t n) {
+    Fixture fixture(1, 1);
+    fixture.requestAll();
+    fixture.loginAdmin();
+    fixture.system.adminApproveRental("rental_1");
+    fixture.loginFirstUser();
+    fixture.system.setConsoleMessages(false);
+    size_t busy = 0;
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        if (!fixture.system.requestResourceRental(fixture.resourceIds[0], 2) &&
+            fixture.system.lastError() == ErrorCode::RESOURCE_BUSY) {
+            ++busy;
+        }
+        recorder.record(t);
+    }
+    recorder.stop();
+    if (busy != n) std::cerr << "requestBusyResource: only " << busy << " of " << n << " rejected as busy" << std::endl;
+    return recorder.finish("requestBusyResource", n);
+}
+
+static BenchResult benchAdminApproveRental(size_t n) {
+    Fixture fixture(1, n);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (const auto& id : rentalIds) {
+        Clock::time_point t = Clock::now();
+        fixture.system.adminApproveRental(id);
+        recorder.record(t);
+    }
+    recorder.stop();
+    return recorder.finish("adminApproveRental", n);
+}
+
+static BenchResult benchProcessRentalCompletion(size_t n) {
+    Fixture fixture(1, n);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+    for (const auto& id : rentalIds) fixture.system.adminApproveRental(id);
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (const auto& id : rentalIds) {
+        Clock::time_point t = Clock::now();
+        fixture.system.processRentalCompletion(id);
+        recorder.record(t);
+    }
+    recorder.stop();
+    BenchResult result = recorder.finish("processRentalCompletion", n);
+    checkAllocationBudget(result);
+    return result;
+}
+
+// One account holding n approved rentals requests one more and cancels it per
+// call: both touch its live rentals, so the cost must not grow with n
+static BenchResult benchHeavyUserChurn(size_t n) {
+    Fixture fixture(1, n + 1);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+    for (size_t i = 0; i < n; ++i) fixture.system.adminApproveRental(rentalIds[i]);
+    fixture.system.cancelRentalRequest(rentalIds[n]); // Leaves the last resource free for the churn
+    fixture.loginFirstUser();
+    const std::string& resourceId = fixture.resourceIds[n];
+    std::vector<std::string> churnIds; // IDs are numbered in request order, after the n + 1 above
+    churnIds.reserve(n);
+    for (size_t i = 0; i < n; ++i) churnIds.push_back("rental_" + std::to_string(n + 2 + i));
+    size_t cancelled = 0;
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (size_t i = 0; i < n; ++i) {
+        Clock::time_point t = Clock::now();
+        fixture.system.requestResourceRental(resourceId, 2);
+        if (fixture.system.cancelRentalRequest(churnIds[i])) ++cancelled;
+        recorder.record(t);
+    }
+    recorder.stop();
+    if (cancelled != n) std::cerr << "heavyUserChurn: cancelled " << cancelled << " of " << n << std::endl;
+    return recorder.finish("heavyUserChurn", n);
+}
+
+// Finds one approved rental overdue per call: each check is given the end time
+// of the next rental, as a monitor running just behind the clock would be
+static BenchResult benchCheckOverdueRentals(size_t n) {
+    Fixture fixture(1, n);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+    std::vector<std::chrono::system_clock::time_point> endTimes;
+    endTimes.reserve(n);
+    for (const auto& id : rentalIds) {
+        fixture.system.adminApproveRental(id);
+        endTimes.push_back(fixture.system.findRental(id)->getEndTime());
+    }
+    std::sort(endTimes.begin(), endTimes.end());
+
+    LatencyRecorder recorder(n);
+    size_t found = 0;
+    recorder.start();
+    for (const auto& endTime : endTimes) {
+        Clock::time_point t = Clock::now();
+        found += fixture.system.checkOverdueRentals(endTime);
+        recorder.record(t);
+    }
+    recorder.stop();
+    if (found != n) std::cerr << "checkOverdueRentals: found " << found << " overdue, expected " << n << std::endl;
+    return recorder.finish("checkOverdueRentals", n);
+}
+
+// Deletes every resource of a catalog whose rentals have all completed
+static BenchResult benchAdminDeleteResource(size_t n) {
+    Fixture fixture(1, n);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+    for (const auto& id : rentalIds) {
+        fixture.system.adminApproveRental(id);
+        fixture.system.processRentalCompletion(id);
+    }
+
+    LatencyRecorder recorder(n);
+    recorder.start();
+    for (const auto& id : fixture.resourceIds) {
+        Clock::time_point t = Clock::now();
+        fixture.system.adminDeleteResource(id);
+        recorder.record(t);
+    }
+    recorder.stop();
+    return recorder.finish("adminDeleteResource", n);
+}
+
+// Display functions walk every entity once per call, so they are run a few
+// times and latency is per call.
+static BenchResult benchDisplay(const std::string& name, size_t n, const std::function<void()>& display) {
+    const size_t repetitions = 3;
+    LatencyRecorder recorder(repetitions);
+    recorder.start();
+    for (size_t i = 0; i < repetitions; ++i) {
+        Clock::time_point t = Clock::now();
+        display();
+        recorder.record(t);
+    }
+    recorder.stop();
+    return recorder.finish(name, n);
+}
+
+static const char* const displayBenchmarks[] = {
+    "displayAllResources", "adminDisplayAllUsers", "adminDisplayAllRentals",
+    "adminDisplayAllBills", "displayUserRentals", "displayUserBills"
+};
+
+static std::vector<BenchResult> benchDisplays(size_t n) {
+    Fixture fixture(n, n);
+    std::vector<std::string> rentalIds = fixture.requestAll();
+    fixture.loginAdmin();
+    for (size_t i = 0; i < rentalIds.size(); ++i) {
+        fixture.system.adminApproveRental(rentalIds[i]);
+        if (i % 2 == 0) fixture.system.processRentalCompletion(rentalIds[i]); // Half of them billed
+    }
+    std::string heavyUserId = "user_1"; // The first user holds every rental
+
+    std::vector<BenchResult> results;
+    System& system = fixture.system;
+    results.push_back(benchDisplay(displayBenchmarks[0], n, [&system]() { system.displayAllResources(); }));
+    results.push_back(benchDisplay(displayBenchmarks[1], n, [&system]() { system.adminDisplayAllUsers(); }));
+    results.push_back(benchDisplay(displayBenchmarks[2], n, [&system]() { system.adminDisplayAllRentals(); }));
+    results.push_back(benchDisplay(displayBenchmarks[3], n, [&system]() { system.adminDisplayAllBills(); }));
+    results.push_back(benchDisplay(displayBenchmarks[4], n,
+                                   [&system, &heavyUserId]() { system.displayUserRentals(heavyUserId); }));
+    results.push_back(benchDisplay(displayBenchmarks[5], n,
+                                   [&system, &heavyUserId]() { system.displayUserBills(heavyUserId); }));
+    return results;
+}
+
+static void printResult(const BenchResult& r, std::ostream& table, std::ostream* json) {
+    double opsPerSec = r.seconds > 0 ? r.ops / r.seconds : 0.0;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-26s %9zu %9zu %14.2f %12.0f %12.0f %10.2f",
+                  r.name.c_str(), r.entities, r.ops, opsPerSec, r.p50Nanos, r.p99Nanos, r.allocationsPerOp);
+    table << line << std::endl;
+    if (json) {
+        std::snprintf(line, sizeof(line),
+                      "{\"benchmark\":\"%s\",\"entities\":%zu,\"ops\":%zu,\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+                      "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"allocs_per_op\":%.3f}",
+                      r.name.c_str(), r.entities, r.ops, r.seconds, opsPerSec, r.p50Nanos, r.p99Nanos, r.allocationsPerOp);
+        *json << line << std::endl;
+    }
+}
+
+static std::vector<size_t> parseSizes(const std::string& text) {
+    std::vector<size_t> sizes;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        long long value = std::atoll(text.substr(start, comma - start).c_str());
+        if (value > 0) sizes.push_back(static_cast<size_t>(value));
+        start = comma + 1;
+    }
+    return sizes;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes = { 1000, 100000, 1000000 };
+    std::string jsonPath;
+    std::string filter;
+    unsigned long kdfIterations = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parseSizes(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--kdf-iterations" && i + 1 < argc) {
+            kdfIterations = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--sizes 1000,100000] [--json results.jsonl] [--filter name]"
+                      << " [--kdf-iterations N]" << std::endl;
+            return 2;
+        }
+    }
+    PasswordHasher::setDefaultIterations(static_cast<uint32_t>(kdfIterations));
+
+    std::ofstream jsonFile;
+    if (!jsonPath.empty()) {
+        jsonFile.open(jsonPath.c_str(), std::ios::app);
+        if (!jsonFile) {
+            std::cerr << "Cannot open " << jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    // Every System call prints to std::cout, so it is silenced and the
+    // results table is written to the real stdout buffer directly
+    std::ostream table(std::cout.rdbuf());
+    NullStreamBuffer nullBuffer;
+    ScopedCoutRedirect silence(&nullBuffer);
+
+    char header[256];
+    std::snprintf(header, sizeof(header), "%-26s %9s %9s %14s %12s %12s %10s",
+                  "benchmark", "entities", "ops", "ops/sec", "p50 ns", "p99 ns", "allocs/op");
+    table << header << std::endl;
+
+    typedef std::function<BenchResult(size_t)> SingleBench;
+    std::vector<std::pair<std::string, SingleBench>> singles = {
+        { "registerUser", benchRegisterUser },
+        { "loginUser", benchLoginUser },
+        { "findResource", benchFindResource },
+        { "scanUsersByName", benchScanUsersByName },
+        { "listResources", benchListResources },
+        { "requestResourceRental", benchRequestResourceRental },
+        { "requestBusyResource", benchRequestBusyResource },
+        { "adminApproveRental", benchAdminApproveRental },
+        { "processRentalCompletion", benchProcessRentalCompletion },
+        { "adminDeleteResource", benchAdminDeleteResource },
+        { "checkOverdueRentals", benchCheckOverdueRentals },
+        { "heavyUserChurn", benchHeavyUserChurn },
+    };
+
+    bool runDisplays = filter.empty();
+    for (const char* name : displayBenchmarks) {
+        if (std::string(name).find(filter) != std::string::npos) runDisplays = true;
+    }
+
+    std::ostream* json = jsonFile.is_open() ? &jsonFile : nullptr;
+    for (size_t n : sizes) {
+        for (const auto& bench : singles) {
+            if (!filter.empty() && bench.first.find(filter) == std::string::npos) continue;
+            printResult(bench.second(n), table, json);
+        }
+        if (runDisplays) {
+            for (const auto& result : benchDisplays(n)) {
+                if (!filter.empty() && result.name.find(filter) == std::string::npos) continue;
+                printResult(result, table, json);
+            }
+        }
+    }
+    if (budgetFailures > 0) {
+        std::cerr << budgetFailures << " benchmark run(s) exceeded the allocation budget of "
+                  << MAX_STEADY_ALLOCATIONS_PER_OP << " per call" << std::endl;
+        return 1;
+    }
+    return 0;
+}
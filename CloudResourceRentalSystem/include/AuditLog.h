@@ -0,0 +1,144 @@
+#ifndef AUDIT_LOG_H
+#define AUDIT_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Audited operations. The numeric values are stored in logs.dat, so only append.
+enum class AuditOp : uint8_t {
+    USER_REGISTERED = 1,
+    LOGIN_SUCCEEDED,
+    LOGIN_FAILED,
+    LOGOUT,
+    NAME_CHANGED,
+    PASSWORD_CHANGED,
+    USER_ADDED,          // By an admin
+    USER_MODIFIED,       // amount = new balance, detail = new status
+    USER_STATUS_CHANGED, // detail = new status
+    RESOURCE_ADDED,
+    RESOURCE_MODIFIED,   // amount = new price per hour
+    RESOURCE_DELETED,
+    RENTAL_REQUESTED,    // detail = duration in hours
+    RENTAL_CANCELLED,
+    RENTAL_APPROVED,
+    RENTAL_REJECTED,
+    RENTAL_COMPLETED,    // amount = billed cost
+    BILLS_ARCHIVED,      // detail = number of bills
+    USERS_IMPORTED,      // detail = number of users
+    RESOURCES_IMPORTED,  // detail = number of resources
+    RECORDS_DROPPED,     // Written by the logger itself: detail = records lost because the ring was full
+    RENTAL_PAUSED,       // By a user suspension; amount = partial bill
+    RENTAL_TERMINATED,   // By a user suspension or a decommission; amount = partial bill
+    RENTAL_RESUMED,      // Paused rental pending approval again after reactivation
+    RENTAL_OVERDUE,      // Found past its end time by the overdue check
+    COUNT
+};
+
+// One log entry, stored as-is (little-endian) in the log file.
+// IDs longer than the fixed fields are cut off and flagged.
+struct AuditRecord {
+    static const uint8_t FLAG_TRUNCATED = 1;
+
+    int64_t timestampMicros; // system_clock, microseconds since the Unix epoch
+    double amount;
+    uint32_t detail;
+    uint8_t op;              // AuditOp
+    uint8_t flags;
+    uint16_t reserved;
+    char actor[20];          // User ID of the logged-in user, NUL padded
+    char target[20];         // Affected user, resource or rental ID, NUL padded
+
+    std::string actorId() const;
+    std::string targetId() const;
+};
+
+struct AuditLogOptions {
+    std::string path;
+    size_t ringCapacity;                     // Records buffered in memory, rounded up to a power of two
+    uint64_t maxFileBytes;                   // Rotate when the file would grow past this
+    int maxRotatedFiles;                     // Keep path.1 .. path.N
+    std::chrono::milliseconds flushInterval; // How often the writer thread polls the ring
+
+    AuditLogOptions(const std::string& filePath = "logs.dat")
+        : path(filePath), ringCapacity(1 << 16), maxFileBytes(64ULL << 20), maxRotatedFiles(5),
+          flushInterval(100) {}
+};
+
+// Asynchronous audit log.
+//
+// append() copies a fixed-size record into a bounded lock-free ring (Vyukov's
+// array queue) and returns without touching the disk. A background thread drains
+// the ring in batches into the log file, which starts with the 8-byte magic
+// "CRRSAUD1" and is rotated to path.1, path.2, ... when it gets too large.
+// If the ring is full the record is dropped and counted; the writer then logs a
+// RECORDS_DROPPED marker so the gap is visible in the file.
+class AuditLog {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        AuditRecord record;
+    };
+
+    AuditLogOptions options;
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    // Padded rather than alignas(64): a C++11 new ignores extended alignment,
+    // while 64 bytes apart they cannot share a cache line wherever they land
+    char padBeforeEnqueue[64];
+    std::atomic<size_t> enqueuePosition;  // Shared by producers
+    char padBeforeDequeue[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePosition;  // Written by the writer thread only
+    char padAfterDequeue[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+
+    std::FILE* file;
+    uint64_t fileBytes;
+
+    std::mutex mutex; // Guards the fields below; producers never take it
+    std::condition_variable wakeWriter;
+    std::condition_variable progress;
+    bool stopping;
+    size_t flushTarget;    // flush() callers wait until everything before this position is on disk
+    size_t durablePosition;
+    std::thread writer;
+
+    bool pop(AuditRecord& record);
+    bool openFile();
+    bool rotate();
+    void writeBatch(const std::vector<AuditRecord>& batch);
+    void run();
+
+public:
+    explicit AuditLog(const AuditLogOptions& logOptions = AuditLogOptions());
+    ~AuditLog(); // Writes everything still buffered
+
+    // Thread-safe and non-blocking. Returns false if the record was dropped.
+    bool append(AuditOp op, const std::string& actor, const std::string& target,
+                double amount = 0.0, uint32_t detail = 0);
+
+    // Blocks until every record appended before the call has been written
+    void flush();
+
+    uint64_t recordsWritten() const;
+    uint64_t recordsDropped() const;
+
+    static const char* opName(AuditOp op);
+    static bool opFromName(const std::string& name, AuditOp& op);
+
+    // Reads every record of one log file
+    static bool readFile(const std::string& path, std::vector<AuditRecord>& records, std::string& error);
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+};
+
+#endif // AUDIT_LOG_H
@@ -0,0 +1,99 @@
+#ifndef BALANCE_WATCH_H
+#define BALANCE_WATCH_H
+
+#include "NodePool.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A user whose running rentals are projected to take the balance below zero
+struct BalanceRisk {
+    std::string userId;
+    double balance;
+    double committed;        // Booked cost of approved/active rentals not billed yet
+    double projectedBalance; // balance - committed, always negative here
+    std::chrono::system_clock::time_point depletion; // When the balance runs out; the epoch if it already has
+
+    BalanceRisk() : balance(0.0), committed(0.0), projectedBalance(0.0) {}
+};
+
+// Incremental low-balance monitoring (see System::adminUsersGoingNegative).
+//
+// For every user with approved or active rentals it keeps running sums of
+// their price per hour, booked cost and amount billed so far, updated in O(1)
+// as rentals start, stop and get billed. Users whose committed spend exceeds
+// their balance are kept ordered by the projected moment the balance runs out,
+// so "who goes negative within N hours" is a range scan of that order, and
+// alerts become due as the clock reaches them rather than by scanning users.
+//
+// Spend is projected to accrue linearly from each rental's start at its price
+// per hour, as if every running rental kept running; a rental ending early
+// stops accruing sooner, so the projected moment is the earliest one.
+// Not synchronized: it belongs to one System, which is externally locked.
+class BalanceWatch {
+public:
+    typedef std::chrono::system_clock::time_point TimePoint;
+
+    BalanceWatch();
+
+    // A rental started or stopped running; `billed` is its cost billed so far
+    void addRental(const std::string& userId, double balance, double pricePerHour, double hours,
+                   TimePoint start, double billed);
+    void removeRental(const std::string& userId, double balance, double pricePerHour, double hours,
+                      TimePoint start, double billed);
+    void addBilled(const std::string& userId, double amount); // Part of a running rental was billed
+    void repriceRental(const std::string& userId, double oldPricePerHour, double newPricePerHour, double hours,
+                       TimePoint start);
+    void setBalance(const std::string& userId, double balance);
+    void removeUser(const std::string& userId);
+
+    bool find(const std::string& userId, BalanceRisk& risk) const; // False if not at risk
+    std::vector<BalanceRisk> atRiskBefore(TimePoint deadline) const; // Soonest first
+    size_t atRiskCount() const;
+
+    // At-risk users whose balance runs out before `deadline` and who were not
+    // returned since they last became at risk, soonest first. A user counts as
+    // recovered only if still not at risk here, so changes that are undone
+    // before the next call (a rolled-back transaction) do not alert again.
+    std::vector<std::string> takeDueAlerts(TimePoint deadline);
+
+    BalanceWatch(const BalanceWatch&) = delete;
+    BalanceWatch& operator=(const BalanceWatch&) = delete;
+
+private:
+    typedef std::pair<TimePoint, std::string> Key;
+    typedef std::set<Key, std::less<Key>, PoolAllocator<Key>> Order;
+
+    struct Exposure {
+        size_t running;
+        double balance;
+        double rate;          // Sum of price per hour
+        double weightedStart; // Sum of price per hour * start, in hours since the epoch
+        double booked;        // Sum of price per hour * booked hours
+        double billed;
+        bool atRisk;
+        bool alerted;
+        bool recovering;      // Alerted, no longer at risk, and in `recovered`
+        TimePoint depletion;  // Key in the orders while atRisk
+
+        Exposure() : running(0), balance(0.0), rate(0.0), weightedStart(0.0), booked(0.0), billed(0.0),
+                     atRisk(false), alerted(false), recovering(false) {}
+    };
+
+    NodePool pool; // Nodes of the orders and the exposures; updates reuse them
+    std::unordered_map<std::string, Exposure, std::hash<std::string>, std::equal_to<std::string>,
+                       PoolAllocator<std::pair<const std::string, Exposure>>> exposures;
+    Order byDepletion;
+    Order awaitingAlert; // At risk and not alerted yet
+    std::vector<std::string> recovered; // Settled by the next takeDueAlerts
+
+    void reposition(const std::string& userId, Exposure& exposure); // After any change
+    BalanceRisk riskOf(const std::string& userId, const Exposure& exposure) const;
+};
+
+#endif // BALANCE_WATCH_H
@@ -0,0 +1,94 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <cstddef>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class System;
+
+struct BatchOptions {
+    bool echoSystemOutput; // Pass System's console messages through instead of discarding them
+    bool stopOnError;      // Stop at the first failed command outside a group
+
+    BatchOptions() : echoSystemOutput(false), stopOnError(false) {}
+};
+
+struct BatchCommandStats {
+    size_t count;
+    size_t failed;
+    double seconds;
+
+    BatchCommandStats() : count(0), failed(0), seconds(0.0) {}
+};
+
+struct BatchReport {
+    size_t commands;  // Executed, including failed ones
+    size_t failed;
+    size_t skipped;   // Not executed because an earlier command of their group failed
+    double seconds;
+    std::map<std::string, BatchCommandStats> byCommand;
+
+    BatchReport() : commands(0), failed(0), skipped(0), seconds(0.0) {}
+};
+
+// Runs a script of System commands, one per line, for unattended admin jobs.
+//
+//   login USER PASSWORD            logout
+//   register USER PASSWORD ROLE "REAL NAME"      (ROLE: student, teacher, admin)
+//   passwd NEW_PASSWORD            rename "NEW NAME"
+//   add-resource ID TYPE "NAME" PRICE_PER_HOUR   (TYPE: cpu, gpu, storage)
+//   delete-resource ID
+//   request RESOURCE_ID HOURS      cancel RENTAL_ID
+//   approve RENTAL_ID              reject RENTAL_ID "REASON"
+//   complete RENTAL_ID
+//   suspend USER                   activate USER
+//   import users|resources FILE    (CSV, or JSONL if FILE ends in .jsonl)
+//   list resources|rentals|bills|users   (own rentals/bills, or all for an admin)
+//   begin ... commit
+//
+// "$last" in an argument is replaced by the rental ID of the latest request.
+// Blank lines and lines starting with '#' are ignored. list writes one line
+// per item to the output stream; failures are reported on the error stream
+// with the line number and System's message.
+//
+// Commands between begin and commit form a group that runs as one System
+// transaction: once one of them fails, the changes made by the group so far
+// are rolled back and the rest of it is skipped. A group without a commit is
+// rolled back at the end of the script. Logins inside a group are not undone.
+//
+// Repeating a login that already succeeded in this run with the same password
+// switches to the user without hashing the password again; such repeats are
+// not counted as logins in the metrics and audit log.
+class BatchRunner {
+private:
+    struct CachedLogin {
+        std::string passwordDigest; // SHA-256 of the password given to the successful login
+        std::string userId;
+    };
+
+    System& system;
+    std::ostream out; // Bound to the caller's buffer, so it is unaffected by the std::cout redirect
+    std::ostream& errors;
+    BatchOptions options;
+    std::string lastRentalId;
+    std::map<std::string, CachedLogin> verifiedLogins; // By username
+
+    bool execute(const std::vector<std::string>& words, std::string& error);
+    bool login(const std::string& username, const std::string& password, std::string& error);
+    bool list(const std::string& what, std::string& error);
+    bool import(const std::string& what, const std::string& path, std::string& error);
+
+public:
+    BatchRunner(System& sys, std::ostream& output, std::ostream& errorOutput,
+                const BatchOptions& batchOptions = BatchOptions());
+
+    BatchReport run(std::istream& script);
+
+    static void printReport(const BatchReport& report, std::ostream& out);
+};
+
+#endif // BATCH_RUNNER_H
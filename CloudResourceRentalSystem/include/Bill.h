@@ -3,6 +3,7 @@
 
 #include <string>
 #include <chrono>
+#include <cstddef>
 #include <vector> // Though not directly used in Bill members, good for consistency
 
 class Bill {
@@ -13,21 +14,27 @@ private:
     double amount;
     std::chrono::system_clock::time_point billDate;
     bool isPaid; // Status of the bill
+    size_t ledgerSequence; // Set by System when appended: increases in creation order and survives archiving
 
 public:
     // Constructor
     Bill(std::string bId, std::string rId, std::string uId, double amt);
+    // Constructor for restoring a bill with its original date and paid status (e.g. from the archive)
+    Bill(std::string bId, std::string rId, std::string uId, double amt,
+         std::chrono::system_clock::time_point date, bool paid);
 
     // Getters
-    std::string getBillId() const;
-    std::string getRentalId() const;
-    std::string getUserId() const;
+    const std::string& getBillId() const;
+    const std::string& getRentalId() const;
+    const std::string& getUserId() const;
     double getAmount() const;
     std::chrono::system_clock::time_point getBillDate() const;
     bool getIsPaid() const;
+    size_t getLedgerSequence() const;
 
     // Setters
     void setPaid(bool status);
+    void setLedgerSequence(size_t sequence); // For System
 
     // Display and helper functions
     void displayBillInfo() const;
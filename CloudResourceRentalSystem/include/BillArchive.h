@@ -0,0 +1,76 @@
+#ifndef BILL_ARCHIVE_H
+#define BILL_ARCHIVE_H
+
+#include "Bill.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+// One immutable block of archived bills, stored column by column.
+// IDs and dates are delta + varint encoded, amounts are fixed-point cents,
+// and the paid flag is packed one bit per bill.
+struct BillSegment {
+    size_t count;
+
+    // Metadata used to skip whole segments during queries
+    int64_t minDate;          // billDate ticks (system_clock duration count)
+    int64_t maxDate;
+    long long minUserNumber;  // numeric part of "user_N"
+    long long maxUserNumber;
+    uint64_t userMask;        // bit (userNumber % 64) set for every user in the segment
+
+    // Columns
+    std::vector<uint8_t> billIds;
+    std::vector<uint8_t> rentalIds;
+    std::vector<uint8_t> userIds;
+    std::vector<uint8_t> dates;
+    std::vector<uint8_t> amounts;
+    std::vector<uint8_t> paidBits;
+
+    size_t memoryBytes() const;
+};
+
+// Cold storage tier for old bills.
+// Only bills whose IDs follow the generateUniqueId format ("bill_N", "rental_N", "user_N")
+// can be archived, since the columns store the numbers rather than the strings.
+class BillArchive {
+private:
+    std::vector<BillSegment> segments;
+    size_t segmentCapacity; // Maximum bills per segment
+    size_t totalBills;
+
+    void sealSegment(const std::vector<const Bill*>& batch);
+    void decodeSegment(const BillSegment& segment, const std::string* userId,
+                       int64_t fromTicks, int64_t toTicks, std::vector<Bill>& out) const;
+
+public:
+    // Constructor
+    explicit BillArchive(size_t billsPerSegment = 4096);
+
+    // Checks whether a bill's IDs can be encoded by the archive
+    static bool canArchive(const Bill& bill);
+
+    // Seals the given bills into new immutable segments (in the given order).
+    // Returns the number of bills archived; bills that cannot be archived are skipped.
+    size_t archive(const std::vector<const Bill*>& billsToArchive);
+
+    // Range queries (inclusive). Results are returned in archive order.
+    std::vector<Bill> findByDate(std::chrono::system_clock::time_point from,
+                                 std::chrono::system_clock::time_point to) const;
+    std::vector<Bill> findByUser(const std::string& userId,
+                                 std::chrono::system_clock::time_point from,
+                                 std::chrono::system_clock::time_point to) const;
+    std::vector<Bill> getAll() const;
+
+    // Decodes a single segment (for callers that stream the archive with bounded memory)
+    void findByDateInSegment(size_t segmentIndex, std::chrono::system_clock::time_point from,
+                             std::chrono::system_clock::time_point to, std::vector<Bill>& out) const;
+
+    // Statistics
+    size_t size() const;
+    size_t segmentCount() const;
+    size_t memoryBytes() const;
+};
+
+#endif // BILL_ARCHIVE_H
@@ -0,0 +1,78 @@
+#ifndef BULK_IMPORTER_H
+#define BULK_IMPORTER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <istream>
+
+class System;
+
+enum class ImportFormat {
+    CSV,   // One record per line, comma separated, optional header line
+    JSONL  // One flat JSON object per line
+};
+
+struct ImportError {
+    size_t line;         // 1-based line number in the input
+    std::string message;
+};
+
+struct ImportReport {
+    size_t rowsRead;
+    size_t rowsImported;
+    size_t errorCount;               // All errors, even those not kept in `errors`
+    std::vector<ImportError> errors; // The first maxReportedErrors errors
+    double seconds;
+
+    ImportReport() : rowsRead(0), rowsImported(0), errorCount(0), seconds(0.0) {}
+};
+
+// Streaming bulk loader for provisioning many users or resources at once.
+//
+// Input is read in fixed-size chunks, rows are validated and checked for
+// duplicates with a hash lookup, and nothing is printed per row. New entities
+// are appended directly to System's containers (capacity reserved from the
+// stream size when it is known) and the secondary indexes are built once at
+// the end. Requires an admin to be logged in.
+//
+// Plaintext passwords are hashed at PasswordHasher::defaultIterations() on the
+// caller's thread, tens of milliseconds per row, so large user imports should
+// carry pre-hashed credentials instead (see PasswordHasher::encode); the
+// password column may then be empty.
+//
+// Users:     username,password,role,realName[,balance[,passwordHash]]
+//            {"username": "...", "password": "...", "role": "student", "realName": "...", "balance": 10,
+//             "passwordHash": "pbkdf2-sha256$100000$<salt hex>$<hash hex>"}
+// Resources: resourceId,type,name,pricePerHour[,specs]   where specs is "Key=Value;Key=Value"
+//            {"resourceId": "...", "type": "gpu", "name": "...", "pricePerHour": 2.5, "specs": {"Memory": "8GB"}}
+class BulkImporter {
+private:
+    System& system;
+    size_t chunkSize;          // Bytes read from the stream per chunk
+    size_t maxReportedErrors;
+
+    // Scratch buffers reused across rows to avoid per-row allocations
+    std::vector<std::string> fields;
+    std::vector<std::string> keys; // JSONL only, keys[i] names fields[i]
+    size_t fieldCount;
+    std::map<std::string, std::string> specs;
+
+    template <typename RowHandler>
+    void readLines(std::istream& in, RowHandler handleRow);
+
+    bool splitRow(const char* begin, const char* end, ImportFormat format, std::string& error);
+    const std::string* field(ImportFormat format, size_t csvIndex, const char* jsonKey) const;
+    void addError(ImportReport& report, size_t line, const std::string& message);
+
+    bool importUserRow(ImportFormat format, std::string& error);
+    bool importResourceRow(ImportFormat format, std::string& error);
+
+public:
+    explicit BulkImporter(System& sys, size_t chunkBytes = 1 << 20, size_t maxErrors = 1000);
+
+    ImportReport importUsers(std::istream& in, ImportFormat format);
+    ImportReport importResources(std::istream& in, ImportFormat format);
+};
+
+#endif // BULK_IMPORTER_H
@@ -0,0 +1,138 @@
+#ifndef CHANGE_EVENTS_H
+#define CHANGE_EVENTS_H
+
+#include "ChangeLog.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Kinds of change events. The numeric values are stored in event logs, so only append.
+enum class ChangeEventType : uint8_t {
+    USER_CREATED,            // Registered, added by an admin or imported
+    USER_STATUS_CHANGED,     // Codes: UserStatus
+    USER_BALANCE_CHANGED,    // Amounts: balance
+    USER_MODIFIED,           // By an admin; codes: UserStatus, amounts: balance
+    RESOURCE_ADDED,          // New amount: price per hour
+    RESOURCE_MODIFIED,       // Amounts: price per hour
+    RESOURCE_STATUS_CHANGED, // Codes: ResourceStatus
+    RESOURCE_DELETED,
+    RENTAL_CREATED,          // userId and relatedId (the resource) are set
+    RENTAL_STATUS_CHANGED,   // Codes: RentalStatus; new amount: total cost; userId and relatedId are set
+    BILL_CREATED,            // New amount: bill amount; userId and relatedId (the rental) are set
+    COUNT
+};
+
+const char* changeEventTypeName(ChangeEventType type);
+
+// One state change of a System entity, with the values before and after it
+// where the type has them (see ChangeEventType).
+struct ChangeEvent {
+    uint64_t sequence;       // 1, 2, 3, ... assigned by the stream
+    int64_t timestampMicros; // system_clock when it was published
+    ChangeEventType type;
+    std::string entityId;    // User, resource, rental or bill ID
+    std::string userId;      // Owner of a rental or bill
+    std::string relatedId;
+    uint32_t oldCode;
+    uint32_t newCode;
+    double oldAmount;
+    double newAmount;
+
+    ChangeEvent() : sequence(0), timestampMicros(0), type(ChangeEventType::COUNT), oldCode(0), newCode(0),
+                    oldAmount(0.0), newAmount(0.0) {}
+    ChangeEvent(ChangeEventType eventType, const std::string& id)
+        : sequence(0), timestampMicros(0), type(eventType), entityId(id), oldCode(0), newCode(0),
+          oldAmount(0.0), newAmount(0.0) {}
+};
+
+// Event logs reuse the change log format with ChangeType::EVENT records, so
+// they are tailed with ChangeLogReader and decoded with this
+bool decodeChangeEvent(const ChangeRecord& record, ChangeEvent& event);
+
+struct ChangeEventStreamOptions {
+    size_t capacity;                          // Events kept for the slowest subscriber
+    std::chrono::milliseconds maxPublishWait; // Longest a full ring holds up a publish
+
+    ChangeEventStreamOptions() : capacity(4096), maxPublishWait(20) {}
+};
+
+class ChangeEventSubscription;
+
+// Typed change-data-capture stream of a System (see System::attachEventStream),
+// for caches, notifications and other derived views that update incrementally.
+//
+// Events go into a bounded ring shared by all subscribers, each with its own
+// cursor. When the slowest subscriber is a full ring behind, publish() waits
+// for it to catch up for at most maxPublishWait (the System lock is held
+// meanwhile, so subscribers must not take it while consuming); subscribers
+// still behind then lose their oldest events, which dropped() reports. Publishes
+// do not wait for such a subscriber again until it next polls, so one stalled
+// consumer costs the System lock maxPublishWait once rather than per event.
+// Optionally every event is also appended to an event log on disk.
+class ChangeEventStream {
+private:
+    ChangeEventStreamOptions options;
+    std::vector<ChangeEvent> ring; // Event n is at ring[(n - 1) % capacity]
+
+    std::mutex mutex; // Guards the fields below and the cursors of the subscriptions
+    std::condition_variable published;
+    std::condition_variable consumed;
+    uint64_t lastSequence;
+    std::vector<ChangeEventSubscription*> subscribers;
+    ChangeLogWriter* eventLog; // Not owned
+
+    uint64_t slowestCursor() const; // Of the subscribers that are not lagging; called with mutex held
+
+    friend class ChangeEventSubscription;
+
+public:
+    explicit ChangeEventStream(const ChangeEventStreamOptions& streamOptions = ChangeEventStreamOptions());
+    ~ChangeEventStream(); // Destroy the subscriptions first
+
+    // Thread-safe. Assigns the event's sequence number and timestamp.
+    uint64_t publish(ChangeEvent& event);
+
+    // Receives the events published from now on
+    std::unique_ptr<ChangeEventSubscription> subscribe();
+
+    // Every event is also appended to the given log as a ChangeType::EVENT
+    // record; the log must outlive the stream or be detached with nullptr
+    void attachEventLog(ChangeLogWriter* log);
+
+    uint64_t sequence(); // Last event published
+
+    ChangeEventStream(const ChangeEventStream&) = delete;
+    ChangeEventStream& operator=(const ChangeEventStream&) = delete;
+};
+
+// One consumer of a ChangeEventStream, to be used from one thread at a time
+class ChangeEventSubscription {
+private:
+    ChangeEventStream& stream;
+    uint64_t nextSequence; // Guarded by the stream's mutex, like the fields below
+    uint64_t droppedCount;
+    bool lagging;          // Lost events and has not polled since, so publishes do not wait for it
+
+    ChangeEventSubscription(ChangeEventStream& eventStream, uint64_t next);
+
+    friend class ChangeEventStream;
+
+public:
+    ~ChangeEventSubscription();
+
+    // Appends up to maxEvents events, waiting up to `wait` for the first one.
+    // Returns the number appended.
+    size_t poll(std::vector<ChangeEvent>& events, size_t maxEvents = 1024,
+                std::chrono::milliseconds wait = std::chrono::milliseconds(0));
+
+    uint64_t dropped(); // Events lost because this subscriber fell a full ring behind
+
+    ChangeEventSubscription(const ChangeEventSubscription&) = delete;
+    ChangeEventSubscription& operator=(const ChangeEventSubscription&) = delete;
+};
+
+#endif // CHANGE_EVENTS_H
@@ -0,0 +1,115 @@
+#ifndef CHANGE_LOG_H
+#define CHANGE_LOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Kinds of change records. The numeric values are stored in the log, so only append.
+enum class ChangeType : uint8_t {
+    HEARTBEAT = 0,    // No change; written while idle so followers can tell how far behind they are
+    USER_PUT,         // Full user after the change
+    RESOURCE_PUT,     // Full resource after the change
+    RESOURCE_DELETED, // resourceId
+    RENTAL_PUT,       // Full rental after the change
+    BILL_PUT,         // New bill
+    BILLS_ARCHIVED,   // Cutoff of adminArchiveBillsBefore, which is deterministic on the same bills
+    EVENT,            // Typed change event; only in event logs (see ChangeEvents.h)
+    COUNT
+};
+
+// One record of the change log. The body is the entity encoded with WireWriter;
+// System writes and applies it (see System::applyChange).
+struct ChangeRecord {
+    uint64_t sequence;       // 1, 2, 3, ... within one log
+    int64_t timestampMicros; // Primary's system_clock when the record was appended
+    ChangeType type;
+    std::string body;
+
+    ChangeRecord() : sequence(0), timestampMicros(0), type(ChangeType::HEARTBEAT) {}
+};
+
+struct ChangeLogOptions {
+    std::string path;
+    std::chrono::milliseconds flushInterval;     // How often buffered records are written
+    std::chrono::milliseconds heartbeatInterval; // Longest gap between two records
+
+    ChangeLogOptions(const std::string& filePath = "changes.wal")
+        : path(filePath), flushInterval(5), heartbeatInterval(100) {}
+};
+
+// Write-ahead change log of the primary System, tailed by replicas.
+//
+// The file starts with the 8-byte magic "CRRSWAL1" and is recreated on every
+// start. Each record is
+//   uint32 length, uint32 CRC-32, uint64 sequence, int64 timestampMicros, uint8 type, body
+// (big-endian; length and CRC cover everything after the CRC). append() only
+// copies the record into a buffer; a background thread writes the buffer every
+// flushInterval and a heartbeat when nothing was written for heartbeatInterval.
+// Records reach the page cache, not the disk: the log feeds replicas on the same
+// machine and is not meant to survive a power loss.
+class ChangeLogWriter {
+private:
+    ChangeLogOptions options;
+    std::FILE* file;
+
+    std::mutex mutex; // Guards the fields below
+    std::condition_variable wakeWriter;
+    std::condition_variable progress;
+    std::string pending;     // Encoded records not yet written
+    uint64_t nextSequence;
+    uint64_t writtenSequence; // Last sequence handed to the file
+    bool stopping;
+    std::thread writer;
+
+    void encode(ChangeType type, const std::string& body); // Called with mutex held
+    void run();
+
+public:
+    explicit ChangeLogWriter(const ChangeLogOptions& logOptions = ChangeLogOptions());
+    ~ChangeLogWriter(); // Writes everything still buffered
+
+    // Thread-safe. Returns the record's sequence number.
+    uint64_t append(ChangeType type, const std::string& body);
+
+    // Blocks until every record appended before the call has been written
+    void flush();
+
+    bool isOpen() const { return file != nullptr; }
+    uint64_t lastSequence();
+
+    ChangeLogWriter(const ChangeLogWriter&) = delete;
+    ChangeLogWriter& operator=(const ChangeLogWriter&) = delete;
+};
+
+// Follows a change log that another thread or process is writing.
+// Partially written records are left for the next call.
+class ChangeLogReader {
+private:
+    std::string path;
+    int fd;
+    uint64_t offset;       // File position of buffer[0]
+    std::string buffer;    // Bytes read but not yet parsed
+    uint64_t lastSequence;
+
+    bool open(std::string& error);
+
+public:
+    explicit ChangeLogReader(const std::string& logPath);
+    ~ChangeLogReader();
+
+    // Appends the complete records written since the last call (at most maxRecords).
+    // A log that does not exist yet simply has no records. Returns false if the
+    // log is damaged or was replaced by a new one, e.g. because the primary restarted.
+    bool poll(std::vector<ChangeRecord>& records, std::string& error, size_t maxRecords = 4096);
+
+    ChangeLogReader(const ChangeLogReader&) = delete;
+    ChangeLogReader& operator=(const ChangeLogReader&) = delete;
+};
+
+#endif // CHANGE_LOG_H
@@ -1 +1,49 @@
-// Empty Exception.h file
+#ifndef EXCEPTION_H
+#define EXCEPTION_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Why a System call failed. Expected business outcomes are reported this way
+// (see System::lastError) rather than thrown, so rejecting a request stays cheap.
+enum class ErrorCode : uint8_t {
+    OK = 0,
+    NOT_LOGGED_IN,
+    PERMISSION_DENIED,
+    NOT_FOUND,
+    ALREADY_EXISTS,
+    INVALID_ARGUMENT,
+    INVALID_STATE,        // E.g. approving a rental that is not pending
+    RESOURCE_BUSY,        // Resource is allocated or part of an open rental
+    INSUFFICIENT_BALANCE,
+    ACCOUNT_INACTIVE,     // Suspended user
+    AUTHENTICATION_FAILED,
+    QUOTA_EXCEEDED,       // Rental limits of the user or role (see RentalQuota)
+    RATE_LIMITED,         // Too many rental requests in a short time
+    COUNT
+};
+
+const char* errorCodeName(ErrorCode code); // "resource_busy", ...
+
+// Technical faults: broken invariants and damaged data. These are bugs or
+// corruption rather than outcomes a caller can fix, so they are thrown and
+// caught at the outermost layer (the request server, main).
+class RentalSystemException : public std::runtime_error {
+public:
+    explicit RentalSystemException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Stored or decoded data failed validation, e.g. a truncated archive segment
+class CorruptDataException : public RentalSystemException {
+public:
+    explicit CorruptDataException(const std::string& message) : RentalSystemException(message) {}
+};
+
+// An internal invariant does not hold, e.g. an index points at a missing entity
+class InternalErrorException : public RentalSystemException {
+public:
+    explicit InternalErrorException(const std::string& message) : RentalSystemException(message) {}
+};
+
+#endif // EXCEPTION_H
@@ -0,0 +1,108 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "Rental.h"
+#include "Bill.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <future>
+#include <cstdint>
+
+class System;
+
+enum class ExportFormat {
+    CSV,    // Header line plus one comma separated line per record
+    JSONL,  // One JSON object per line
+    BINARY  // "CRRX" header, then fixed-width little-endian fields and length-prefixed strings
+};
+
+// Optional filters; by default everything is exported
+struct ExportFilter {
+    std::chrono::system_clock::time_point from; // Rentals: request time, bills: bill date (inclusive)
+    std::chrono::system_clock::time_point to;
+    bool filterRentalStatus;
+    RentalStatus rentalStatus;
+    int paidStatus; // Bills only: -1 = any, 0 = unpaid, 1 = paid
+
+    ExportFilter()
+        : from(std::chrono::system_clock::time_point::min()), to(std::chrono::system_clock::time_point::max()),
+          filterRentalStatus(false), rentalStatus(RentalStatus::PENDING_APPROVAL), paidStatus(-1) {}
+};
+
+struct ExportReport {
+    bool success;
+    size_t records;
+    uint64_t bytes;
+    double seconds;
+    std::string error;
+
+    ExportReport() : success(false), records(0), bytes(0), seconds(0.0) {}
+};
+
+// Fixed-size output buffer in front of a stream. Numbers and timestamps are
+// formatted into it directly so writing a record does not allocate.
+class BufferedWriter {
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used;
+    uint64_t totalBytes;
+
+public:
+    explicit BufferedWriter(std::ostream& stream, size_t capacity = 1 << 16);
+    ~BufferedWriter();
+
+    void write(const char* data, size_t size);
+    void write(const std::string& text);
+    void writeChar(char c);
+    void writeInteger(long long value);
+    void writeAmount(double value);                                  // Two decimals
+    void writeTimestamp(std::chrono::system_clock::time_point tp);   // ISO 8601, UTC
+    void writeCsvField(const std::string& text);                     // Quoted only when needed
+    void writeJsonString(const std::string& text);
+    void writeRaw64(uint64_t value);                                 // Little-endian
+    void writeRaw16(uint16_t value);
+    bool flush();
+
+    uint64_t bytesWritten() const;
+};
+
+// Streams rentals and bills out of a System for analytics.
+//
+// Records are copied out of System in fixed-size chunks while holding its
+// mutex, so memory use does not depend on the number of records and other
+// threads only wait for one chunk at a time. The set of records is fixed when
+// the export starts: records created later are not included. A rental whose
+// status changes during the export is written as it was when its chunk was copied.
+// Records a transaction rolls back before their chunk is copied are left out.
+// If the System has snapshots enabled, records are read from one snapshot
+// instead, without the lock, and every record is written as of the start.
+//
+// Exports cover every user, so the System's current user must be an admin
+// when one is started; otherwise nothing is written and the System's
+// lastError() is PERMISSION_DENIED.
+class Exporter {
+private:
+    System& system;
+    size_t chunkSize; // Records copied per lock acquisition
+
+    bool permitted(const char* what, ExportReport& report); // Takes the System lock
+    ExportReport writeRentals(std::ostream& out, ExportFormat format, const ExportFilter& filter);
+    ExportReport writeBills(std::ostream& out, ExportFormat format, const ExportFilter& filter);
+
+public:
+    explicit Exporter(System& sys, size_t recordsPerChunk = 4096);
+
+    ExportReport exportRentals(std::ostream& out, ExportFormat format, const ExportFilter& filter = ExportFilter());
+    ExportReport exportBills(std::ostream& out, ExportFormat format, const ExportFilter& filter = ExportFilter());
+
+    // Run an export to a file on a background thread; the admin check is made before it starts
+    std::future<ExportReport> exportRentalsAsync(const std::string& path, ExportFormat format,
+                                                 const ExportFilter& filter = ExportFilter());
+    std::future<ExportReport> exportBillsAsync(const std::string& path, ExportFormat format,
+                                               const ExportFilter& filter = ExportFilter());
+};
+
+#endif // EXPORTER_H
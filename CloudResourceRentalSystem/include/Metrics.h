@@ -0,0 +1,168 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Public System operations that are timed
+enum class ApiMethod {
+    REGISTER_USER, LOGIN_USER, LOGOUT_USER, GET_CURRENT_USER, SWITCH_TO_USER, DISPLAY_ALL_USERS,
+    UPDATE_CURRENT_USER_NAME, UPDATE_CURRENT_USER_PASSWORD,
+    ADD_RESOURCE, FIND_RESOURCE, DISPLAY_ALL_RESOURCES, FIND_RESOURCES_BY_TYPE,
+    REQUEST_RESOURCE_RENTAL, GET_USER_RENTALS, FIND_RENTAL, DISPLAY_USER_RENTALS, CANCEL_RENTAL_REQUEST,
+    ADMIN_MODIFY_RESOURCE, ADMIN_DELETE_RESOURCE,
+    ADMIN_DISPLAY_ALL_USERS, ADMIN_ADD_USER, ADMIN_MODIFY_USER, ADMIN_SET_USER_STATUS,
+    ADMIN_DISPLAY_PENDING_RENTALS, ADMIN_APPROVE_RENTAL, ADMIN_REJECT_RENTAL, ADMIN_DISPLAY_ALL_RENTALS,
+    PROCESS_RENTAL_COMPLETION, DISPLAY_USER_BILLS, ADMIN_DISPLAY_ALL_BILLS,
+    ADMIN_ARCHIVE_BILLS_BEFORE, FIND_USER_BILLS, FIND_BILLS_BY_DATE,
+    LIST_USER_RENTALS, LIST_USER_BILLS, LIST_RESOURCES, ADMIN_LIST_USERS, ADMIN_LIST_RENTALS, ADMIN_LIST_BILLS,
+    LOGIN_USER_ASYNC, // Only the submission; the hashing runs on the login pool
+    ADMIN_DECOMMISSION_RESOURCES, CHECK_OVERDUE_RENTALS,
+    ADMIN_SET_ROLE_QUOTA, ADMIN_SET_USER_QUOTA, ADMIN_CLEAR_USER_QUOTA, GET_QUOTA_USAGE,
+    ADMIN_SET_LOW_BALANCE_HORIZON, ADMIN_USERS_GOING_NEGATIVE, CHECK_LOW_BALANCE_ALERTS,
+    READ_NOTIFICATIONS, CLEAR_NOTIFICATIONS, ADMIN_SET_OVERDUE_AUTO_COMPLETE,
+    ADMIN_OPEN_SNAPSHOT, BEGIN_TRANSACTION, COMMIT_TRANSACTION, ROLLBACK_TRANSACTION,
+    APPLY_CHANGE, // One change log record on a replica
+    COUNT
+};
+
+// Business event counters
+enum class MetricCounter {
+    LOGIN_SUCCEEDED,
+    LOGIN_FAILED,
+    USER_REGISTERED,
+    PERMISSION_DENIED,   // An admin-only operation was attempted without admin privileges
+    RENTAL_REQUESTED,
+    RENTAL_APPROVED,
+    RENTAL_REJECTED,
+    RENTAL_CANCELLED,
+    RENTAL_COMPLETED,
+    BILL_CREATED,
+    BILLED_CENTS,        // Sum of all bill amounts, in cents
+    BILL_ARCHIVED,
+    AUDIT_RECORDS_WRITTEN,
+    AUDIT_RECORDS_DROPPED, // Ring full or write failed
+    CHANGES_LOGGED,        // Records appended to the change log of a primary
+    CHANGES_APPLIED,       // Change log records applied by a replica
+    CHANGE_EVENTS_PUBLISHED,
+    CHANGE_EVENTS_DROPPED, // Lost by subscribers that fell a full ring behind
+    RENTALS_OVER_QUOTA,    // Requests refused by a rental quota
+    RENTALS_RATE_LIMITED,  // Requests refused by the request rate limit
+    RENTALS_SUSPENDED,     // Paused or terminated because their user was suspended
+    LOW_BALANCE_ALERTS,    // Users notified that their balance is projected to run out
+    RENTALS_OVERDUE,       // Found past their end time by checkOverdueRentals
+    RENTALS_OVERDUE_ENDED, // Overdue rentals completed or stopped since
+    RENTALS_OVERDUE_SECONDS, // Time those held their resource past their end time
+    COUNT
+};
+
+// Current values, set by their owner, as opposed to the running totals above
+enum class MetricGauge {
+    REPLICATION_LAG_MICROS,       // Age of the newest change log record a replica has read
+    REPLICATION_APPLIED_SEQUENCE, // Sequence number of that record
+    COUNT
+};
+
+// Latency histogram with log-linear buckets: values below 4 ns get one bucket
+// each, every power of two above that is split into 4 equal buckets, so a
+// bucket's bounds are within 25% of any value in it.
+struct LatencyHistogram {
+    static const int SUB_BUCKET_BITS = 2;
+    static const int BUCKET_COUNT = 160; // Up to 2^40 ns (about 18 minutes); larger values use the last bucket
+
+    std::vector<uint64_t> buckets;
+    uint64_t count;
+    uint64_t sumNanos;
+
+    LatencyHistogram() : buckets(BUCKET_COUNT, 0), count(0), sumNanos(0) {}
+
+    static int bucketFor(uint64_t nanos);
+    static uint64_t bucketUpperBound(int bucket); // Largest value counted in the bucket
+
+    // Upper bound of the bucket containing the given quantile (0..1), in nanoseconds
+    uint64_t quantileNanos(double quantile) const;
+};
+
+// Point-in-time copy of all metrics, merged over every thread
+struct MetricsSnapshot {
+    std::vector<uint64_t> counters;          // Indexed by MetricCounter
+    std::vector<LatencyHistogram> latencies; // Indexed by ApiMethod
+    std::vector<int64_t> gauges;             // Indexed by MetricGauge
+
+    MetricsSnapshot()
+        : counters(static_cast<size_t>(MetricCounter::COUNT), 0),
+          latencies(static_cast<size_t>(ApiMethod::COUNT)),
+          gauges(static_cast<size_t>(MetricGauge::COUNT), 0) {}
+
+    uint64_t counter(MetricCounter c) const { return counters[static_cast<size_t>(c)]; }
+    int64_t gauge(MetricGauge g) const { return gauges[static_cast<size_t>(g)]; }
+    const LatencyHistogram& latency(ApiMethod m) const { return latencies[static_cast<size_t>(m)]; }
+};
+
+// Process-wide metrics registry.
+// Every thread updates its own block of counters without atomic read-modify-write
+// or locks; readers merge all blocks. Totals of exited threads are kept.
+// Gauges are single process-wide values; the last setGauge wins.
+class Metrics {
+public:
+    static void increment(MetricCounter counter, uint64_t amount = 1);
+    static void recordLatency(ApiMethod method, uint64_t nanos);
+    static void setGauge(MetricGauge gauge, int64_t value);
+
+    static MetricsSnapshot snapshot();
+    static void reset(); // Zeroes every thread's counters; gauges keep their values
+
+    // Prometheus text exposition format (version 0.0.4)
+    static void writePrometheus(std::ostream& out);
+    static void writePrometheus(std::ostream& out, const MetricsSnapshot& snapshot);
+
+    static const char* methodName(ApiMethod method);
+    static const char* counterName(MetricCounter counter);
+};
+
+// Records the duration of the enclosing scope as one call of an API method
+class ApiTimer {
+private:
+    ApiMethod method;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ApiTimer(ApiMethod m) : method(m), start(std::chrono::steady_clock::now()) {}
+    ~ApiTimer() {
+        Metrics::recordLatency(method, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
+
+    ApiTimer(const ApiTimer&) = delete;
+    ApiTimer& operator=(const ApiTimer&) = delete;
+};
+
+// Background thread that rewrites a metrics file at a fixed interval.
+// The file is written to "<path>.tmp" and renamed, so readers never see a partial dump.
+class MetricsDumper {
+private:
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+    bool dumpNow();
+
+public:
+    MetricsDumper(const std::string& filePath, std::chrono::milliseconds dumpInterval);
+    ~MetricsDumper(); // Writes a final dump and stops the thread
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+};
+
+#endif // METRICS_H
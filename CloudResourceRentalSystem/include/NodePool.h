@@ -0,0 +1,83 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Arena of small fixed-size blocks for the nodes of hash indexes.
+//
+// Blocks are carved out of 64 KiB chunks and recycled through one free list
+// per size class, so inserting into an index costs a pointer pop instead of a
+// malloc once the pool has warmed up. Chunks are only released when the pool
+// is destroyed. Not synchronized: each pool belongs to one System, which is
+// externally locked.
+class NodePool {
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* cursor;       // Unused tail of the newest chunk
+    size_t remaining;
+    FreeBlock* freeLists[16];
+
+public:
+    static const size_t GRANULE = 16;  // Block sizes are multiples of this; also the alignment
+    static const size_t MAX_BLOCK = 256; // Larger requests go to operator new
+
+    NodePool();
+
+    void* allocate(size_t bytes);
+    void deallocate(void* block, size_t bytes);
+
+    size_t chunkCount() const { return chunks.size(); }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+};
+
+// Standard allocator drawing single nodes from a NodePool. Arrays (hash bucket
+// tables) and over-aligned types still use operator new, as does an allocator
+// without a pool.
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    NodePool* pool;
+
+    PoolAllocator() : pool(nullptr) {}
+    explicit PoolAllocator(NodePool* nodePool) : pool(nodePool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t n) {
+        if (pooled(n)) return static_cast<T*>(pool->allocate(sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (pooled(n)) {
+            pool->deallocate(p, sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+private:
+    bool pooled(size_t n) const {
+        return pool && n == 1 && sizeof(T) <= NodePool::MAX_BLOCK && alignof(T) <= NodePool::GRANULE;
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) { return a.pool == b.pool; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) { return a.pool != b.pool; }
+
+#endif // NODE_POOL_H
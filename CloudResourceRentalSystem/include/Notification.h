@@ -1 +1,39 @@
-// Empty Notification.h file
+#ifndef NOTIFICATION_H
+#define NOTIFICATION_H
+
+#include <string>
+#include <chrono>
+
+enum class NotificationPriority {
+    NORMAL,
+    HIGH // Shown again at every login until read
+};
+
+// A message for one user, kept by System until the user clears it
+class Notification {
+private:
+    std::string userId;
+    std::string message;
+    NotificationPriority priority;
+    std::chrono::system_clock::time_point createdAt;
+    bool isRead;
+
+public:
+    // Constructor
+    Notification(std::string uId, std::string text, NotificationPriority level);
+
+    // Getters
+    const std::string& getUserId() const;
+    const std::string& getMessage() const;
+    NotificationPriority getPriority() const;
+    std::chrono::system_clock::time_point getCreatedAt() const;
+    bool getIsRead() const;
+
+    // Setters
+    void markRead();
+
+    // Display and helper functions
+    void displayNotification() const;
+};
+
+#endif // NOTIFICATION_H
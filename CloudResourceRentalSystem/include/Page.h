@@ -0,0 +1,32 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Listings are sorted by creation order (registration, request or billing time)
+enum class PageOrder {
+    OLDEST_FIRST,
+    NEWEST_FIRST
+};
+
+// Parameters of a paginated listing call
+struct PageRequest {
+    size_t pageSize;
+    PageOrder order;
+    std::string cursor; // Empty for the first page, otherwise Page::nextCursor of the previous page
+
+    PageRequest(size_t size = 20, PageOrder pageOrder = PageOrder::OLDEST_FIRST, const std::string& pageCursor = "")
+        : pageSize(size), order(pageOrder), cursor(pageCursor) {}
+};
+
+// One page of results. The pointers refer into System's containers and stay
+// valid until the next call that adds or removes entities.
+template <typename T>
+struct Page {
+    std::vector<const T*> items;
+    std::string nextCursor; // Opaque continuation token, empty when there are no more items
+};
+
+#endif // PAGE_H
@@ -0,0 +1,47 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include <cstdint>
+#include <string>
+
+// A stored password: raw salt and hash bytes plus the cost they were made with
+struct PasswordCredential {
+    std::string salt;
+    std::string hash;
+    uint32_t iterations;
+
+    PasswordCredential() : iterations(0) {}
+};
+
+// Salted password hashing with PBKDF2-HMAC-SHA256 (RFC 8018).
+// The iteration count is the cost; it is stored with each credential so it can be raised later.
+class PasswordHasher {
+public:
+    static const size_t SALT_BYTES = 16;
+    static const size_t HASH_BYTES = 32;
+    static const uint32_t DEFAULT_ITERATIONS = 100000;
+
+    // Cost used for new hashes. Users whose stored cost differs are rehashed on
+    // their next successful login. Lower it only for tests and benchmarks.
+    static uint32_t defaultIterations();
+    static void setDefaultIterations(uint32_t iterations);
+
+    static PasswordCredential create(const std::string& password); // New salt, default cost
+    static bool verify(const PasswordCredential& credential, const std::string& password);
+
+    static std::string generateSalt(); // From std::random_device
+    static std::string derive(const std::string& password, const std::string& salt, uint32_t iterations);
+
+    // Compares without an early exit, so timing does not reveal the matching prefix
+    static bool constantTimeEquals(const std::string& a, const std::string& b);
+
+    // Text form for provisioning pre-hashed users: "pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>"
+    static std::string encode(const PasswordCredential& credential);
+    static bool decode(const std::string& text, PasswordCredential& credential); // False if malformed
+
+    static std::string sha256(const std::string& data); // Exposed for testing against known vectors
+    static std::string toHex(const std::string& bytes);
+    static bool fromHex(const std::string& hex, std::string& bytes); // False on odd length or a non-hex digit
+};
+
+#endif // PASSWORD_HASHER_H
@@ -0,0 +1,104 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+
+// Binary request/response protocol spoken by RentalServer.
+//
+// Every message is a frame: a uint32 payload length followed by the payload.
+// Request payload:  uint32 requestId, uint8 RequestOp, then the op's arguments.
+// Response payload: uint32 requestId, uint8 ResponseStatus, then the op's results
+//                   (OK) or a single string with the error message (ERROR).
+// Integers are big-endian, strings are a uint32 length followed by the bytes,
+// amounts are IEEE doubles sent as their uint64 bit pattern.
+//
+// Clients may pipeline: send any number of requests without waiting. Responses
+// on one connection come back in request order; requestId is echoed back so a
+// client can match them anyway.
+
+const uint32_t PROTOCOL_MAX_FRAME = 1 << 20; // Larger frames close the connection
+
+enum class RequestOp : uint8_t {
+    PING = 1,              // -> (nothing)
+    REGISTER_USER,         // username, password, role u8, realName
+    LOGIN,                 // username, password -> userId
+    LOGOUT,                //
+    WHOAMI,                // -> userId, username, role u8, status u8, balance
+    UPDATE_NAME,           // newName
+    UPDATE_PASSWORD,       // newPassword
+    FIND_RESOURCE,         // resourceId -> resource
+    LIST_RESOURCES,        // cursor, pageSize u32 -> count u32, resource..., nextCursor
+    REQUEST_RENTAL,        // resourceId, hours u32 -> rentalId
+    CANCEL_RENTAL,         // rentalId
+    LIST_MY_RENTALS,       // cursor, pageSize u32 -> count u32, rental..., nextCursor
+    LIST_MY_BILLS,         // cursor, pageSize u32 -> count u32, bill..., nextCursor
+    ADMIN_ADD_RESOURCE,    // resourceId, type u8, name, pricePerHour
+    ADMIN_DELETE_RESOURCE, // resourceId
+    ADMIN_SET_USER_STATUS, // username, status u8
+    ADMIN_APPROVE_RENTAL,  // rentalId
+    ADMIN_REJECT_RENTAL,   // rentalId, reason
+    ADMIN_COMPLETE_RENTAL, // rentalId
+    ADMIN_METRICS,         // -> Prometheus text
+    ADMIN_LIST_RENTALS,    // cursor, pageSize u32 -> count u32, rental..., nextCursor (every user's)
+    ADMIN_LIST_BILLS,      // cursor, pageSize u32 -> count u32, bill..., nextCursor (every user's, hot tier)
+    COUNT
+};
+// Records inside results:
+//   resource: resourceId, type u8, name, pricePerHour, status u8
+//   rental:   rentalId, resourceId, status u8, totalCost
+//   bill:     billId, rentalId, amount, paid u8
+// Enums are sent as their declaration index (UserRole, UserStatus, ResourceType, ...).
+
+enum class ResponseStatus : uint8_t {
+    OK = 0,
+    ERROR = 1
+};
+
+const char* requestOpName(RequestOp op);
+bool requestOpIsReadOnly(RequestOp op); // Served by read-only replicas
+bool requestOpFromName(const std::string& name, RequestOp& op);
+
+// Appends fields to a payload
+class WireWriter {
+private:
+    std::string buffer;
+
+public:
+    WireWriter& u8(uint8_t value);
+    WireWriter& u32(uint32_t value);
+    WireWriter& u64(uint64_t value);
+    WireWriter& f64(double value);
+    WireWriter& str(const std::string& value);
+
+    const std::string& data() const { return buffer; }
+    std::string frame() const; // Length prefix followed by the payload
+};
+
+// Reads fields from a payload. After the first short read every further read
+// fails too, so a request can be decoded in full and checked once with ok().
+class WireReader {
+private:
+    const char* cursor;
+    const char* end;
+    bool valid;
+
+    bool take(size_t size);
+
+public:
+    WireReader(const char* data, size_t size) : cursor(data), end(data + size), valid(true) {}
+
+    uint8_t u8();
+    uint32_t u32();
+    uint64_t u64();
+    double f64();
+    std::string str();
+
+    bool ok() const { return valid; }
+    bool atEnd() const { return cursor == end; }
+};
+
+// Reads a big-endian uint32 from 4 bytes, e.g. a frame length
+uint32_t readU32(const char* bytes);
+
+#endif // PROTOCOL_H
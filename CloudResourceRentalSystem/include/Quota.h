@@ -0,0 +1,51 @@
+#ifndef QUOTA_H
+#define QUOTA_H
+
+#include <chrono>
+#include <cstdint>
+
+// Limits on a user's rental requests, set per role and optionally overridden
+// per user (see System::adminSetRoleQuota). A zero field means no limit.
+struct RentalQuota {
+    uint32_t maxOpenRentals;          // Pending plus approved/active rentals
+    uint32_t maxPending;              // Requests waiting for approval
+    double maxHoursPerPeriod;         // Rental hours requested per period
+    std::chrono::hours period;
+    double requestsPerSecond;         // Token bucket refill rate
+    double burst;                     // Token bucket size; at least 1 when rate limited
+
+    RentalQuota()
+        : maxOpenRentals(0), maxPending(0), maxHoursPerPeriod(0.0), period(24 * 7),
+          requestsPerSecond(0.0), burst(0.0) {}
+};
+
+// Token bucket: holds up to `burst` tokens, refilled continuously at `rate` per second
+class TokenBucket {
+private:
+    double tokens;
+    std::chrono::steady_clock::time_point refilled;
+    bool started;
+
+public:
+    TokenBucket() : tokens(0.0), started(false) {}
+
+    // Takes one token if there is one
+    bool take(double rate, double burst, std::chrono::steady_clock::time_point now);
+};
+
+// A user's usage against its quota, updated on every rental transition so
+// admission never scans the user's rentals
+struct QuotaUsage {
+    uint32_t pending;  // PENDING_APPROVAL rentals
+    uint32_t open;     // APPROVED or ACTIVE rentals
+    double periodHours; // Hours requested since periodStart
+    std::chrono::system_clock::time_point periodStart;
+    TokenBucket requests;
+
+    QuotaUsage() : pending(0), open(0), periodHours(0.0) {}
+
+    // Starts a new period if the current one is over
+    void roll(std::chrono::hours period, std::chrono::system_clock::time_point now);
+};
+
+#endif // QUOTA_H
@@ -13,7 +13,9 @@ enum class RentalStatus {
     REJECTED,
     ACTIVE,
     COMPLETED,
-    CANCELLED
+    CANCELLED,
+    PAUSED,     // Stopped by a suspension of its user; pending approval again on reactivation
+    OVERDUE     // Past its end time and not completed yet; still holds its resource
 };
 
 class Rental {
@@ -34,9 +36,9 @@ public:
            std::chrono::system_clock::time_point eTime);
 
     // Getters
-    std::string getRentalId() const;
-    std::string getUserId() const;
-    std::string getResourceId() const;
+    const std::string& getRentalId() const;
+    const std::string& getUserId() const;
+    const std::string& getResourceId() const;
     std::chrono::system_clock::time_point getStartTime() const;
     std::chrono::system_clock::time_point getEndTime() const;
     std::chrono::system_clock::time_point getRequestTime() const;
@@ -48,6 +50,7 @@ public:
     void setTotalCost(double cost);
     void setStartTime(std::chrono::system_clock::time_point sTime); // For admin approval/adjustment
     void setEndTime(std::chrono::system_clock::time_point eTime);   // For admin approval/adjustment
+    void setRequestTime(std::chrono::system_clock::time_point rTime); // For copies restored from a change log
 
     // Helper and display functions
     std::string rentalStatusToString() const; // Helper to convert enum to string
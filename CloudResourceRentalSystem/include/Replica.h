@@ -0,0 +1,67 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+#include "ChangeLog.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class System;
+
+// Keeps a System in step with a primary by tailing the primary's change log
+// (see ChangeLogWriter), so reporting queries can run against a copy.
+//
+// A background thread polls the log every pollInterval and applies new
+// records while holding the System's mutex, in batches so readers are not
+// starved. Lag is the age of the newest record read, measured against the
+// primary's timestamp; because the primary writes heartbeats while idle it
+// stays bounded by heartbeatInterval plus the flush and poll intervals when
+// the replica keeps up. It is published as the replication lag gauge.
+//
+// The replica never writes to its System otherwise; serve it read-only. If the
+// log is damaged or replaced (the primary restarted) replication stops and
+// failed() reports why; the replica has to be restarted from an empty System.
+class Replica {
+private:
+    System& system;
+    ChangeLogReader reader;
+    std::chrono::milliseconds pollInterval;
+    std::atomic<uint64_t> appliedSequence;
+    std::atomic<int64_t> newestTimestampMicros; // Primary's clock, 0 before the first record
+
+    std::mutex mutex; // Guards the fields below
+    std::condition_variable wakeUp;
+    bool stopping;
+    std::string failure;
+    std::thread worker;
+
+    bool pollOnce(size_t& recordsRead); // False once replication has failed
+    void run();
+
+public:
+    static const size_t APPLY_BATCH = 1024; // Records applied per System lock
+
+    Replica(System& sys, const std::string& logPath,
+            std::chrono::milliseconds interval = std::chrono::milliseconds(2));
+    ~Replica(); // Stops the thread if it was started
+
+    // Starts the polling thread
+    void start();
+
+    // Applies everything written so far on the calling thread; for replicas
+    // without a thread, e.g. a nightly reporting job. Returns false on failure.
+    bool catchUp();
+
+    uint64_t sequence() const;          // Last record applied
+    int64_t lagMicros() const;          // -1 before the first record
+    bool failed(std::string& reason);
+
+    Replica(const Replica&) = delete;
+    Replica& operator=(const Replica&) = delete;
+};
+
+#endif // REPLICA_H
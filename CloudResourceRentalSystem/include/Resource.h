@@ -15,7 +15,8 @@ enum class ResourceType {
 
 enum class ResourceStatus {
     IDLE,
-    IN_USE
+    IN_USE,
+    RETIRED // Deleted; a tombstone in System's catalog until it is compacted
 };
 
 class Resource {
@@ -26,6 +27,7 @@ private:
     std::map<std::string, std::string> specs;
     ResourceStatus status;
     double pricePerHour;
+    size_t catalogSequence; // Set by System when appended: increases in catalog order and survives compaction
 
 public:
     // Constructor
@@ -33,19 +35,21 @@ public:
              std::map<std::string, std::string> rSpecs, double rPricePerHour);
 
     // Getters
-    std::string getResourceId() const;
+    const std::string& getResourceId() const;
     ResourceType getType() const;
-    std::string getName() const;
+    const std::string& getName() const;
     std::string getSpec(const std::string& key) const; // Get a specific spec
-    std::map<std::string, std::string> getAllSpecs() const; // Get all specs
+    const std::map<std::string, std::string>& getAllSpecs() const; // Get all specs
     ResourceStatus getStatus() const;
     double getPricePerHour() const;
+    size_t getCatalogSequence() const;
 
     // Setters
     void setStatus(ResourceStatus newStatus);
     void setPricePerHour(double newPrice); // For admin use
     void setName(const std::string& newName); // For admin use
     void setSpecs(const std::map<std::string, std::string>& newSpecs); // For admin use
+    void setCatalogSequence(size_t sequence); // For System
 
     // Display and helper functions
     void displayResourceInfo() const;
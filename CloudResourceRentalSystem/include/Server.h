@@ -0,0 +1,137 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "System.h"
+#include "Protocol.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ServerOptions {
+    size_t dispatchWorkers;    // Threads that run requests against System
+    size_t maxPipelined;       // Requests queued per connection before it stops being read
+    size_t maxOutputBytes;     // Unsent response bytes per connection before it stops being read
+    size_t maxConnections;
+    bool readOnly;             // Reject requests that change state, e.g. on a replica
+    std::chrono::seconds overdueCheckInterval; // System::checkOverdueRentals runs this often; zero for never
+
+    ServerOptions()
+        : dispatchWorkers(4), maxPipelined(256), maxOutputBytes(4 << 20), maxConnections(10000), readOnly(false),
+          overdueCheckInterval(60) {}
+};
+
+struct ServerStats {
+    uint64_t connectionsAccepted;
+    uint64_t connectionsOpen;
+    uint64_t requestsHandled;
+    uint64_t protocolErrors; // Connections closed for malformed or oversized frames
+};
+
+// Serves System over the binary protocol in Protocol.h.
+//
+// One thread runs an epoll loop that accepts connections, reads frames and
+// writes responses; it never touches System. Decoded requests are queued on
+// their connection and a small pool of dispatch workers executes them while
+// holding System::getMutex(). Each connection has at most one request in a
+// worker at a time, so its requests run in order and its session (the user it
+// logged in as) is restored with switchToUser before each one. A login is
+// handed to System's login pool and answered from there, so password hashing
+// does not hold a dispatch worker. Finished responses are handed back to the
+// loop through an eventfd. The loop also times the overdue-rental check, which
+// a dispatch worker runs like a request without a session; a read-only server
+// leaves it to its primary.
+class Server {
+private:
+    struct Connection {
+        uint64_t id;
+        int fd;
+        // Loop thread only
+        std::string input;
+        std::string output;
+        size_t outputOffset;
+        size_t inFlight;       // Requests queued or running whose response has not come back
+        uint32_t events;       // Currently registered epoll events
+        // Guarded by Server::queueMutex
+        std::deque<std::string> requests;
+        bool scheduled;        // A dispatch task owns this connection
+        // Dispatch task only (at most one runs per connection)
+        std::string sessionUserId;
+
+        Connection(uint64_t connectionId, int socket)
+            : id(connectionId), fd(socket), outputOffset(0), inFlight(0), events(0), scheduled(false) {}
+    };
+    typedef std::shared_ptr<Connection> ConnectionPtr;
+
+    System& system;
+    ServerOptions options;
+    std::vector<int> listeners;
+    std::vector<std::string> unixPaths; // Unlinked on destruction
+    int epollFd;
+    int wakeFd;                         // eventfd: responses ready or stop requested
+    std::atomic<bool> stopping;
+    uint64_t nextConnectionId;
+    std::map<uint64_t, ConnectionPtr> connections; // Loop thread only
+    std::chrono::steady_clock::time_point nextOverdueCheck; // Loop thread only
+    std::atomic<bool> overdueCheckRunning; // At most one is queued or running
+
+    std::mutex queueMutex;
+    std::deque<std::pair<uint64_t, std::string>> finished; // Encoded response frames, guarded by queueMutex
+    std::vector<ConnectionPtr> resumed; // Scheduled connections the loop dispatches again after a login, ditto
+
+    std::mutex loginMutex;
+    std::condition_variable loginsDone;
+    size_t pendingLogins; // Logins on System's pool that will still call back, guarded by loginMutex
+
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> openConnections;
+    std::atomic<uint64_t> handled;
+    std::atomic<uint64_t> protocolErrors;
+
+    std::unique_ptr<ThreadPool> dispatchPool; // Declared last so it is destroyed first
+
+    bool addListener(int fd, std::string& error);
+    void acceptConnections(int listener);
+    void readFrom(const ConnectionPtr& connection);
+    bool parseFrames(const ConnectionPtr& connection); // False on a protocol error
+    void writeTo(const ConnectionPtr& connection);
+    void updateEvents(const ConnectionPtr& connection);
+    void closeConnection(const ConnectionPtr& connection);
+    void deliverFinished();
+    void signalWake();
+    int untilOverdueCheck(); // epoll_wait timeout in milliseconds; starts the check when it is due
+    void checkOverdueRentals(); // Runs on a dispatch worker
+
+    void enqueue(const ConnectionPtr& connection, std::string payload);
+    void dispatchNext(ConnectionPtr connection);                        // Runs on a dispatch worker
+    // Sets the response payload, or returns false if a login will deliver it later
+    bool execute(const ConnectionPtr& connection, const std::string& payload, std::string& response);
+    void startLogin(const ConnectionPtr& connection, uint32_t requestId, const std::string& username,
+                    const std::string& password);
+    // Hands a response to the loop; true if the connection has another request queued and stays scheduled
+    bool finishRequest(const ConnectionPtr& connection, const std::string& response, bool resumeOnLoop);
+
+public:
+    Server(System& sys, const ServerOptions& serverOptions = ServerOptions());
+    ~Server();
+
+    bool listenUnix(const std::string& path, std::string& error);
+    bool listenTcp(const std::string& address, uint16_t port, std::string& error); // e.g. "127.0.0.1"
+
+    void run();  // Serves until stop() is called
+    void stop(); // Safe from any thread and from signal handlers
+
+    ServerStats stats() const;
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+};
+
+#endif // SERVER_H
@@ -0,0 +1,110 @@
+#ifndef SHARDED_SYSTEM_H
+#define SHARDED_SYSTEM_H
+
+#include "System.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One page of a listing that spans shards. The items are copies, since other
+// threads may change a shard as soon as its lock is released.
+template <typename T>
+struct ShardedPage {
+    std::vector<T> items;
+    std::string nextCursor; // Empty when there are no more items
+};
+
+// Partitioned deployment: N independent System instances ("shards") in one
+// process, each behind its own mutex, so calls for users on different shards
+// run in parallel instead of queueing on one System lock. Unlike System it is
+// thread-safe; callers identify themselves with the session (user ID) returned
+// by login() instead of a current user.
+//
+// Users are placed on shard hash(username) % N. Each shard numbers the IDs it
+// creates so that user_K, rental_K and bill_K belong to shard (K - 1) % N;
+// a user's rentals and bills live on the user's shard, and every call is routed
+// to the shard owning the user or rental it names.
+//
+// The resource catalog is replicated: admin changes are applied to every shard
+// while holding all shard locks. Allocation is owner-partitioned: the copy on
+// shard hash(resourceId) % N holds the authoritative IDLE/IN_USE status.
+// Approving or completing a rental of a resource owned by another shard locks
+// both shards (in index order) and updates the owner's copy as well.
+//
+// Admin accounts are copied to every shard so that an admin session is valid
+// wherever a call is routed; the copies are refreshed when the admin changes
+// and are only used for permission checks. Admin listings walk the shards in
+// order, so items are grouped by shard rather than sorted by creation time.
+class ShardedSystem {
+private:
+    std::vector<std::unique_ptr<System>> shards;
+
+    size_t shardForUserId(const std::string& userId) const;
+    size_t shardForRental(const std::string& rentalId) const;
+
+    bool isAdmin(const std::string& session, const char* action); // Prints the usual error if not
+    void syncAdminCopies(const std::string& userId); // Copies the user from its shard to every other shard
+    bool checkResourceIdle(const std::string& resourceId); // On the owner shard; prints why not
+    std::vector<std::string> heldResources(System& system, const std::string& userId); // Of approved/active rentals
+    void releaseOwnerCopies(size_t home, const std::vector<std::string>& resourceIds); // After a suspension cascade
+    std::vector<std::unique_lock<std::mutex>> lockAll(); // In shard order
+
+    template <typename Call>
+    bool onShard(size_t index, const std::string& session, Call call); // Locked, with the session's user current
+    template <typename T, typename List>
+    ShardedPage<T> collectPage(const std::string& session, const PageRequest& request, List list,
+                               bool skipCopies = false);
+
+public:
+    explicit ShardedSystem(size_t shardCount);
+
+    size_t shardCount() const;
+    size_t shardForUsername(const std::string& username) const;
+    size_t shardForResource(const std::string& resourceId) const;
+    // Direct access for anything not routed here; hold shard(i).getMutex() while using it
+    System& shard(size_t index);
+
+    // Users
+    bool registerUser(const std::string& username, const std::string& password, UserRole role,
+                      const std::string& realName);
+    bool login(const std::string& username, const std::string& password, std::string& session);
+    bool updateName(const std::string& session, const std::string& newName);
+    bool updatePassword(const std::string& session, const std::string& newPassword);
+
+    // Resource catalog (admin only, except findResource)
+    bool addResource(const std::string& session, const Resource& resource);
+    bool modifyResource(const std::string& session, const std::string& resourceId, const std::string& newName,
+                        const std::map<std::string, std::string>& newSpecs, double newPricePerHour);
+    bool deleteResource(const std::string& session, const std::string& resourceId);
+    bool findResource(const std::string& resourceId, Resource& resource); // Copy with the owner's status
+
+    // Rentals
+    bool requestRental(const std::string& session, const std::string& resourceId, int durationHours,
+                       std::string& rentalId);
+    bool cancelRental(const std::string& session, const std::string& rentalId);
+    bool approveRental(const std::string& session, const std::string& rentalId);
+    bool rejectRental(const std::string& session, const std::string& rentalId, const std::string& reason);
+    bool completeRental(const std::string& session, const std::string& rentalId);
+
+    // Admin user management
+    bool modifyUser(const std::string& session, const std::string& targetUsername, const std::string& newRealName,
+                    UserRole newRole, UserStatus newStatus, double newBalance,
+                    SuspensionCascade cascade = SuspensionCascade::PAUSE);
+    bool setUserStatus(const std::string& session, const std::string& targetUsername, UserStatus newStatus,
+                       SuspensionCascade cascade = SuspensionCascade::PAUSE);
+
+    // Listings. Users may list their own rentals and bills, admins anything.
+    ShardedPage<Rental> listUserRentals(const std::string& session, const std::string& userId,
+                                        const PageRequest& request);
+    ShardedPage<Bill> listUserBills(const std::string& session, const std::string& userId,
+                                    const PageRequest& request);
+    ShardedPage<User> adminListUsers(const std::string& session, const PageRequest& request);
+    ShardedPage<Rental> adminListRentals(const std::string& session, const PageRequest& request);
+    ShardedPage<Bill> adminListBills(const std::string& session, const PageRequest& request);
+
+    ShardedSystem(const ShardedSystem&) = delete;
+    ShardedSystem& operator=(const ShardedSystem&) = delete;
+};
+
+#endif // SHARDED_SYSTEM_H
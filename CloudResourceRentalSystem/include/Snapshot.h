@@ -0,0 +1,222 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "User.h"
+#include "Resource.h"
+#include "Rental.h"
+#include "Bill.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Multi-version copies of System's records for reports that must not hold the
+// System lock (see SnapshotStore).
+//
+// Each record has a chain of versions, newest first, stamped with the epoch in
+// which they were written. A reader pinned at epoch E sees, for every record,
+// the newest version with epoch <= E; records created later are skipped and a
+// removal is a version without a value. Writers (System, under its lock)
+// prepend versions and publish the chain head with a release store, so readers
+// walk chains without locking.
+template <typename T>
+class VersionedTable {
+private:
+    struct Version {
+        uint64_t epoch;
+        bool present; // False for a removal
+        Version* older;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        Version(uint64_t e, const T* value, Version* next) : epoch(e), present(value != nullptr), older(next) {
+            if (value) new (&storage) T(*value);
+        }
+        ~Version() {
+            if (present) reinterpret_cast<T*>(&storage)->~T();
+        }
+        const T& value() const { return *reinterpret_cast<const T*>(&storage); }
+    };
+
+    struct Slot {
+        std::atomic<Version*> head;
+        bool dirty; // Writer only: queued in `dirty` because older versions may be reclaimable
+
+        Slot() : head(nullptr), dirty(false) {}
+    };
+
+    static const size_t CHUNK_SLOTS = 4096;
+    static const size_t MAX_CHUNKS = 4096; // 16M records per table
+
+    // Slots never move, so readers can hold on to them while writers append
+    std::atomic<Slot*> chunks[MAX_CHUNKS];
+    std::atomic<size_t> slotCount;
+    std::unordered_map<std::string, size_t> slotById; // Writer only
+    std::vector<size_t> dirty;                        // Writer only
+
+    Slot& slotAt(size_t index) const {
+        return chunks[index / CHUNK_SLOTS].load(std::memory_order_acquire)[index % CHUNK_SLOTS];
+    }
+
+    // Frees the versions below the newest one a reader at `oldestNeeded` or later can see.
+    // Returns true if the chain still holds more than one version.
+    static bool trim(Slot& slot, uint64_t oldestNeeded) {
+        Version* keep = slot.head.load(std::memory_order_relaxed);
+        while (keep && keep->epoch > oldestNeeded) keep = keep->older;
+        if (!keep) return slot.head.load(std::memory_order_relaxed)->older != nullptr; // All newer than any reader
+        Version* garbage = keep->older;
+        keep->older = nullptr;
+        while (garbage) {
+            Version* next = garbage->older;
+            delete garbage;
+            garbage = next;
+        }
+        return slot.head.load(std::memory_order_relaxed) != keep;
+    }
+
+    void publish(const std::string& id, const T* value, uint64_t epoch, uint64_t oldestNeeded) {
+        size_t index;
+        auto it = slotById.find(id);
+        if (it != slotById.end()) {
+            index = it->second;
+        } else if (!value) {
+            return; // Removing a record readers never saw
+        } else {
+            index = slotCount.load(std::memory_order_relaxed);
+            if (index / CHUNK_SLOTS >= MAX_CHUNKS) return; // Full; the record is missing from snapshots
+            if (index % CHUNK_SLOTS == 0) {
+                chunks[index / CHUNK_SLOTS].store(new Slot[CHUNK_SLOTS], std::memory_order_release);
+            }
+            slotById.emplace(id, index);
+        }
+        Slot& slot = slotAt(index);
+        slot.head.store(new Version(epoch, value, slot.head.load(std::memory_order_relaxed)),
+                        std::memory_order_release);
+        if (it == slotById.end()) slotCount.store(index + 1, std::memory_order_release);
+
+        if (trim(slot, oldestNeeded) && !slot.dirty) {
+            slot.dirty = true;
+            dirty.push_back(index);
+        }
+        // Reclaim a little of what earlier readers held on to, so a chain does
+        // not keep its old versions until the record happens to change again
+        for (size_t budget = 2; budget > 0 && !dirty.empty(); --budget) {
+            Slot& other = slotAt(dirty.back());
+            if (trim(other, oldestNeeded)) break; // Still held by a reader; try again later
+            other.dirty = false;
+            dirty.pop_back();
+        }
+    }
+
+public:
+    VersionedTable() : slotCount(0) {
+        for (auto& chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~VersionedTable() {
+        size_t count = slotCount.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) {
+            Version* version = slotAt(i).head.load(std::memory_order_relaxed);
+            while (version) {
+                Version* next = version->older;
+                delete version;
+                version = next;
+            }
+        }
+        for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    void put(const std::string& id, const T& value, uint64_t epoch, uint64_t oldestNeeded) {
+        publish(id, &value, epoch, oldestNeeded);
+    }
+
+    void remove(const std::string& id, uint64_t epoch, uint64_t oldestNeeded) {
+        publish(id, nullptr, epoch, oldestNeeded);
+    }
+
+    // Calls visit(const T&) for every record present at `epoch`, in creation order
+    template <typename Visit>
+    void forEach(uint64_t epoch, Visit visit) const {
+        size_t count = slotCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            const Version* version = slotAt(i).head.load(std::memory_order_acquire);
+            while (version && version->epoch > epoch) version = version->older;
+            if (version && version->present) visit(version->value());
+        }
+    }
+
+    VersionedTable(const VersionedTable&) = delete;
+    VersionedTable& operator=(const VersionedTable&) = delete;
+};
+
+class Snapshot;
+
+// Versioned copies of users, resources, rentals and hot-tier bills, kept by a
+// System after enableSnapshots(). Writes happen under the System lock; each one
+// is a new epoch. Snapshots are pinned under the System lock too, so a pinned
+// epoch never falls between two records changed by the same call.
+//
+// Reclamation is epoch based: a write frees the versions of its record (and of
+// up to two records left over from earlier readers) that are older than what
+// the oldest pinned snapshot can see.
+class SnapshotStore {
+private:
+    std::atomic<uint64_t> epoch;         // Last epoch written
+    std::mutex pinMutex;                 // Guards pins
+    std::vector<uint64_t> pins;          // Epochs of open snapshots
+    std::atomic<uint64_t> oldestPinned;  // UINT64_MAX when there are none
+
+    uint64_t oldestNeeded(uint64_t writing) const;
+    uint64_t pin();
+    void unpin(uint64_t pinnedEpoch);
+
+    friend class Snapshot;
+
+public:
+    VersionedTable<User> users;
+    VersionedTable<Resource> resources;
+    VersionedTable<Rental> rentals;
+    VersionedTable<Bill> bills;
+
+    SnapshotStore();
+
+    // Writer side, called with the System lock held
+    void put(const User& user);
+    void put(const Resource& resource);
+    void put(const Rental& rental);
+    void put(const Bill& bill);
+    void removeResource(const std::string& resourceId);
+    void removeBill(const std::string& billId); // Moved to the archive
+
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+};
+
+// A consistent, read-only view of a System at one moment. Open it with
+// System::adminOpenSnapshot() while holding the System lock, then read it
+// without the lock for as long as needed, from any one thread; writers keep
+// running and the versions it sees stay alive until it is destroyed.
+class Snapshot {
+private:
+    SnapshotStore& store;
+    uint64_t pinnedEpoch;
+
+public:
+    explicit Snapshot(SnapshotStore& snapshotStore); // Call with the System lock held
+    ~Snapshot();
+
+    uint64_t epoch() const { return pinnedEpoch; }
+
+    template <typename Visit> void forEachUser(Visit visit) const { store.users.forEach(pinnedEpoch, visit); }
+    template <typename Visit> void forEachResource(Visit visit) const { store.resources.forEach(pinnedEpoch, visit); }
+    template <typename Visit> void forEachRental(Visit visit) const { store.rentals.forEach(pinnedEpoch, visit); }
+    template <typename Visit> void forEachBill(Visit visit) const { store.bills.forEach(pinnedEpoch, visit); }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+};
+
+#endif // SNAPSHOT_H
@@ -6,21 +6,226 @@
 #include "Resource.h" // Added for Resource management
 #include "Rental.h"   // Added for Rental management
 #include "Bill.h"     // Added for Bill management
+#include "BillArchive.h" // Cold storage for old bills
+#include "Page.h"     // Paginated listings
+#include "Metrics.h"  // Operation counters and latency histograms
+#include "Trace.h"    // Trace spans
+#include "AuditLog.h" // Asynchronous audit log (logs.dat)
+#include "ThreadPool.h" // Password verification off the System lock
+#include "ChangeLog.h" // Change log shipped to read replicas
+#include "NodePool.h" // Pooled nodes for the rental and bill indexes
+#include "Exception.h" // Error codes and technical-fault exceptions
+#include "Snapshot.h"  // Versioned copies for lock-free reports
+#include "Transaction.h" // Undo log for multi-entity changes
+#include "ChangeEvents.h" // Typed change-data-capture stream
+#include "Quota.h"    // Rental quotas and request rate limits
+#include "BalanceWatch.h" // Projected balances of users with running rentals
+#include "Notification.h" // Messages for users
 #include <vector>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <memory> // For std::unique_ptr or std::shared_ptr
+#include <mutex>
+#include <functional>
+#include <future>
 
+// Outcome of an asynchronous login
+struct LoginResult {
+    bool success;
+    std::string userId;  // Set on success
+    ErrorCode error;     // Cause on failure
+    std::string message; // Reason on failure
+
+    LoginResult() : success(false), error(ErrorCode::OK) {}
+};
+
+// What suspending a user does to the user's pending, approved and active rentals
+enum class SuspensionCascade {
+    NONE,     // Leave them as they are
+    PAUSE,    // Bill running ones so far, release their resources and pause them all;
+              // reactivation puts them back up for approval
+    TERMINATE // Bill running ones so far and complete them, cancel the others
+};
+
+// Hash index whose nodes come from a NodePool
+template <typename Value>
+using PooledIndex = std::unordered_map<std::string, Value, std::hash<std::string>, std::equal_to<std::string>,
+                                       PoolAllocator<std::pair<const std::string, Value>>>;
+
+// Rental positions whose first element also comes from the pool: most
+// resources have a single live rental, which then costs no malloc
+typedef std::vector<size_t, PoolAllocator<size_t>> LiveRentals;
+
+// Rental positions ordered by end time, soonest first
+typedef std::pair<std::chrono::system_clock::time_point, size_t> ExpiryKey;
+typedef std::set<ExpiryKey, std::less<ExpiryKey>, PoolAllocator<ExpiryKey>> ExpiryIndex;
+
+// System is not internally synchronized. When one instance is shared between
+// threads, every call must be made while holding getMutex(); long-running
+// readers such as the Exporter take it per chunk.
 class System {
 private:
+    mutable std::mutex stateMutex;
     std::vector<User> users;
     User* currentUser; // Raw pointer to the currently logged-in user
     std::vector<Resource> resources; // Container for resources
     std::vector<Rental> rentals;     // Container for rentals
-    std::vector<Bill> bills;         // Container for bills
+    std::vector<Bill> bills;         // Container for bills (hot tier)
+    BillArchive billArchive;         // Sealed, compressed old bills (cold tier)
+
+    // Hash indexes: key -> position in the corresponding vector
+    std::unordered_map<std::string, size_t> userIndexByName;
+    std::unordered_map<std::string, size_t> userIndexById;
+    std::unordered_map<std::string, size_t> resourceIndexById;
+    NodePool indexPool; // Nodes of the indexes below, which grow with every rental and bill
+    PooledIndex<size_t> rentalIndexById;
+
+    // Per-user positions into rentals/bills, in creation order
+    PooledIndex<std::vector<size_t>> rentalsByUser;
+    PooledIndex<std::vector<size_t>> billsByUser;
+    PooledIndex<QuotaUsage> quotaUsage; // By userId; kept current as rentals change state
+    PooledIndex<LiveRentals> liveRentalsByUser; // Pending, approved, active and paused; unordered
+    PooledIndex<LiveRentals> liveRentalsByResource; // Same, by resourceId; empty when it can be deleted
+    std::vector<size_t> liveSlotByUser;     // By rental position: where it sits in its user's live list
+    std::vector<size_t> liveSlotByResource; // and in its resource's, so it is removed without a search
+    ExpiryIndex rentalsByEndTime; // Approved and active rentals; the front is the next to run over
+    bool autoCompleteOverdue; // Overdue rentals are completed and their resources freed when found
+    size_t retiredResources; // Tombstones in `resources`, dropped once they are half of it
+    size_t resourcesAppended; // Catalog sequence of the newest resource; listResources cursors hold these
+    size_t billsAppended; // Ledger sequence of the newest bill; bill listing cursors hold these
+
+    BalanceWatch balanceWatch; // Kept current as rentals run, get billed and balances change
+    std::chrono::hours lowBalanceHorizon; // Users are alerted this long before their balance runs out
+    std::unordered_map<std::string, std::vector<Notification>> notifications; // By userId, oldest first
+
+    RentalQuota roleQuotas[3];                              // By UserRole
+    std::unordered_map<std::string, RentalQuota> userQuotas; // Overrides, by userId
+
+    std::unique_ptr<MetricsDumper> metricsDumper; // Periodic metrics file, if enabled
+    AuditLog* auditLog; // Not owned; nullptr when auditing is off
+    ChangeLogWriter* changeLog; // Not owned; nullptr when not replicated
+    std::unique_ptr<SnapshotStore> snapshots; // Created by enableSnapshots()
+    ChangeEventStream* eventStream; // Not owned; nullptr when no one subscribes
+    size_t idOffset; // New IDs are numbered count * idStride + idOffset + 1,
+    size_t idStride; // so the shards of a ShardedSystem never hand out the same ID
+    mutable ErrorCode lastErrorCode;
+    bool consoleMessages;
+    mutable std::ostream silentConsole; // Has no buffer, so writes are rejected before any formatting
+    size_t loginWorkerCount;
+    std::unique_ptr<ThreadPool> loginPool; // Created on the first asynchronous login
+
+    // Open transactions (see beginTransaction)
+    struct Savepoint {
+        size_t undoRecords;
+        size_t userImages;
+        size_t resourceImages;
+        size_t pendingAudits;
+        size_t pendingCounts;
+        size_t pendingEvents;
+    };
+    struct PendingChange {
+        ChangeType type;
+        size_t position; // In the entity's container; published with its state at commit time
+    };
+    struct PendingAudit {
+        AuditOp op;
+        std::string actor;
+        std::string target;
+        double amount;
+        uint32_t detail;
+    };
+    std::vector<Savepoint> savepoints; // One per open begin, innermost last
+    std::vector<UndoRecord> undoLog;
+    std::vector<User> userImages;
+    std::vector<Resource> resourceImages;
+    std::vector<PendingChange> pendingChanges; // Held back until the outermost transaction ends
+    std::vector<PendingAudit> pendingAudits;
+    std::vector<std::pair<MetricCounter, uint64_t>> pendingCounts;
+    std::vector<ChangeEvent> pendingEvents;
 
     // Private helper methods
     User* findUser(const std::string& username); // Finds by username
     User* findUserById(const std::string& userId); // Finds by userId
+    Resource* findResourceById(const std::string& resourceId); // Internal lookups, not counted as API calls
+    Rental* findRentalById(const std::string& rentalId);
+    void audit(AuditOp op, const std::string& target, double amount = 0.0, uint32_t detail = 0); // Actor is the current user
+    void auditAs(const std::string& actor, AuditOp op, const std::string& target, double amount = 0.0, uint32_t detail = 0);
+    void submitLogin(const std::string& username, const std::string& password,
+                     std::function<void(const LoginResult&)> done); // Both forms of loginUserAsync
+    LoginResult finishAsyncLogin(const std::string& username, const std::string& userId,
+                                 const PasswordCredential& checked, bool passwordOk,
+                                 const PasswordCredential& upgraded); // Runs on a login worker
+    void rebuildBillIndex(); // After bills have been moved to the archive
+    void rebuildResourceIndex(); // After resources have been removed
+    void tombstoneResource(Resource& resource); // Marks a deleted resource and unindexes it
+    void retireResource(Resource& resource); // Tombstones it and publishes the deletion
+    void compactResources(); // Drops the tombstones if they are half of the catalog
+    User* appendUser(const std::string& username, const std::string& password, UserRole role,
+                     const std::string& realName); // Creates, indexes and logs a new user
+    User* insertUser(const User& user); // Adds and indexes a user, keeps currentUser valid
+    std::string nextId(const std::string& prefix, size_t count) const; // ID of the next of `count` entities
+    std::ostream& console() const; // std::cout, or a stream that discards everything
+    bool fail(ErrorCode code) const; // Records the cause and returns false
+    size_t archiveBills(std::chrono::system_clock::time_point cutoff); // Moves old bills to the archive
+
+    // Undo logging; all of these are plain assignments outside a transaction
+    void recordUndo(UndoOp op, size_t position, uint32_t oldValue = 0, double oldNumber = 0.0);
+    void undo(const UndoRecord& record);
+    void openSavepoint();      // The public transaction calls without their timers
+    bool commitSavepoint();
+    bool rollbackSavepoint();
+    void publishPending(); // Once the outermost transaction has ended
+    void setUserStatus(User& user, UserStatus status);
+    void setUserBalance(User& user, double balance);
+    void setResourceStatus(Resource& resource, ResourceStatus status);
+    void setRentalStatus(Rental& rental, RentalStatus status);
+    void setRentalCost(Rental& rental, double cost);
+    void restartRental(Rental& rental, std::chrono::system_clock::time_point now); // Booked period resumes at `now`
+    // Business counters and audit records of changes, held back until commit
+    void count(MetricCounter counter, uint64_t amount = 1);
+    void auditChange(AuditOp op, const std::string& target, double amount = 0.0, uint32_t detail = 0);
+    void emit(ChangeEvent& event); // Held back until commit inside a transaction; check eventStream first
+    void emitRentalStatus(const Rental& rental, RentalStatus oldStatus);
+
+    // Quota accounting
+    const RentalQuota& quotaFor(const User& user) const;
+    QuotaUsage* admitRental(const User& user, int durationHours); // nullptr (and a message) if refused
+    void trackRentalStatus(const Rental& rental, RentalStatus from, RentalStatus to);
+    void trackNewRental(const Rental& rental);
+    void untrackRental(const Rental& rental); // Undoing its creation
+
+    // Low-balance watch
+    void watchRental(const Rental& rental, bool running); // Rental started or stopped running
+    void repriceRentals(const Resource& resource, double oldPricePerHour); // After a price change
+    size_t alertLowBalances(); // Notifies users now within the horizon; deferred inside a transaction
+    void notify(const std::string& userId, const std::string& message, NotificationPriority priority);
+    void showImportantNotifications(const User& user) const; // Unread HIGH ones, at login
+
+    // Overdue rentals
+    const Bill& completeRental(Rental& rental, Resource& resource, User& user,
+                               std::chrono::system_clock::time_point now); // Bills the booked hours
+    void endOverdue(const Rental& rental, std::chrono::system_clock::time_point now); // After an overdue rental stopped holding its resource
+
+    // Rentals of suspended users
+    Bill& chargeRental(Rental& rental, User& user, double amount); // Adds to its cost; caller logs
+    double settleRunningRental(Rental& rental, User& user, Resource& resource,
+                               std::chrono::system_clock::time_point now); // Bills the hours used, frees the resource
+    size_t cascadeSuspension(User& user, SuspensionCascade cascade); // Returns the rentals changed
+    size_t resumeRentals(User& user); // Paused rentals back to pending approval, their unused hours from now
+    void applyStatusCascade(User& user, UserStatus oldStatus, SuspensionCascade cascade);
+
+    // Change log: the full state of an entity after each change
+    void logUser(const User& user);
+    void logResource(const Resource& resource);
+    void logRental(const Rental& rental);
+    void logBill(const Bill& bill);
+    void logChange(ChangeType type, const std::string& body);
+
+    friend class BulkImporter; // Appends in bulk and indexes once at the end
+    friend class Exporter;     // Copies records out in chunks
+    friend class ShardedSystem; // Partitions IDs and coordinates resources across shards
+    friend class Transaction;   // Internal transactions are not API calls
     // findResource is public as per requirement
 
 public:
@@ -30,11 +235,104 @@ public:
     // Destructor
     ~System();
 
+    std::mutex& getMutex() const;
+
+    // Rental quotas and request rate limits (see Quota.h); unlimited by default.
+    // A user quota replaces the quota of the user's role.
+    bool adminSetRoleQuota(UserRole role, const RentalQuota& quota);
+    bool adminSetUserQuota(const std::string& username, const RentalQuota& quota);
+    bool adminClearUserQuota(const std::string& username);
+    bool getQuotaUsage(const std::string& userId, QuotaUsage& usage) const; // Own usage, or any for an admin
+
+    // Low-balance watch (see BalanceWatch.h). A user whose balance is projected
+    // to run out within the horizon (24 hours by default) gets one important
+    // notification until the projection recovers.
+    bool adminSetLowBalanceHorizon(std::chrono::hours horizon);
+    std::vector<BalanceRisk> adminUsersGoingNegative(std::chrono::hours within); // Soonest first
+    size_t checkLowBalanceAlerts(); // For a timer: alerts users the clock has brought within the horizon
+
+    // Overdue rentals: approved or active ones past their end time. For a
+    // timer (Server runs it every ServerOptions::overdueCheckInterval): marks
+    // every rental that ended by `asOf` OVERDUE and notifies its user, or, with
+    // auto-completion on, completes it and frees its resource. A later `asOf`
+    // than now is a look-ahead only an admin session may take; for anyone else
+    // it is clamped to now. Completions and overdue times are recorded at the
+    // real time either way. Costs O(k log n) for k overdue rentals out of n
+    // running. Returns k.
+    bool adminSetOverdueAutoComplete(bool enabled); // Off by default
+    size_t checkOverdueRentals(std::chrono::system_clock::time_point asOf = std::chrono::system_clock::now());
+
+    // Notifications of the current user, oldest first. Reading marks them
+    // read; clearing removes the read ones.
+    std::vector<Notification> readNotifications();
+    size_t clearNotifications();
+
+    // Cause of the most recent failed call (false, nullptr or 0 returned). Like
+    // errno it is not reset by successful calls, so check it right after the failure.
+    ErrorCode lastError() const;
+
+    // Status and error messages go to std::cout by default. Programmatic callers
+    // that branch on lastError() can turn them off, which also skips formatting
+    // them; display* functions always print.
+    void setConsoleMessages(bool enabled);
+
+    // Key operations are recorded in the given audit log, which must outlive
+    // this System or be detached with nullptr
+    void attachAuditLog(AuditLog* log);
+
+    // Every change to users, resources, rentals and bills is appended to the given
+    // change log, which must outlive this System or be detached with nullptr.
+    // Attach it before the first change, since replicas start from an empty System.
+    void attachChangeLog(ChangeLogWriter* log);
+
+    // Every change to users, resources, rentals and bills is published to the
+    // given stream as a typed event with old and new values (see ChangeEvents.h).
+    // The stream must outlive this System or be detached with nullptr.
+    void attachEventStream(ChangeEventStream* stream);
+
+    // Transactions make a series of calls take effect together or not at all.
+    // Inside one, changes to users, resources, rentals and bills are recorded in
+    // an undo log, and their change log, snapshot, audit and metrics records are
+    // held back until the outermost commit; rollbackTransaction() undoes the
+    // changes instead. Transactions nest, and rolling back an inner one only
+    // undoes what happened since its begin. Console messages are not held back.
+    // Deleting resources and archiving bills fail with INVALID_STATE inside a
+    // transaction. See also the scoped Transaction in Transaction.h.
+    void beginTransaction();
+    bool commitTransaction();   // INVALID_STATE without a matching begin
+    bool rollbackTransaction(); // INVALID_STATE without a matching begin
+    bool inTransaction() const;
+
+    // Keeps versioned copies of every record from now on, so admin reports can
+    // read a consistent snapshot without holding the System lock (see Snapshot.h)
+    void enableSnapshots();
+    // Pins the current state; call with the lock held, read with or without it.
+    // Admin only; nullptr if snapshots are not enabled.
+    std::unique_ptr<Snapshot> adminOpenSnapshot();
+
+    // Replays one record of a primary's change log on a replica (see Replica.h).
+    // Records must be applied in order to a System that receives no other changes.
+    // Permission checks, business counters and the audit log are bypassed.
+    bool applyChange(const ChangeRecord& record, std::string& error);
+
     // User management functions
     bool registerUser(const std::string& username, const std::string& password, UserRole role, const std::string& realName);
     User* loginUser(const std::string& username, const std::string& password);
+    // Verifies the password on the login worker pool instead of the calling thread.
+    // Call it while holding getMutex() like any other method, but wait for the future
+    // only after releasing it: the worker takes the lock to finish the login.
+    // On success the session is not changed; use switchToUser(result.userId).
+    std::future<LoginResult> loginUserAsync(const std::string& username, const std::string& password);
+    // Same, but calls done on the login worker once the lock is released instead of returning a future
+    void loginUserAsync(const std::string& username, const std::string& password,
+                        std::function<void(const LoginResult&)> done);
+    void setLoginWorkers(size_t count); // Before the first asynchronous login; default is half the cores
     void logoutUser();
     User* getCurrentUser() const;
+    // Makes an already authenticated user current without checking the password
+    // again, for front-ends that multiplex many sessions onto one System.
+    // An empty userId selects no user; on failure no user is current either.
+    bool switchToUser(const std::string& userId);
     void displayAllUsers() const; // Changed from optional to standard
 
     // Personal information management for the current user
@@ -60,17 +358,27 @@ public:
     bool adminModifyResource(const std::string& resourceId, const std::string& newName, 
                              const std::map<std::string, std::string>& newSpecs, double newPricePerHour);
     bool adminDeleteResource(const std::string& resourceId);
+    // Drains and deletes many resources in one pass, e.g. a rack being retired.
+    // Their pending and paused rentals are cancelled; a resource with an approved
+    // or active rental is kept (RESOURCE_BUSY) unless terminateRunning, which
+    // completes that rental with a bill for the hours used. Returns how many
+    // were deleted; when not all of them, lastError() tells why.
+    size_t adminDecommissionResources(const std::vector<std::string>& resourceIds, bool terminateRunning = false);
 
     // Admin User Management
     void adminDisplayAllUsers() const;
     bool adminAddUser(const std::string& username, const std::string& password, UserRole role, const std::string& realName);
+    // Suspending a user applies `cascade` to the user's rentals; reactivating
+    // puts paused rentals back up for approval
     bool adminModifyUser(const std::string& targetUsername, const std::string& newRealName, 
-                         UserRole newRole, UserStatus newStatus, double newBalance);
-    bool adminSetUserStatus(const std::string& targetUsername, UserStatus newStatus);
+                         UserRole newRole, UserStatus newStatus, double newBalance,
+                         SuspensionCascade cascade = SuspensionCascade::PAUSE);
+    bool adminSetUserStatus(const std::string& targetUsername, UserStatus newStatus,
+                            SuspensionCascade cascade = SuspensionCascade::PAUSE);
 
     // Admin Rental Review
     void adminDisplayPendingRentals() const;
-    bool adminApproveRental(const std::string& rentalId);
+    bool adminApproveRental(const std::string& rentalId); // Its booked hours run from the approval
     bool adminRejectRental(const std::string& rentalId, const std::string& reason);
 
     // Admin View All Rentals
@@ -80,6 +388,37 @@ public:
     bool processRentalCompletion(const std::string& rentalId);
     void displayUserBills(const std::string& userId) const;
     void adminDisplayAllBills() const;
+
+    // Bill archive
+    size_t adminArchiveBillsBefore(std::chrono::system_clock::time_point cutoff); // Returns number archived
+    std::vector<Bill> findUserBills(const std::string& userId,
+                                    std::chrono::system_clock::time_point from,
+                                    std::chrono::system_clock::time_point to) const; // Hot and archived
+    std::vector<Bill> findBillsByDate(std::chrono::system_clock::time_point from,
+                                      std::chrono::system_clock::time_point to) const; // Hot and archived
+
+    // Paginated listings: no console output, O(page size) per call.
+    // Users may list their own rentals/bills, admins may list anything.
+    // Bill pages cover the hot tier; archived bills are queried with findUserBills/findBillsByDate.
+    // Cursors stay valid across archiving and resource deletion: they resume after the last item returned.
+    Page<Rental> listUserRentals(const std::string& userId, const PageRequest& request) const;
+    Page<Bill> listUserBills(const std::string& userId, const PageRequest& request) const;
+    Page<Resource> listResources(const PageRequest& request) const;
+    Page<User> adminListUsers(const PageRequest& request) const;
+    Page<Rental> adminListRentals(const PageRequest& request) const;
+    Page<Bill> adminListBills(const PageRequest& request) const;
+
+    // Operation metrics (admin only). Every public method above records its call
+    // count and latency; counters track logins, rentals and billing.
+    // Metrics are process-wide, shared by all System instances.
+    bool adminGetMetrics(MetricsSnapshot& snapshot) const;
+    bool adminWriteMetrics(std::ostream& out) const; // Prometheus text format
+    bool adminStartMetricsDump(const std::string& path, std::chrono::milliseconds interval);
+    bool adminStopMetricsDump(); // Writes a final dump
+
+    // Tracing (admin only). Spans are recorded only in builds with TRACE=1.
+    bool adminSetTracing(bool enabled);
+    bool adminWriteTrace(std::ostream& out) const; // Chrome trace-event JSON
 };
 
 #endif // SYSTEM_H
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size pool of worker threads running queued tasks in FIFO order
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void workerLoop();
+
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool(); // Runs the tasks still queued, then joins the workers
+
+    // Queues a callable and returns a future for its result
+    template <typename Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task) {
+        typedef typename std::result_of<Task()>::type Result;
+        // packaged_task is move-only and std::function needs a copyable target
+        std::shared_ptr<std::packaged_task<Result()>> packaged =
+            std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back([packaged] { (*packaged)(); });
+        }
+        wakeUp.notify_one();
+        return result;
+    }
+
+    size_t size() const;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Scoped trace spans written as Chrome trace-event JSON (chrome://tracing, Perfetto).
+//
+// TRACE_SCOPE("name") records the duration of the enclosing scope. Only the
+// pointer to the name is stored, so it must outlive the tracer (a string literal).
+// Spans are only compiled in when CRRS_TRACING is defined (make TRACE=1);
+// otherwise the macro expands to nothing. Even when compiled in, nothing is
+// recorded until Trace::setEnabled(true).
+//
+// Every thread records into its own ring buffer, which keeps the most recent
+// Trace::RING_CAPACITY spans of that thread. When a thread exits, its spans
+// move into one shared ring of the same capacity and its buffer is freed, so
+// short-lived threads do not add up.
+class Trace {
+public:
+    static const size_t RING_CAPACITY = 1 << 16;
+
+    static bool compiledIn(); // Whether TRACE_SCOPE records anything in this build
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static uint64_t nowNanos(); // Monotonic, relative to the first use of the tracer
+    static void record(const char* name, uint64_t startNanos, uint64_t endNanos);
+
+    // Writes all buffered spans as a JSON array of complete ("X") events
+    static bool writeChromeJson(std::ostream& out);
+    static void clear();
+};
+
+// Records one span from construction to destruction when tracing is enabled
+class TraceSpan {
+private:
+    const char* name; // nullptr when tracing was disabled at construction
+    uint64_t start;
+
+public:
+    explicit TraceSpan(const char* spanName)
+        : name(Trace::isEnabled() ? spanName : nullptr), start(name ? Trace::nowNanos() : 0) {}
+    ~TraceSpan() {
+        if (name) Trace::record(name, start, Trace::nowNanos());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef CRRS_TRACING
+#define TRACE_SCOPE(spanName) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(spanName)
+#else
+#define TRACE_SCOPE(spanName) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,56 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <cstddef>
+#include <cstdint>
+
+class System;
+
+// What an undo record restores. Field records hold the old value; *_APPENDED
+// records hold the size of the container before the append and undo every
+// entity from there on, so a bulk import needs only one record.
+enum class UndoOp : uint8_t {
+    USER_STATUS,
+    USER_BALANCE,
+    USER_IMAGE,        // Whole user, saved before an admin modification
+    USERS_APPENDED,
+    RESOURCE_STATUS,
+    RESOURCE_IMAGE,    // Whole resource, saved before an admin modification
+    RESOURCES_APPENDED,
+    RENTAL_STATUS,
+    RENTAL_COST,
+    RENTAL_TIMES,      // Start and end, both moved by `number` clock ticks
+    RENTALS_APPENDED,
+    BILLS_APPENDED
+};
+
+struct UndoRecord {
+    UndoOp op;
+    uint32_t value;  // Old status, or the index of the saved image
+    size_t position; // Of the entity in its container
+    double number;   // Old balance or cost, or how far the rental times moved
+
+    UndoRecord(UndoOp undoOp, size_t entityPosition, uint32_t oldValue, double oldNumber)
+        : op(undoOp), value(oldValue), position(entityPosition), number(oldNumber) {}
+};
+
+// Scoped System transaction: begins in the constructor and rolls back in the
+// destructor unless commit() was called, so an early return or an exception
+// leaves no partial changes. Call with the System lock held.
+class Transaction {
+private:
+    System& system;
+    bool open;
+
+public:
+    explicit Transaction(System& sys);
+    ~Transaction();
+
+    void commit();
+    void rollback();
+
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+};
+
+#endif // TRANSACTION_H
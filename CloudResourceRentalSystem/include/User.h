@@ -1,6 +1,7 @@
 #ifndef USER_H
 #define USER_H
 
+#include "PasswordHasher.h"
 #include <string>
 #include <vector> // Included as per instruction, though not used yet
 
@@ -20,26 +21,24 @@ class User {
 private:
     std::string userId;
     std::string username;
-    std::string passwordHash; // Store a hash of the password, not plaintext
+    PasswordCredential password; // Salted PBKDF2 hash, never the plaintext
     UserRole role;
     double balance;
     UserStatus status;
     std::string name; // Real name
 
-    // Helper function for password hashing (simple XOR hash)
-    std::string xorHash(const std::string& input) const;
-
 public:
     // Constructor
     User(std::string id, std::string uname, std::string passwd, UserRole r, std::string realName);
+    User(std::string id, std::string uname, const PasswordCredential& credential, UserRole r, std::string realName);
 
     // Getters
-    std::string getUserId() const;
-    std::string getUsername() const;
+    const std::string& getUserId() const;
+    const std::string& getUsername() const;
     UserRole getRole() const;
     double getBalance() const;
     UserStatus getStatus() const;
-    std::string getName() const;
+    const std::string& getName() const;
 
     // Setters
     void setPassword(const std::string& newPassword);
@@ -48,8 +47,13 @@ public:
     void setName(const std::string& newName);
     void setRole(UserRole newRole); // Added setter for role
 
-    // Password checking
+    // Password checking (runs the full key derivation, so it is deliberately slow)
     bool checkPassword(const std::string& passwd) const;
+    bool passwordNeedsRehash() const; // Stored cost differs from PasswordHasher::defaultIterations()
+
+    // Raw credential access, so hashing can be done without holding the System lock
+    const PasswordCredential& getPasswordCredential() const;
+    void setPasswordCredential(const PasswordCredential& credential);
 
     // Display user information
     void displayUserInfo() const;
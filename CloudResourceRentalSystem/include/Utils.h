@@ -3,11 +3,42 @@
 
 #include <string>
 #include <chrono> // Required for std::chrono::system_clock::time_point
+#include <iostream>
+#include <streambuf>
+#include <vector>
 
 // Function to generate a unique ID with a given prefix and current size
 std::string generateUniqueId(const std::string& prefix, int currentSize);
 
+// Reverse of generateUniqueId: extracts the numeric part of an ID such as "bill_12".
+// Returns false if the ID does not have the given prefix followed by digits only.
+bool parseUniqueId(const std::string& id, const std::string& prefix, long long& number);
+
+// Splits a command line on spaces and tabs; "double quoted" words may contain spaces
+std::vector<std::string> splitCommandLine(const std::string& line);
+
 // Function to format a time_point to a string
 std::string formatTimePoint(const std::chrono::system_clock::time_point& tp, const std::string& format = "%Y-%m-%d %H:%M:%S");
 
+// Stream buffer that discards everything written to it
+class NullStreamBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Redirects std::cout to another buffer for the lifetime of the object,
+// e.g. to silence System's console messages in benchmarks and batch runs
+class ScopedCoutRedirect {
+private:
+    std::streambuf* previous;
+
+public:
+    explicit ScopedCoutRedirect(std::streambuf* target) : previous(std::cout.rdbuf(target)) {}
+    ~ScopedCoutRedirect() { std::cout.rdbuf(previous); }
+
+    ScopedCoutRedirect(const ScopedCoutRedirect&) = delete;
+    ScopedCoutRedirect& operator=(const ScopedCoutRedirect&) = delete;
+};
+
 #endif // UTILS_H
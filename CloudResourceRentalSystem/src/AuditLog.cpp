@@ -0,0 +1,264 @@
+#include "AuditLog.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include <cstring>
+#include <iostream>
+
+static const char AUDIT_MAGIC[8] = { 'C', 'R', 'R', 'S', 'A', 'U', 'D', '1' };
+static const size_t WRITE_BATCH = 4096; // Records per fwrite
+
+static_assert(sizeof(AuditRecord) == 64, "AuditRecord is a fixed 64-byte on-disk format");
+
+static const char* const opNames[static_cast<size_t>(AuditOp::COUNT)] = {
+    "UNKNOWN", "USER_REGISTERED", "LOGIN_SUCCEEDED", "LOGIN_FAILED", "LOGOUT", "NAME_CHANGED",
+    "PASSWORD_CHANGED", "USER_ADDED", "USER_MODIFIED", "USER_STATUS_CHANGED", "RESOURCE_ADDED",
+    "RESOURCE_MODIFIED", "RESOURCE_DELETED", "RENTAL_REQUESTED", "RENTAL_CANCELLED", "RENTAL_APPROVED",
+    "RENTAL_REJECTED", "RENTAL_COMPLETED", "BILLS_ARCHIVED", "USERS_IMPORTED", "RESOURCES_IMPORTED",
+    "RECORDS_DROPPED", "RENTAL_PAUSED", "RENTAL_TERMINATED", "RENTAL_RESUMED",
+    "RENTAL_OVERDUE"
+};
+
+// Copies an ID into a fixed field, flagging the record if it does not fit
+static void copyId(char (&field)[20], const std::string& id, uint8_t& flags) {
+    std::memset(field, 0, sizeof(field));
+    size_t length = id.size();
+    if (length > sizeof(field)) {
+        length = sizeof(field);
+        flags |= AuditRecord::FLAG_TRUNCATED;
+    }
+    std::memcpy(field, id.data(), length);
+}
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string AuditRecord::actorId() const {
+    return std::string(actor, strnlen(actor, sizeof(actor)));
+}
+
+std::string AuditRecord::targetId() const {
+    return std::string(target, strnlen(target, sizeof(target)));
+}
+
+AuditLog::AuditLog(const AuditLogOptions& logOptions)
+    : options(logOptions), mask(0), enqueuePosition(0), dequeuePosition(0), dropped(0), written(0),
+      file(nullptr), fileBytes(0), stopping(false), flushTarget(0), durablePosition(0) {
+    size_t capacity = 2;
+    while (capacity < options.ringCapacity) capacity <<= 1;
+    cells.reset(new Cell[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+
+    if (!openFile()) {
+        std::cout << "Error: Cannot open audit log '" << options.path << "'. Audit records will be discarded." << std::endl;
+    }
+    writer = std::thread(&AuditLog::run, this);
+}
+
+AuditLog::~AuditLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+    if (file) std::fclose(file);
+}
+
+bool AuditLog::append(AuditOp op, const std::string& actor, const std::string& target, double amount,
+                      uint32_t detail) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[position & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break; // Slot claimed
+            }
+        } else if (difference < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed); // Ring full: the writer is behind
+            return false;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    AuditRecord& record = cell->record;
+    record.timestampMicros = nowMicros();
+    record.amount = amount;
+    record.detail = detail;
+    record.op = static_cast<uint8_t>(op);
+    record.flags = 0;
+    record.reserved = 0;
+    copyId(record.actor, actor, record.flags);
+    copyId(record.target, target, record.flags);
+    cell->sequence.store(position + 1, std::memory_order_release); // Publish to the writer
+    return true;
+}
+
+// Single consumer: only the writer thread calls this
+bool AuditLog::pop(AuditRecord& record) {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    Cell& cell = cells[position & mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1) < 0) {
+        return false; // Empty, or the next producer has not finished writing its record
+    }
+    record = cell.record;
+    cell.sequence.store(position + mask + 1, std::memory_order_release); // Free the slot for the next lap
+    dequeuePosition.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AuditLog::openFile() {
+    file = std::fopen(options.path.c_str(), "ab");
+    if (!file) return false;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    fileBytes = size > 0 ? static_cast<uint64_t>(size) : 0;
+    if (fileBytes == 0) {
+        std::fwrite(AUDIT_MAGIC, 1, sizeof(AUDIT_MAGIC), file);
+        fileBytes = sizeof(AUDIT_MAGIC);
+    }
+    return true;
+}
+
+// logs.dat -> logs.dat.1 -> logs.dat.2 ...; the oldest file is removed
+bool AuditLog::rotate() {
+    std::fclose(file);
+    file = nullptr;
+    std::string oldest = options.path + "." + std::to_string(options.maxRotatedFiles);
+    std::remove(oldest.c_str());
+    for (int i = options.maxRotatedFiles - 1; i >= 1; --i) {
+        std::string from = options.path + "." + std::to_string(i);
+        std::string to = options.path + "." + std::to_string(i + 1);
+        std::rename(from.c_str(), to.c_str());
+    }
+    if (options.maxRotatedFiles > 0) {
+        std::rename(options.path.c_str(), (options.path + ".1").c_str());
+    } else {
+        std::remove(options.path.c_str());
+    }
+    return openFile();
+}
+
+void AuditLog::writeBatch(const std::vector<AuditRecord>& batch) {
+    TRACE_SCOPE("AuditLog::writeBatch");
+    uint64_t bytes = batch.size() * sizeof(AuditRecord);
+    if (file && fileBytes > sizeof(AUDIT_MAGIC) && fileBytes + bytes > options.maxFileBytes) {
+        rotate();
+    }
+    if (!file && !openFile()) {
+        Metrics::increment(MetricCounter::AUDIT_RECORDS_DROPPED, batch.size());
+        return;
+    }
+    size_t count = std::fwrite(batch.data(), sizeof(AuditRecord), batch.size(), file);
+    fileBytes += count * sizeof(AuditRecord);
+    written.fetch_add(count, std::memory_order_relaxed);
+    Metrics::increment(MetricCounter::AUDIT_RECORDS_WRITTEN, count);
+    if (count < batch.size()) {
+        Metrics::increment(MetricCounter::AUDIT_RECORDS_DROPPED, batch.size() - count);
+    }
+}
+
+void AuditLog::run() {
+    std::vector<AuditRecord> batch;
+    batch.reserve(WRITE_BATCH);
+    uint64_t droppedReported = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        bool stop = stopping;
+        lock.unlock();
+
+        AuditRecord record;
+        do {
+            batch.clear();
+            uint64_t lost = dropped.load(std::memory_order_relaxed);
+            if (lost != droppedReported) {
+                AuditRecord marker = AuditRecord();
+                marker.timestampMicros = nowMicros();
+                marker.op = static_cast<uint8_t>(AuditOp::RECORDS_DROPPED);
+                marker.detail = static_cast<uint32_t>(lost - droppedReported);
+                batch.push_back(marker);
+                Metrics::increment(MetricCounter::AUDIT_RECORDS_DROPPED, lost - droppedReported);
+                droppedReported = lost;
+            }
+            while (batch.size() < WRITE_BATCH && pop(record)) {
+                batch.push_back(record);
+            }
+            if (!batch.empty()) writeBatch(batch);
+        } while (batch.size() == WRITE_BATCH);
+        if (file) std::fflush(file);
+
+        lock.lock();
+        durablePosition = dequeuePosition.load(std::memory_order_relaxed);
+        progress.notify_all();
+        if (stop) break;
+        wakeWriter.wait_for(lock, options.flushInterval,
+                            [this] { return stopping || flushTarget > durablePosition; });
+    }
+}
+
+void AuditLog::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t target = enqueuePosition.load(std::memory_order_acquire);
+    if (target > flushTarget) flushTarget = target;
+    wakeWriter.notify_one();
+    progress.wait(lock, [this, target] { return durablePosition >= target; });
+}
+
+uint64_t AuditLog::recordsWritten() const {
+    return written.load(std::memory_order_relaxed);
+}
+
+uint64_t AuditLog::recordsDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+const char* AuditLog::opName(AuditOp op) {
+    size_t index = static_cast<size_t>(op);
+    return index < static_cast<size_t>(AuditOp::COUNT) ? opNames[index] : "UNKNOWN";
+}
+
+bool AuditLog::opFromName(const std::string& name, AuditOp& op) {
+    for (size_t i = 1; i < static_cast<size_t>(AuditOp::COUNT); ++i) {
+        if (name == opNames[i]) {
+            op = static_cast<AuditOp>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AuditLog::readFile(const std::string& path, std::vector<AuditRecord>& records, std::string& error) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        error = "Cannot open '" + path + "'";
+        return false;
+    }
+    char magic[sizeof(AUDIT_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        std::memcmp(magic, AUDIT_MAGIC, sizeof(magic)) != 0) {
+        std::fclose(in);
+        error = "'" + path + "' is not an audit log";
+        return false;
+    }
+    std::vector<AuditRecord> chunk(WRITE_BATCH);
+    size_t count;
+    while ((count = std::fread(chunk.data(), sizeof(AuditRecord), chunk.size(), in)) > 0) {
+        records.insert(records.end(), chunk.begin(), chunk.begin() + count);
+    }
+    bool partial = std::ftell(in) % sizeof(AuditRecord) != sizeof(AUDIT_MAGIC) % sizeof(AuditRecord);
+    std::fclose(in);
+    if (partial) {
+        error = "'" + path + "' ends with an incomplete record";
+        return false;
+    }
+    return true;
+}
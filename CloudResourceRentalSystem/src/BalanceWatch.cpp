@@ -0,0 +1,162 @@
+#include "BalanceWatch.h"
+
+typedef std::chrono::duration<double, std::ratio<3600>> Hours;
+
+static double toHours(BalanceWatch::TimePoint time) {
+    return std::chrono::duration_cast<Hours>(time.time_since_epoch()).count();
+}
+
+static BalanceWatch::TimePoint fromHours(double hours) {
+    return BalanceWatch::TimePoint(std::chrono::duration_cast<std::chrono::system_clock::duration>(Hours(hours)));
+}
+
+BalanceWatch::BalanceWatch()
+    : exposures(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                PoolAllocator<std::pair<const std::string, Exposure>>(&pool)),
+      byDepletion(std::less<Key>(), PoolAllocator<Key>(&pool)),
+      awaitingAlert(std::less<Key>(), PoolAllocator<Key>(&pool)) {
+}
+
+void BalanceWatch::addRental(const std::string& userId, double balance, double pricePerHour, double hours,
+                             TimePoint start, double billed) {
+    Exposure& exposure = exposures[userId];
+    ++exposure.running;
+    exposure.balance = balance;
+    exposure.rate += pricePerHour;
+    exposure.weightedStart += pricePerHour * toHours(start);
+    exposure.booked += pricePerHour * hours;
+    exposure.billed += billed;
+    reposition(userId, exposure);
+}
+
+void BalanceWatch::removeRental(const std::string& userId, double balance, double pricePerHour, double hours,
+                                TimePoint start, double billed) {
+    auto it = exposures.find(userId);
+    if (it == exposures.end() || it->second.running == 0) return;
+    Exposure& exposure = it->second;
+    exposure.balance = balance;
+    if (--exposure.running == 0) { // Exact zeros, so rounding does not build up
+        exposure.rate = exposure.weightedStart = exposure.booked = exposure.billed = 0.0;
+    } else {
+        exposure.rate -= pricePerHour;
+        exposure.weightedStart -= pricePerHour * toHours(start);
+        exposure.booked -= pricePerHour * hours;
+        exposure.billed -= billed;
+    }
+    reposition(userId, exposure);
+}
+
+void BalanceWatch::addBilled(const std::string& userId, double amount) {
+    auto it = exposures.find(userId);
+    if (it == exposures.end() || it->second.running == 0) return;
+    it->second.billed += amount;
+    reposition(userId, it->second);
+}
+
+void BalanceWatch::repriceRental(const std::string& userId, double oldPricePerHour, double newPricePerHour,
+                                 double hours, TimePoint start) {
+    auto it = exposures.find(userId);
+    if (it == exposures.end() || it->second.running == 0) return;
+    Exposure& exposure = it->second;
+    double change = newPricePerHour - oldPricePerHour;
+    exposure.rate += change;
+    exposure.weightedStart += change * toHours(start);
+    exposure.booked += change * hours;
+    reposition(userId, exposure);
+}
+
+void BalanceWatch::setBalance(const std::string& userId, double balance) {
+    auto it = exposures.find(userId);
+    if (it == exposures.end()) {
+        if (balance >= 0) return; // Not running anything and not negative
+        it = exposures.emplace(userId, Exposure()).first;
+    }
+    it->second.balance = balance;
+    reposition(userId, it->second);
+}
+
+void BalanceWatch::removeUser(const std::string& userId) {
+    auto it = exposures.find(userId);
+    if (it == exposures.end()) return;
+    if (it->second.atRisk) {
+        byDepletion.erase(Key(it->second.depletion, userId));
+        awaitingAlert.erase(Key(it->second.depletion, userId));
+    }
+    exposures.erase(it);
+}
+
+void BalanceWatch::reposition(const std::string& userId, Exposure& exposure) {
+    double committed = exposure.booked - exposure.billed;
+    bool atRisk = exposure.balance < 0 || (exposure.running > 0 && exposure.balance < committed - 1e-9);
+    TimePoint depletion; // The epoch: already negative
+    if (atRisk && exposure.balance >= 0) {
+        // Unbilled spend at time t is rate * t - weightedStart - billed; it passes the balance at:
+        depletion = fromHours((exposure.balance + exposure.weightedStart + exposure.billed) / exposure.rate);
+    }
+
+    if (exposure.atRisk && (!atRisk || depletion != exposure.depletion)) {
+        byDepletion.erase(Key(exposure.depletion, userId));
+        if (!exposure.alerted) awaitingAlert.erase(Key(exposure.depletion, userId));
+    }
+    if (atRisk && (!exposure.atRisk || depletion != exposure.depletion)) {
+        byDepletion.insert(Key(depletion, userId));
+        if (!exposure.alerted) awaitingAlert.insert(Key(depletion, userId));
+    }
+    if (!atRisk && exposure.alerted && !exposure.recovering) {
+        exposure.recovering = true;
+        recovered.push_back(userId);
+    }
+    exposure.atRisk = atRisk;
+    exposure.depletion = depletion;
+    if (!atRisk && exposure.running == 0 && !exposure.alerted) exposures.erase(userId);
+}
+
+BalanceRisk BalanceWatch::riskOf(const std::string& userId, const Exposure& exposure) const {
+    BalanceRisk risk;
+    risk.userId = userId;
+    risk.balance = exposure.balance;
+    risk.committed = exposure.booked - exposure.billed;
+    risk.projectedBalance = exposure.balance - risk.committed;
+    risk.depletion = exposure.depletion;
+    return risk;
+}
+
+bool BalanceWatch::find(const std::string& userId, BalanceRisk& risk) const {
+    auto it = exposures.find(userId);
+    if (it == exposures.end() || !it->second.atRisk) return false;
+    risk = riskOf(userId, it->second);
+    return true;
+}
+
+std::vector<BalanceRisk> BalanceWatch::atRiskBefore(TimePoint deadline) const {
+    std::vector<BalanceRisk> risks;
+    for (auto it = byDepletion.begin(); it != byDepletion.end() && it->first <= deadline; ++it) {
+        risks.push_back(riskOf(it->second, exposures.find(it->second)->second));
+    }
+    return risks;
+}
+
+size_t BalanceWatch::atRiskCount() const {
+    return byDepletion.size();
+}
+
+std::vector<std::string> BalanceWatch::takeDueAlerts(TimePoint deadline) {
+    for (const std::string& userId : recovered) {
+        auto it = exposures.find(userId);
+        if (it == exposures.end() || !it->second.recovering) continue;
+        Exposure& exposure = it->second;
+        exposure.recovering = false;
+        if (exposure.atRisk) continue; // Back at risk meanwhile: still alerted
+        exposure.alerted = false;      // Alert again if the user drifts back
+        if (exposure.running == 0) exposures.erase(it);
+    }
+    recovered.clear();
+
+    std::vector<std::string> due;
+    while (!awaitingAlert.empty() && awaitingAlert.begin()->first <= deadline) {
+        due.push_back(awaitingAlert.begin()->second);
+        exposures.find(due.back())->second.alerted = true;
+        awaitingAlert.erase(awaitingAlert.begin());
+    }
+    return due;
+}
@@ -0,0 +1,375 @@
+#include "BatchRunner.h"
+#include "BulkImporter.h"
+#include "System.h"
+#include "Utils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <streambuf>
+
+// Stands in for std::cout during a batch. Keeps the last complete line so a
+// failed command's error message can be reported, and optionally forwards
+// everything to another buffer.
+class LastLineBuffer : public std::streambuf {
+private:
+    std::streambuf* forward;
+    std::string current;
+    std::string last;
+
+protected:
+    int overflow(int c) override {
+        if (c == traits_type::eof()) return traits_type::not_eof(c);
+        if (c == '\n') {
+            last.swap(current);
+            current.clear();
+        } else {
+            current += static_cast<char>(c);
+        }
+        if (forward) forward->sputc(static_cast<char>(c));
+        return c;
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        for (std::streamsize i = 0; i < size; ++i) overflow(static_cast<unsigned char>(data[i]));
+        return size;
+    }
+
+    int sync() override { return forward ? forward->pubsync() : 0; }
+
+public:
+    explicit LastLineBuffer(std::streambuf* target) : forward(target) {}
+
+    void clear() {
+        current.clear();
+        last.clear();
+    }
+
+    std::string lastLine() const { return current.empty() ? last : current; }
+};
+
+static bool parseRole(const std::string& value, UserRole& role) {
+    if (value == "student") { role = UserRole::STUDENT; return true; }
+    if (value == "teacher") { role = UserRole::TEACHER; return true; }
+    if (value == "admin")   { role = UserRole::ADMIN;   return true; }
+    return false;
+}
+
+static bool parseResourceType(const std::string& value, ResourceType& type) {
+    if (value == "cpu")     { type = ResourceType::CPU;     return true; }
+    if (value == "gpu")     { type = ResourceType::GPU;     return true; }
+    if (value == "storage") { type = ResourceType::STORAGE; return true; }
+    return false;
+}
+
+static const char* roleName(UserRole role) {
+    switch (role) {
+        case UserRole::STUDENT: return "student";
+        case UserRole::TEACHER: return "teacher";
+        case UserRole::ADMIN:   return "admin";
+    }
+    return "unknown";
+}
+
+static bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Number of arguments each command takes
+struct CommandSpec {
+    const char* name;
+    size_t arguments;
+};
+
+static const CommandSpec commandSpecs[] = {
+    { "login", 2 }, { "logout", 0 }, { "register", 4 }, { "passwd", 1 }, { "rename", 1 },
+    { "add-resource", 4 }, { "delete-resource", 1 }, { "request", 2 }, { "cancel", 1 },
+    { "approve", 1 }, { "reject", 2 }, { "complete", 1 }, { "suspend", 1 }, { "activate", 1 },
+    { "import", 2 }, { "list", 1 }
+};
+
+static const CommandSpec* findCommand(const std::string& name) {
+    for (const auto& spec : commandSpecs) {
+        if (name == spec.name) return &spec;
+    }
+    return nullptr;
+}
+
+BatchRunner::BatchRunner(System& sys, std::ostream& output, std::ostream& errorOutput, const BatchOptions& batchOptions)
+    : system(sys), out(output.rdbuf()), errors(errorOutput), options(batchOptions) {}
+
+BatchReport BatchRunner::run(std::istream& script) {
+    typedef std::chrono::steady_clock Clock;
+    BatchReport report;
+    LastLineBuffer console(options.echoSystemOutput ? out.rdbuf() : nullptr);
+    ScopedCoutRedirect capture(&console);
+
+    Clock::time_point runStart = Clock::now();
+    std::string line;
+    size_t lineNumber = 0;
+    bool inGroup = false;
+    bool groupFailed = false;
+    size_t groupStartLine = 0;
+    while (std::getline(script, line)) {
+        ++lineNumber;
+        std::vector<std::string> words = splitCommandLine(line);
+        if (words.empty() || words[0][0] == '#') continue;
+
+        if (words[0] == "begin" || words[0] == "commit") {
+            bool begin = words[0] == "begin";
+            if (words.size() != 1 || begin == inGroup) {
+                errors << "line " << lineNumber << ": "
+                       << (words.size() != 1 ? "begin and commit take no arguments"
+                                             : begin ? "begin inside a group" : "commit without begin")
+                       << std::endl;
+                ++report.failed;
+                if (options.stopOnError) break;
+                continue;
+            }
+            if (begin) {
+                system.beginTransaction();
+            } else if (!groupFailed) {
+                system.commitTransaction();
+            }
+            inGroup = begin;
+            groupFailed = false;
+            groupStartLine = lineNumber;
+            continue;
+        }
+        if (inGroup && groupFailed) {
+            ++report.skipped;
+            continue;
+        }
+
+        for (auto& word : words) {
+            if (word == "$last") word = lastRentalId;
+        }
+        console.clear();
+        std::string error;
+        Clock::time_point started = Clock::now();
+        bool ok = execute(words, error);
+        double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+        BatchCommandStats& stats = report.byCommand[findCommand(words[0]) ? words[0] : "(unknown)"];
+        ++stats.count;
+        stats.seconds += seconds;
+        ++report.commands;
+        if (!ok) {
+            ++stats.failed;
+            ++report.failed;
+            if (error.empty()) error = console.lastLine();
+            errors << "line " << lineNumber << ": " << line << ": " << (error.empty() ? "failed" : error) << std::endl;
+            if (inGroup) {
+                groupFailed = true;
+                system.rollbackTransaction();
+                errors << "line " << lineNumber << ": rolled back the group started on line "
+                       << groupStartLine << ", skipping the rest of it" << std::endl;
+            }
+            if (options.stopOnError) break;
+        }
+    }
+    if (inGroup) {
+        if (!groupFailed) system.rollbackTransaction();
+        errors << "line " << lineNumber << ": group started on line " << groupStartLine
+               << " has no commit; rolled back" << std::endl;
+        ++report.failed;
+    }
+    report.seconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+    std::cout.flush();
+    out.flush();
+    return report;
+}
+
+bool BatchRunner::execute(const std::vector<std::string>& words, std::string& error) {
+    const std::string& command = words[0];
+    const CommandSpec* spec = findCommand(command);
+    if (!spec) {
+        error = "unknown command";
+        return false;
+    }
+    if (words.size() - 1 != spec->arguments) {
+        error = command + " takes " + std::to_string(spec->arguments) + " argument(s)";
+        return false;
+    }
+
+    if (command == "login") return login(words[1], words[2], error);
+    if (command == "logout") {
+        system.logoutUser();
+        return true;
+    }
+    if (command == "register") {
+        UserRole role;
+        if (!parseRole(words[3], role)) {
+            error = "unknown role '" + words[3] + "'";
+            return false;
+        }
+        return system.registerUser(words[1], words[2], role, words[4]);
+    }
+    if (command == "passwd") {
+        User* user = system.getCurrentUser();
+        if (!system.updateCurrentUserPassword(words[1])) return false;
+        verifiedLogins.erase(user->getUsername());
+        return true;
+    }
+    if (command == "rename") return system.updateCurrentUserName(words[1]);
+    if (command == "add-resource") {
+        ResourceType type;
+        char* end = nullptr;
+        double price = std::strtod(words[4].c_str(), &end);
+        if (!parseResourceType(words[2], type) || end != words[4].c_str() + words[4].size()) {
+            error = "expected add-resource ID cpu|gpu|storage NAME PRICE";
+            return false;
+        }
+        User* user = system.getCurrentUser();
+        if (!user || user->getRole() != UserRole::ADMIN) {
+            error = "Error: Admin privileges required to add resources.";
+            return false;
+        }
+        return system.addResource(Resource(words[1], type, words[3], {}, price));
+    }
+    if (command == "delete-resource") return system.adminDeleteResource(words[1]);
+    if (command == "request") {
+        int hours = std::atoi(words[2].c_str());
+        if (!system.requestResourceRental(words[1], hours)) return false;
+        Page<Rental> newest = system.listUserRentals(system.getCurrentUser()->getUserId(),
+                                                     PageRequest(1, PageOrder::NEWEST_FIRST));
+        lastRentalId = newest.items.front()->getRentalId();
+        return true;
+    }
+    if (command == "cancel") return system.cancelRentalRequest(words[1]);
+    if (command == "approve") return system.adminApproveRental(words[1]);
+    if (command == "reject") return system.adminRejectRental(words[1], words[2]);
+    if (command == "complete") {
+        User* user = system.getCurrentUser();
+        if (!user || user->getRole() != UserRole::ADMIN) {
+            error = "Error: Admin privileges required to complete rentals.";
+            return false;
+        }
+        return system.processRentalCompletion(words[1]);
+    }
+    if (command == "suspend") return system.adminSetUserStatus(words[1], UserStatus::SUSPENDED);
+    if (command == "activate") return system.adminSetUserStatus(words[1], UserStatus::ACTIVE);
+    if (command == "import") return import(words[1], words[2], error);
+    return list(words[1], error);
+}
+
+bool BatchRunner::login(const std::string& username, const std::string& password, std::string& error) {
+    std::string digest = PasswordHasher::sha256(password);
+    auto cached = verifiedLogins.find(username);
+    if (cached != verifiedLogins.end() &&
+        PasswordHasher::constantTimeEquals(cached->second.passwordDigest, digest) &&
+        system.switchToUser(cached->second.userId)) {
+        return true; // Still active with the password it logged in with before
+    }
+    User* user = system.loginUser(username, password);
+    if (!user) return false;
+    CachedLogin entry;
+    entry.passwordDigest = digest;
+    entry.userId = user->getUserId();
+    verifiedLogins[username] = entry;
+    return true;
+}
+
+bool BatchRunner::list(const std::string& what, std::string& error) {
+    User* user = system.getCurrentUser();
+    bool admin = user && user->getRole() == UserRole::ADMIN;
+    PageRequest request(1000);
+    char amount[32];
+    if (what == "resources") {
+        do {
+            Page<Resource> page = system.listResources(request);
+            for (const Resource* resource : page.items) {
+                std::snprintf(amount, sizeof(amount), "%.2f", resource->getPricePerHour());
+                out << resource->getResourceId() << ' ' << resource->resourceTypeToString() << " \""
+                    << resource->getName() << "\" " << amount << '\n';
+            }
+            request.cursor = page.nextCursor;
+        } while (!request.cursor.empty());
+        return true;
+    }
+    if (what == "users") {
+        if (!admin) {
+            error = "Error: Admin privileges required to list users.";
+            return false;
+        }
+        do {
+            Page<User> page = system.adminListUsers(request);
+            for (const User* listed : page.items) {
+                std::snprintf(amount, sizeof(amount), "%.2f", listed->getBalance());
+                out << listed->getUserId() << ' ' << listed->getUsername() << ' ' << roleName(listed->getRole())
+                    << ' ' << (listed->getStatus() == UserStatus::ACTIVE ? "active" : "suspended") << ' ' << amount
+                    << '\n';
+            }
+            request.cursor = page.nextCursor;
+        } while (!request.cursor.empty());
+        return true;
+    }
+    if (what != "rentals" && what != "bills") {
+        error = "expected list resources|rentals|bills|users";
+        return false;
+    }
+    if (!user) {
+        error = "Error: No user logged in.";
+        return false;
+    }
+    do {
+        if (what == "rentals") {
+            Page<Rental> page = admin ? system.adminListRentals(request)
+                                      : system.listUserRentals(user->getUserId(), request);
+            for (const Rental* rental : page.items) {
+                std::snprintf(amount, sizeof(amount), "%.2f", rental->getTotalCost());
+                out << rental->getRentalId() << ' ' << rental->getUserId() << ' ' << rental->getResourceId() << ' '
+                    << rental->rentalStatusToString() << ' ' << amount << '\n';
+            }
+            request.cursor = page.nextCursor;
+        } else {
+            Page<Bill> page = admin ? system.adminListBills(request) : system.listUserBills(user->getUserId(), request);
+            for (const Bill* bill : page.items) {
+                std::snprintf(amount, sizeof(amount), "%.2f", bill->getAmount());
+                out << bill->getBillId() << ' ' << bill->getRentalId() << ' ' << bill->getUserId() << ' ' << amount
+                    << (bill->getIsPaid() ? " paid" : " unpaid") << '\n';
+            }
+            request.cursor = page.nextCursor;
+        }
+    } while (!request.cursor.empty());
+    return true;
+}
+
+bool BatchRunner::import(const std::string& what, const std::string& path, std::string& error) {
+    if (what != "users" && what != "resources") {
+        error = "expected import users|resources FILE";
+        return false;
+    }
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        error = "cannot open '" + path + "'";
+        return false;
+    }
+    ImportFormat format = endsWith(path, ".jsonl") ? ImportFormat::JSONL : ImportFormat::CSV;
+    BulkImporter importer(system);
+    ImportReport imported = what == "users" ? importer.importUsers(file, format) : importer.importResources(file, format);
+    if (imported.errorCount == 0) return true;
+    error = std::to_string(imported.errorCount) + " row(s) rejected";
+    if (!imported.errors.empty()) {
+        error += ", first on line " + std::to_string(imported.errors.front().line) + ": " +
+                 imported.errors.front().message;
+    }
+    return false;
+}
+
+void BatchRunner::printReport(const BatchReport& report, std::ostream& out) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%zu command(s), %zu failed, %zu skipped in %.3f s (%.0f commands/sec)",
+                  report.commands, report.failed, report.skipped, report.seconds,
+                  report.seconds > 0 ? report.commands / report.seconds : 0.0);
+    out << line << '\n';
+    std::snprintf(line, sizeof(line), "%-16s %10s %8s %12s %12s", "command", "count", "failed", "total ms", "mean us");
+    out << line << '\n';
+    for (const auto& entry : report.byCommand) {
+        const BatchCommandStats& stats = entry.second;
+        std::snprintf(line, sizeof(line), "%-16s %10zu %8zu %12.3f %12.2f", entry.first.c_str(), stats.count,
+                      stats.failed, stats.seconds * 1e3, stats.count ? stats.seconds * 1e6 / stats.count : 0.0);
+        out << line << '\n';
+    }
+    out.flush();
+}
@@ -1,24 +1,32 @@
 #include "Bill.h"
+#include "Trace.h"
 #include "Utils.h" // For formatTimePoint
 #include <iostream>
+#include <utility> // For std::move
 #include <iomanip> // For std::fixed, std::setprecision
 
 // Constructor
 Bill::Bill(std::string bId, std::string rId, std::string uId, double amt)
-    : billId(bId), rentalId(rId), userId(uId), amount(amt),
-      billDate(std::chrono::system_clock::now()), isPaid(false) {
+    : billId(std::move(bId)), rentalId(std::move(rId)), userId(std::move(uId)), amount(amt),
+      billDate(std::chrono::system_clock::now()), isPaid(false), ledgerSequence(0) {
+}
+
+Bill::Bill(std::string bId, std::string rId, std::string uId, double amt,
+           std::chrono::system_clock::time_point date, bool paid)
+    : billId(std::move(bId)), rentalId(std::move(rId)), userId(std::move(uId)), amount(amt),
+      billDate(date), isPaid(paid), ledgerSequence(0) {
 }
 
 // Getters
-std::string Bill::getBillId() const {
+const std::string& Bill::getBillId() const {
     return billId;
 }
 
-std::string Bill::getRentalId() const {
+const std::string& Bill::getRentalId() const {
     return rentalId;
 }
 
-std::string Bill::getUserId() const {
+const std::string& Bill::getUserId() const {
     return userId;
 }
 
@@ -34,13 +42,22 @@ bool Bill::getIsPaid() const {
     return isPaid;
 }
 
+size_t Bill::getLedgerSequence() const {
+    return ledgerSequence;
+}
+
 // Setters
 void Bill::setPaid(bool status) {
     this->isPaid = status;
 }
 
+void Bill::setLedgerSequence(size_t sequence) {
+    this->ledgerSequence = sequence;
+}
+
 // Display and helper functions
 void Bill::displayBillInfo() const {
+    TRACE_SCOPE("Bill::displayBillInfo");
     std::cout << "----------------------------------------" << std::endl;
     std::cout << "Bill ID: " << billId << std::endl;
     std::cout << "Rental ID: " << rentalId << std::endl;
@@ -0,0 +1,236 @@
+#include "BillArchive.h"
+#include "Exception.h"
+#include "Utils.h" // For parseUniqueId
+#include "Trace.h"
+#include <cmath>   // For std::llround
+#include <limits>
+#include <utility> // For std::move
+
+// Varint helpers (LEB128). Signed values are zigzag encoded first so small
+// negative deltas stay small.
+static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint64_t getVarint(const std::vector<uint8_t>& in, size_t& pos) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (true) {
+        // Segments are only written by sealSegment, so running off the end means memory corruption
+        if (pos >= in.size() || shift > 63) {
+            throw CorruptDataException("Bill archive segment holds a truncated or oversized varint");
+        }
+        uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+        shift += 7;
+    }
+}
+
+static void putSigned(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+static int64_t getSigned(const std::vector<uint8_t>& in, size_t& pos) {
+    uint64_t raw = getVarint(in, pos);
+    return static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+}
+
+static int64_t timePointToTicks(std::chrono::system_clock::time_point tp) {
+    return static_cast<int64_t>(tp.time_since_epoch().count());
+}
+
+static std::chrono::system_clock::time_point ticksToTimePoint(int64_t ticks) {
+    return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+}
+
+size_t BillSegment::memoryBytes() const {
+    return sizeof(BillSegment) + billIds.capacity() + rentalIds.capacity() + userIds.capacity()
+           + dates.capacity() + amounts.capacity() + paidBits.capacity();
+}
+
+// Constructor
+BillArchive::BillArchive(size_t billsPerSegment)
+    : segmentCapacity(billsPerSegment == 0 ? 1 : billsPerSegment), totalBills(0) {
+}
+
+bool BillArchive::canArchive(const Bill& bill) {
+    long long number;
+    return parseUniqueId(bill.getBillId(), "bill_", number)
+        && parseUniqueId(bill.getRentalId(), "rental_", number)
+        && parseUniqueId(bill.getUserId(), "user_", number);
+}
+
+size_t BillArchive::archive(const std::vector<const Bill*>& billsToArchive) {
+    std::vector<const Bill*> batch;
+    batch.reserve(segmentCapacity);
+    size_t archived = 0;
+    for (const Bill* bill : billsToArchive) {
+        if (!canArchive(*bill)) {
+            continue;
+        }
+        batch.push_back(bill);
+        if (batch.size() == segmentCapacity) {
+            sealSegment(batch);
+            archived += batch.size();
+            batch.clear();
+        }
+    }
+    if (!batch.empty()) {
+        sealSegment(batch);
+        archived += batch.size();
+    }
+    return archived;
+}
+
+void BillArchive::sealSegment(const std::vector<const Bill*>& batch) {
+    TRACE_SCOPE("BillArchive::sealSegment");
+    BillSegment segment;
+    segment.count = batch.size();
+    segment.minDate = std::numeric_limits<int64_t>::max();
+    segment.maxDate = std::numeric_limits<int64_t>::min();
+    segment.minUserNumber = std::numeric_limits<long long>::max();
+    segment.maxUserNumber = std::numeric_limits<long long>::min();
+    segment.userMask = 0;
+    segment.paidBits.assign((batch.size() + 7) / 8, 0);
+
+    long long prevBill = 0, prevRental = 0, prevUser = 0;
+    int64_t prevDate = 0, prevCents = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const Bill& bill = *batch[i];
+        long long billNumber = 0, rentalNumber = 0, userNumber = 0;
+        parseUniqueId(bill.getBillId(), "bill_", billNumber);
+        parseUniqueId(bill.getRentalId(), "rental_", rentalNumber);
+        parseUniqueId(bill.getUserId(), "user_", userNumber);
+        int64_t date = timePointToTicks(bill.getBillDate());
+        int64_t cents = static_cast<int64_t>(std::llround(bill.getAmount() * 100.0));
+
+        putSigned(segment.billIds, billNumber - prevBill);
+        putSigned(segment.rentalIds, rentalNumber - prevRental);
+        putSigned(segment.userIds, userNumber - prevUser);
+        putSigned(segment.dates, date - prevDate);
+        putSigned(segment.amounts, cents - prevCents);
+        if (bill.getIsPaid()) {
+            segment.paidBits[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+        }
+        prevBill = billNumber;
+        prevRental = rentalNumber;
+        prevUser = userNumber;
+        prevDate = date;
+        prevCents = cents;
+
+        if (date < segment.minDate) segment.minDate = date;
+        if (date > segment.maxDate) segment.maxDate = date;
+        if (userNumber < segment.minUserNumber) segment.minUserNumber = userNumber;
+        if (userNumber > segment.maxUserNumber) segment.maxUserNumber = userNumber;
+        segment.userMask |= 1ULL << (static_cast<unsigned long long>(userNumber) % 64);
+    }
+
+    segment.billIds.shrink_to_fit();
+    segment.rentalIds.shrink_to_fit();
+    segment.userIds.shrink_to_fit();
+    segment.dates.shrink_to_fit();
+    segment.amounts.shrink_to_fit();
+
+    segments.push_back(std::move(segment));
+    totalBills += batch.size();
+}
+
+// Decodes the bills of one segment that fall into [fromTicks, toTicks] and,
+// if userId is given, belong to that user.
+void BillArchive::decodeSegment(const BillSegment& segment, const std::string* userId,
+                                int64_t fromTicks, int64_t toTicks, std::vector<Bill>& out) const {
+    TRACE_SCOPE("BillArchive::decodeSegment");
+    long long wantedUser = -1;
+    if (userId && !parseUniqueId(*userId, "user_", wantedUser)) {
+        return;
+    }
+
+    size_t billPos = 0, rentalPos = 0, userPos = 0, datePos = 0, amountPos = 0;
+    long long billNumber = 0, rentalNumber = 0, userNumber = 0;
+    int64_t date = 0, cents = 0;
+    for (size_t i = 0; i < segment.count; ++i) {
+        // Every column has to be advanced since values are deltas of the previous row
+        billNumber += getSigned(segment.billIds, billPos);
+        rentalNumber += getSigned(segment.rentalIds, rentalPos);
+        userNumber += getSigned(segment.userIds, userPos);
+        date += getSigned(segment.dates, datePos);
+        cents += getSigned(segment.amounts, amountPos);
+
+        if (date < fromTicks || date > toTicks) continue;
+        if (userId && userNumber != wantedUser) continue;
+
+        bool paid = (segment.paidBits[i / 8] >> (i % 8)) & 1;
+        out.emplace_back("bill_" + std::to_string(billNumber),
+                         "rental_" + std::to_string(rentalNumber),
+                         "user_" + std::to_string(userNumber),
+                         static_cast<double>(cents) / 100.0, ticksToTimePoint(date), paid);
+    }
+}
+
+std::vector<Bill> BillArchive::findByDate(std::chrono::system_clock::time_point from,
+                                          std::chrono::system_clock::time_point to) const {
+    std::vector<Bill> result;
+    int64_t fromT = timePointToTicks(from), toT = timePointToTicks(to);
+    for (const auto& segment : segments) {
+        if (segment.maxDate < fromT || segment.minDate > toT) continue; // Pruned by date range
+        decodeSegment(segment, nullptr, fromT, toT, result);
+    }
+    return result;
+}
+
+std::vector<Bill> BillArchive::findByUser(const std::string& userId,
+                                          std::chrono::system_clock::time_point from,
+                                          std::chrono::system_clock::time_point to) const {
+    std::vector<Bill> result;
+    long long userNumber;
+    if (!parseUniqueId(userId, "user_", userNumber)) {
+        return result; // Such a user can never be in the archive
+    }
+    int64_t fromT = timePointToTicks(from), toT = timePointToTicks(to);
+    uint64_t bit = 1ULL << (static_cast<unsigned long long>(userNumber) % 64);
+    for (const auto& segment : segments) {
+        if (segment.maxDate < fromT || segment.minDate > toT) continue;
+        if (userNumber < segment.minUserNumber || userNumber > segment.maxUserNumber) continue;
+        if (!(segment.userMask & bit)) continue;
+        decodeSegment(segment, &userId, fromT, toT, result);
+    }
+    return result;
+}
+
+void BillArchive::findByDateInSegment(size_t segmentIndex, std::chrono::system_clock::time_point from,
+                                      std::chrono::system_clock::time_point to, std::vector<Bill>& out) const {
+    if (segmentIndex >= segments.size()) return;
+    const BillSegment& segment = segments[segmentIndex];
+    int64_t fromT = timePointToTicks(from), toT = timePointToTicks(to);
+    if (segment.maxDate < fromT || segment.minDate > toT) return;
+    decodeSegment(segment, nullptr, fromT, toT, out);
+}
+
+std::vector<Bill> BillArchive::getAll() const {
+    return findByDate(std::chrono::system_clock::time_point::min(),
+                      std::chrono::system_clock::time_point::max());
+}
+
+// Statistics
+size_t BillArchive::size() const {
+    return totalBills;
+}
+
+size_t BillArchive::segmentCount() const {
+    return segments.size();
+}
+
+size_t BillArchive::memoryBytes() const {
+    size_t bytes = sizeof(BillArchive);
+    for (const auto& segment : segments) {
+        bytes += segment.memoryBytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,467 @@
+#include "BulkImporter.h"
+#include "System.h"
+#include "Utils.h" // For generateUniqueId
+#include "PasswordHasher.h" // Pre-hashed credentials
+#include <chrono>
+#include <cstring> // For std::memchr, std::strcmp
+#include <cstdlib> // For std::strtod
+#include <algorithm> // For std::min
+
+// Case-insensitive comparison of a field against a lowercase keyword
+static bool equalsIgnoreCase(const std::string& value, const char* keyword) {
+    size_t i = 0;
+    for (; i < value.size() && keyword[i]; ++i) {
+        char c = value[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c != keyword[i]) return false;
+    }
+    return i == value.size() && keyword[i] == '\0';
+}
+
+static bool parseRole(const std::string& value, UserRole& role) {
+    if (equalsIgnoreCase(value, "student")) { role = UserRole::STUDENT; return true; }
+    if (equalsIgnoreCase(value, "teacher")) { role = UserRole::TEACHER; return true; }
+    if (equalsIgnoreCase(value, "admin"))   { role = UserRole::ADMIN;   return true; }
+    return false;
+}
+
+static bool parseResourceType(const std::string& value, ResourceType& type) {
+    if (equalsIgnoreCase(value, "cpu"))     { type = ResourceType::CPU;     return true; }
+    if (equalsIgnoreCase(value, "gpu"))     { type = ResourceType::GPU;     return true; }
+    if (equalsIgnoreCase(value, "storage")) { type = ResourceType::STORAGE; return true; }
+    return false;
+}
+
+static bool parseNumber(const std::string& value, double& number) {
+    if (value.empty()) return false;
+    char* end = nullptr;
+    number = std::strtod(value.c_str(), &end);
+    return end == value.c_str() + value.size();
+}
+
+// Appends a code point as UTF-8 (used for \uXXXX escapes)
+static void appendUtf8(std::string& out, unsigned codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+static void skipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+}
+
+// Parses a JSON string starting at the opening quote
+static bool parseJsonString(const char*& p, const char* end, std::string& out) {
+    out.clear();
+    if (p >= end || *p != '"') return false;
+    ++p;
+    while (p < end) {
+        char c = *p++;
+        if (c == '"') return true;
+        if (c != '\\') { out += c; continue; }
+        if (p >= end) return false;
+        char e = *p++;
+        switch (e) {
+            case '"': case '\\': case '/': out += e; break;
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (end - p < 4) return false;
+                unsigned codePoint = 0;
+                for (int i = 0; i < 4; ++i, ++p) {
+                    char h = *p;
+                    codePoint <<= 4;
+                    if (h >= '0' && h <= '9') codePoint |= h - '0';
+                    else if (h >= 'a' && h <= 'f') codePoint |= h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F') codePoint |= h - 'A' + 10;
+                    else return false;
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default: return false;
+        }
+    }
+    return false; // Unterminated string
+}
+
+// Parses a scalar (string, number, true/false/null) into its text form
+static bool parseJsonScalar(const char*& p, const char* end, std::string& out) {
+    if (p < end && *p == '"') return parseJsonString(p, end, out);
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t') ++p;
+    if (p == start) return false;
+    out.assign(start, p);
+    if (out == "null") out.clear();
+    return true;
+}
+
+// Constructor
+BulkImporter::BulkImporter(System& sys, size_t chunkBytes, size_t maxErrors)
+    : system(sys), chunkSize(chunkBytes < 4096 ? 4096 : chunkBytes), maxReportedErrors(maxErrors), fieldCount(0) {
+}
+
+void BulkImporter::addError(ImportReport& report, size_t line, const std::string& message) {
+    ++report.errorCount;
+    if (report.errors.size() < maxReportedErrors) {
+        ImportError error;
+        error.line = line;
+        error.message = message;
+        report.errors.push_back(error);
+    }
+}
+
+// Reads the stream chunk by chunk and calls handleRow(lineNumber, begin, end) for
+// every line. A line split across two chunks is carried over to the next one.
+template <typename RowHandler>
+void BulkImporter::readLines(std::istream& in, RowHandler handleRow) {
+    std::vector<char> buffer(chunkSize);
+    std::string carry;
+    size_t lineNumber = 0;
+
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        size_t got = static_cast<size_t>(in.gcount());
+        if (got == 0) break;
+
+        const char* p = buffer.data();
+        const char* end = p + got;
+        if (!carry.empty()) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!newline) {
+                carry.append(p, end);
+                continue;
+            }
+            carry.append(p, newline);
+            handleRow(++lineNumber, carry.data(), carry.data() + carry.size());
+            carry.clear();
+            p = newline + 1;
+        }
+        const char* newline;
+        while (p < end && (newline = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr) {
+            handleRow(++lineNumber, p, newline);
+            p = newline + 1;
+        }
+        carry.assign(p, end);
+    }
+    if (!carry.empty()) {
+        handleRow(++lineNumber, carry.data(), carry.data() + carry.size());
+    }
+}
+
+// Estimates the number of rows left in a seekable stream by sampling the
+// average line length of its first chunk. Returns 0 if the stream cannot seek.
+static size_t estimateRows(std::istream& in, size_t sampleBytes) {
+    std::streampos start = in.tellg();
+    if (start == std::streampos(-1)) return 0;
+    in.seekg(0, std::ios::end);
+    std::streampos finish = in.tellg();
+    in.seekg(start);
+    if (finish == std::streampos(-1) || finish <= start) {
+        in.clear();
+        in.seekg(start);
+        return 0;
+    }
+    size_t totalBytes = static_cast<size_t>(finish - start);
+
+    std::vector<char> sample(std::min(sampleBytes, totalBytes));
+    in.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+    size_t got = static_cast<size_t>(in.gcount());
+    in.clear();
+    in.seekg(start);
+
+    size_t lines = 0;
+    for (size_t i = 0; i < got; ++i) {
+        if (sample[i] == '\n') ++lines;
+    }
+    if (lines == 0) return 1;
+    return totalBytes / (got / lines) + 1;
+}
+
+// Splits one line into fields (CSV) or key/value pairs (JSONL).
+// For JSONL a nested "specs" object is parsed straight into `specs`.
+bool BulkImporter::splitRow(const char* begin, const char* end, ImportFormat format, std::string& error) {
+    fieldCount = 0;
+    specs.clear();
+
+    if (format == ImportFormat::CSV) {
+        const char* p = begin;
+        while (true) {
+            if (fields.size() <= fieldCount) fields.resize(fieldCount + 1);
+            std::string& out = fields[fieldCount++];
+            out.clear();
+            if (p < end && *p == '"') { // Quoted field, "" is an escaped quote
+                ++p;
+                while (true) {
+                    if (p >= end) { error = "Unterminated quoted field"; return false; }
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') { out += '"'; p += 2; continue; }
+                        ++p;
+                        break;
+                    }
+                    out += *p++;
+                }
+                if (p < end && *p != ',') { error = "Unexpected character after quoted field"; return false; }
+            } else {
+                const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+                const char* fieldEnd = comma ? comma : end;
+                out.assign(p, fieldEnd);
+                p = fieldEnd;
+            }
+            if (p >= end) return true;
+            ++p; // Skip the comma
+        }
+    }
+
+    const char* p = begin;
+    skipSpaces(p, end);
+    if (p >= end || *p != '{') { error = "Expected a JSON object"; return false; }
+    ++p;
+    skipSpaces(p, end);
+    if (p < end && *p == '}') return true;
+    while (true) {
+        if (fields.size() <= fieldCount) fields.resize(fieldCount + 1);
+        if (keys.size() <= fieldCount) keys.resize(fieldCount + 1);
+        skipSpaces(p, end);
+        if (!parseJsonString(p, end, keys[fieldCount])) { error = "Expected a JSON key"; return false; }
+        skipSpaces(p, end);
+        if (p >= end || *p != ':') { error = "Expected ':' after key"; return false; }
+        ++p;
+        skipSpaces(p, end);
+        if (p < end && *p == '{') { // Nested object of string values (resource specs)
+            ++p;
+            fields[fieldCount].clear();
+            std::string specKey, specValue;
+            skipSpaces(p, end);
+            if (p < end && *p == '}') {
+                ++p;
+            } else {
+                while (true) {
+                    skipSpaces(p, end);
+                    if (!parseJsonString(p, end, specKey)) { error = "Expected a key in nested object"; return false; }
+                    skipSpaces(p, end);
+                    if (p >= end || *p != ':') { error = "Expected ':' in nested object"; return false; }
+                    ++p;
+                    skipSpaces(p, end);
+                    if (!parseJsonScalar(p, end, specValue)) { error = "Expected a value in nested object"; return false; }
+                    specs[specKey] = specValue;
+                    skipSpaces(p, end);
+                    if (p < end && *p == ',') { ++p; continue; }
+                    if (p < end && *p == '}') { ++p; break; }
+                    error = "Expected ',' or '}' in nested object";
+                    return false;
+                }
+            }
+        } else if (!parseJsonScalar(p, end, fields[fieldCount])) {
+            error = "Expected a JSON value";
+            return false;
+        }
+        ++fieldCount;
+        skipSpaces(p, end);
+        if (p < end && *p == ',') { ++p; continue; }
+        if (p < end && *p == '}') return true;
+        error = "Expected ',' or '}'";
+        return false;
+    }
+}
+
+const std::string* BulkImporter::field(ImportFormat format, size_t csvIndex, const char* jsonKey) const {
+    if (format == ImportFormat::CSV) {
+        return csvIndex < fieldCount ? &fields[csvIndex] : nullptr;
+    }
+    for (size_t i = 0; i < fieldCount; ++i) {
+        if (std::strcmp(keys[i].c_str(), jsonKey) == 0) {
+            return &fields[i];
+        }
+    }
+    return nullptr;
+}
+
+bool BulkImporter::importUserRow(ImportFormat format, std::string& error) {
+    const std::string* username = field(format, 0, "username");
+    const std::string* password = field(format, 1, "password");
+    const std::string* roleText = field(format, 2, "role");
+    const std::string* realName = field(format, 3, "realName");
+    const std::string* balanceText = field(format, 4, "balance");
+    const std::string* passwordHash = field(format, 5, "passwordHash");
+
+    if (!username || username->empty()) { error = "Missing username"; return false; }
+    bool preHashed = passwordHash && !passwordHash->empty();
+    PasswordCredential credential;
+    if (preHashed && !PasswordHasher::decode(*passwordHash, credential)) { error = "Invalid passwordHash"; return false; }
+    if (!preHashed && (!password || password->empty())) { error = "Missing password"; return false; }
+    UserRole role;
+    if (!roleText || !parseRole(*roleText, role)) { error = "Invalid role"; return false; }
+    double balance = 0.0;
+    if (balanceText && !balanceText->empty() && !parseNumber(*balanceText, balance)) {
+        error = "Invalid balance";
+        return false;
+    }
+
+    // The username index doubles as the duplicate check
+    size_t position = system.users.size();
+    if (!system.userIndexByName.emplace(*username, position).second) {
+        error = "Username '" + *username + "' already exists";
+        return false;
+    }
+    if (preHashed) {
+        system.users.emplace_back(system.nextId("user_", position), *username, credential, role,
+                                  realName ? *realName : std::string());
+    } else {
+        system.users.emplace_back(system.nextId("user_", position), *username, *password, role,
+                                  realName ? *realName : std::string());
+    }
+    system.users.back().setBalance(balance);
+    return true;
+}
+
+bool BulkImporter::importResourceRow(ImportFormat format, std::string& error) {
+    const std::string* resourceId = field(format, 0, "resourceId");
+    const std::string* typeText = field(format, 1, "type");
+    const std::string* name = field(format, 2, "name");
+    const std::string* priceText = field(format, 3, "pricePerHour");
+
+    if (!resourceId || resourceId->empty()) { error = "Missing resourceId"; return false; }
+    ResourceType type;
+    if (!typeText || !parseResourceType(*typeText, type)) { error = "Invalid resource type"; return false; }
+    if (!name || name->empty()) { error = "Missing name"; return false; }
+    double price;
+    if (!priceText || !parseNumber(*priceText, price) || price < 0) { error = "Invalid pricePerHour"; return false; }
+
+    if (format == ImportFormat::CSV && fieldCount > 4) { // "Key=Value;Key=Value"
+        const std::string& text = fields[4];
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t stop = text.find(';', start);
+            if (stop == std::string::npos) stop = text.size();
+            size_t equals = text.find('=', start);
+            if (equals == std::string::npos || equals > stop) { error = "Invalid specs entry"; return false; }
+            specs[text.substr(start, equals - start)] = text.substr(equals + 1, stop - equals - 1);
+            start = stop + 1;
+        }
+    }
+
+    if (!system.resourceIndexById.emplace(*resourceId, system.resources.size()).second) {
+        error = "Resource ID '" + *resourceId + "' already exists";
+        return false;
+    }
+    system.resources.emplace_back(*resourceId, type, *name, specs, price);
+    system.resources.back().setCatalogSequence(++system.resourcesAppended);
+    return true;
+}
+
+ImportReport BulkImporter::importUsers(std::istream& in, ImportFormat format) {
+    ImportReport report;
+    auto started = std::chrono::steady_clock::now();
+    if (!system.currentUser || system.currentUser->getRole() != UserRole::ADMIN) {
+        addError(report, 0, "Admin privileges required to import users");
+        return report;
+    }
+
+    // Growing the vector moves every User, so currentUser is looked up again at the end
+    std::string currentUserId = system.currentUser->getUserId();
+    size_t firstNew = system.users.size();
+    system.recordUndo(UndoOp::USERS_APPENDED, firstNew); // The whole import is one undo step
+
+    size_t expectedRows = estimateRows(in, chunkSize);
+    if (expectedRows > 0) {
+        system.users.reserve(system.users.size() + expectedRows);
+        system.userIndexByName.reserve(system.users.size() + expectedRows);
+    }
+
+    std::string error;
+    readLines(in, [&](size_t line, const char* begin, const char* end) {
+        if (end > begin && end[-1] == '\r') --end;
+        if (begin == end) return;
+        ++report.rowsRead;
+        if (!splitRow(begin, end, format, error)) {
+            addError(report, line, error);
+            return;
+        }
+        if (line == 1 && format == ImportFormat::CSV && fieldCount > 0 && fields[0] == "username") {
+            --report.rowsRead; // Header line
+            return;
+        }
+        if (importUserRow(format, error)) {
+            ++report.rowsImported;
+        } else {
+            addError(report, line, error);
+        }
+    });
+
+    // Build the ID index for all new users in one pass
+    system.userIndexById.reserve(system.users.size());
+    for (size_t i = firstNew; i < system.users.size(); ++i) {
+        system.userIndexById[system.users[i].getUserId()] = i;
+        system.balanceWatch.setBalance(system.users[i].getUserId(), system.users[i].getBalance());
+        system.logUser(system.users[i]);
+        if (system.eventStream) {
+            ChangeEvent event(ChangeEventType::USER_CREATED, system.users[i].getUserId());
+            system.emit(event);
+        }
+    }
+    system.currentUser = system.findUserById(currentUserId);
+    system.auditChange(AuditOp::USERS_IMPORTED, "", 0.0, static_cast<uint32_t>(report.rowsImported));
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+ImportReport BulkImporter::importResources(std::istream& in, ImportFormat format) {
+    ImportReport report;
+    auto started = std::chrono::steady_clock::now();
+    if (!system.currentUser || system.currentUser->getRole() != UserRole::ADMIN) {
+        addError(report, 0, "Admin privileges required to import resources");
+        return report;
+    }
+
+    size_t firstNew = system.resources.size();
+    system.recordUndo(UndoOp::RESOURCES_APPENDED, firstNew);
+    size_t expectedRows = estimateRows(in, chunkSize);
+    if (expectedRows > 0) {
+        system.resources.reserve(system.resources.size() + expectedRows);
+        system.resourceIndexById.reserve(system.resources.size() + expectedRows);
+    }
+
+    std::string error;
+    readLines(in, [&](size_t line, const char* begin, const char* end) {
+        if (end > begin && end[-1] == '\r') --end;
+        if (begin == end) return;
+        ++report.rowsRead;
+        if (!splitRow(begin, end, format, error)) {
+            addError(report, line, error);
+            return;
+        }
+        if (line == 1 && format == ImportFormat::CSV && fieldCount > 0 && fields[0] == "resourceId") {
+            --report.rowsRead; // Header line
+            return;
+        }
+        if (importResourceRow(format, error)) {
+            ++report.rowsImported;
+        } else {
+            addError(report, line, error);
+        }
+    });
+    for (size_t i = firstNew; i < system.resources.size(); ++i) {
+        system.logResource(system.resources[i]);
+        if (system.eventStream) {
+            ChangeEvent event(ChangeEventType::RESOURCE_ADDED, system.resources[i].getResourceId());
+            event.newAmount = system.resources[i].getPricePerHour();
+            system.emit(event);
+        }
+    }
+    system.auditChange(AuditOp::RESOURCES_IMPORTED, "", 0.0, static_cast<uint32_t>(report.rowsImported));
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
@@ -0,0 +1,147 @@
+#include "ChangeEvents.h"
+#include "Metrics.h"
+#include "Protocol.h"
+#include <algorithm>
+
+static const char* const changeEventTypeNames[] = {
+    "user_created", "user_status_changed", "user_balance_changed", "user_modified",
+    "resource_added", "resource_modified", "resource_status_changed", "resource_deleted",
+    "rental_created", "rental_status_changed", "bill_created"
+};
+
+const char* changeEventTypeName(ChangeEventType type) {
+    size_t index = static_cast<size_t>(type);
+    return index < static_cast<size_t>(ChangeEventType::COUNT) ? changeEventTypeNames[index] : "unknown";
+}
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string encodeChangeEvent(const ChangeEvent& event) {
+    WireWriter out;
+    out.u64(event.sequence).u64(static_cast<uint64_t>(event.timestampMicros)).u8(static_cast<uint8_t>(event.type))
+       .str(event.entityId).str(event.userId).str(event.relatedId)
+       .u32(event.oldCode).u32(event.newCode).f64(event.oldAmount).f64(event.newAmount);
+    return out.data();
+}
+
+bool decodeChangeEvent(const ChangeRecord& record, ChangeEvent& event) {
+    if (record.type != ChangeType::EVENT) return false;
+    WireReader in(record.body.data(), record.body.size());
+    event.sequence = in.u64();
+    event.timestampMicros = static_cast<int64_t>(in.u64());
+    uint8_t type = in.u8();
+    event.entityId = in.str();
+    event.userId = in.str();
+    event.relatedId = in.str();
+    event.oldCode = in.u32();
+    event.newCode = in.u32();
+    event.oldAmount = in.f64();
+    event.newAmount = in.f64();
+    if (!in.ok() || !in.atEnd() || type >= static_cast<uint8_t>(ChangeEventType::COUNT)) return false;
+    event.type = static_cast<ChangeEventType>(type);
+    return true;
+}
+
+// ChangeEventStream
+ChangeEventStream::ChangeEventStream(const ChangeEventStreamOptions& streamOptions)
+    : options(streamOptions), ring(std::max<size_t>(streamOptions.capacity, 1)), lastSequence(0),
+      eventLog(nullptr) {
+}
+
+ChangeEventStream::~ChangeEventStream() {
+}
+
+uint64_t ChangeEventStream::slowestCursor() const {
+    uint64_t slowest = lastSequence + 1;
+    for (const ChangeEventSubscription* subscriber : subscribers) {
+        if (!subscriber->lagging) slowest = std::min(slowest, subscriber->nextSequence);
+    }
+    return slowest;
+}
+
+uint64_t ChangeEventStream::publish(ChangeEvent& event) {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t sequence = lastSequence + 1;
+    uint64_t capacity = ring.size();
+    if (sequence > capacity) {
+        uint64_t oldestKept = sequence - capacity + 1; // After this publish
+        if (slowestCursor() < oldestKept) {
+            consumed.wait_for(lock, options.maxPublishWait, [&]() { return slowestCursor() >= oldestKept; });
+        }
+        for (ChangeEventSubscription* subscriber : subscribers) {
+            if (subscriber->nextSequence < oldestKept) {
+                uint64_t lost = oldestKept - subscriber->nextSequence;
+                subscriber->droppedCount += lost;
+                subscriber->nextSequence = oldestKept;
+                subscriber->lagging = true;
+                Metrics::increment(MetricCounter::CHANGE_EVENTS_DROPPED, lost);
+            }
+        }
+    }
+
+    event.sequence = sequence;
+    event.timestampMicros = nowMicros();
+    ring[(sequence - 1) % capacity] = event; // Assignment reuses the slot's string buffers
+    lastSequence = sequence;
+    if (eventLog) eventLog->append(ChangeType::EVENT, encodeChangeEvent(event));
+    lock.unlock();
+    published.notify_all();
+    Metrics::increment(MetricCounter::CHANGE_EVENTS_PUBLISHED);
+    return sequence;
+}
+
+std::unique_ptr<ChangeEventSubscription> ChangeEventStream::subscribe() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<ChangeEventSubscription> subscription(new ChangeEventSubscription(*this, lastSequence + 1));
+    subscribers.push_back(subscription.get());
+    return subscription;
+}
+
+void ChangeEventStream::attachEventLog(ChangeLogWriter* log) {
+    std::lock_guard<std::mutex> lock(mutex);
+    eventLog = log;
+}
+
+uint64_t ChangeEventStream::sequence() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastSequence;
+}
+
+// ChangeEventSubscription
+ChangeEventSubscription::ChangeEventSubscription(ChangeEventStream& eventStream, uint64_t next)
+    : stream(eventStream), nextSequence(next), droppedCount(0), lagging(false) {
+}
+
+ChangeEventSubscription::~ChangeEventSubscription() {
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.subscribers.erase(std::find(stream.subscribers.begin(), stream.subscribers.end(), this));
+    }
+    stream.consumed.notify_all(); // This may have been the subscriber a publish is waiting for
+}
+
+size_t ChangeEventSubscription::poll(std::vector<ChangeEvent>& events, size_t maxEvents,
+                                     std::chrono::milliseconds wait) {
+    std::unique_lock<std::mutex> lock(stream.mutex);
+    lagging = false; // Consuming again, so publishes wait for it again
+    if (nextSequence > stream.lastSequence && wait.count() > 0) {
+        stream.published.wait_for(lock, wait, [&]() { return nextSequence <= stream.lastSequence; });
+    }
+    size_t count = 0;
+    while (count < maxEvents && nextSequence <= stream.lastSequence) {
+        events.push_back(stream.ring[(nextSequence - 1) % stream.ring.size()]);
+        ++nextSequence;
+        ++count;
+    }
+    lock.unlock();
+    if (count > 0) stream.consumed.notify_all();
+    return count;
+}
+
+uint64_t ChangeEventSubscription::dropped() {
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    return droppedCount;
+}
@@ -0,0 +1,221 @@
+#include "ChangeLog.h"
+#include "Metrics.h"
+#include "Protocol.h"
+#include "Trace.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CHANGE_LOG_MAGIC[8] = { 'C', 'R', 'R', 'S', 'W', 'A', 'L', '1' };
+static const size_t RECORD_PREFIX_BYTES = 8;                      // Length and CRC
+static const size_t RECORD_FIXED_BYTES = 8 + 8 + 1;               // Sequence, timestamp, type
+static const uint32_t MAX_RECORD_BYTES = 16 << 20;
+static const size_t READ_CHUNK = 64 * 1024;
+static const size_t MAX_BUFFERED = 4 << 20; // Bytes read ahead per poll
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+    }
+};
+
+static uint32_t crc32(const char* data, size_t size) {
+    static const Crc32Table table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ChangeLogWriter::ChangeLogWriter(const ChangeLogOptions& logOptions)
+    : options(logOptions), file(nullptr), nextSequence(1), writtenSequence(0), stopping(false) {
+    file = std::fopen(options.path.c_str(), "wb");
+    if (file) {
+        std::fwrite(CHANGE_LOG_MAGIC, 1, sizeof(CHANGE_LOG_MAGIC), file);
+        std::fflush(file);
+    } else {
+        std::cout << "Error: Cannot open change log '" << options.path << "'. Changes will not be replicated." << std::endl;
+    }
+    writer = std::thread(&ChangeLogWriter::run, this);
+}
+
+ChangeLogWriter::~ChangeLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+    if (file) std::fclose(file);
+}
+
+void ChangeLogWriter::encode(ChangeType type, const std::string& body) {
+    WireWriter record;
+    record.u64(nextSequence++).u64(static_cast<uint64_t>(nowMicros())).u8(static_cast<uint8_t>(type));
+    const std::string& fixed = record.data();
+    std::string payload;
+    payload.reserve(fixed.size() + body.size());
+    payload += fixed;
+    payload += body;
+    WireWriter prefix;
+    prefix.u32(static_cast<uint32_t>(payload.size())).u32(crc32(payload.data(), payload.size()));
+    pending += prefix.data();
+    pending += payload;
+}
+
+uint64_t ChangeLogWriter::append(ChangeType type, const std::string& body) {
+    std::lock_guard<std::mutex> lock(mutex);
+    encode(type, body);
+    Metrics::increment(MetricCounter::CHANGES_LOGGED);
+    return nextSequence - 1;
+}
+
+void ChangeLogWriter::run() {
+    std::string batch;
+    auto lastWrite = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (pending.empty() && std::chrono::steady_clock::now() - lastWrite >= options.heartbeatInterval) {
+            encode(ChangeType::HEARTBEAT, std::string());
+        }
+        batch.swap(pending);
+        uint64_t batchSequence = nextSequence - 1;
+        bool stop = stopping;
+        lock.unlock();
+
+        if (!batch.empty()) {
+            TRACE_SCOPE("ChangeLogWriter::write");
+            if (file) {
+                std::fwrite(batch.data(), 1, batch.size(), file);
+                std::fflush(file); // Into the page cache, where readers see it
+            }
+            batch.clear();
+            lastWrite = std::chrono::steady_clock::now();
+        }
+
+        lock.lock();
+        writtenSequence = batchSequence;
+        progress.notify_all();
+        if (stop) break;
+        wakeWriter.wait_for(lock, options.flushInterval);
+    }
+}
+
+void ChangeLogWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = nextSequence - 1;
+    wakeWriter.notify_one();
+    progress.wait(lock, [this, target] { return writtenSequence >= target; });
+}
+
+uint64_t ChangeLogWriter::lastSequence() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextSequence - 1;
+}
+
+ChangeLogReader::ChangeLogReader(const std::string& logPath)
+    : path(logPath), fd(-1), offset(0), lastSequence(0) {}
+
+ChangeLogReader::~ChangeLogReader() {
+    if (fd >= 0) close(fd);
+}
+
+// Opens the log and reads its header; false with an empty error if it does not exist yet
+bool ChangeLogReader::open(std::string& error) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) error = "Cannot open change log '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    char magic[sizeof(CHANGE_LOG_MAGIC)];
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    bool valid = n == static_cast<ssize_t>(sizeof(magic)) && std::memcmp(magic, CHANGE_LOG_MAGIC, sizeof(magic)) == 0;
+    if (!valid) {
+        close(fd);
+        fd = -1;
+        // A file shorter than the magic has just been created and is tried again on the next poll
+        if (n >= static_cast<ssize_t>(sizeof(magic))) error = "'" + path + "' is not a change log";
+        return false;
+    }
+    offset = sizeof(CHANGE_LOG_MAGIC);
+    return true;
+}
+
+bool ChangeLogReader::poll(std::vector<ChangeRecord>& records, std::string& error, size_t maxRecords) {
+    if (fd < 0 && !open(error)) {
+        return error.empty();
+    }
+
+    // A primary that restarts recreates the file, so a follower would silently miss state
+    struct stat opened, current;
+    if (fstat(fd, &opened) != 0 || stat(path.c_str(), &current) != 0 ||
+        opened.st_ino != current.st_ino || opened.st_dev != current.st_dev ||
+        static_cast<uint64_t>(opened.st_size) < offset + buffer.size()) {
+        error = "Change log '" + path + "' was replaced or truncated";
+        return false;
+    }
+
+    char chunk[READ_CHUNK];
+    ssize_t n;
+    while ((n = pread(fd, chunk, sizeof(chunk), static_cast<off_t>(offset + buffer.size()))) > 0) {
+        buffer.append(chunk, static_cast<size_t>(n));
+        if (buffer.size() >= MAX_BUFFERED) break;
+    }
+    if (n < 0) {
+        error = "Cannot read change log '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+
+    size_t position = 0;
+    size_t added = 0;
+    while (added < maxRecords && buffer.size() - position >= RECORD_PREFIX_BYTES) {
+        uint32_t length = readU32(buffer.data() + position);
+        uint32_t checksum = readU32(buffer.data() + position + 4);
+        if (length < RECORD_FIXED_BYTES || length > MAX_RECORD_BYTES) {
+            error = "Corrupt record at offset " + std::to_string(offset + position) + " of '" + path + "'";
+            return false;
+        }
+        if (buffer.size() - position - RECORD_PREFIX_BYTES < length) break; // Still being written
+        const char* payload = buffer.data() + position + RECORD_PREFIX_BYTES;
+        if (crc32(payload, length) != checksum) {
+            error = "Checksum mismatch at offset " + std::to_string(offset + position) + " of '" + path + "'";
+            return false;
+        }
+        WireReader in(payload, length);
+        ChangeRecord record;
+        record.sequence = in.u64();
+        record.timestampMicros = static_cast<int64_t>(in.u64());
+        record.type = static_cast<ChangeType>(in.u8());
+        record.body.assign(payload + RECORD_FIXED_BYTES, length - RECORD_FIXED_BYTES);
+        if (record.sequence != lastSequence + 1) {
+            error = "Gap in change log '" + path + "': expected record " + std::to_string(lastSequence + 1) +
+                    ", found " + std::to_string(record.sequence);
+            return false;
+        }
+        lastSequence = record.sequence;
+        records.push_back(std::move(record));
+        position += RECORD_PREFIX_BYTES + length;
+        ++added;
+    }
+    buffer.erase(0, position);
+    offset += position;
+    return true;
+}
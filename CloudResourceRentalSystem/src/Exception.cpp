@@ -1 +1,13 @@
-// Empty Exception.cpp file
+#include "Exception.h"
+
+const char* errorCodeName(ErrorCode code) {
+    static const char* const names[] = {
+        "ok", "not_logged_in", "permission_denied", "not_found", "already_exists", "invalid_argument",
+        "invalid_state", "resource_busy", "insufficient_balance", "account_inactive", "authentication_failed",
+        "quota_exceeded", "rate_limited",
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(ErrorCode::COUNT),
+                  "every error code needs a name");
+    size_t index = static_cast<size_t>(code);
+    return index < static_cast<size_t>(ErrorCode::COUNT) ? names[index] : "unknown";
+}
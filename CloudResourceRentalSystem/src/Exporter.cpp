@@ -0,0 +1,470 @@
+#include "Exporter.h"
+#include "System.h"
+#include "Trace.h"
+#include <fstream>
+#include <cstdio>  // For std::snprintf
+#include <cstring> // For std::memcpy
+#include <ctime>   // For gmtime_r, std::strftime
+
+// Stable machine-readable names (rentalStatusToString is meant for display)
+static const char* rentalStatusCode(RentalStatus status) {
+    switch (status) {
+        case RentalStatus::PENDING_APPROVAL: return "PENDING_APPROVAL";
+        case RentalStatus::APPROVED:         return "APPROVED";
+        case RentalStatus::REJECTED:         return "REJECTED";
+        case RentalStatus::ACTIVE:           return "ACTIVE";
+        case RentalStatus::COMPLETED:        return "COMPLETED";
+        case RentalStatus::CANCELLED:        return "CANCELLED";
+        case RentalStatus::PAUSED:           return "PAUSED";
+        case RentalStatus::OVERDUE:          return "OVERDUE";
+        default:                             return "UNKNOWN";
+    }
+}
+
+static int64_t toMicros(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+static uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// BufferedWriter
+BufferedWriter::BufferedWriter(std::ostream& stream, size_t capacity)
+    : out(stream), buffer(capacity < 256 ? 256 : capacity), used(0), totalBytes(0) {
+}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+}
+
+void BufferedWriter::write(const char* data, size_t size) {
+    if (used + size > buffer.size()) {
+        flush();
+        if (size > buffer.size()) { // Larger than the whole buffer: bypass it
+            TRACE_SCOPE("BufferedWriter::writeThrough");
+            out.write(data, static_cast<std::streamsize>(size));
+            totalBytes += size;
+            return;
+        }
+    }
+    std::memcpy(buffer.data() + used, data, size);
+    used += size;
+    totalBytes += size;
+}
+
+void BufferedWriter::write(const std::string& text) {
+    write(text.data(), text.size());
+}
+
+void BufferedWriter::writeChar(char c) {
+    if (used == buffer.size()) {
+        flush();
+    }
+    buffer[used++] = c;
+    ++totalBytes;
+}
+
+void BufferedWriter::writeInteger(long long value) {
+    char digits[24];
+    int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+    write(digits, static_cast<size_t>(length));
+}
+
+void BufferedWriter::writeAmount(double value) {
+    char digits[40];
+    int length = std::snprintf(digits, sizeof(digits), "%.2f", value);
+    write(digits, static_cast<size_t>(length));
+}
+
+void BufferedWriter::writeTimestamp(std::chrono::system_clock::time_point tp) {
+    std::time_t tt = std::chrono::system_clock::to_time_t(tp);
+    std::tm tm;
+    gmtime_r(&tt, &tm); // Thread-safe, unlike std::gmtime
+    char text[32];
+    size_t length = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    write(text, length);
+}
+
+void BufferedWriter::writeCsvField(const std::string& text) {
+    if (text.find_first_of(",\"\n\r") == std::string::npos) {
+        write(text);
+        return;
+    }
+    writeChar('"');
+    for (char c : text) {
+        if (c == '"') writeChar('"');
+        writeChar(c);
+    }
+    writeChar('"');
+}
+
+void BufferedWriter::writeJsonString(const std::string& text) {
+    writeChar('"');
+    for (char c : text) {
+        switch (c) {
+            case '"':  write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    int length = std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    write(escaped, static_cast<size_t>(length));
+                } else {
+                    writeChar(c);
+                }
+        }
+    }
+    writeChar('"');
+}
+
+void BufferedWriter::writeRaw64(uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    write(bytes, 8);
+}
+
+void BufferedWriter::writeRaw16(uint16_t value) {
+    char bytes[2] = { static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+    write(bytes, 2);
+}
+
+bool BufferedWriter::flush() {
+    if (used > 0) {
+        TRACE_SCOPE("BufferedWriter::flush");
+        out.write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+    }
+    return static_cast<bool>(out);
+}
+
+uint64_t BufferedWriter::bytesWritten() const {
+    return totalBytes;
+}
+
+// Record writers
+template <size_t N>
+static void writeLiteral(BufferedWriter& writer, const char (&text)[N]) {
+    writer.write(text, N - 1);
+}
+
+static void writeBinaryString(BufferedWriter& writer, const std::string& text) {
+    size_t length = text.size() > 0xFFFF ? 0xFFFF : text.size();
+    writer.writeRaw16(static_cast<uint16_t>(length));
+    writer.write(text.data(), length);
+}
+
+static void writeBinaryHeader(BufferedWriter& writer, uint16_t recordKind) {
+    writeLiteral(writer, "CRRX");
+    writer.writeRaw16(1); // Format version
+    writer.writeRaw16(recordKind);
+}
+
+static void writeRental(BufferedWriter& writer, ExportFormat format, const Rental& rental) {
+    switch (format) {
+        case ExportFormat::CSV:
+            writer.writeCsvField(rental.getRentalId());
+            writer.writeChar(',');
+            writer.writeCsvField(rental.getUserId());
+            writer.writeChar(',');
+            writer.writeCsvField(rental.getResourceId());
+            writer.writeChar(',');
+            writer.write(rentalStatusCode(rental.getStatus()), std::strlen(rentalStatusCode(rental.getStatus())));
+            writer.writeChar(',');
+            writer.writeTimestamp(rental.getRequestTime());
+            writer.writeChar(',');
+            writer.writeTimestamp(rental.getStartTime());
+            writer.writeChar(',');
+            writer.writeTimestamp(rental.getEndTime());
+            writer.writeChar(',');
+            writer.writeAmount(rental.getTotalCost());
+            writer.writeChar('\n');
+            break;
+        case ExportFormat::JSONL:
+            writeLiteral(writer, "{\"rentalId\":");
+            writer.writeJsonString(rental.getRentalId());
+            writeLiteral(writer, ",\"userId\":");
+            writer.writeJsonString(rental.getUserId());
+            writeLiteral(writer, ",\"resourceId\":");
+            writer.writeJsonString(rental.getResourceId());
+            writeLiteral(writer, ",\"status\":\"");
+            writer.write(rentalStatusCode(rental.getStatus()), std::strlen(rentalStatusCode(rental.getStatus())));
+            writeLiteral(writer, "\",\"requestTime\":\"");
+            writer.writeTimestamp(rental.getRequestTime());
+            writeLiteral(writer, "\",\"startTime\":\"");
+            writer.writeTimestamp(rental.getStartTime());
+            writeLiteral(writer, "\",\"endTime\":\"");
+            writer.writeTimestamp(rental.getEndTime());
+            writeLiteral(writer, "\",\"totalCost\":");
+            writer.writeAmount(rental.getTotalCost());
+            writeLiteral(writer, "}\n");
+            break;
+        case ExportFormat::BINARY:
+            writeBinaryString(writer, rental.getRentalId());
+            writeBinaryString(writer, rental.getUserId());
+            writeBinaryString(writer, rental.getResourceId());
+            writer.writeChar(static_cast<char>(rental.getStatus()));
+            writer.writeRaw64(static_cast<uint64_t>(toMicros(rental.getRequestTime())));
+            writer.writeRaw64(static_cast<uint64_t>(toMicros(rental.getStartTime())));
+            writer.writeRaw64(static_cast<uint64_t>(toMicros(rental.getEndTime())));
+            writer.writeRaw64(doubleBits(rental.getTotalCost()));
+            break;
+    }
+}
+
+static void writeBill(BufferedWriter& writer, ExportFormat format, const Bill& bill) {
+    switch (format) {
+        case ExportFormat::CSV:
+            writer.writeCsvField(bill.getBillId());
+            writer.writeChar(',');
+            writer.writeCsvField(bill.getRentalId());
+            writer.writeChar(',');
+            writer.writeCsvField(bill.getUserId());
+            writer.writeChar(',');
+            writer.writeAmount(bill.getAmount());
+            writer.writeChar(',');
+            writer.writeTimestamp(bill.getBillDate());
+            writer.writeChar(',');
+            writer.writeChar(bill.getIsPaid() ? '1' : '0');
+            writer.writeChar('\n');
+            break;
+        case ExportFormat::JSONL:
+            writeLiteral(writer, "{\"billId\":");
+            writer.writeJsonString(bill.getBillId());
+            writeLiteral(writer, ",\"rentalId\":");
+            writer.writeJsonString(bill.getRentalId());
+            writeLiteral(writer, ",\"userId\":");
+            writer.writeJsonString(bill.getUserId());
+            writeLiteral(writer, ",\"amount\":");
+            writer.writeAmount(bill.getAmount());
+            writeLiteral(writer, ",\"billDate\":\"");
+            writer.writeTimestamp(bill.getBillDate());
+            if (bill.getIsPaid()) {
+                writeLiteral(writer, "\",\"paid\":true}\n");
+            } else {
+                writeLiteral(writer, "\",\"paid\":false}\n");
+            }
+            break;
+        case ExportFormat::BINARY:
+            writeBinaryString(writer, bill.getBillId());
+            writeBinaryString(writer, bill.getRentalId());
+            writeBinaryString(writer, bill.getUserId());
+            writer.writeRaw64(static_cast<uint64_t>(toMicros(bill.getBillDate())));
+            writer.writeRaw64(doubleBits(bill.getAmount()));
+            writer.writeChar(bill.getIsPaid() ? 1 : 0);
+            break;
+    }
+}
+
+static bool rentalMatches(const Rental& rental, const ExportFilter& filter) {
+    if (rental.getRequestTime() < filter.from || rental.getRequestTime() > filter.to) return false;
+    return !filter.filterRentalStatus || rental.getStatus() == filter.rentalStatus;
+}
+
+static bool billMatches(const Bill& bill, const ExportFilter& filter) {
+    if (bill.getBillDate() < filter.from || bill.getBillDate() > filter.to) return false;
+    return filter.paidStatus < 0 || bill.getIsPaid() == (filter.paidStatus == 1);
+}
+
+// Exporter
+Exporter::Exporter(System& sys, size_t recordsPerChunk)
+    : system(sys), chunkSize(recordsPerChunk == 0 ? 1 : recordsPerChunk) {
+}
+
+// Exports are admin-only, like System's listings of every user's records
+bool Exporter::permitted(const char* what, ExportReport& report) {
+    std::lock_guard<std::mutex> lock(system.getMutex());
+    if (system.currentUser && system.currentUser->getRole() == UserRole::ADMIN) return true;
+    Metrics::increment(MetricCounter::PERMISSION_DENIED);
+    system.lastErrorCode = ErrorCode::PERMISSION_DENIED;
+    report.error = std::string("Admin privileges required to export ") + what;
+    return false;
+}
+
+ExportReport Exporter::exportRentals(std::ostream& out, ExportFormat format, const ExportFilter& filter) {
+    ExportReport report;
+    if (!permitted("rentals", report)) return report;
+    return writeRentals(out, format, filter);
+}
+
+ExportReport Exporter::exportBills(std::ostream& out, ExportFormat format, const ExportFilter& filter) {
+    ExportReport report;
+    if (!permitted("bills", report)) return report;
+    return writeBills(out, format, filter);
+}
+
+ExportReport Exporter::writeRentals(std::ostream& out, ExportFormat format, const ExportFilter& filter) {
+    ExportReport report;
+    auto started = std::chrono::steady_clock::now();
+    BufferedWriter writer(out);
+    if (format == ExportFormat::CSV) {
+        writeLiteral(writer, "rentalId,userId,resourceId,status,requestTime,startTime,endTime,totalCost\n");
+    } else if (format == ExportFormat::BINARY) {
+        writeBinaryHeader(writer, 1);
+    }
+
+    size_t total;
+    std::unique_ptr<Snapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(system.getMutex());
+        // Rentals are only removed when a transaction rolls back the ones it appended; a transaction
+        // left open across lock releases can do that mid-export, so each chunk is clamped below
+        total = system.rentals.size();
+        if (system.snapshots) snapshot.reset(new Snapshot(*system.snapshots));
+    }
+
+    if (snapshot) { // No chunking needed: the snapshot is read without the lock
+        snapshot->forEachRental([&](const Rental& rental) {
+            if (out && rentalMatches(rental, filter)) {
+                writeRental(writer, format, rental);
+                ++report.records;
+            }
+        });
+        total = 0;
+    }
+
+    std::vector<Rental> chunk; // Reused: copy-assignment keeps the string buffers
+    for (size_t position = 0; position < total; position += chunkSize) {
+        {
+            TRACE_SCOPE("Exporter::copyRentalChunk"); // Includes waiting for the System lock
+            std::lock_guard<std::mutex> lock(system.getMutex());
+            total = std::min(total, system.rentals.size());
+            size_t stop = std::min(total, position + chunkSize);
+            chunk.assign(system.rentals.begin() + std::min(position, stop), system.rentals.begin() + stop);
+        }
+        for (const auto& rental : chunk) {
+            if (rentalMatches(rental, filter)) {
+                writeRental(writer, format, rental);
+                ++report.records;
+            }
+        }
+        if (!out) break;
+    }
+
+    report.success = writer.flush();
+    if (!report.success) report.error = "Write to output stream failed";
+    report.bytes = writer.bytesWritten();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+ExportReport Exporter::writeBills(std::ostream& out, ExportFormat format, const ExportFilter& filter) {
+    ExportReport report;
+    auto started = std::chrono::steady_clock::now();
+    BufferedWriter writer(out);
+    if (format == ExportFormat::CSV) {
+        writeLiteral(writer, "billId,rentalId,userId,amount,billDate,paid\n");
+    } else if (format == ExportFormat::BINARY) {
+        writeBinaryHeader(writer, 2);
+    }
+
+    size_t segments, hotTotal, archivedTotal;
+    std::unique_ptr<Snapshot> snapshot; // Pinned together with the segment count, so each bill is seen once
+    {
+        std::lock_guard<std::mutex> lock(system.getMutex());
+        segments = system.billArchive.segmentCount();
+        archivedTotal = system.billArchive.size();
+        hotTotal = system.bills.size();
+        if (system.snapshots) snapshot.reset(new Snapshot(*system.snapshots));
+    }
+
+    // Archived bills first (oldest), one immutable segment at a time
+    std::vector<Bill> chunk;
+    for (size_t segment = 0; segment < segments && out; ++segment) {
+        chunk.clear();
+        {
+            TRACE_SCOPE("Exporter::decodeArchiveSegment"); // Includes waiting for the System lock
+            std::lock_guard<std::mutex> lock(system.getMutex());
+            system.billArchive.findByDateInSegment(segment, filter.from, filter.to, chunk);
+        }
+        for (const auto& bill : chunk) {
+            if (billMatches(bill, filter)) {
+                writeBill(writer, format, bill);
+                ++report.records;
+            }
+        }
+    }
+
+    // Then the hot tier. Archiving moves bills out of it, which would shift
+    // positions; a snapshot still has them as they were when it was pinned.
+    if (snapshot) {
+        snapshot->forEachBill([&](const Bill& bill) {
+            if (out && billMatches(bill, filter)) {
+                writeBill(writer, format, bill);
+                ++report.records;
+            }
+        });
+        hotTotal = 0;
+    }
+    for (size_t position = 0; position < hotTotal && out; position += chunkSize) {
+        {
+            TRACE_SCOPE("Exporter::copyBillChunk"); // Includes waiting for the System lock
+            std::lock_guard<std::mutex> lock(system.getMutex());
+            if (system.billArchive.size() != archivedTotal) {
+                report.error = "Bills were archived during the export";
+                break;
+            }
+            // Rolling back a transaction removes the bills it appended, as for rentals
+            hotTotal = std::min(hotTotal, system.bills.size());
+            size_t stop = std::min(hotTotal, position + chunkSize);
+            chunk.assign(system.bills.begin() + std::min(position, stop), system.bills.begin() + stop);
+        }
+        for (const auto& bill : chunk) {
+            if (billMatches(bill, filter)) {
+                writeBill(writer, format, bill);
+                ++report.records;
+            }
+        }
+    }
+
+    report.success = writer.flush() && report.error.empty();
+    if (!report.success && report.error.empty()) report.error = "Write to output stream failed";
+    report.bytes = writer.bytesWritten();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+std::future<ExportReport> Exporter::exportRentalsAsync(const std::string& path, ExportFormat format,
+                                                       const ExportFilter& filter) {
+    ExportReport denied;
+    if (!permitted("rentals", denied)) {
+        std::promise<ExportReport> refused;
+        refused.set_value(denied);
+        return refused.get_future();
+    }
+    return std::async(std::launch::async, [this, path, format, filter]() {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            ExportReport failed;
+            failed.error = "Cannot open '" + path + "' for writing";
+            return failed;
+        }
+        return writeRentals(file, format, filter);
+    });
+}
+
+std::future<ExportReport> Exporter::exportBillsAsync(const std::string& path, ExportFormat format,
+                                                     const ExportFilter& filter) {
+    ExportReport denied;
+    if (!permitted("bills", denied)) {
+        std::promise<ExportReport> refused;
+        refused.set_value(denied);
+        return refused.get_future();
+    }
+    return std::async(std::launch::async, [this, path, format, filter]() {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            ExportReport failed;
+            failed.error = "Cannot open '" + path + "' for writing";
+            return failed;
+        }
+        return writeBills(file, format, filter);
+    });
+}
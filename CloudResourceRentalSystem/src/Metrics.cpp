@@ -0,0 +1,320 @@
+#include "Metrics.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+static const size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+static const size_t METHOD_COUNT = static_cast<size_t>(ApiMethod::COUNT);
+static const size_t GAUGE_COUNT = static_cast<size_t>(MetricGauge::COUNT);
+
+static const char* const methodNames[METHOD_COUNT] = {
+    "registerUser", "loginUser", "logoutUser", "getCurrentUser", "switchToUser", "displayAllUsers",
+    "updateCurrentUserName", "updateCurrentUserPassword",
+    "addResource", "findResource", "displayAllResources", "findResourcesByType",
+    "requestResourceRental", "getUserRentals", "findRental", "displayUserRentals", "cancelRentalRequest",
+    "adminModifyResource", "adminDeleteResource",
+    "adminDisplayAllUsers", "adminAddUser", "adminModifyUser", "adminSetUserStatus",
+    "adminDisplayPendingRentals", "adminApproveRental", "adminRejectRental", "adminDisplayAllRentals",
+    "processRentalCompletion", "displayUserBills", "adminDisplayAllBills",
+    "adminArchiveBillsBefore", "findUserBills", "findBillsByDate",
+    "listUserRentals", "listUserBills", "listResources", "adminListUsers", "adminListRentals", "adminListBills",
+    "loginUserAsync", "adminDecommissionResources", "checkOverdueRentals",
+    "adminSetRoleQuota", "adminSetUserQuota", "adminClearUserQuota", "getQuotaUsage",
+    "adminSetLowBalanceHorizon", "adminUsersGoingNegative", "checkLowBalanceAlerts",
+    "readNotifications", "clearNotifications", "adminSetOverdueAutoComplete",
+    "adminOpenSnapshot", "beginTransaction", "commitTransaction", "rollbackTransaction",
+    "applyChange"
+};
+
+struct CounterInfo {
+    const char* name;
+    const char* help;
+};
+
+static const CounterInfo counterInfo[COUNTER_COUNT] = {
+    { "crrs_logins_succeeded_total", "Successful logins." },
+    { "crrs_logins_failed_total", "Rejected logins (unknown user, wrong password or suspended account)." },
+    { "crrs_users_registered_total", "Users created by registration or by an administrator." },
+    { "crrs_permission_denied_total", "Admin-only operations attempted without admin privileges." },
+    { "crrs_rentals_requested_total", "Rental requests accepted for review." },
+    { "crrs_rentals_approved_total", "Rentals approved by an administrator." },
+    { "crrs_rentals_rejected_total", "Rentals rejected by an administrator." },
+    { "crrs_rentals_cancelled_total", "Rental requests cancelled by their user." },
+    { "crrs_rentals_completed_total", "Rentals completed and billed." },
+    { "crrs_bills_created_total", "Bills generated." },
+    { "crrs_billed_amount_total", "Sum of all bill amounts." },
+    { "crrs_bills_archived_total", "Bills moved to the archive tier." },
+    { "crrs_audit_records_written_total", "Audit records written to the log file." },
+    { "crrs_audit_records_dropped_total", "Audit records lost because the ring was full or the write failed." },
+    { "crrs_changes_logged_total", "Records appended to the change log for replicas." },
+    { "crrs_changes_applied_total", "Change log records applied by this replica." },
+    { "crrs_change_events_published_total", "Events published to the change event stream." },
+    { "crrs_change_events_dropped_total", "Change events lost by subscribers that fell a full ring behind." },
+    { "crrs_rentals_over_quota_total", "Rental requests refused because a quota was reached." },
+    { "crrs_rentals_rate_limited_total", "Rental requests refused by the per-user request rate limit." },
+    { "crrs_rentals_suspended_total", "Rentals paused or terminated because their user was suspended." },
+    { "crrs_low_balance_alerts_total", "Users alerted that their balance is projected to run out." },
+    { "crrs_rentals_overdue_total", "Rentals found past their end time without being completed." },
+    { "crrs_rentals_overdue_ended_total", "Overdue rentals completed, automatically or not, or stopped." },
+    { "crrs_rentals_overdue_seconds_total", "Seconds overdue rentals held their resource past their end time." }
+};
+
+struct GaugeInfo {
+    const char* name;
+    const char* help;
+    double scale; // Exported value = stored value * scale
+};
+
+static const GaugeInfo gaugeInfo[GAUGE_COUNT] = {
+    { "crrs_replication_lag_seconds", "Age of the newest change log record this replica has read.", 1e-6 },
+    { "crrs_replication_applied_sequence", "Sequence number of the newest change log record this replica has read.", 1.0 }
+};
+
+static std::atomic<int64_t> gaugeValues[GAUGE_COUNT];
+
+// One thread's metrics. Only the owning thread writes; readers load concurrently.
+struct ThreadBlock {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> buckets[METHOD_COUNT][LatencyHistogram::BUCKET_COUNT];
+    std::atomic<uint64_t> sums[METHOD_COUNT];
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBlock*> live;
+    ThreadBlock retired; // Totals of threads that have exited
+};
+
+static Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Single writer, so a plain load and store is enough and avoids a locked instruction
+static inline void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void addBlock(ThreadBlock& target, const ThreadBlock& source) {
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        target.counters[c].fetch_add(source.counters[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    for (size_t m = 0; m < METHOD_COUNT; ++m) {
+        for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b) {
+            target.buckets[m][b].fetch_add(source.buckets[m][b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        target.sums[m].fetch_add(source.sums[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+static void clearBlock(ThreadBlock& block) {
+    for (auto& counter : block.counters) counter.store(0, std::memory_order_relaxed);
+    for (auto& row : block.buckets) {
+        for (auto& bucket : row) bucket.store(0, std::memory_order_relaxed);
+    }
+    for (auto& sum : block.sums) sum.store(0, std::memory_order_relaxed);
+}
+
+// Registers the calling thread's block on first use and folds it into the
+// retired totals when the thread exits
+struct ThreadHandle {
+    ThreadBlock* block;
+
+    ThreadHandle() {
+        Registry& r = registry(); // Constructed first, so it outlives every handle
+        block = new ThreadBlock();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(block);
+    }
+
+    ~ThreadHandle() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        addBlock(r.retired, *block);
+        r.live.erase(std::remove(r.live.begin(), r.live.end(), block), r.live.end());
+        delete block;
+    }
+};
+
+static ThreadBlock& localBlock() {
+    thread_local ThreadHandle handle;
+    return *handle.block;
+}
+
+int LatencyHistogram::bucketFor(uint64_t nanos) {
+    if (nanos < 4) return static_cast<int>(nanos);
+    int exponent = 63 - __builtin_clzll(nanos); // >= 2
+    int subBucket = static_cast<int>((nanos >> (exponent - SUB_BUCKET_BITS)) & 3);
+    int bucket = (exponent - 1) * 4 + subBucket;
+    return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < 4) return static_cast<uint64_t>(bucket);
+    int exponent = bucket / 4 + 1;
+    uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    uint64_t lower = static_cast<uint64_t>(4 + bucket % 4) << (exponent - SUB_BUCKET_BITS);
+    return lower + width - 1;
+}
+
+uint64_t LatencyHistogram::quantileNanos(double quantile) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(quantile * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKET_COUNT; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return bucketUpperBound(b);
+    }
+    return bucketUpperBound(BUCKET_COUNT - 1);
+}
+
+void Metrics::increment(MetricCounter counter, uint64_t amount) {
+    bump(localBlock().counters[static_cast<size_t>(counter)], amount);
+}
+
+void Metrics::recordLatency(ApiMethod method, uint64_t nanos) {
+    ThreadBlock& block = localBlock();
+    size_t m = static_cast<size_t>(method);
+    bump(block.buckets[m][LatencyHistogram::bucketFor(nanos)], 1);
+    bump(block.sums[m], nanos);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    Registry& r = registry();
+    MetricsSnapshot result;
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<const ThreadBlock*> blocks(r.live.begin(), r.live.end());
+    blocks.push_back(&r.retired);
+    for (const ThreadBlock* block : blocks) {
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            result.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t m = 0; m < METHOD_COUNT; ++m) {
+            LatencyHistogram& histogram = result.latencies[m];
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b) {
+                uint64_t n = block->buckets[m][b].load(std::memory_order_relaxed);
+                histogram.buckets[b] += n;
+                histogram.count += n;
+            }
+            histogram.sumNanos += block->sums[m].load(std::memory_order_relaxed);
+        }
+    }
+    for (size_t g = 0; g < GAUGE_COUNT; ++g) {
+        result.gauges[g] = gaugeValues[g].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void Metrics::setGauge(MetricGauge gauge, int64_t value) {
+    gaugeValues[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+// Values recorded by other threads while the reset runs may survive it
+void Metrics::reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (ThreadBlock* block : r.live) clearBlock(*block);
+    clearBlock(r.retired);
+}
+
+const char* Metrics::methodName(ApiMethod method) {
+    return methodNames[static_cast<size_t>(method)];
+}
+
+const char* Metrics::counterName(MetricCounter counter) {
+    return counterInfo[static_cast<size_t>(counter)].name;
+}
+
+void Metrics::writePrometheus(std::ostream& out) {
+    writePrometheus(out, snapshot());
+}
+
+void Metrics::writePrometheus(std::ostream& out, const MetricsSnapshot& snapshot) {
+    char line[256];
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        const CounterInfo& info = counterInfo[c];
+        out << "# HELP " << info.name << ' ' << info.help << "\n# TYPE " << info.name << " counter\n";
+        if (static_cast<MetricCounter>(c) == MetricCounter::BILLED_CENTS) {
+            std::snprintf(line, sizeof(line), "%s %.2f\n", info.name, snapshot.counters[c] / 100.0);
+        } else {
+            std::snprintf(line, sizeof(line), "%s %llu\n", info.name,
+                          static_cast<unsigned long long>(snapshot.counters[c]));
+        }
+        out << line;
+    }
+
+    for (size_t g = 0; g < GAUGE_COUNT; ++g) {
+        const GaugeInfo& info = gaugeInfo[g];
+        out << "# HELP " << info.name << ' ' << info.help << "\n# TYPE " << info.name << " gauge\n";
+        if (info.scale == 1.0) {
+            std::snprintf(line, sizeof(line), "%s %lld\n", info.name, static_cast<long long>(snapshot.gauges[g]));
+        } else {
+            std::snprintf(line, sizeof(line), "%s %.6f\n", info.name, snapshot.gauges[g] * info.scale);
+        }
+        out << line;
+    }
+
+    // Only methods that have been called, and only their non-empty buckets
+    out << "# HELP crrs_api_latency_seconds Duration of System API calls.\n"
+        << "# TYPE crrs_api_latency_seconds histogram\n";
+    for (size_t m = 0; m < METHOD_COUNT; ++m) {
+        const LatencyHistogram& histogram = snapshot.latencies[m];
+        if (histogram.count == 0) continue;
+        uint64_t cumulative = 0;
+        for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b) {
+            if (histogram.buckets[b] == 0) continue;
+            cumulative += histogram.buckets[b];
+            std::snprintf(line, sizeof(line), "crrs_api_latency_seconds_bucket{method=\"%s\",le=\"%.9g\"} %llu\n",
+                          methodNames[m], LatencyHistogram::bucketUpperBound(b) * 1e-9,
+                          static_cast<unsigned long long>(cumulative));
+            out << line;
+        }
+        std::snprintf(line, sizeof(line),
+                      "crrs_api_latency_seconds_bucket{method=\"%s\",le=\"+Inf\"} %llu\n"
+                      "crrs_api_latency_seconds_sum{method=\"%s\"} %.9f\n"
+                      "crrs_api_latency_seconds_count{method=\"%s\"} %llu\n",
+                      methodNames[m], static_cast<unsigned long long>(histogram.count),
+                      methodNames[m], histogram.sumNanos * 1e-9,
+                      methodNames[m], static_cast<unsigned long long>(histogram.count));
+        out << line;
+    }
+}
+
+MetricsDumper::MetricsDumper(const std::string& filePath, std::chrono::milliseconds dumpInterval)
+    : path(filePath), interval(dumpInterval), stopping(false) {
+    worker = std::thread(&MetricsDumper::run, this);
+}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+void MetricsDumper::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        bool stop = wakeUp.wait_for(lock, interval, [this] { return stopping; });
+        lock.unlock();
+        dumpNow();
+        lock.lock();
+        if (stop) break;
+    }
+}
+
+bool MetricsDumper::dumpNow() {
+    TRACE_SCOPE("MetricsDumper::dumpNow");
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath.c_str(), std::ios::trunc);
+        if (!out) return false;
+        Metrics::writePrometheus(out);
+        if (!out) return false;
+    }
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
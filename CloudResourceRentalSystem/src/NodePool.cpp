@@ -0,0 +1,32 @@
+#include "NodePool.h"
+
+NodePool::NodePool() : cursor(nullptr), remaining(0) {
+    for (FreeBlock*& list : freeLists) list = nullptr;
+}
+
+void* NodePool::allocate(size_t bytes) {
+    size_t size = (bytes + GRANULE - 1) / GRANULE * GRANULE;
+    FreeBlock*& list = freeLists[size / GRANULE - 1];
+    if (list) {
+        FreeBlock* block = list;
+        list = block->next;
+        return block;
+    }
+    if (remaining < size) {
+        // operator new[] aligns to at least GRANULE; what is left of the old chunk is abandoned
+        chunks.emplace_back(new char[CHUNK_SIZE]);
+        cursor = chunks.back().get();
+        remaining = CHUNK_SIZE;
+    }
+    void* block = cursor;
+    cursor += size;
+    remaining -= size;
+    return block;
+}
+
+void NodePool::deallocate(void* block, size_t bytes) {
+    size_t size = (bytes + GRANULE - 1) / GRANULE * GRANULE;
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = freeLists[size / GRANULE - 1];
+    freeLists[size / GRANULE - 1] = freed;
+}
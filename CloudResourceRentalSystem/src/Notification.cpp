@@ -1 +1,43 @@
-// Empty Notification.cpp file
+#include "Notification.h"
+#include "Utils.h" // For formatTimePoint
+#include <iostream>
+#include <utility> // For std::move
+
+// Constructor
+Notification::Notification(std::string uId, std::string text, NotificationPriority level)
+    : userId(std::move(uId)), message(std::move(text)), priority(level),
+      createdAt(std::chrono::system_clock::now()), isRead(false) {
+}
+
+// Getters
+const std::string& Notification::getUserId() const {
+    return userId;
+}
+
+const std::string& Notification::getMessage() const {
+    return message;
+}
+
+NotificationPriority Notification::getPriority() const {
+    return priority;
+}
+
+std::chrono::system_clock::time_point Notification::getCreatedAt() const {
+    return createdAt;
+}
+
+bool Notification::getIsRead() const {
+    return isRead;
+}
+
+// Setters
+void Notification::markRead() {
+    isRead = true;
+}
+
+// Display and helper functions
+void Notification::displayNotification() const {
+    std::cout << "[" << formatTimePoint(createdAt) << "] "
+              << (priority == NotificationPriority::HIGH ? "IMPORTANT: " : "")
+              << message << (isRead ? "" : " (unread)") << std::endl;
+}
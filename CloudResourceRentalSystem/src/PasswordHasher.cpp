@@ -0,0 +1,277 @@
+#include "PasswordHasher.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+static std::atomic<uint32_t> defaultIterationCount(PasswordHasher::DEFAULT_ITERATIONS);
+
+// SHA-256 (FIPS 180-4)
+static const uint32_t roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t initialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t rotateRight(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Processes one 64-byte block
+static void compress(uint32_t state[8], const unsigned char block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) +
+                      roundConstants[i] + w[i];
+        uint32_t t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+class Sha256 {
+private:
+    uint32_t state[8];
+    unsigned char buffer[64];
+    size_t buffered;
+    uint64_t totalBytes;
+
+public:
+    Sha256() : buffered(0), totalBytes(0) { std::memcpy(state, initialState, sizeof(state)); }
+
+    void update(const unsigned char* data, size_t size) {
+        totalBytes += size;
+        while (size > 0) {
+            size_t take = std::min(size, sizeof(buffer) - buffered);
+            std::memcpy(buffer + buffered, data, take);
+            buffered += take;
+            data += take;
+            size -= take;
+            if (buffered == sizeof(buffer)) {
+                compress(state, buffer);
+                buffered = 0;
+            }
+        }
+    }
+
+    void update(const std::string& data) { update(reinterpret_cast<const unsigned char*>(data.data()), data.size()); }
+
+    void finish(unsigned char digest[32]) {
+        uint64_t bitLength = totalBytes * 8;
+        unsigned char padding[72] = { 0x80 };
+        size_t padBytes = (buffered < 56) ? 56 - buffered : 120 - buffered;
+        update(padding, padBytes);
+        unsigned char lengthBytes[8];
+        for (int i = 0; i < 8; ++i) lengthBytes[i] = static_cast<unsigned char>(bitLength >> (56 - 8 * i));
+        update(lengthBytes, 8);
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = static_cast<unsigned char>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<unsigned char>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<unsigned char>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<unsigned char>(state[i]);
+        }
+    }
+
+    // Raw chaining state after whole blocks, used to reuse the HMAC key pads
+    const uint32_t* chainingState() const { return state; }
+};
+
+// Hashes a 32-byte message that follows one already-processed 64-byte block
+// (an HMAC pad), starting from the saved chaining state. This is the inner loop of PBKDF2.
+static void hashAfterPad(const uint32_t padState[8], const unsigned char message[32], unsigned char digest[32]) {
+    unsigned char block[64];
+    std::memcpy(block, message, 32);
+    block[32] = 0x80;
+    std::memset(block + 33, 0, 64 - 33 - 8);
+    const uint64_t bitLength = (64 + 32) * 8;
+    for (int i = 0; i < 8; ++i) block[56 + i] = static_cast<unsigned char>(bitLength >> (56 - 8 * i));
+    uint32_t state[8];
+    std::memcpy(state, padState, sizeof(state));
+    compress(state, block);
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = static_cast<unsigned char>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(state[i]);
+    }
+}
+
+uint32_t PasswordHasher::defaultIterations() {
+    return defaultIterationCount.load(std::memory_order_relaxed);
+}
+
+void PasswordHasher::setDefaultIterations(uint32_t iterations) {
+    defaultIterationCount.store(iterations > 0 ? iterations : 1, std::memory_order_relaxed);
+}
+
+PasswordCredential PasswordHasher::create(const std::string& password) {
+    PasswordCredential credential;
+    credential.salt = generateSalt();
+    credential.iterations = defaultIterations();
+    credential.hash = derive(password, credential.salt, credential.iterations);
+    return credential;
+}
+
+bool PasswordHasher::verify(const PasswordCredential& credential, const std::string& password) {
+    return constantTimeEquals(derive(password, credential.salt, credential.iterations), credential.hash);
+}
+
+std::string PasswordHasher::generateSalt() {
+    std::random_device device;
+    std::string salt(SALT_BYTES, '\0');
+    for (size_t i = 0; i < SALT_BYTES; i += 4) {
+        uint32_t value = device();
+        for (size_t j = 0; j < 4 && i + j < SALT_BYTES; ++j) {
+            salt[i + j] = static_cast<char>(value >> (8 * j));
+        }
+    }
+    return salt;
+}
+
+std::string PasswordHasher::derive(const std::string& password, const std::string& salt, uint32_t iterations) {
+    TRACE_SCOPE("PasswordHasher::derive");
+    // HMAC key: passwords longer than a block are hashed first
+    unsigned char key[64] = { 0 };
+    if (password.size() > sizeof(key)) {
+        Sha256 keyHash;
+        keyHash.update(password);
+        keyHash.finish(key);
+    } else {
+        std::memcpy(key, password.data(), password.size());
+    }
+    unsigned char innerPad[64], outerPad[64];
+    for (int i = 0; i < 64; ++i) {
+        innerPad[i] = key[i] ^ 0x36;
+        outerPad[i] = key[i] ^ 0x5c;
+    }
+
+    // The pads are the same for every HMAC call, so their compression is done once
+    Sha256 inner, outer;
+    inner.update(innerPad, 64);
+    outer.update(outerPad, 64);
+    uint32_t innerState[8], outerState[8];
+    std::memcpy(innerState, inner.chainingState(), sizeof(innerState));
+    std::memcpy(outerState, outer.chainingState(), sizeof(outerState));
+
+    // One output block is enough: HASH_BYTES equals the SHA-256 digest size.
+    // U1 = HMAC(password, salt || INT(1))
+    unsigned char u[32], result[32];
+    Sha256 first = inner;
+    first.update(salt);
+    const unsigned char blockIndex[4] = { 0, 0, 0, 1 };
+    first.update(blockIndex, 4);
+    first.finish(u);
+    hashAfterPad(outerState, u, u);
+    std::memcpy(result, u, sizeof(result));
+
+    // U_i = HMAC(password, U_{i-1}); result = U1 ^ U2 ^ ...
+    for (uint32_t i = 1; i < iterations; ++i) {
+        hashAfterPad(innerState, u, u);
+        hashAfterPad(outerState, u, u);
+        for (int j = 0; j < 32; ++j) result[j] ^= u[j];
+    }
+    return std::string(reinterpret_cast<const char*>(result), HASH_BYTES);
+}
+
+bool PasswordHasher::constantTimeEquals(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    unsigned char difference = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        difference |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return difference == 0;
+}
+
+std::string PasswordHasher::sha256(const std::string& data) {
+    Sha256 hash;
+    hash.update(data);
+    unsigned char digest[32];
+    hash.finish(digest);
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+static const char ENCODED_PREFIX[] = "pbkdf2-sha256$";
+
+std::string PasswordHasher::encode(const PasswordCredential& credential) {
+    return ENCODED_PREFIX + std::to_string(credential.iterations) + "$" + toHex(credential.salt) + "$" +
+           toHex(credential.hash);
+}
+
+bool PasswordHasher::decode(const std::string& text, PasswordCredential& credential) {
+    size_t prefixLength = sizeof(ENCODED_PREFIX) - 1;
+    if (text.compare(0, prefixLength, ENCODED_PREFIX) != 0) return false;
+    size_t saltStart = text.find('$', prefixLength);
+    if (saltStart == std::string::npos) return false;
+    size_t hashStart = text.find('$', saltStart + 1);
+    if (hashStart == std::string::npos) return false;
+
+    uint64_t iterations = 0;
+    if (saltStart == prefixLength || saltStart - prefixLength > 10) return false;
+    for (size_t i = prefixLength; i < saltStart; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        iterations = iterations * 10 + static_cast<uint64_t>(text[i] - '0');
+    }
+    PasswordCredential decoded;
+    if (iterations == 0 || iterations > UINT32_MAX ||
+        !fromHex(text.substr(saltStart + 1, hashStart - saltStart - 1), decoded.salt) ||
+        !fromHex(text.substr(hashStart + 1), decoded.hash) ||
+        decoded.salt.empty() || decoded.hash.size() != HASH_BYTES) {
+        return false;
+    }
+    decoded.iterations = static_cast<uint32_t>(iterations);
+    credential = decoded;
+    return true;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool PasswordHasher::fromHex(const std::string& hex, std::string& bytes) {
+    if (hex.size() % 2 != 0) return false;
+    bytes.clear();
+    bytes.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int high = hexValue(hex[i]), low = hexValue(hex[i + 1]);
+        if (high < 0 || low < 0) return false;
+        bytes += static_cast<char>(high * 16 + low);
+    }
+    return true;
+}
+
+std::string PasswordHasher::toHex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char c : bytes) {
+        hex += digits[c >> 4];
+        hex += digits[c & 15];
+    }
+    return hex;
+}
@@ -0,0 +1,129 @@
+#include "Protocol.h"
+#include <cstring>
+
+// Indexed by RequestOp value - 1
+static const char* const opNames[] = {
+    "ping", "register_user", "login", "logout", "whoami", "update_name", "update_password",
+    "find_resource", "list_resources", "request_rental", "cancel_rental", "list_my_rentals", "list_my_bills",
+    "admin_add_resource", "admin_delete_resource", "admin_set_user_status", "admin_approve_rental",
+    "admin_reject_rental", "admin_complete_rental", "admin_metrics", "admin_list_rentals", "admin_list_bills"
+};
+
+static_assert(sizeof(opNames) / sizeof(opNames[0]) == static_cast<size_t>(RequestOp::COUNT) - 1,
+              "opNames must list every RequestOp");
+
+const char* requestOpName(RequestOp op) {
+    size_t index = static_cast<size_t>(op);
+    if (index == 0 || index >= static_cast<size_t>(RequestOp::COUNT)) return "unknown";
+    return opNames[index - 1];
+}
+
+bool requestOpFromName(const std::string& name, RequestOp& op) {
+    for (size_t i = 1; i < static_cast<size_t>(RequestOp::COUNT); ++i) {
+        if (name == opNames[i - 1]) {
+            op = static_cast<RequestOp>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool requestOpIsReadOnly(RequestOp op) {
+    switch (op) {
+        case RequestOp::PING:
+        case RequestOp::LOGIN:
+        case RequestOp::LOGOUT:
+        case RequestOp::WHOAMI:
+        case RequestOp::FIND_RESOURCE:
+        case RequestOp::LIST_RESOURCES:
+        case RequestOp::LIST_MY_RENTALS:
+        case RequestOp::LIST_MY_BILLS:
+        case RequestOp::ADMIN_METRICS:
+        case RequestOp::ADMIN_LIST_RENTALS:
+        case RequestOp::ADMIN_LIST_BILLS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+WireWriter& WireWriter::u8(uint8_t value) {
+    buffer += static_cast<char>(value);
+    return *this;
+}
+
+WireWriter& WireWriter::u32(uint32_t value) {
+    char bytes[4] = { static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                      static_cast<char>(value >> 8), static_cast<char>(value) };
+    buffer.append(bytes, 4);
+    return *this;
+}
+
+WireWriter& WireWriter::u64(uint64_t value) {
+    u32(static_cast<uint32_t>(value >> 32));
+    return u32(static_cast<uint32_t>(value));
+}
+
+WireWriter& WireWriter::f64(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return u64(bits);
+}
+
+WireWriter& WireWriter::str(const std::string& value) {
+    u32(static_cast<uint32_t>(value.size()));
+    buffer += value;
+    return *this;
+}
+
+std::string WireWriter::frame() const {
+    WireWriter prefix;
+    prefix.u32(static_cast<uint32_t>(buffer.size()));
+    return prefix.buffer + buffer;
+}
+
+uint32_t readU32(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+           (static_cast<uint32_t>(b[2]) << 8) | static_cast<uint32_t>(b[3]);
+}
+
+bool WireReader::take(size_t size) {
+    if (!valid || static_cast<size_t>(end - cursor) < size) {
+        valid = false;
+        return false;
+    }
+    return true;
+}
+
+uint8_t WireReader::u8() {
+    if (!take(1)) return 0;
+    return static_cast<uint8_t>(*cursor++);
+}
+
+uint32_t WireReader::u32() {
+    if (!take(4)) return 0;
+    uint32_t value = readU32(cursor);
+    cursor += 4;
+    return value;
+}
+
+uint64_t WireReader::u64() {
+    uint64_t high = u32();
+    return (high << 32) | u32();
+}
+
+double WireReader::f64() {
+    uint64_t bits = u64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return valid ? value : 0.0;
+}
+
+std::string WireReader::str() {
+    uint32_t size = u32();
+    if (!take(size)) return std::string();
+    std::string value(cursor, size);
+    cursor += size;
+    return value;
+}
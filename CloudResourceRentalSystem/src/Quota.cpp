@@ -0,0 +1,24 @@
+#include "Quota.h"
+#include <algorithm>
+
+bool TokenBucket::take(double rate, double burst, std::chrono::steady_clock::time_point now) {
+    double capacity = std::max(burst, 1.0);
+    if (!started) {
+        tokens = capacity;
+        started = true;
+    } else {
+        double elapsed = std::chrono::duration<double>(now - refilled).count();
+        tokens = std::min(capacity, tokens + elapsed * rate);
+    }
+    refilled = now;
+    if (tokens < 1.0) return false;
+    tokens -= 1.0;
+    return true;
+}
+
+void QuotaUsage::roll(std::chrono::hours period, std::chrono::system_clock::time_point now) {
+    if (now - periodStart >= period) {
+        periodStart = now;
+        periodHours = 0.0;
+    }
+}
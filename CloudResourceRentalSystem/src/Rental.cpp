@@ -1,6 +1,8 @@
 #include "Rental.h"
+#include "Trace.h"
 #include "Utils.h" // For formatTimePoint
 #include <iostream>
+#include <utility> // For std::move
 #include <iomanip> // For std::fixed, std::setprecision
 #include <ctime>   // For std::localtime, std::put_time (used in Utils::formatTimePoint)
 
@@ -8,21 +10,21 @@
 Rental::Rental(std::string id, std::string uId, std::string rId,
                std::chrono::system_clock::time_point sTime,
                std::chrono::system_clock::time_point eTime)
-    : rentalId(id), userId(uId), resourceId(rId), startTime(sTime), endTime(eTime),
+    : rentalId(std::move(id)), userId(std::move(uId)), resourceId(std::move(rId)), startTime(sTime), endTime(eTime),
       requestTime(std::chrono::system_clock::now()),
       status(RentalStatus::PENDING_APPROVAL), totalCost(0.0) {
 }
 
 // Getters
-std::string Rental::getRentalId() const {
+const std::string& Rental::getRentalId() const {
     return rentalId;
 }
 
-std::string Rental::getUserId() const {
+const std::string& Rental::getUserId() const {
     return userId;
 }
 
-std::string Rental::getResourceId() const {
+const std::string& Rental::getResourceId() const {
     return resourceId;
 }
 
@@ -63,6 +65,10 @@ void Rental::setEndTime(std::chrono::system_clock::time_point eTime) {
     this->endTime = eTime;
 }
 
+void Rental::setRequestTime(std::chrono::system_clock::time_point rTime) {
+    this->requestTime = rTime;
+}
+
 // Helper to convert RentalStatus enum to string
 std::string Rental::rentalStatusToString() const {
     switch (status) {
@@ -72,12 +78,15 @@ std::string Rental::rentalStatusToString() const {
         case RentalStatus::ACTIVE:           return "Active";
         case RentalStatus::COMPLETED:        return "Completed";
         case RentalStatus::CANCELLED:        return "Cancelled";
+        case RentalStatus::PAUSED:           return "Paused";
+        case RentalStatus::OVERDUE:          return "Overdue";
         default:                             return "Unknown Status";
     }
 }
 
 // Display rental information
 void Rental::displayRentalInfo() const {
+    TRACE_SCOPE("Rental::displayRentalInfo");
     std::cout << "----------------------------------------" << std::endl;
     std::cout << "Rental ID: " << rentalId << std::endl;
     std::cout << "User ID: " << userId << std::endl;
@@ -0,0 +1,103 @@
+#include "Replica.h"
+#include "Metrics.h"
+#include "System.h"
+#include "Trace.h"
+#include <algorithm>
+#include <vector>
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Replica::Replica(System& sys, const std::string& logPath, std::chrono::milliseconds interval)
+    : system(sys), reader(logPath), pollInterval(interval), appliedSequence(0), newestTimestampMicros(0),
+      stopping(false) {}
+
+Replica::~Replica() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+void Replica::start() {
+    if (!worker.joinable()) {
+        worker = std::thread(&Replica::run, this);
+    }
+}
+
+// Reads one batch of records and applies it under the System lock
+bool Replica::pollOnce(size_t& recordsRead) {
+    TRACE_SCOPE("Replica::pollOnce");
+    std::vector<ChangeRecord> records;
+    std::string error;
+    size_t applied = 0;
+    bool ok = reader.poll(records, error, APPLY_BATCH);
+    recordsRead = records.size();
+    if (!records.empty()) {
+        std::lock_guard<std::mutex> lock(system.getMutex());
+        for (const ChangeRecord& record : records) {
+            if (!system.applyChange(record, error)) {
+                ok = false;
+                break;
+            }
+            appliedSequence.store(record.sequence, std::memory_order_relaxed);
+            newestTimestampMicros.store(record.timestampMicros, std::memory_order_relaxed);
+            if (record.type != ChangeType::HEARTBEAT) ++applied;
+        }
+    }
+    Metrics::increment(MetricCounter::CHANGES_APPLIED, applied);
+    Metrics::setGauge(MetricGauge::REPLICATION_LAG_MICROS, lagMicros());
+    Metrics::setGauge(MetricGauge::REPLICATION_APPLIED_SEQUENCE, static_cast<int64_t>(sequence()));
+    if (!ok) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failure = error;
+    }
+    return ok;
+}
+
+void Replica::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
+        size_t recordsRead;
+        bool ok = pollOnce(recordsRead);
+        lock.lock();
+        if (!ok) break;
+        // A full batch means more is waiting, so poll again right away
+        if (recordsRead < APPLY_BATCH) {
+            wakeUp.wait_for(lock, pollInterval, [this] { return stopping; });
+        }
+    }
+    // After a failure the lag keeps growing; refresh it until stopped
+    while (!stopping) {
+        Metrics::setGauge(MetricGauge::REPLICATION_LAG_MICROS, lagMicros());
+        wakeUp.wait_for(lock, std::chrono::seconds(1), [this] { return stopping; });
+    }
+}
+
+bool Replica::catchUp() {
+    size_t recordsRead;
+    do {
+        if (!pollOnce(recordsRead)) return false;
+    } while (recordsRead > 0);
+    return true;
+}
+
+uint64_t Replica::sequence() const {
+    return appliedSequence.load(std::memory_order_relaxed);
+}
+
+int64_t Replica::lagMicros() const {
+    int64_t newest = newestTimestampMicros.load(std::memory_order_relaxed);
+    return newest == 0 ? -1 : std::max<int64_t>(0, nowMicros() - newest);
+}
+
+bool Replica::failed(std::string& reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reason = failure;
+    return !failure.empty();
+}
@@ -1,17 +1,19 @@
 #include "Resource.h"
+#include "Trace.h"
 #include <iostream>
 #include <iomanip> // For std::fixed and std::setprecision
+#include <utility> // For std::move
 
 // Constructor
 Resource::Resource(std::string id, ResourceType rType, std::string rName, 
                    std::map<std::string, std::string> rSpecs, double rPricePerHour)
-    : resourceId(id), type(rType), name(rName), specs(rSpecs), 
-      pricePerHour(rPricePerHour), status(ResourceStatus::IDLE) {
+    : resourceId(std::move(id)), type(rType), name(std::move(rName)), specs(std::move(rSpecs)), 
+      pricePerHour(rPricePerHour), status(ResourceStatus::IDLE), catalogSequence(0) {
     // Status is initialized to IDLE by default
 }
 
 // Getters
-std::string Resource::getResourceId() const {
+const std::string& Resource::getResourceId() const {
     return resourceId;
 }
 
@@ -19,7 +21,7 @@ ResourceType Resource::getType() const {
     return type;
 }
 
-std::string Resource::getName() const {
+const std::string& Resource::getName() const {
     return name;
 }
 
@@ -31,7 +33,7 @@ std::string Resource::getSpec(const std::string& key) const {
     return "N/A"; // Or throw an exception, or return an optional
 }
 
-std::map<std::string, std::string> Resource::getAllSpecs() const {
+const std::map<std::string, std::string>& Resource::getAllSpecs() const {
     return specs;
 }
 
@@ -43,6 +45,10 @@ double Resource::getPricePerHour() const {
     return pricePerHour;
 }
 
+size_t Resource::getCatalogSequence() const {
+    return catalogSequence;
+}
+
 // Setters
 void Resource::setStatus(ResourceStatus newStatus) {
     this->status = newStatus;
@@ -60,6 +66,10 @@ void Resource::setSpecs(const std::map<std::string, std::string>& newSpecs) {
     this->specs = newSpecs; // Typically only for admins
 }
 
+void Resource::setCatalogSequence(size_t sequence) {
+    this->catalogSequence = sequence;
+}
+
 // Helper function to convert ResourceType enum to string
 std::string Resource::resourceTypeToString() const {
     switch (type) {
@@ -72,6 +82,7 @@ std::string Resource::resourceTypeToString() const {
 
 // Display resource information
 void Resource::displayResourceInfo() const {
+    TRACE_SCOPE("Resource::displayResourceInfo");
     std::cout << "----------------------------------------" << std::endl;
     std::cout << "Resource ID: " << resourceId << std::endl;
     std::cout << "Name: " << name << std::endl;
@@ -80,6 +91,7 @@ void Resource::displayResourceInfo() const {
     switch (status) {
         case ResourceStatus::IDLE:   std::cout << "Idle";   break;
         case ResourceStatus::IN_USE: std::cout << "In Use"; break;
+        case ResourceStatus::RETIRED: std::cout << "Retired"; break;
         default:                     std::cout << "Unknown";break;
     }
     std::cout << std::endl;
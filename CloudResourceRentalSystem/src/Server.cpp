@@ -0,0 +1,709 @@
+#include "Server.h"
+#include "Utils.h"
+#include "Trace.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// epoll user data: connection IDs count up from 1, the other sources are tagged in the top bits
+static const uint64_t WAKE_TAG = 1ULL << 62;
+static const uint64_t LISTENER_TAG = 1ULL << 63;
+
+static const size_t READ_CHUNK = 64 * 1024;
+static const uint32_t MAX_PAGE_SIZE = 1000;
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Encoders for the records listed in Protocol.h
+static void writeResource(WireWriter& out, const Resource& resource) {
+    out.str(resource.getResourceId()).u8(static_cast<uint8_t>(resource.getType())).str(resource.getName())
+        .f64(resource.getPricePerHour()).u8(static_cast<uint8_t>(resource.getStatus()));
+}
+
+static void writeRental(WireWriter& out, const Rental& rental) {
+    out.str(rental.getRentalId()).str(rental.getResourceId()).u8(static_cast<uint8_t>(rental.getStatus()))
+        .f64(rental.getTotalCost());
+}
+
+static void writeBill(WireWriter& out, const Bill& bill) {
+    out.str(bill.getBillId()).str(bill.getRentalId()).f64(bill.getAmount()).u8(bill.getIsPaid() ? 1 : 0);
+}
+
+template <typename T, typename Writer>
+static void writePage(WireWriter& out, const Page<T>& page, Writer writeItem) {
+    out.u32(static_cast<uint32_t>(page.items.size()));
+    for (const T* item : page.items) writeItem(out, *item);
+    out.str(page.nextCursor);
+}
+
+static PageRequest readPageRequest(WireReader& in) {
+    std::string cursor = in.str();
+    uint32_t size = in.u32();
+    if (size == 0) size = 20;
+    return PageRequest(std::min(size, MAX_PAGE_SIZE), PageOrder::OLDEST_FIRST, cursor);
+}
+
+// The last line System printed, which for a failed call is its error message
+static std::string lastLine(const std::string& console) {
+    size_t end = console.find_last_not_of("\r\n");
+    if (end == std::string::npos) return "Request failed";
+    size_t start = console.find_last_of('\n', end);
+    start = (start == std::string::npos) ? 0 : start + 1;
+    return console.substr(start, end - start + 1);
+}
+
+// Response payload: request ID and status, then the results or the error message
+static std::string encodeResponse(uint32_t requestId, bool ok, const WireWriter& results, const std::string& error) {
+    WireWriter response;
+    response.u32(requestId).u8(static_cast<uint8_t>(ok ? ResponseStatus::OK : ResponseStatus::ERROR));
+    if (!ok) response.str(error);
+    return ok ? response.data() + results.data() : response.data();
+}
+
+// Some System calls do not check the caller's role themselves; the server does not expose them to everyone
+static bool requireAdmin(System& system, const char* action, std::string& error) {
+    User* user = system.getCurrentUser();
+    if (user && user->getRole() == UserRole::ADMIN) return true;
+    Metrics::increment(MetricCounter::PERMISSION_DENIED);
+    error = std::string("Error: Admin privileges required to ") + action + ".";
+    return false;
+}
+
+// Runs one decoded request while holding the System lock with the connection's session current.
+// Returns false with error set if the request failed.
+static bool runRequest(System& system, RequestOp op, WireReader& in, WireWriter& results, std::string& error) {
+    bool ok = false;
+    switch (op) {
+        case RequestOp::PING:
+            ok = in.ok();
+            break;
+        case RequestOp::REGISTER_USER: {
+            std::string username = in.str(), password = in.str();
+            uint8_t role = in.u8();
+            std::string realName = in.str();
+            if (!in.ok()) break;
+            if (role > static_cast<uint8_t>(UserRole::ADMIN)) {
+                error = "Error: Unknown role.";
+                return false;
+            }
+            // Admin accounts can only be created by an admin
+            ok = role == static_cast<uint8_t>(UserRole::ADMIN)
+                     ? system.adminAddUser(username, password, UserRole::ADMIN, realName)
+                     : system.registerUser(username, password, static_cast<UserRole>(role), realName);
+            break;
+        }
+        case RequestOp::LOGOUT:
+            ok = in.ok();
+            if (ok) system.logoutUser();
+            break;
+        case RequestOp::WHOAMI: {
+            if (!in.ok()) break;
+            User* user = system.getCurrentUser();
+            if (!user) {
+                error = "Error: No user logged in.";
+                return false;
+            }
+            results.str(user->getUserId()).str(user->getUsername()).u8(static_cast<uint8_t>(user->getRole()))
+                .u8(static_cast<uint8_t>(user->getStatus())).f64(user->getBalance());
+            ok = true;
+            break;
+        }
+        case RequestOp::UPDATE_NAME: {
+            std::string name = in.str();
+            ok = in.ok() && system.updateCurrentUserName(name);
+            break;
+        }
+        case RequestOp::UPDATE_PASSWORD: {
+            std::string password = in.str();
+            ok = in.ok() && system.updateCurrentUserPassword(password);
+            break;
+        }
+        case RequestOp::FIND_RESOURCE: {
+            std::string resourceId = in.str();
+            if (!in.ok()) break;
+            Resource* resource = system.findResource(resourceId);
+            if (!resource) {
+                error = "Error: Resource '" + resourceId + "' not found.";
+                return false;
+            }
+            writeResource(results, *resource);
+            ok = true;
+            break;
+        }
+        case RequestOp::LIST_RESOURCES: {
+            PageRequest request = readPageRequest(in);
+            if (!in.ok()) break;
+            writePage(results, system.listResources(request), writeResource);
+            ok = true;
+            break;
+        }
+        case RequestOp::REQUEST_RENTAL: {
+            std::string resourceId = in.str();
+            uint32_t hours = in.u32();
+            if (!in.ok()) break;
+            ok = system.requestResourceRental(resourceId, static_cast<int>(std::min<uint32_t>(hours, 1 << 30)));
+            if (ok) {
+                Page<Rental> newest = system.listUserRentals(system.getCurrentUser()->getUserId(),
+                                                             PageRequest(1, PageOrder::NEWEST_FIRST));
+                results.str(newest.items.front()->getRentalId());
+            }
+            break;
+        }
+        case RequestOp::CANCEL_RENTAL: {
+            std::string rentalId = in.str();
+            ok = in.ok() && system.cancelRentalRequest(rentalId);
+            break;
+        }
+        case RequestOp::LIST_MY_RENTALS:
+        case RequestOp::LIST_MY_BILLS: {
+            PageRequest request = readPageRequest(in);
+            if (!in.ok()) break;
+            User* user = system.getCurrentUser();
+            if (!user) {
+                error = "Error: No user logged in.";
+                return false;
+            }
+            if (op == RequestOp::LIST_MY_RENTALS) {
+                writePage(results, system.listUserRentals(user->getUserId(), request), writeRental);
+            } else {
+                writePage(results, system.listUserBills(user->getUserId(), request), writeBill);
+            }
+            ok = true;
+            break;
+        }
+        case RequestOp::ADMIN_ADD_RESOURCE: {
+            std::string resourceId = in.str();
+            uint8_t type = in.u8();
+            std::string name = in.str();
+            double price = in.f64();
+            if (!in.ok()) break;
+            if (!requireAdmin(system, "add resources", error)) return false;
+            if (type > static_cast<uint8_t>(ResourceType::STORAGE)) {
+                error = "Error: Unknown resource type.";
+                return false;
+            }
+            ok = system.addResource(Resource(resourceId, static_cast<ResourceType>(type), name, {}, price));
+            break;
+        }
+        case RequestOp::ADMIN_DELETE_RESOURCE: {
+            std::string resourceId = in.str();
+            ok = in.ok() && system.adminDeleteResource(resourceId);
+            break;
+        }
+        case RequestOp::ADMIN_SET_USER_STATUS: {
+            std::string username = in.str();
+            uint8_t status = in.u8();
+            if (!in.ok()) break;
+            if (status > static_cast<uint8_t>(UserStatus::SUSPENDED)) {
+                error = "Error: Unknown user status.";
+                return false;
+            }
+            ok = system.adminSetUserStatus(username, static_cast<UserStatus>(status));
+            break;
+        }
+        case RequestOp::ADMIN_APPROVE_RENTAL: {
+            std::string rentalId = in.str();
+            ok = in.ok() && system.adminApproveRental(rentalId);
+            break;
+        }
+        case RequestOp::ADMIN_REJECT_RENTAL: {
+            std::string rentalId = in.str(), reason = in.str();
+            ok = in.ok() && system.adminRejectRental(rentalId, reason);
+            break;
+        }
+        case RequestOp::ADMIN_COMPLETE_RENTAL: {
+            std::string rentalId = in.str();
+            if (!in.ok()) break;
+            if (!requireAdmin(system, "complete rentals", error)) return false;
+            ok = system.processRentalCompletion(rentalId);
+            break;
+        }
+        case RequestOp::ADMIN_METRICS: {
+            if (!in.ok()) break;
+            std::ostringstream text;
+            ok = system.adminWriteMetrics(text);
+            if (ok) results.str(text.str());
+            break;
+        }
+        case RequestOp::ADMIN_LIST_RENTALS:
+        case RequestOp::ADMIN_LIST_BILLS: {
+            PageRequest request = readPageRequest(in);
+            if (!in.ok()) break;
+            if (!requireAdmin(system, "list every user's records", error)) return false;
+            if (op == RequestOp::ADMIN_LIST_RENTALS) {
+                writePage(results, system.adminListRentals(request), writeRental);
+            } else {
+                writePage(results, system.adminListBills(request), writeBill);
+            }
+            ok = true;
+            break;
+        }
+        default:
+            error = "Error: Unknown operation.";
+            return false;
+    }
+    if (!in.ok() || !in.atEnd()) {
+        error = "Error: Malformed arguments for " + std::string(requestOpName(op)) + ".";
+        return false;
+    }
+    return ok;
+}
+
+Server::Server(System& sys, const ServerOptions& serverOptions)
+    : system(sys), options(serverOptions), epollFd(-1), wakeFd(-1), stopping(false), nextConnectionId(1),
+      nextOverdueCheck(std::chrono::steady_clock::now() + serverOptions.overdueCheckInterval),
+      overdueCheckRunning(false), pendingLogins(0), accepted(0), openConnections(0), handled(0), protocolErrors(0),
+      dispatchPool(new ThreadPool(serverOptions.dispatchWorkers)) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+Server::~Server() {
+    // Dispatch tasks and the logins they started signal wakeFd, so they finish before it is closed
+    dispatchPool.reset();
+    {
+        std::unique_lock<std::mutex> lock(loginMutex);
+        loginsDone.wait(lock, [this] { return pendingLogins == 0; });
+    }
+    for (auto& entry : connections) close(entry.second->fd);
+    for (int listener : listeners) close(listener);
+    for (const auto& path : unixPaths) unlink(path.c_str());
+    close(wakeFd);
+    close(epollFd);
+}
+
+bool Server::addListener(int fd, std::string& error) {
+    if (listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd)) {
+        error = systemError("listen");
+        close(fd);
+        return false;
+    }
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN;
+    event.data.u64 = LISTENER_TAG | static_cast<uint64_t>(fd);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        error = systemError("epoll_ctl");
+        close(fd);
+        return false;
+    }
+    listeners.push_back(fd);
+    return true;
+}
+
+bool Server::listenUnix(const std::string& path, std::string& error) {
+    sockaddr_un address = sockaddr_un();
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = "Socket path too long: " + path;
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = systemError("socket");
+        return false;
+    }
+    unlink(path.c_str()); // A stale socket file from an earlier run
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error = systemError("bind " + path);
+        close(fd);
+        return false;
+    }
+    unixPaths.push_back(path);
+    return addListener(fd, error);
+}
+
+bool Server::listenTcp(const std::string& address, uint16_t port, std::string& error) {
+    sockaddr_in socketAddress = sockaddr_in();
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+        error = "Bad IPv4 address: " + address;
+        return false;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = systemError("socket");
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0) {
+        error = systemError("bind " + address + ":" + std::to_string(port));
+        close(fd);
+        return false;
+    }
+    return addListener(fd, error);
+}
+
+void Server::run() {
+    std::vector<epoll_event> events(256);
+    while (!stopping.load()) {
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), untilOverdueCheck());
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == WAKE_TAG) {
+                deliverFinished();
+            } else if (tag & LISTENER_TAG) {
+                acceptConnections(static_cast<int>(tag & ~LISTENER_TAG));
+            } else {
+                auto found = connections.find(tag);
+                if (found == connections.end()) continue; // Closed earlier in this batch
+                ConnectionPtr connection = found->second;
+                uint32_t ready = events[i].events;
+                if ((ready & (EPOLLHUP | EPOLLERR)) && !(ready & EPOLLIN)) {
+                    closeConnection(connection);
+                    continue;
+                }
+                if (ready & EPOLLIN) readFrom(connection);
+                if (connection->fd >= 0 && (ready & EPOLLOUT)) writeTo(connection);
+                if (connection->fd >= 0 && !parseFrames(connection)) { // Frames held back by the pipelining limit
+                    ++protocolErrors;
+                    closeConnection(connection);
+                    continue;
+                }
+                if (connection->fd >= 0) updateEvents(connection);
+            }
+        }
+    }
+    std::vector<ConnectionPtr> open;
+    for (auto& entry : connections) open.push_back(entry.second);
+    for (auto& connection : open) closeConnection(connection);
+}
+
+int Server::untilOverdueCheck() {
+    if (options.readOnly || options.overdueCheckInterval.count() <= 0) return -1;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextOverdueCheck) {
+        // A check still running when the next one is due is not queued again
+        if (!overdueCheckRunning.exchange(true)) {
+            dispatchPool->submit(std::bind(&Server::checkOverdueRentals, this));
+        }
+        nextOverdueCheck = now + options.overdueCheckInterval;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextOverdueCheck - now).count();
+    return static_cast<int>(std::max<long long>(1, wait));
+}
+
+void Server::checkOverdueRentals() {
+    {
+        std::lock_guard<std::mutex> lock(system.getMutex());
+        NullStreamBuffer discard;
+        ScopedCoutRedirect silence(&discard);
+        system.switchToUser(""); // No session: the check cannot look ahead
+        try {
+            system.checkOverdueRentals();
+        } catch (const RentalSystemException& fault) {
+            std::cerr << "Internal error in the overdue check: " << fault.what() << std::endl;
+        }
+    }
+    overdueCheckRunning.store(false);
+}
+
+void Server::stop() {
+    stopping.store(true);
+    signalWake();
+}
+
+void Server::signalWake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written; // EAGAIN means a wake-up is already pending
+}
+
+ServerStats Server::stats() const {
+    ServerStats result;
+    result.connectionsAccepted = accepted.load();
+    result.connectionsOpen = openConnections.load();
+    result.requestsHandled = handled.load();
+    result.protocolErrors = protocolErrors.load();
+    return result;
+}
+
+void Server::acceptConnections(int listener) {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN, or a client that gave up before being accepted
+        if (connections.size() >= options.maxConnections) {
+            close(fd);
+            continue;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Fails harmlessly on Unix sockets
+        ConnectionPtr connection = std::make_shared<Connection>(nextConnectionId++, fd);
+        epoll_event event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.u64 = connection->id;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        connection->events = EPOLLIN;
+        connections[connection->id] = connection;
+        ++accepted;
+        ++openConnections;
+    }
+}
+
+void Server::readFrom(const ConnectionPtr& connection) {
+    char buffer[READ_CHUNK];
+    // Level-triggered: whatever is left in the socket is read on a later wake-up
+    while (connection->inFlight < options.maxPipelined) {
+        ssize_t received = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection->input.append(buffer, static_cast<size_t>(received));
+            if (!parseFrames(connection)) {
+                ++protocolErrors;
+                closeConnection(connection);
+                return;
+            }
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (received < 0 && errno == EINTR) continue;
+        closeConnection(connection); // Peer closed or reset; responses still being computed are dropped
+        return;
+    }
+}
+
+bool Server::parseFrames(const ConnectionPtr& connection) {
+    std::string& input = connection->input;
+    size_t offset = 0;
+    while (connection->inFlight < options.maxPipelined && input.size() - offset >= 4) {
+        uint32_t length = readU32(input.data() + offset);
+        if (length > PROTOCOL_MAX_FRAME) return false;
+        if (input.size() - offset - 4 < length) break;
+        enqueue(connection, input.substr(offset + 4, length));
+        offset += 4 + length;
+    }
+    input.erase(0, offset);
+    return true;
+}
+
+void Server::writeTo(const ConnectionPtr& connection) {
+    std::string& output = connection->output;
+    while (connection->outputOffset < output.size()) {
+        ssize_t sent = send(connection->fd, output.data() + connection->outputOffset,
+                            output.size() - connection->outputOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection->outputOffset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (sent < 0 && errno == EINTR) continue;
+        closeConnection(connection);
+        return;
+    }
+    if (connection->outputOffset == output.size()) {
+        output.clear();
+        connection->outputOffset = 0;
+    } else if (connection->outputOffset > output.size() / 2) {
+        output.erase(0, connection->outputOffset);
+        connection->outputOffset = 0;
+    }
+}
+
+void Server::updateEvents(const ConnectionPtr& connection) {
+    size_t unsent = connection->output.size() - connection->outputOffset;
+    uint32_t wanted = 0;
+    if (connection->inFlight < options.maxPipelined && unsent < options.maxOutputBytes) wanted |= EPOLLIN;
+    if (unsent > 0) wanted |= EPOLLOUT;
+    if (wanted == connection->events) return;
+    epoll_event event = epoll_event();
+    event.events = wanted;
+    event.data.u64 = connection->id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->events = wanted;
+}
+
+void Server::closeConnection(const ConnectionPtr& connection) {
+    if (connection->fd < 0) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+    connection->fd = -1; // A dispatch task may still hold the connection; its response is discarded
+    connections.erase(connection->id);
+    --openConnections;
+}
+
+void Server::deliverFinished() {
+    uint64_t wakeups;
+    ssize_t drained = read(wakeFd, &wakeups, sizeof(wakeups));
+    (void)drained;
+    std::deque<std::pair<uint64_t, std::string>> batch;
+    std::vector<ConnectionPtr> resume;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        batch.swap(finished);
+        resume.swap(resumed);
+    }
+    for (auto& connection : resume) {
+        dispatchPool->submit(std::bind(&Server::dispatchNext, this, connection));
+    }
+    std::map<uint64_t, ConnectionPtr> touched;
+    for (auto& response : batch) {
+        auto found = connections.find(response.first);
+        if (found == connections.end()) continue;
+        ConnectionPtr& connection = found->second;
+        touched[connection->id] = connection;
+        connection->output += response.second;
+        --connection->inFlight;
+    }
+    for (auto& entry : touched) {
+        ConnectionPtr& connection = entry.second;
+        // Frames held back by the pipelining limit can go now, whether or not earlier output is still unsent
+        if (!parseFrames(connection)) {
+            ++protocolErrors;
+            closeConnection(connection);
+            continue;
+        }
+        writeTo(connection);
+        if (connection->fd >= 0) updateEvents(connection);
+    }
+}
+
+void Server::enqueue(const ConnectionPtr& connection, std::string payload) {
+    ++connection->inFlight;
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        connection->requests.push_back(std::move(payload));
+        if (!connection->scheduled) {
+            connection->scheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) {
+        dispatchPool->submit(std::bind(&Server::dispatchNext, this, connection));
+    }
+}
+
+void Server::dispatchNext(ConnectionPtr connection) {
+    std::string payload;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        payload = std::move(connection->requests.front());
+        connection->requests.pop_front();
+    }
+    std::string response;
+    if (!execute(connection, payload, response)) return; // The login continues the connection
+    // One request per task, so a busy connection cannot starve the others
+    if (finishRequest(connection, response, false)) {
+        dispatchPool->submit(std::bind(&Server::dispatchNext, this, connection));
+    }
+}
+
+bool Server::finishRequest(const ConnectionPtr& connection, const std::string& response, bool resumeOnLoop) {
+    WireWriter prefix;
+    prefix.u32(static_cast<uint32_t>(response.size()));
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finished.push_back(std::make_pair(connection->id, prefix.data() + response));
+        more = !connection->requests.empty();
+        if (!more) connection->scheduled = false;
+        else if (resumeOnLoop) resumed.push_back(connection);
+    }
+    signalWake();
+    ++handled;
+    return more;
+}
+
+void Server::startLogin(const ConnectionPtr& connection, uint32_t requestId, const std::string& username,
+                        const std::string& password) {
+    {
+        std::lock_guard<std::mutex> lock(loginMutex);
+        ++pendingLogins;
+    }
+    std::lock_guard<std::mutex> lock(system.getMutex());
+    NullStreamBuffer discard;
+    ScopedCoutRedirect silence(&discard);
+    // Hashing runs on the login pool without the System lock. The connection stays scheduled
+    // meanwhile, so its next request waits for the session this sets
+    system.loginUserAsync(username, password, [this, connection, requestId](const LoginResult& result) {
+        WireWriter results;
+        std::string error;
+        if (result.success) {
+            connection->sessionUserId = result.userId;
+            results.str(result.userId);
+        } else {
+            error = "Error: " + result.message + ".";
+        }
+        // Dispatch workers may be shutting down, so the loop dispatches the next request
+        finishRequest(connection, encodeResponse(requestId, result.success, results, error), true);
+        std::lock_guard<std::mutex> lock(loginMutex);
+        if (--pendingLogins == 0) loginsDone.notify_all();
+    });
+}
+
+bool Server::execute(const ConnectionPtr& connection, const std::string& payload, std::string& response) {
+    TRACE_SCOPE("Server::execute");
+    WireReader in(payload.data(), payload.size());
+    uint32_t requestId = in.u32();
+    RequestOp op = static_cast<RequestOp>(in.u8());
+    WireWriter results;
+    std::string error;
+    bool ok = false;
+
+    if (!in.ok()) {
+        error = "Error: Malformed request.";
+    } else if (options.readOnly && !requestOpIsReadOnly(op)) {
+        error = "Error: This server is a read-only replica.";
+    } else if (op == RequestOp::LOGIN) {
+        std::string username = in.str(), password = in.str();
+        if (!in.ok() || !in.atEnd()) {
+            error = "Error: Malformed arguments for login.";
+        } else {
+            startLogin(connection, requestId, username, password);
+            return false;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(system.getMutex());
+        // System reports errors on std::cout; it only writes there under the lock, so the
+        // output is captured per request and a failure's last line becomes the error message
+        std::ostringstream console;
+        ScopedCoutRedirect capture(console.rdbuf());
+        if (!system.switchToUser(connection->sessionUserId)) {
+            connection->sessionUserId.clear(); // Suspended or removed since login
+        }
+        try {
+            ok = runRequest(system, op, in, results, error);
+        } catch (const RentalSystemException& fault) {
+            // One broken request must not take the server down; the fault is logged for the operator
+            std::cerr << "Internal error in " << requestOpName(op) << ": " << fault.what() << std::endl;
+            ok = false;
+            error = "Error: Internal error.";
+        }
+        User* current = system.getCurrentUser();
+        connection->sessionUserId = current ? current->getUserId() : std::string();
+        if (!ok && error.empty()) error = lastLine(console.str());
+    }
+
+    response = encodeResponse(requestId, ok, results, error);
+    return true;
+}
@@ -0,0 +1,481 @@
+#include "ShardedSystem.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional> // For std::hash
+#include <iostream>
+#include <thread>
+
+ShardedSystem::ShardedSystem(size_t shardCount) {
+    shardCount = std::max<size_t>(shardCount, 1);
+    // The login pools of all shards share the cores
+    size_t loginWorkers = std::max<size_t>(1, std::thread::hardware_concurrency() / (2 * shardCount));
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.emplace_back(new System());
+        shards.back()->idOffset = i;
+        shards.back()->idStride = shardCount;
+        shards.back()->setLoginWorkers(loginWorkers);
+    }
+}
+
+size_t ShardedSystem::shardCount() const {
+    return shards.size();
+}
+
+System& ShardedSystem::shard(size_t index) {
+    return *shards[index];
+}
+
+size_t ShardedSystem::shardForUsername(const std::string& username) const {
+    return std::hash<std::string>()(username) % shards.size();
+}
+
+size_t ShardedSystem::shardForResource(const std::string& resourceId) const {
+    return std::hash<std::string>()(resourceId) % shards.size();
+}
+
+// IDs that were not made by a shard are routed to shard 0, where they are not found
+size_t ShardedSystem::shardForUserId(const std::string& userId) const {
+    long long number;
+    return parseUniqueId(userId, "user_", number) && number > 0 ? (number - 1) % shards.size() : 0;
+}
+
+size_t ShardedSystem::shardForRental(const std::string& rentalId) const {
+    long long number;
+    return parseUniqueId(rentalId, "rental_", number) && number > 0 ? (number - 1) % shards.size() : 0;
+}
+
+template <typename Call>
+bool ShardedSystem::onShard(size_t index, const std::string& session, Call call) {
+    System& system = *shards[index];
+    std::lock_guard<std::mutex> lock(system.getMutex());
+    system.switchToUser(session);
+    return call(system);
+}
+
+std::vector<std::unique_lock<std::mutex>> ShardedSystem::lockAll() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto& system : shards) {
+        locks.emplace_back(system->getMutex());
+    }
+    return locks;
+}
+
+bool ShardedSystem::isAdmin(const std::string& session, const char* action) {
+    System& home = *shards[shardForUserId(session)];
+    std::lock_guard<std::mutex> lock(home.getMutex());
+    User* user = session.empty() ? nullptr : home.findUserById(session);
+    if (user && user->getRole() == UserRole::ADMIN && user->getStatus() == UserStatus::ACTIVE) {
+        return true;
+    }
+    Metrics::increment(MetricCounter::PERMISSION_DENIED);
+    std::cout << "Error: Admin privileges required to " << action << "." << std::endl;
+    return false;
+}
+
+void ShardedSystem::syncAdminCopies(const std::string& userId) {
+    TRACE_SCOPE("ShardedSystem::syncAdminCopies");
+    size_t home = shardForUserId(userId);
+    std::unique_ptr<User> original;
+    {
+        std::lock_guard<std::mutex> lock(shards[home]->getMutex());
+        User* user = shards[home]->findUserById(userId);
+        if (!user) return;
+        original.reset(new User(*user));
+    }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (i == home) continue;
+        std::lock_guard<std::mutex> lock(shards[i]->getMutex());
+        User* copy = shards[i]->findUserById(userId);
+        if (copy) {
+            *copy = *original; // Demoted admins keep a copy, which no longer grants anything
+        } else if (original->getRole() == UserRole::ADMIN) {
+            shards[i]->insertUser(*original);
+        }
+    }
+}
+
+bool ShardedSystem::checkResourceIdle(const std::string& resourceId) {
+    System& owner = *shards[shardForResource(resourceId)];
+    std::lock_guard<std::mutex> lock(owner.getMutex());
+    Resource* resource = owner.findResourceById(resourceId);
+    if (!resource) {
+        std::cout << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
+        return false;
+    }
+    if (resource->getStatus() != ResourceStatus::IDLE) {
+        std::cout << "Error: Resource '" << resource->getName() << "' is currently not IDLE." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> ShardedSystem::heldResources(System& system, const std::string& userId) {
+    std::vector<std::string> resourceIds;
+    auto live = system.liveRentalsByUser.find(userId);
+    if (live == system.liveRentalsByUser.end()) return resourceIds;
+    for (size_t position : live->second) {
+        const Rental& rental = system.rentals[position];
+        if (rental.getStatus() == RentalStatus::APPROVED || rental.getStatus() == RentalStatus::ACTIVE ||
+            rental.getStatus() == RentalStatus::OVERDUE) {
+            resourceIds.push_back(rental.getResourceId());
+        }
+    }
+    return resourceIds;
+}
+
+// Resources a suspension released on the user's shard are released on their owner shards too.
+// The owner copies are still IN_USE, so no other shard can allocate them in between.
+void ShardedSystem::releaseOwnerCopies(size_t home, const std::vector<std::string>& resourceIds) {
+    for (const std::string& resourceId : resourceIds) {
+        size_t owner = shardForResource(resourceId);
+        if (owner == home) continue;
+        std::lock_guard<std::mutex> lock(shards[owner]->getMutex());
+        Resource* ownerCopy = shards[owner]->findResourceById(resourceId);
+        if (ownerCopy) ownerCopy->setStatus(ResourceStatus::IDLE);
+    }
+}
+
+// Users
+bool ShardedSystem::registerUser(const std::string& username, const std::string& password, UserRole role,
+                                 const std::string& realName) {
+    std::string userId;
+    bool ok = onShard(shardForUsername(username), "", [&](System& system) {
+        if (!system.registerUser(username, password, role, realName)) return false;
+        userId = system.findUser(username)->getUserId();
+        return true;
+    });
+    if (ok && role == UserRole::ADMIN) {
+        syncAdminCopies(userId);
+    }
+    return ok;
+}
+
+bool ShardedSystem::login(const std::string& username, const std::string& password, std::string& session) {
+    System& home = *shards[shardForUsername(username)];
+    std::future<LoginResult> pending;
+    {
+        std::lock_guard<std::mutex> lock(home.getMutex());
+        pending = home.loginUserAsync(username, password);
+    }
+    LoginResult result = pending.get(); // Hashing runs without the shard lock
+    if (!result.success) {
+        std::cout << "Login failed: " << result.message << "." << std::endl;
+        return false;
+    }
+    session = result.userId;
+    return true;
+}
+
+bool ShardedSystem::updateName(const std::string& session, const std::string& newName) {
+    bool admin = false;
+    bool ok = onShard(shardForUserId(session), session, [&](System& system) {
+        admin = system.getCurrentUser() && system.getCurrentUser()->getRole() == UserRole::ADMIN;
+        return system.updateCurrentUserName(newName);
+    });
+    if (ok && admin) syncAdminCopies(session);
+    return ok;
+}
+
+bool ShardedSystem::updatePassword(const std::string& session, const std::string& newPassword) {
+    bool admin = false;
+    bool ok = onShard(shardForUserId(session), session, [&](System& system) {
+        admin = system.getCurrentUser() && system.getCurrentUser()->getRole() == UserRole::ADMIN;
+        return system.updateCurrentUserPassword(newPassword);
+    });
+    if (ok && admin) syncAdminCopies(session);
+    return ok;
+}
+
+// Resource catalog: the owner shard runs the System call (messages, metrics,
+// audit); the other shards get a silent copy.
+bool ShardedSystem::addResource(const std::string& session, const Resource& resource) {
+    TRACE_SCOPE("ShardedSystem::addResource");
+    if (!isAdmin(session, "add resources")) return false;
+    std::vector<std::unique_lock<std::mutex>> locks = lockAll();
+    size_t owner = shardForResource(resource.getResourceId());
+    System& ownerShard = *shards[owner];
+    ownerShard.switchToUser(session);
+    if (!ownerShard.addResource(resource)) return false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (i == owner || shards[i]->findResourceById(resource.getResourceId())) continue;
+        shards[i]->resources.push_back(resource);
+        shards[i]->resources.back().setCatalogSequence(++shards[i]->resourcesAppended);
+        shards[i]->resourceIndexById[resource.getResourceId()] = shards[i]->resources.size() - 1;
+    }
+    return true;
+}
+
+bool ShardedSystem::modifyResource(const std::string& session, const std::string& resourceId,
+                                   const std::string& newName, const std::map<std::string, std::string>& newSpecs,
+                                   double newPricePerHour) {
+    TRACE_SCOPE("ShardedSystem::modifyResource");
+    std::vector<std::unique_lock<std::mutex>> locks = lockAll();
+    size_t owner = shardForResource(resourceId);
+    System& ownerShard = *shards[owner];
+    ownerShard.switchToUser(session);
+    if (!ownerShard.adminModifyResource(resourceId, newName, newSpecs, newPricePerHour)) return false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        Resource* copy = i == owner ? nullptr : shards[i]->findResourceById(resourceId);
+        if (copy) {
+            copy->setName(newName);
+            copy->setSpecs(newSpecs);
+            copy->setPricePerHour(newPricePerHour);
+        }
+    }
+    return true;
+}
+
+bool ShardedSystem::deleteResource(const std::string& session, const std::string& resourceId) {
+    TRACE_SCOPE("ShardedSystem::deleteResource");
+    std::vector<std::unique_lock<std::mutex>> locks = lockAll();
+    size_t owner = shardForResource(resourceId);
+    // The owner only checks its own rentals; rentals of the resource may live on any shard
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (i == owner) continue;
+        auto live = shards[i]->liveRentalsByResource.find(resourceId);
+        if (live != shards[i]->liveRentalsByResource.end()) {
+            const Rental& rental = shards[i]->rentals[live->second.front()];
+            std::cout << "Error: Resource '" << resourceId << "' cannot be deleted. It is part of an active, "
+                      << "approved, or pending rental (Rental ID: " << rental.getRentalId() << ", Status: "
+                      << rental.rentalStatusToString() << ")." << std::endl;
+            return false;
+        }
+    }
+    System& ownerShard = *shards[owner];
+    ownerShard.switchToUser(session);
+    if (!ownerShard.adminDeleteResource(resourceId)) return false;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (i == owner) continue;
+        Resource* copy = shards[i]->findResourceById(resourceId);
+        if (copy) {
+            shards[i]->tombstoneResource(*copy);
+            shards[i]->compactResources();
+        }
+    }
+    return true;
+}
+
+bool ShardedSystem::findResource(const std::string& resourceId, Resource& resource) {
+    System& owner = *shards[shardForResource(resourceId)];
+    std::lock_guard<std::mutex> lock(owner.getMutex());
+    Resource* found = owner.findResource(resourceId);
+    if (!found) return false;
+    resource = *found;
+    return true;
+}
+
+// Rentals
+bool ShardedSystem::requestRental(const std::string& session, const std::string& resourceId, int durationHours,
+                                  std::string& rentalId) {
+    // The home shard's copy of the resource does not know about allocations made by other shards
+    if (!checkResourceIdle(resourceId)) return false;
+    return onShard(shardForUserId(session), session, [&](System& system) {
+        if (!system.requestResourceRental(resourceId, durationHours)) return false;
+        rentalId = system.rentals.back().getRentalId();
+        return true;
+    });
+}
+
+bool ShardedSystem::cancelRental(const std::string& session, const std::string& rentalId) {
+    return onShard(shardForRental(rentalId), session,
+                   [&](System& system) { return system.cancelRentalRequest(rentalId); });
+}
+
+bool ShardedSystem::rejectRental(const std::string& session, const std::string& rentalId, const std::string& reason) {
+    return onShard(shardForRental(rentalId), session,
+                   [&](System& system) { return system.adminRejectRental(rentalId, reason); });
+}
+
+// Approval and completion change the resource's status on the rental's shard and on the owner shard.
+// Both are locked, lower index first, so two shards cannot allocate the same resource.
+bool ShardedSystem::approveRental(const std::string& session, const std::string& rentalId) {
+    TRACE_SCOPE("ShardedSystem::approveRental");
+    size_t home = shardForRental(rentalId);
+    std::string resourceId;
+    {
+        std::lock_guard<std::mutex> lock(shards[home]->getMutex());
+        Rental* rental = shards[home]->findRentalById(rentalId);
+        if (rental) resourceId = rental->getResourceId();
+    }
+    size_t owner = resourceId.empty() ? home : shardForResource(resourceId);
+    std::unique_lock<std::mutex> first(shards[std::min(home, owner)]->getMutex());
+    std::unique_lock<std::mutex> second;
+    if (owner != home) second = std::unique_lock<std::mutex>(shards[std::max(home, owner)]->getMutex());
+
+    Resource* ownerCopy = owner != home ? shards[owner]->findResourceById(resourceId) : nullptr;
+    System& system = *shards[home];
+    system.switchToUser(session);
+    if (ownerCopy && ownerCopy->getStatus() != ResourceStatus::IDLE &&
+        system.getCurrentUser() && system.getCurrentUser()->getRole() == UserRole::ADMIN) {
+        std::cout << "Error: Resource '" << ownerCopy->getName() << "' (ID: " << resourceId
+                  << ") is in use by a rental on another shard. Cannot approve rental '" << rentalId << "'." << std::endl;
+        return false;
+    }
+    if (!system.adminApproveRental(rentalId)) return false;
+    if (ownerCopy) ownerCopy->setStatus(ResourceStatus::IN_USE);
+    return true;
+}
+
+bool ShardedSystem::completeRental(const std::string& session, const std::string& rentalId) {
+    TRACE_SCOPE("ShardedSystem::completeRental");
+    // processRentalCompletion leaves the permission check to its caller
+    if (!isAdmin(session, "complete rentals")) return false;
+    size_t home = shardForRental(rentalId);
+    std::string resourceId;
+    {
+        std::lock_guard<std::mutex> lock(shards[home]->getMutex());
+        Rental* rental = shards[home]->findRentalById(rentalId);
+        if (rental) resourceId = rental->getResourceId();
+    }
+    size_t owner = resourceId.empty() ? home : shardForResource(resourceId);
+    std::unique_lock<std::mutex> first(shards[std::min(home, owner)]->getMutex());
+    std::unique_lock<std::mutex> second;
+    if (owner != home) second = std::unique_lock<std::mutex>(shards[std::max(home, owner)]->getMutex());
+
+    System& system = *shards[home];
+    system.switchToUser(session);
+    if (!system.processRentalCompletion(rentalId)) return false;
+    Resource* ownerCopy = owner != home ? shards[owner]->findResourceById(resourceId) : nullptr;
+    if (ownerCopy) ownerCopy->setStatus(ResourceStatus::IDLE);
+    return true;
+}
+
+// Admin user management
+bool ShardedSystem::modifyUser(const std::string& session, const std::string& targetUsername,
+                               const std::string& newRealName, UserRole newRole, UserStatus newStatus,
+                               double newBalance, SuspensionCascade cascade) {
+    bool wasAdmin = false;
+    std::string userId;
+    std::vector<std::string> released;
+    size_t home = shardForUsername(targetUsername);
+    bool ok = onShard(home, session, [&](System& system) {
+        User* target = system.findUser(targetUsername);
+        if (target) {
+            wasAdmin = target->getRole() == UserRole::ADMIN;
+            userId = target->getUserId();
+            if (target->getStatus() != UserStatus::SUSPENDED && newStatus == UserStatus::SUSPENDED &&
+                cascade != SuspensionCascade::NONE) {
+                released = heldResources(system, userId);
+            }
+        }
+        return system.adminModifyUser(targetUsername, newRealName, newRole, newStatus, newBalance, cascade);
+    });
+    if (ok) releaseOwnerCopies(home, released);
+    if (ok && (wasAdmin || newRole == UserRole::ADMIN)) syncAdminCopies(userId);
+    return ok;
+}
+
+bool ShardedSystem::setUserStatus(const std::string& session, const std::string& targetUsername,
+                                  UserStatus newStatus, SuspensionCascade cascade) {
+    bool admin = false;
+    std::string userId;
+    std::vector<std::string> released;
+    size_t home = shardForUsername(targetUsername);
+    bool ok = onShard(home, session, [&](System& system) {
+        User* target = system.findUser(targetUsername);
+        if (target) {
+            admin = target->getRole() == UserRole::ADMIN;
+            userId = target->getUserId();
+            if (target->getStatus() != UserStatus::SUSPENDED && newStatus == UserStatus::SUSPENDED &&
+                cascade != SuspensionCascade::NONE) {
+                released = heldResources(system, userId);
+            }
+        }
+        return system.adminSetUserStatus(targetUsername, newStatus, cascade);
+    });
+    if (ok) releaseOwnerCopies(home, released);
+    if (ok && admin) syncAdminCopies(userId);
+    return ok;
+}
+
+// Listings
+ShardedPage<Rental> ShardedSystem::listUserRentals(const std::string& session, const std::string& userId,
+                                                   const PageRequest& request) {
+    ShardedPage<Rental> result;
+    onShard(shardForUserId(userId), session, [&](System& system) {
+        Page<Rental> page = system.listUserRentals(userId, request);
+        for (const Rental* rental : page.items) result.items.push_back(*rental);
+        result.nextCursor = page.nextCursor;
+        return true;
+    });
+    return result;
+}
+
+ShardedPage<Bill> ShardedSystem::listUserBills(const std::string& session, const std::string& userId,
+                                               const PageRequest& request) {
+    ShardedPage<Bill> result;
+    onShard(shardForUserId(userId), session, [&](System& system) {
+        Page<Bill> page = system.listUserBills(userId, request);
+        for (const Bill* bill : page.items) result.items.push_back(*bill);
+        result.nextCursor = page.nextCursor;
+        return true;
+    });
+    return result;
+}
+
+// Walks the shards in order (reverse order for NEWEST_FIRST). The cursor is
+// "<shard>:<cursor within that shard>". Admin copies are skipped when listing
+// users, so such pages may hold fewer items than requested.
+template <typename T, typename List>
+ShardedPage<T> ShardedSystem::collectPage(const std::string& session, const PageRequest& request, List list,
+                                          bool skipCopies) {
+    ShardedPage<T> result;
+    bool newestFirst = request.order == PageOrder::NEWEST_FIRST;
+    size_t index = newestFirst ? shards.size() - 1 : 0;
+    std::string inner;
+    if (request.pageSize == 0) return result;
+    if (!request.cursor.empty()) {
+        char* end;
+        unsigned long parsed = std::strtoul(request.cursor.c_str(), &end, 10);
+        if (*end != ':' || end == request.cursor.c_str() || parsed >= shards.size()) return result;
+        index = parsed;
+        inner = end + 1;
+    }
+
+    while (true) {
+        Page<T> page;
+        {
+            System& system = *shards[index];
+            std::lock_guard<std::mutex> lock(system.getMutex());
+            system.switchToUser(session);
+            page = list(system, PageRequest(request.pageSize - result.items.size(), request.order, inner));
+            for (const T* item : page.items) {
+                if (!skipCopies || shardForUserId(item->getUserId()) == index) result.items.push_back(*item);
+            }
+        }
+        if (!page.nextCursor.empty()) {
+            inner = page.nextCursor;
+        } else if (newestFirst ? index == 0 : index + 1 == shards.size()) {
+            return result;
+        } else {
+            index = newestFirst ? index - 1 : index + 1;
+            inner.clear();
+        }
+        if (result.items.size() >= request.pageSize) {
+            result.nextCursor = std::to_string(index) + ":" + inner;
+            return result;
+        }
+    }
+}
+
+ShardedPage<User> ShardedSystem::adminListUsers(const std::string& session, const PageRequest& request) {
+    if (!isAdmin(session, "list users")) return ShardedPage<User>();
+    return collectPage<User>(session, request, [](System& system, const PageRequest& part) {
+        return system.adminListUsers(part);
+    }, true);
+}
+
+ShardedPage<Rental> ShardedSystem::adminListRentals(const std::string& session, const PageRequest& request) {
+    if (!isAdmin(session, "list rentals")) return ShardedPage<Rental>();
+    return collectPage<Rental>(session, request, [](System& system, const PageRequest& part) {
+        return system.adminListRentals(part);
+    });
+}
+
+ShardedPage<Bill> ShardedSystem::adminListBills(const std::string& session, const PageRequest& request) {
+    if (!isAdmin(session, "list bills")) return ShardedPage<Bill>();
+    return collectPage<Bill>(session, request, [](System& system, const PageRequest& part) {
+        return system.adminListBills(part);
+    });
+}
@@ -0,0 +1,73 @@
+#include "Snapshot.h"
+#include <algorithm>
+#include <limits>
+
+static const uint64_t NO_PINS = std::numeric_limits<uint64_t>::max();
+
+SnapshotStore::SnapshotStore() : epoch(0), oldestPinned(NO_PINS) {}
+
+// Versions a reader could still need: those visible at the oldest pinned epoch,
+// or only the one being written when nothing is pinned
+uint64_t SnapshotStore::oldestNeeded(uint64_t writing) const {
+    return std::min(oldestPinned.load(std::memory_order_acquire), writing);
+}
+
+void SnapshotStore::put(const User& user) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    users.put(user.getUserId(), user, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+void SnapshotStore::put(const Resource& resource) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    resources.put(resource.getResourceId(), resource, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+void SnapshotStore::put(const Rental& rental) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    rentals.put(rental.getRentalId(), rental, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+void SnapshotStore::put(const Bill& bill) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    bills.put(bill.getBillId(), bill, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+void SnapshotStore::removeResource(const std::string& resourceId) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    resources.remove(resourceId, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+void SnapshotStore::removeBill(const std::string& billId) {
+    uint64_t next = epoch.load(std::memory_order_relaxed) + 1;
+    bills.remove(billId, next, oldestNeeded(next));
+    epoch.store(next, std::memory_order_release);
+}
+
+// Pins happen under the System lock, so no write is in progress and every
+// later write sees the pin before it reclaims anything
+uint64_t SnapshotStore::pin() {
+    std::lock_guard<std::mutex> lock(pinMutex);
+    uint64_t current = epoch.load(std::memory_order_acquire);
+    pins.push_back(current);
+    oldestPinned.store(*std::min_element(pins.begin(), pins.end()), std::memory_order_release);
+    return current;
+}
+
+// Needs no System lock: a writer that still sees the old pin only keeps more than necessary
+void SnapshotStore::unpin(uint64_t pinnedEpoch) {
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins.erase(std::find(pins.begin(), pins.end(), pinnedEpoch));
+    oldestPinned.store(pins.empty() ? NO_PINS : *std::min_element(pins.begin(), pins.end()),
+                       std::memory_order_release);
+}
+
+Snapshot::Snapshot(SnapshotStore& snapshotStore) : store(snapshotStore), pinnedEpoch(store.pin()) {}
+
+Snapshot::~Snapshot() {
+    store.unpin(pinnedEpoch);
+}
@@ -1,61 +1,814 @@
 #include "System.h"
 #include "User.h" // Included for User class definition, though System.h includes it
 #include "Utils.h"  // For generateUniqueId
+#include "Trace.h"
+#include "Protocol.h" // WireWriter/WireReader for change log records
 #include <iostream>
-#include <algorithm> // For std::find_if
+#include <algorithm> // For std::remove_if, std::min
 #include <sstream>   // Not strictly needed here if using Utils::generateUniqueId
 #include <iomanip>   // For std::fixed and std::setprecision
+#include <cmath>     // For std::llround
+#include <cstdint>   // For SIZE_MAX
 
 // Constructor
-System::System() : currentUser(nullptr) {
+System::System()
+    : currentUser(nullptr),
+      rentalIndexById(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                      PoolAllocator<std::pair<const std::string, size_t>>(&indexPool)),
+      rentalsByUser(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                    PoolAllocator<std::pair<const std::string, std::vector<size_t>>>(&indexPool)),
+      billsByUser(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                  PoolAllocator<std::pair<const std::string, std::vector<size_t>>>(&indexPool)),
+      quotaUsage(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                 PoolAllocator<std::pair<const std::string, QuotaUsage>>(&indexPool)),
+      liveRentalsByUser(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                        PoolAllocator<std::pair<const std::string, LiveRentals>>(&indexPool)),
+      liveRentalsByResource(0, std::hash<std::string>(), std::equal_to<std::string>(),
+                            PoolAllocator<std::pair<const std::string, LiveRentals>>(&indexPool)),
+      rentalsByEndTime(std::less<ExpiryKey>(), PoolAllocator<ExpiryKey>(&indexPool)), autoCompleteOverdue(false),
+      retiredResources(0), resourcesAppended(0), billsAppended(0), lowBalanceHorizon(24),
+      auditLog(nullptr), changeLog(nullptr), eventStream(nullptr), idOffset(0), idStride(1), lastErrorCode(ErrorCode::OK),
+      consoleMessages(true), silentConsole(nullptr), loginWorkerCount(0) {
     // Initialization, if any, can go here
 }
 
 // Destructor
 System::~System() {
-    // Cleanup, if any (e.g., if using raw pointers for users and dynamically allocating them)
-    // If users vector holds objects directly, or smart pointers, this might not be needed.
+    // Login workers still running take stateMutex and touch users, so they finish first
+    loginPool.reset();
+}
+
+ErrorCode System::lastError() const {
+    return lastErrorCode;
+}
+
+void System::setConsoleMessages(bool enabled) {
+    consoleMessages = enabled;
+}
+
+std::ostream& System::console() const {
+    return consoleMessages ? std::cout : silentConsole;
+}
+
+bool System::fail(ErrorCode code) const {
+    lastErrorCode = code;
+    return false;
+}
+
+std::mutex& System::getMutex() const {
+    return stateMutex;
+}
+
+void System::attachAuditLog(AuditLog* log) {
+    auditLog = log;
+}
+
+void System::attachChangeLog(ChangeLogWriter* log) {
+    changeLog = log;
+}
+
+void System::attachEventStream(ChangeEventStream* stream) {
+    eventStream = stream;
+}
+
+void System::enableSnapshots() {
+    if (snapshots) return;
+    snapshots.reset(new SnapshotStore());
+    for (const auto& user : users) snapshots->put(user);
+    for (const auto& resource : resources) snapshots->put(resource);
+    for (const auto& rental : rentals) snapshots->put(rental);
+    for (const auto& bill : bills) snapshots->put(bill);
+}
+
+std::unique_ptr<Snapshot> System::adminOpenSnapshot() {
+    ApiTimer timer(ApiMethod::ADMIN_OPEN_SNAPSHOT);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to open snapshots." << std::endl;
+        lastErrorCode = ErrorCode::PERMISSION_DENIED;
+        return nullptr;
+    }
+    if (!snapshots) {
+        console() << "Error: Snapshots are not enabled." << std::endl;
+        lastErrorCode = ErrorCode::INVALID_STATE;
+        return nullptr;
+    }
+    return std::unique_ptr<Snapshot>(new Snapshot(*snapshots));
+}
+
+void System::beginTransaction() {
+    ApiTimer timer(ApiMethod::BEGIN_TRANSACTION);
+    openSavepoint();
+}
+
+bool System::commitTransaction() {
+    ApiTimer timer(ApiMethod::COMMIT_TRANSACTION);
+    return commitSavepoint();
+}
+
+bool System::rollbackTransaction() {
+    ApiTimer timer(ApiMethod::ROLLBACK_TRANSACTION);
+    return rollbackSavepoint();
+}
+
+// The scoped Transaction calls these directly, so only callers' own transactions are timed
+void System::openSavepoint() {
+    Savepoint savepoint;
+    savepoint.undoRecords = undoLog.size();
+    savepoint.userImages = userImages.size();
+    savepoint.resourceImages = resourceImages.size();
+    savepoint.pendingAudits = pendingAudits.size();
+    savepoint.pendingCounts = pendingCounts.size();
+    savepoint.pendingEvents = pendingEvents.size();
+    savepoints.push_back(savepoint);
+}
+
+bool System::commitSavepoint() {
+    if (savepoints.empty()) {
+        console() << "Error: No transaction to commit." << std::endl;
+        return fail(ErrorCode::INVALID_STATE);
+    }
+    savepoints.pop_back(); // An inner commit hands its undo records to the enclosing transaction
+    if (savepoints.empty()) {
+        undoLog.clear();
+        userImages.clear();
+        resourceImages.clear();
+        publishPending();
+    }
+    return true;
+}
+
+bool System::rollbackSavepoint() {
+    if (savepoints.empty()) {
+        console() << "Error: No transaction to roll back." << std::endl;
+        return fail(ErrorCode::INVALID_STATE);
+    }
+    Savepoint savepoint = savepoints.back();
+    while (undoLog.size() > savepoint.undoRecords) {
+        undo(undoLog.back());
+        undoLog.pop_back();
+    }
+    savepoints.pop_back(); // Only now, so undoing does not publish anything meanwhile
+    userImages.erase(userImages.begin() + savepoint.userImages, userImages.end());
+    resourceImages.erase(resourceImages.begin() + savepoint.resourceImages, resourceImages.end());
+    pendingAudits.erase(pendingAudits.begin() + savepoint.pendingAudits, pendingAudits.end());
+    pendingCounts.erase(pendingCounts.begin() + savepoint.pendingCounts, pendingCounts.end());
+    pendingEvents.erase(pendingEvents.begin() + savepoint.pendingEvents, pendingEvents.end());
+    // Pending changes are kept: they log whatever state an entity ends up in,
+    // which also covers changes that have no undo record (e.g. a login upgrading a hash)
+    if (savepoints.empty()) publishPending();
+    return true;
+}
+
+bool System::inTransaction() const {
+    return !savepoints.empty();
+}
+
+void System::publishPending() {
+    for (const auto& change : pendingChanges) {
+        switch (change.type) {
+            case ChangeType::USER_PUT:
+                if (change.position < users.size()) logUser(users[change.position]);
+                break;
+            case ChangeType::RESOURCE_PUT:
+                if (change.position < resources.size()) logResource(resources[change.position]);
+                break;
+            case ChangeType::RENTAL_PUT:
+                if (change.position < rentals.size()) logRental(rentals[change.position]);
+                break;
+            case ChangeType::BILL_PUT:
+                if (change.position < bills.size()) logBill(bills[change.position]);
+                break;
+            default:
+                break;
+        }
+    }
+    pendingChanges.clear();
+    for (const auto& record : pendingAudits) {
+        auditAs(record.actor, record.op, record.target, record.amount, record.detail);
+    }
+    pendingAudits.clear();
+    for (const auto& counted : pendingCounts) {
+        Metrics::increment(counted.first, counted.second);
+    }
+    pendingCounts.clear();
+    if (eventStream) {
+        for (auto& event : pendingEvents) eventStream->publish(event);
+    }
+    pendingEvents.clear();
+    alertLowBalances();
+}
+
+// Rentals holding their resource, whose cost is committed: the low-balance watch projects their spend
+static bool isRunning(RentalStatus status) {
+    return status == RentalStatus::APPROVED || status == RentalStatus::ACTIVE || status == RentalStatus::OVERDUE;
+}
+
+void System::recordUndo(UndoOp op, size_t position, uint32_t oldValue, double oldNumber) {
+    if (!savepoints.empty()) undoLog.emplace_back(op, position, oldValue, oldNumber);
+}
+
+void System::undo(const UndoRecord& record) {
+    switch (record.op) {
+        case UndoOp::USER_STATUS:
+            users[record.position].setStatus(static_cast<UserStatus>(record.value));
+            break;
+        case UndoOp::USER_BALANCE:
+            users[record.position].setBalance(record.number);
+            balanceWatch.setBalance(users[record.position].getUserId(), record.number);
+            break;
+        case UndoOp::USER_IMAGE:
+            users[record.position] = userImages[record.value];
+            balanceWatch.setBalance(users[record.position].getUserId(), users[record.position].getBalance());
+            break;
+        case UndoOp::USERS_APPENDED:
+            for (size_t i = record.position; i < users.size(); ++i) {
+                balanceWatch.removeUser(users[i].getUserId());
+                userIndexByName.erase(users[i].getUsername());
+                userIndexById.erase(users[i].getUserId());
+                if (currentUser == &users[i]) currentUser = nullptr;
+            }
+            users.erase(users.begin() + record.position, users.end());
+            break;
+        case UndoOp::RESOURCE_STATUS:
+            resources[record.position].setStatus(static_cast<ResourceStatus>(record.value));
+            break;
+        case UndoOp::RESOURCE_IMAGE: {
+            double price = resources[record.position].getPricePerHour();
+            resources[record.position] = resourceImages[record.value];
+            repriceRentals(resources[record.position], price);
+            break;
+        }
+        case UndoOp::RESOURCES_APPENDED:
+            for (size_t i = record.position; i < resources.size(); ++i) {
+                resourceIndexById.erase(resources[i].getResourceId());
+            }
+            resources.erase(resources.begin() + record.position, resources.end());
+            break;
+        case UndoOp::RENTAL_STATUS: {
+            Rental& rental = rentals[record.position];
+            RentalStatus undone = rental.getStatus();
+            rental.setStatus(static_cast<RentalStatus>(record.value));
+            trackRentalStatus(rental, undone, rental.getStatus());
+            break;
+        }
+        case UndoOp::RENTAL_COST: {
+            Rental& rental = rentals[record.position];
+            if (isRunning(rental.getStatus())) balanceWatch.addBilled(rental.getUserId(), record.number - rental.getTotalCost());
+            rental.setTotalCost(record.number);
+            break;
+        }
+        case UndoOp::RENTAL_TIMES: {
+            Rental& rental = rentals[record.position];
+            auto moved = std::chrono::system_clock::duration(static_cast<std::chrono::system_clock::rep>(record.number));
+            rental.setStartTime(rental.getStartTime() - moved);
+            rental.setEndTime(rental.getEndTime() - moved);
+            break;
+        }
+        case UndoOp::RENTALS_APPENDED:
+            for (size_t i = rentals.size(); i-- > record.position;) {
+                untrackRental(rentals[i]);
+                rentalIndexById.erase(rentals[i].getRentalId());
+                auto owned = rentalsByUser.find(rentals[i].getUserId());
+                if (owned != rentalsByUser.end() && !owned->second.empty() && owned->second.back() == i) {
+                    owned->second.pop_back();
+                    if (owned->second.empty()) rentalsByUser.erase(owned);
+                }
+            }
+            rentals.erase(rentals.begin() + record.position, rentals.end());
+            break;
+        case UndoOp::BILLS_APPENDED:
+            for (size_t i = bills.size(); i-- > record.position;) {
+                auto owned = billsByUser.find(bills[i].getUserId());
+                if (owned != billsByUser.end() && !owned->second.empty() && owned->second.back() == i) {
+                    owned->second.pop_back();
+                    if (owned->second.empty()) billsByUser.erase(owned);
+                }
+            }
+            bills.erase(bills.begin() + record.position, bills.end());
+            break;
+    }
+}
+
+void System::setUserStatus(User& user, UserStatus status) {
+    recordUndo(UndoOp::USER_STATUS, &user - users.data(), static_cast<uint32_t>(user.getStatus()));
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::USER_STATUS_CHANGED, user.getUserId());
+        event.oldCode = static_cast<uint32_t>(user.getStatus());
+        event.newCode = static_cast<uint32_t>(status);
+        emit(event);
+    }
+    user.setStatus(status);
+}
+
+void System::setUserBalance(User& user, double balance) {
+    recordUndo(UndoOp::USER_BALANCE, &user - users.data(), 0, user.getBalance());
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::USER_BALANCE_CHANGED, user.getUserId());
+        event.oldAmount = user.getBalance();
+        event.newAmount = balance;
+        emit(event);
+    }
+    user.setBalance(balance);
+    balanceWatch.setBalance(user.getUserId(), balance);
+    alertLowBalances();
+}
+
+void System::setResourceStatus(Resource& resource, ResourceStatus status) {
+    recordUndo(UndoOp::RESOURCE_STATUS, &resource - resources.data(), static_cast<uint32_t>(resource.getStatus()));
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::RESOURCE_STATUS_CHANGED, resource.getResourceId());
+        event.oldCode = static_cast<uint32_t>(resource.getStatus());
+        event.newCode = static_cast<uint32_t>(status);
+        emit(event);
+    }
+    resource.setStatus(status);
+}
+
+void System::setRentalStatus(Rental& rental, RentalStatus status) {
+    RentalStatus oldStatus = rental.getStatus();
+    recordUndo(UndoOp::RENTAL_STATUS, &rental - rentals.data(), static_cast<uint32_t>(oldStatus));
+    rental.setStatus(status);
+    trackRentalStatus(rental, oldStatus, status);
+    if (eventStream) emitRentalStatus(rental, oldStatus);
+}
+
+void System::setRentalCost(Rental& rental, double cost) {
+    recordUndo(UndoOp::RENTAL_COST, &rental - rentals.data(), 0, rental.getTotalCost());
+    if (isRunning(rental.getStatus())) balanceWatch.addBilled(rental.getUserId(), cost - rental.getTotalCost());
+    rental.setTotalCost(cost);
+}
+
+void System::count(MetricCounter counter, uint64_t amount) {
+    if (savepoints.empty()) {
+        Metrics::increment(counter, amount);
+    } else {
+        pendingCounts.emplace_back(counter, amount);
+    }
+}
+
+void System::emit(ChangeEvent& event) {
+    if (savepoints.empty()) {
+        eventStream->publish(event);
+    } else {
+        pendingEvents.push_back(event);
+    }
+}
+
+void System::emitRentalStatus(const Rental& rental, RentalStatus oldStatus) {
+    ChangeEvent event(ChangeEventType::RENTAL_STATUS_CHANGED, rental.getRentalId());
+    event.userId = rental.getUserId();
+    event.relatedId = rental.getResourceId();
+    event.oldCode = static_cast<uint32_t>(oldStatus);
+    event.newCode = static_cast<uint32_t>(rental.getStatus());
+    event.newAmount = rental.getTotalCost();
+    emit(event);
+}
+
+void System::auditChange(AuditOp op, const std::string& target, double amount, uint32_t detail) {
+    if (savepoints.empty()) {
+        audit(op, target, amount, detail);
+    } else if (auditLog) {
+        PendingAudit record = { op, currentUser ? currentUser->getUserId() : std::string(), target, amount, detail };
+        pendingAudits.push_back(record);
+    }
+}
+
+// Private helper: queues an audit record; does not wait for the disk
+void System::audit(AuditOp op, const std::string& target, double amount, uint32_t detail) {
+    if (auditLog) {
+        auditLog->append(op, currentUser ? currentUser->getUserId() : std::string(), target, amount, detail);
+    }
+}
+
+void System::auditAs(const std::string& actor, AuditOp op, const std::string& target, double amount, uint32_t detail) {
+    if (auditLog) {
+        auditLog->append(op, actor, target, amount, detail);
+    }
 }
 
 // Private helper method to find a user by username
 User* System::findUser(const std::string& username) {
-    auto it = std::find_if(users.begin(), users.end(), 
-                           [&username](const User& u) { return u.getUsername() == username; });
-    if (it != users.end()) {
-        return &(*it); // Return a pointer to the found user
+    TRACE_SCOPE("System::findUser");
+    auto it = userIndexByName.find(username);
+    if (it != userIndexByName.end()) {
+        return &users[it->second]; // Return a pointer to the found user
     }
     return nullptr; // User not found
 }
 
 // Private helper method to find a user by user ID
 User* System::findUserById(const std::string& userId) {
-    auto it = std::find_if(users.begin(), users.end(),
-                           [&userId](const User& u) { return u.getUserId() == userId; });
-    if (it != users.end()) {
-        return &(*it); // Return a pointer to the found user
+    TRACE_SCOPE("System::findUserById");
+    auto it = userIndexById.find(userId);
+    if (it != userIndexById.end()) {
+        return &users[it->second]; // Return a pointer to the found user
     }
     return nullptr; // User not found
 }
 
+std::string System::nextId(const std::string& prefix, size_t count) const {
+    return generateUniqueId(prefix, static_cast<int>(count * idStride + idOffset));
+}
+
+// Creates a user with the next free ID. The caller has already checked that
+// the username is free.
+User* System::appendUser(const std::string& username, const std::string& password, UserRole role,
+                         const std::string& realName) {
+    User* user = insertUser(User(nextId("user_", users.size()), username, password, role, realName));
+    logUser(*user);
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::USER_CREATED, user->getUserId());
+        emit(event);
+    }
+    return user;
+}
+
+// Adds a user to the container and the indexes. Growing the vector may move
+// every User, so the currentUser pointer is looked up again afterwards.
+User* System::insertUser(const User& user) {
+    std::string currentUserId = currentUser ? currentUser->getUserId() : "";
+    recordUndo(UndoOp::USERS_APPENDED, users.size());
+    users.push_back(user);
+    userIndexByName[user.getUsername()] = users.size() - 1;
+    userIndexById[user.getUserId()] = users.size() - 1;
+    if (currentUser) {
+        currentUser = findUserById(currentUserId);
+    }
+    return &users.back();
+}
+
+void System::rebuildResourceIndex() {
+    TRACE_SCOPE("System::rebuildResourceIndex");
+    resourceIndexById.clear();
+    resourceIndexById.reserve(resources.size());
+    for (size_t i = 0; i < resources.size(); ++i) {
+        if (resources[i].getStatus() != ResourceStatus::RETIRED) resourceIndexById[resources[i].getResourceId()] = i;
+    }
+}
+
+// Deleting a resource only marks it, so it costs the same however large the
+// catalog is; compactResources drops the tombstones later.
+void System::tombstoneResource(Resource& resource) {
+    resource.setStatus(ResourceStatus::RETIRED);
+    resourceIndexById.erase(resource.getResourceId());
+    ++retiredResources;
+}
+
+void System::retireResource(Resource& resource) {
+    const std::string& resourceId = resource.getResourceId();
+    tombstoneResource(resource);
+    if (snapshots) snapshots->removeResource(resourceId);
+    WireWriter change;
+    logChange(ChangeType::RESOURCE_DELETED, change.str(resourceId).data());
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::RESOURCE_DELETED, resourceId);
+        emit(event);
+    }
+}
+
+// Amortized over the deletions that made the tombstones, so each one stays O(1)
+void System::compactResources() {
+    if (retiredResources == 0 || retiredResources * 2 < resources.size()) return;
+    resources.erase(std::remove_if(resources.begin(), resources.end(),
+                                   [](const Resource& r) { return r.getStatus() == ResourceStatus::RETIRED; }),
+                    resources.end());
+    retiredResources = 0;
+    rebuildResourceIndex();
+}
+
+void System::rebuildBillIndex() {
+    TRACE_SCOPE("System::rebuildBillIndex");
+    billsByUser.clear();
+    for (size_t i = 0; i < bills.size(); ++i) {
+        billsByUser[bills[i].getUserId()].push_back(i);
+    }
+}
+
+// Change log records. Times are stored as raw system_clock ticks so a replica
+// restores them exactly; enums are stored as their declaration index.
+static uint64_t toTicks(std::chrono::system_clock::time_point time) {
+    return static_cast<uint64_t>(time.time_since_epoch().count());
+}
+
+static std::chrono::system_clock::time_point fromTicks(uint64_t ticks) {
+    return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(static_cast<int64_t>(ticks)));
+}
+
+void System::logChange(ChangeType type, const std::string& body) {
+    if (changeLog) {
+        changeLog->append(type, body);
+    }
+}
+
+// userId, username, salt, hash, iterations u32, role u8, status u8, balance, name
+void System::logUser(const User& user) {
+    if (!savepoints.empty()) {
+        pendingChanges.push_back(PendingChange{ChangeType::USER_PUT, static_cast<size_t>(&user - users.data())});
+        return;
+    }
+    if (snapshots) snapshots->put(user);
+    if (!changeLog) return;
+    const PasswordCredential& credential = user.getPasswordCredential();
+    WireWriter out;
+    out.str(user.getUserId()).str(user.getUsername()).str(credential.salt).str(credential.hash)
+        .u32(credential.iterations).u8(static_cast<uint8_t>(user.getRole())).u8(static_cast<uint8_t>(user.getStatus()))
+        .f64(user.getBalance()).str(user.getName());
+    logChange(ChangeType::USER_PUT, out.data());
+}
+
+// resourceId, type u8, name, spec count u32, (key, value)..., pricePerHour, status u8
+void System::logResource(const Resource& resource) {
+    if (!savepoints.empty()) {
+        pendingChanges.push_back(PendingChange{ChangeType::RESOURCE_PUT, static_cast<size_t>(&resource - resources.data())});
+        return;
+    }
+    if (snapshots) snapshots->put(resource);
+    if (!changeLog) return;
+    const std::map<std::string, std::string>& specs = resource.getAllSpecs();
+    WireWriter out;
+    out.str(resource.getResourceId()).u8(static_cast<uint8_t>(resource.getType())).str(resource.getName())
+        .u32(static_cast<uint32_t>(specs.size()));
+    for (const auto& spec : specs) {
+        out.str(spec.first).str(spec.second);
+    }
+    out.f64(resource.getPricePerHour()).u8(static_cast<uint8_t>(resource.getStatus()));
+    logChange(ChangeType::RESOURCE_PUT, out.data());
+}
+
+// rentalId, userId, resourceId, startTime u64, endTime u64, requestTime u64, status u8, totalCost
+void System::logRental(const Rental& rental) {
+    if (!savepoints.empty()) {
+        pendingChanges.push_back(PendingChange{ChangeType::RENTAL_PUT, static_cast<size_t>(&rental - rentals.data())});
+        return;
+    }
+    if (snapshots) snapshots->put(rental);
+    if (!changeLog) return;
+    WireWriter out;
+    out.str(rental.getRentalId()).str(rental.getUserId()).str(rental.getResourceId())
+        .u64(toTicks(rental.getStartTime())).u64(toTicks(rental.getEndTime())).u64(toTicks(rental.getRequestTime()))
+        .u8(static_cast<uint8_t>(rental.getStatus())).f64(rental.getTotalCost());
+    logChange(ChangeType::RENTAL_PUT, out.data());
+}
+
+// billId, rentalId, userId, amount, billDate u64, paid u8
+void System::logBill(const Bill& bill) {
+    if (!savepoints.empty()) {
+        pendingChanges.push_back(PendingChange{ChangeType::BILL_PUT, static_cast<size_t>(&bill - bills.data())});
+        return;
+    }
+    if (snapshots) snapshots->put(bill);
+    if (!changeLog) return;
+    WireWriter out;
+    out.str(bill.getBillId()).str(bill.getRentalId()).str(bill.getUserId()).f64(bill.getAmount())
+        .u64(toTicks(bill.getBillDate())).u8(bill.getIsPaid() ? 1 : 0);
+    logChange(ChangeType::BILL_PUT, out.data());
+}
+
+bool System::applyChange(const ChangeRecord& record, std::string& error) {
+    ApiTimer timer(ApiMethod::APPLY_CHANGE);
+    TRACE_SCOPE("System::applyChange");
+    WireReader in(record.body.data(), record.body.size());
+    bool valid = false;
+    switch (record.type) {
+        case ChangeType::HEARTBEAT:
+            valid = in.atEnd();
+            break;
+        case ChangeType::USER_PUT: {
+            std::string userId = in.str(), username = in.str();
+            PasswordCredential credential;
+            credential.salt = in.str();
+            credential.hash = in.str();
+            credential.iterations = in.u32();
+            uint8_t role = in.u8(), status = in.u8();
+            double balance = in.f64();
+            std::string name = in.str();
+            if (!in.ok() || !in.atEnd() || role > static_cast<uint8_t>(UserRole::ADMIN) ||
+                status > static_cast<uint8_t>(UserStatus::SUSPENDED)) break;
+            User* user = findUserById(userId);
+            if (!user) {
+                user = insertUser(User(userId, username, credential, static_cast<UserRole>(role), name));
+            } else {
+                user->setPasswordCredential(credential);
+                user->setRole(static_cast<UserRole>(role));
+                user->setName(name);
+            }
+            user->setStatus(static_cast<UserStatus>(status));
+            user->setBalance(balance);
+            if (snapshots) snapshots->put(*user);
+            valid = true;
+            break;
+        }
+        case ChangeType::RESOURCE_PUT: {
+            std::string resourceId = in.str();
+            uint8_t type = in.u8();
+            std::string name = in.str();
+            std::map<std::string, std::string> specs;
+            uint32_t specCount = in.u32();
+            for (uint32_t i = 0; i < specCount && in.ok(); ++i) {
+                std::string key = in.str();
+                specs[key] = in.str();
+            }
+            double price = in.f64();
+            uint8_t status = in.u8();
+            if (!in.ok() || !in.atEnd() || type > static_cast<uint8_t>(ResourceType::STORAGE) ||
+                status > static_cast<uint8_t>(ResourceStatus::IN_USE)) break;
+            Resource* resource = findResourceById(resourceId);
+            if (!resource) {
+                resources.emplace_back(resourceId, static_cast<ResourceType>(type), name, specs, price);
+                resources.back().setCatalogSequence(++resourcesAppended);
+                resourceIndexById[resourceId] = resources.size() - 1;
+                resource = &resources.back();
+            } else {
+                resource->setName(name);
+                resource->setSpecs(specs);
+                resource->setPricePerHour(price);
+            }
+            resource->setStatus(static_cast<ResourceStatus>(status));
+            if (snapshots) snapshots->put(*resource);
+            valid = true;
+            break;
+        }
+        case ChangeType::RESOURCE_DELETED: {
+            std::string resourceId = in.str();
+            if (!in.ok() || !in.atEnd()) break;
+            Resource* resource = findResourceById(resourceId);
+            if (resource) {
+                tombstoneResource(*resource);
+                compactResources();
+            }
+            if (snapshots) snapshots->removeResource(resourceId);
+            valid = true;
+            break;
+        }
+        case ChangeType::RENTAL_PUT: {
+            std::string rentalId = in.str(), userId = in.str(), resourceId = in.str();
+            uint64_t start = in.u64(), end = in.u64(), requested = in.u64();
+            uint8_t status = in.u8();
+            double cost = in.f64();
+            if (!in.ok() || !in.atEnd() || status > static_cast<uint8_t>(RentalStatus::OVERDUE)) break;
+            Rental* rental = findRentalById(rentalId);
+            if (!rental) {
+                rentals.emplace_back(rentalId, userId, resourceId, fromTicks(start), fromTicks(end));
+                rentalIndexById[rentalId] = rentals.size() - 1;
+                rentalsByUser[userId].push_back(rentals.size() - 1);
+                rental = &rentals.back();
+                rental->setRequestTime(fromTicks(requested));
+            } else {
+                rental->setStartTime(fromTicks(start));
+                rental->setEndTime(fromTicks(end));
+            }
+            rental->setStatus(static_cast<RentalStatus>(status));
+            rental->setTotalCost(cost);
+            if (snapshots) snapshots->put(*rental);
+            valid = true;
+            break;
+        }
+        case ChangeType::BILL_PUT: {
+            std::string billId = in.str(), rentalId = in.str(), userId = in.str();
+            double amount = in.f64();
+            uint64_t date = in.u64();
+            uint8_t paid = in.u8();
+            if (!in.ok() || !in.atEnd()) break;
+            bills.emplace_back(billId, rentalId, userId, amount, fromTicks(date), paid != 0);
+            bills.back().setLedgerSequence(++billsAppended);
+            billsByUser[userId].push_back(bills.size() - 1);
+            if (snapshots) snapshots->put(bills.back());
+            valid = true;
+            break;
+        }
+        case ChangeType::BILLS_ARCHIVED: {
+            uint64_t cutoff = in.u64();
+            if (!in.ok() || !in.atEnd()) break;
+            archiveBills(fromTicks(cutoff));
+            valid = true;
+            break;
+        }
+        default:
+            error = "Unknown change type " + std::to_string(static_cast<int>(record.type)) + " in record " +
+                    std::to_string(record.sequence);
+            return false;
+    }
+    if (!valid) {
+        error = "Malformed change record " + std::to_string(record.sequence);
+    }
+    return valid;
+}
+
+// Cursor helpers for paginated listings.
+// A cursor is the order letter followed by the position of the next item,
+// so it stays valid while new items are appended.
+static std::string encodeCursor(PageOrder order, size_t position) {
+    return (order == PageOrder::OLDEST_FIRST ? "a" : "d") + std::to_string(position);
+}
+
+static bool decodeCursor(const std::string& cursor, PageOrder order, size_t& position) {
+    if (cursor.size() < 2 || cursor[0] != (order == PageOrder::OLDEST_FIRST ? 'a' : 'd')) {
+        return false;
+    }
+    size_t value = 0;
+    for (size_t i = 1; i < cursor.size(); ++i) {
+        if (cursor[i] < '0' || cursor[i] > '9') {
+            return false;
+        }
+        size_t digit = static_cast<size_t>(cursor[i] - '0');
+        if (value > (SIZE_MAX - digit) / 10) {
+            return false; // Longer than any position: not a cursor this System handed out
+        }
+        value = value * 10 + digit;
+    }
+    position = value;
+    return true;
+}
+
+// Builds one page over a sequence of `total` items, where itemAt(i) returns the
+// i-th item, or nullptr for a deleted one that is skipped
+template <typename T, typename ItemAt>
+static Page<T> buildPage(size_t total, const PageRequest& request, ItemAt itemAt) {
+    Page<T> page;
+    if (total == 0 || request.pageSize == 0) {
+        return page;
+    }
+
+    size_t position;
+    if (request.cursor.empty()) {
+        position = (request.order == PageOrder::OLDEST_FIRST) ? 0 : total - 1;
+    } else if (!decodeCursor(request.cursor, request.order, position) || position >= total) {
+        return page; // Invalid or exhausted cursor
+    }
+
+    page.items.reserve(std::min(request.pageSize, total));
+    if (request.order == PageOrder::OLDEST_FIRST) {
+        while (position < total && page.items.size() < request.pageSize) {
+            if (const T* item = itemAt(position++)) page.items.push_back(item);
+        }
+        if (position < total) {
+            page.nextCursor = encodeCursor(request.order, position);
+        }
+    } else {
+        while (page.items.size() < request.pageSize) {
+            if (const T* item = itemAt(position)) page.items.push_back(item);
+            if (position == 0) {
+                return page; // Reached the oldest item
+            }
+            --position;
+        }
+        page.nextCursor = encodeCursor(request.order, position);
+    }
+    return page;
+}
+
+// Pages over items that can be removed from the middle (compacted resources,
+// archived bills). Their cursors hold the sequence number of the next item,
+// which only increases along the items, and are mapped to its position, or to
+// where it would be if it has been removed since, by binary search.
+template <typename T, typename ItemAt, typename SequenceAt>
+static Page<T> buildSequencedPage(size_t total, const PageRequest& request, ItemAt itemAt, SequenceAt sequenceAt) {
+    PageRequest byPosition(request);
+    if (!request.cursor.empty()) {
+        size_t sequence;
+        if (!decodeCursor(request.cursor, request.order, sequence)) return Page<T>();
+        size_t low = 0, high = total; // First position whose sequence is not below the cursor's
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (sequenceAt(middle) < sequence) low = middle + 1;
+            else high = middle;
+        }
+        if (request.order == PageOrder::NEWEST_FIRST && (low == total || sequenceAt(low) != sequence)) {
+            if (low == 0) return Page<T>(); // Everything older is gone
+            --low;
+        }
+        byPosition.cursor = encodeCursor(request.order, low);
+    }
+    Page<T> page = buildPage<T>(total, byPosition, itemAt);
+    size_t position;
+    if (decodeCursor(page.nextCursor, request.order, position)) {
+        page.nextCursor = encodeCursor(request.order, sequenceAt(position));
+    }
+    return page;
+}
+
 // User management functions
 bool System::registerUser(const std::string& username, const std::string& password, UserRole role, const std::string& realName) {
+    ApiTimer timer(ApiMethod::REGISTER_USER);
     if (findUser(username)) {
-        std::cout << "Error: Username '" << username << "' already exists." << std::endl;
-        return false; // Username already exists
+        console() << "Error: Username '" << username << "' already exists." << std::endl;
+        return fail(ErrorCode::ALREADY_EXISTS); // Username already exists
     }
 
-    // Generate a unique ID for the user
-    std::string userId = generateUniqueId("user_", users.size());
-
-    // Create and add the new user
-    users.emplace_back(userId, username, password, role, realName);
-    std::cout << "User '" << username << "' registered successfully with ID: " << userId << std::endl;
+    // Create and add the new user (a unique ID is generated for it)
+    User* newUser = appendUser(username, password, role, realName);
+    count(MetricCounter::USER_REGISTERED);
+    auditChange(AuditOp::USER_REGISTERED, newUser->getUserId());
+    console() << "User '" << username << "' registered successfully with ID: " << newUser->getUserId() << std::endl;
     return true;
 }
 
 // Admin View All Rentals
 void System::adminDisplayAllRentals() const {
+    ApiTimer timer(ApiMethod::ADMIN_DISPLAY_ALL_RENTALS);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
         std::cout << "Error: Admin privileges required to display all rental records." << std::endl;
         return;
     }
@@ -73,37 +826,57 @@ void System::adminDisplayAllRentals() const {
 
 // Billing
 bool System::processRentalCompletion(const std::string& rentalId) {
-    Rental* rental = findRental(rentalId);
+    ApiTimer timer(ApiMethod::PROCESS_RENTAL_COMPLETION);
+    TRACE_SCOPE("System::processRentalCompletion");
+    Rental* rental = findRentalById(rentalId);
     if (!rental) {
-        std::cout << "Error: Rental with ID '" << rentalId << "' not found for processing completion." << std::endl;
-        return false;
+        console() << "Error: Rental with ID '" << rentalId << "' not found for processing completion." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
-    if (rental->getStatus() != RentalStatus::APPROVED && rental->getStatus() != RentalStatus::ACTIVE) {
-        std::cout << "Error: Rental '" << rentalId << "' is not in APPROVED or ACTIVE state. Current status: "
+    if (!isRunning(rental->getStatus())) {
+        console() << "Error: Rental '" << rentalId << "' is not in APPROVED, ACTIVE or OVERDUE state. Current status: "
                   << rental->rentalStatusToString() << ". Cannot process completion." << std::endl;
-        return false;
+        return fail(ErrorCode::INVALID_STATE);
     }
 
     // For simplicity, we assume endTime has been reached. A real system would check this.
 
-    Resource* resource = findResource(rental->getResourceId());
+    Resource* resource = findResourceById(rental->getResourceId());
     if (!resource) {
-        std::cout << "Error: Associated resource with ID '" << rental->getResourceId() 
+        console() << "Error: Associated resource with ID '" << rental->getResourceId() 
                   << "' for rental '" << rentalId << "' not found. Cannot process completion." << std::endl;
         // Potentially mark rental as problematic, e.g., needs investigation
-        return false;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     User* user = findUserById(rental->getUserId()); // Corrected: Use findUserById
     if (!user) {
-        std::cout << "Error: Associated user with ID '" << rental->getUserId() 
+        console() << "Error: Associated user with ID '" << rental->getUserId() 
                   << "' for rental '" << rentalId << "' not found. Cannot process completion." << std::endl;
-        return false;
+        return fail(ErrorCode::NOT_FOUND);
+    }
+
+    const Bill& newBill = completeRental(*rental, *resource, *user, std::chrono::system_clock::now());
+    const std::string& billId = newBill.getBillId();
+    double cost = newBill.getAmount();
+
+    console() << "Rental '" << rentalId << "' completed. Bill '" << billId << "' generated for $" << cost 
+              << ". User '" << user->getUsername() << "' balance updated to $" << user->getBalance() << "." << std::endl;
+
+    if (user->getBalance() < 0) {
+        console() << "Warning: User '" << user->getUsername() << "' balance is negative: $" 
+                  << std::fixed << std::setprecision(2) << user->getBalance() << "." << std::endl;
     }
+    return true;
+}
 
+// Bills the booked hours not billed yet, completes the rental and frees its
+// resource. `now` is when it ended, for the overdue metrics.
+const Bill& System::completeRental(Rental& rental, Resource& resource, User& user,
+                                   std::chrono::system_clock::time_point now) {
     // Calculate duration and cost
-    auto duration = std::chrono::duration_cast<std::chrono::hours>(rental->getEndTime() - rental->getStartTime());
+    auto duration = std::chrono::duration_cast<std::chrono::hours>(rental.getEndTime() - rental.getStartTime());
     long long durationHours = duration.count();
     if (durationHours == 0) { // Minimum 1 hour rule
         // This rule applies if the duration is less than 1 full hour.
@@ -124,34 +897,58 @@ bool System::processRentalCompletion(const std::string& rentalId) {
         durationHours = 1; 
     }
     
-    double cost = durationHours * resource->getPricePerHour();
-
-    rental->setTotalCost(cost);
-    rental->setStatus(RentalStatus::COMPLETED);
-    resource->setStatus(ResourceStatus::IDLE); // Resource becomes available
-
-    std::string billId = generateUniqueId("bill_", bills.size());
-    Bill newBill(billId, rentalId, user->getUserId(), cost);
-    
-    // Deduct from user balance and mark bill as paid
-    double currentBalance = user->getBalance();
-    user->setBalance(currentBalance - cost);
-    newBill.setPaid(true); // Direct deduction model
-
-    bills.push_back(newBill);
-
-    std::cout << "Rental '" << rentalId << "' completed. Bill '" << billId << "' generated for $" << cost 
-              << ". User '" << user->getUsername() << "' balance updated to $" << user->getBalance() << "." << std::endl;
+    // A rental paused by a suspension has already been billed for the time it ran
+    double cost = durationHours * resource.getPricePerHour() - rental.getTotalCost();
+
+    bool overdue = rental.getStatus() == RentalStatus::OVERDUE;
+
+    // Rental, resource, bill and balance change together: if anything below
+    // throws, the transaction's destructor undoes the steps already taken
+    Transaction transaction(*this);
+    Bill& newBill = chargeRental(rental, user, cost);
+    setRentalStatus(rental, RentalStatus::COMPLETED);
+    setResourceStatus(resource, ResourceStatus::IDLE); // Resource becomes available
+    transaction.commit();
+    logRental(rental);
+    logResource(resource);
+    logUser(user);
+    logBill(newBill);
+    count(MetricCounter::RENTAL_COMPLETED);
+    auditChange(AuditOp::RENTAL_COMPLETED, rental.getRentalId(), cost);
+    if (overdue) endOverdue(rental, now);
+    return newBill;
+}
 
-    if (user->getBalance() < 0) {
-        std::cout << "Warning: User '" << user->getUsername() << "' balance is negative: $" 
-                  << std::fixed << std::setprecision(2) << user->getBalance() << "." << std::endl;
-        // Future: Trigger notification
-    }
-    return true;
+// Bills `amount` of a rental to its user and deducts it from the balance
+// (direct deduction model). Part of the caller's transaction.
+Bill& System::chargeRental(Rental& rental, User& user, double amount) {
+    // Balance first: in between, the watch sees the user no better off than before
+    setUserBalance(user, user.getBalance() - amount);
+    setRentalCost(rental, rental.getTotalCost() + amount);
+
+    // Archived bills still count, otherwise IDs would be reused after archiving
+    std::string billId = nextId("bill_", bills.size() + billArchive.size());
+    recordUndo(UndoOp::BILLS_APPENDED, bills.size());
+    bills.emplace_back(billId, rental.getRentalId(), user.getUserId(), amount);
+    Bill& bill = bills.back();
+    bill.setLedgerSequence(++billsAppended);
+    bill.setPaid(true);
+
+    billsByUser[user.getUserId()].push_back(bills.size() - 1);
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::BILL_CREATED, billId);
+        event.userId = user.getUserId();
+        event.relatedId = rental.getRentalId();
+        event.newAmount = amount;
+        emit(event);
+    }
+    count(MetricCounter::BILL_CREATED);
+    count(MetricCounter::BILLED_CENTS, static_cast<uint64_t>(std::llround(amount * 100)));
+    return bill;
 }
 
 void System::displayUserBills(const std::string& userId) const {
+    ApiTimer timer(ApiMethod::DISPLAY_USER_BILLS);
     // Permission checks:
     // 1. A user must be logged in.
     // 2. The logged-in user must either be the user whose bills are requested OR an admin.
@@ -167,9 +964,16 @@ void System::displayUserBills(const std::string& userId) const {
     
     std::cout << "\n--- Bills for User ID: " << userId << " ---" << std::endl;
     bool found = false;
-    for (const auto& bill : bills) {
-        if (bill.getUserId() == userId) {
-            bill.displayBillInfo();
+    std::vector<Bill> archivedBills = billArchive.findByUser(userId, std::chrono::system_clock::time_point::min(),
+                                                             std::chrono::system_clock::time_point::max());
+    for (const auto& bill : archivedBills) {
+        bill.displayBillInfo();
+        found = true;
+    }
+    auto indexIt = billsByUser.find(userId);
+    if (indexIt != billsByUser.end()) {
+        for (size_t position : indexIt->second) {
+            bills[position].displayBillInfo();
             found = true;
         }
     }
@@ -180,15 +984,21 @@ void System::displayUserBills(const std::string& userId) const {
 }
 
 void System::adminDisplayAllBills() const {
+    ApiTimer timer(ApiMethod::ADMIN_DISPLAY_ALL_BILLS);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
         std::cout << "Error: Admin privileges required to display all bills." << std::endl;
         return;
     }
 
     std::cout << "\n--- All Bills (Admin View) ---" << std::endl;
-    if (bills.empty()) {
+    if (bills.empty() && billArchive.size() == 0) {
         std::cout << "No bills found in the system." << std::endl;
     } else {
+        std::vector<Bill> archivedBills = billArchive.getAll();
+        for (const auto& bill : archivedBills) {
+            bill.displayBillInfo();
+        }
         for (const auto& bill : bills) {
             bill.displayBillInfo();
         }
@@ -196,9 +1006,100 @@ void System::adminDisplayAllBills() const {
     std::cout << "------------------------------" << std::endl;
 }
 
+// Bill archive
+size_t System::adminArchiveBillsBefore(std::chrono::system_clock::time_point cutoff) {
+    ApiTimer timer(ApiMethod::ADMIN_ARCHIVE_BILLS_BEFORE);
+    TRACE_SCOPE("System::adminArchiveBillsBefore");
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to archive bills." << std::endl;
+        lastErrorCode = ErrorCode::PERMISSION_DENIED;
+        return 0;
+    }
+    if (inTransaction()) { // Sealed segments cannot be undone
+        console() << "Error: Bills cannot be archived inside a transaction." << std::endl;
+        lastErrorCode = ErrorCode::INVALID_STATE;
+        return 0;
+    }
+
+    size_t archived = archiveBills(cutoff);
+    if (archived == 0) {
+        console() << "No bills older than the cutoff to archive." << std::endl;
+        return 0;
+    }
+    Metrics::increment(MetricCounter::BILL_ARCHIVED, archived);
+    audit(AuditOp::BILLS_ARCHIVED, "", 0.0, static_cast<uint32_t>(archived));
+    WireWriter change;
+    logChange(ChangeType::BILLS_ARCHIVED, change.u64(toTicks(cutoff)).data());
+
+    console() << archived << " bill(s) archived by admin '" << currentUser->getUsername() << "'. Archive now holds "
+              << billArchive.size() << " bill(s) in " << billArchive.segmentCount() << " segment(s), "
+              << billArchive.memoryBytes() << " bytes." << std::endl;
+    return archived;
+}
+
+// Bills that are old enough and have archivable IDs move to the archive;
+// everything else stays in the hot vector in its original order.
+size_t System::archiveBills(std::chrono::system_clock::time_point cutoff) {
+    std::vector<const Bill*> toArchive;
+    for (const auto& bill : bills) {
+        if (bill.getBillDate() < cutoff && BillArchive::canArchive(bill)) {
+            toArchive.push_back(&bill);
+        }
+    }
+    if (toArchive.empty()) {
+        return 0;
+    }
+
+    size_t archived = billArchive.archive(toArchive);
+    if (snapshots) {
+        for (const Bill* bill : toArchive) snapshots->removeBill(bill->getBillId());
+    }
+    auto it = std::remove_if(bills.begin(), bills.end(), [&cutoff](const Bill& b) {
+        return b.getBillDate() < cutoff && BillArchive::canArchive(b);
+    });
+    bills.erase(it, bills.end());
+    bills.shrink_to_fit(); // Give the memory of the archived bills back
+    rebuildBillIndex();    // Positions have shifted
+    return archived;
+}
+
+std::vector<Bill> System::findUserBills(const std::string& userId,
+                                        std::chrono::system_clock::time_point from,
+                                        std::chrono::system_clock::time_point to) const {
+    ApiTimer timer(ApiMethod::FIND_USER_BILLS);
+    TRACE_SCOPE("System::findUserBills");
+    std::vector<Bill> result = billArchive.findByUser(userId, from, to);
+    auto indexIt = billsByUser.find(userId);
+    if (indexIt != billsByUser.end()) {
+        for (size_t position : indexIt->second) {
+            const Bill& bill = bills[position];
+            if (bill.getBillDate() >= from && bill.getBillDate() <= to) {
+                result.push_back(bill);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<Bill> System::findBillsByDate(std::chrono::system_clock::time_point from,
+                                          std::chrono::system_clock::time_point to) const {
+    ApiTimer timer(ApiMethod::FIND_BILLS_BY_DATE);
+    TRACE_SCOPE("System::findBillsByDate");
+    std::vector<Bill> result = billArchive.findByDate(from, to);
+    for (const auto& bill : bills) {
+        if (bill.getBillDate() >= from && bill.getBillDate() <= to) {
+            result.push_back(bill);
+        }
+    }
+    return result;
+}
+
 // Admin Rental Review
 void System::adminDisplayPendingRentals() const {
+    ApiTimer timer(ApiMethod::ADMIN_DISPLAY_PENDING_RENTALS);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
         std::cout << "Error: Admin privileges required to display pending rentals." << std::endl;
         return;
     }
@@ -218,114 +1119,244 @@ void System::adminDisplayPendingRentals() const {
 }
 
 bool System::adminApproveRental(const std::string& rentalId) {
+    ApiTimer timer(ApiMethod::ADMIN_APPROVE_RENTAL);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to approve rentals." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to approve rentals." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
-    Rental* rentalToApprove = findRental(rentalId);
+    Rental* rentalToApprove = findRentalById(rentalId);
     if (!rentalToApprove) {
-        std::cout << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     if (rentalToApprove->getStatus() != RentalStatus::PENDING_APPROVAL) {
-        std::cout << "Error: Rental '" << rentalId << "' is not pending approval. Current status: " 
+        console() << "Error: Rental '" << rentalId << "' is not pending approval. Current status: " 
                   << rentalToApprove->rentalStatusToString() << "." << std::endl;
-        return false;
+        return fail(ErrorCode::INVALID_STATE);
     }
 
-    Resource* resourceToUse = findResource(rentalToApprove->getResourceId());
+    Resource* resourceToUse = findResourceById(rentalToApprove->getResourceId());
     if (!resourceToUse) {
-        std::cout << "Error: Associated resource with ID '" << rentalToApprove->getResourceId() 
+        console() << "Error: Associated resource with ID '" << rentalToApprove->getResourceId() 
                   << "' for rental '" << rentalId << "' not found. Cannot approve." << std::endl;
         // Optionally, set rental to REJECTED here if resource is permanently gone
         // rentalToApprove->setStatus(RentalStatus::REJECTED);
-        return false;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     if (resourceToUse->getStatus() != ResourceStatus::IDLE) {
         std::string statusStr = (resourceToUse->getStatus() == ResourceStatus::IDLE) ? "Idle" : "In Use";
-        std::cout << "Error: Resource '" << resourceToUse->getName() << "' (ID: " << resourceToUse->getResourceId() 
+        console() << "Error: Resource '" << resourceToUse->getName() << "' (ID: " << resourceToUse->getResourceId() 
                   << ") is currently not IDLE. Status: " << statusStr << ". Cannot approve rental '" << rentalId << "'." << std::endl;
-        return false;
+        return fail(ErrorCode::RESOURCE_BUSY);
     }
 
-    rentalToApprove->setStatus(RentalStatus::APPROVED); 
+    // The booked hours run from now, when the user gets the resource: a request
+    // waiting for approval, or a paused rental resumed, does not run over early
+    restartRental(*rentalToApprove, std::chrono::system_clock::now());
+    setRentalStatus(*rentalToApprove, RentalStatus::APPROVED);
     // Or RentalStatus::ACTIVE if startTime is now/past. For simplicity, using APPROVED.
     // Actual activation could be a separate timed process or when user explicitly starts it.
-    resourceToUse->setStatus(ResourceStatus::IN_USE);
+    setResourceStatus(*resourceToUse, ResourceStatus::IN_USE);
+    logRental(*rentalToApprove);
+    logResource(*resourceToUse);
+    count(MetricCounter::RENTAL_APPROVED);
+    auditChange(AuditOp::RENTAL_APPROVED, rentalId);
 
-    std::cout << "Rental '" << rentalId << "' approved by admin '" << currentUser->getUsername() 
+    console() << "Rental '" << rentalId << "' approved by admin '" << currentUser->getUsername() 
               << "'. Resource '" << resourceToUse->getName() << "' is now IN_USE." << std::endl;
     // Placeholder for notification to user
     return true;
 }
 
 bool System::adminRejectRental(const std::string& rentalId, const std::string& reason) {
+    ApiTimer timer(ApiMethod::ADMIN_REJECT_RENTAL);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to reject rentals." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to reject rentals." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
-    Rental* rentalToReject = findRental(rentalId);
+    Rental* rentalToReject = findRentalById(rentalId);
     if (!rentalToReject) {
-        std::cout << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     if (rentalToReject->getStatus() != RentalStatus::PENDING_APPROVAL) {
-        std::cout << "Error: Rental '" << rentalId << "' is not pending approval. Current status: " 
+        console() << "Error: Rental '" << rentalId << "' is not pending approval. Current status: " 
                   << rentalToReject->rentalStatusToString() << "." << std::endl;
-        return false;
+        return fail(ErrorCode::INVALID_STATE);
     }
 
-    rentalToReject->setStatus(RentalStatus::REJECTED);
+    setRentalStatus(*rentalToReject, RentalStatus::REJECTED);
+    logRental(*rentalToReject);
+    count(MetricCounter::RENTAL_REJECTED);
+    auditChange(AuditOp::RENTAL_REJECTED, rentalId);
     // If Rental class had a rejectionReason field, set it here:
     // rentalToReject->setRejectionReason(reason); 
 
-    std::cout << "Rental '" << rentalId << "' rejected by admin '" << currentUser->getUsername() 
+    console() << "Rental '" << rentalId << "' rejected by admin '" << currentUser->getUsername() 
               << "'. Reason: " << reason << "." << std::endl;
     // Placeholder for notification to user
     return true;
 }
 
 User* System::loginUser(const std::string& username, const std::string& password) {
+    ApiTimer timer(ApiMethod::LOGIN_USER);
     User* userToLogin = findUser(username);
     if (userToLogin) {
         if (userToLogin->checkPassword(password)) {
             if (userToLogin->getStatus() == UserStatus::ACTIVE) {
+                if (userToLogin->passwordNeedsRehash()) {
+                    userToLogin->setPassword(password); // Move the stored hash to the current cost
+                    logUser(*userToLogin);
+                }
                 currentUser = userToLogin;
-                std::cout << "User '" << username << "' logged in successfully." << std::endl;
+                Metrics::increment(MetricCounter::LOGIN_SUCCEEDED);
+                audit(AuditOp::LOGIN_SUCCEEDED, currentUser->getUserId());
+                console() << "User '" << username << "' logged in successfully." << std::endl;
+                showImportantNotifications(*currentUser);
                 return currentUser;
             } else {
-                std::cout << "Login failed: User '" << username << "' account is suspended." << std::endl;
+                console() << "Login failed: User '" << username << "' account is suspended." << std::endl;
+                Metrics::increment(MetricCounter::LOGIN_FAILED);
+                audit(AuditOp::LOGIN_FAILED, username);
+                lastErrorCode = ErrorCode::ACCOUNT_INACTIVE;
                 return nullptr;
             }
         } else {
-            std::cout << "Login failed: Incorrect password for user '" << username << "'." << std::endl;
+            console() << "Login failed: Incorrect password for user '" << username << "'." << std::endl;
+            lastErrorCode = ErrorCode::AUTHENTICATION_FAILED;
         }
     } else {
-        std::cout << "Login failed: User '" << username << "' not found." << std::endl;
+        console() << "Login failed: User '" << username << "' not found." << std::endl;
+        lastErrorCode = ErrorCode::NOT_FOUND;
     }
+    Metrics::increment(MetricCounter::LOGIN_FAILED);
+    audit(AuditOp::LOGIN_FAILED, username);
     return nullptr; // Login failed
 }
 
+std::future<LoginResult> System::loginUserAsync(const std::string& username, const std::string& password) {
+    ApiTimer timer(ApiMethod::LOGIN_USER_ASYNC);
+    std::shared_ptr<std::promise<LoginResult>> promise = std::make_shared<std::promise<LoginResult>>();
+    std::future<LoginResult> result = promise->get_future();
+    submitLogin(username, password, [promise](const LoginResult& outcome) { promise->set_value(outcome); });
+    return result;
+}
+
+void System::loginUserAsync(const std::string& username, const std::string& password,
+                            std::function<void(const LoginResult&)> done) {
+    ApiTimer timer(ApiMethod::LOGIN_USER_ASYNC);
+    submitLogin(username, password, std::move(done));
+}
+
+void System::submitLogin(const std::string& username, const std::string& password,
+                         std::function<void(const LoginResult&)> done) {
+    if (!loginPool) {
+        size_t workers = loginWorkerCount;
+        if (workers == 0) {
+            workers = std::max(2u, std::thread::hardware_concurrency() / 2);
+        }
+        loginPool.reset(new ThreadPool(workers));
+    }
+
+    // Copy what the worker needs; it must not touch users without the lock
+    User* user = findUser(username);
+    std::string userId = user ? user->getUserId() : std::string();
+    PasswordCredential credential;
+    if (user) {
+        credential = user->getPasswordCredential();
+    } else {
+        // Unknown users cost as much as wrong passwords, so timing does not reveal which usernames exist
+        credential.salt = std::string(PasswordHasher::SALT_BYTES, '\0');
+        credential.iterations = PasswordHasher::defaultIterations();
+    }
+
+    loginPool->submit([this, username, userId, credential, password, done]() {
+        bool passwordOk = PasswordHasher::verify(credential, password) && !userId.empty();
+        PasswordCredential upgraded;
+        if (passwordOk && credential.iterations != PasswordHasher::defaultIterations()) {
+            upgraded = PasswordHasher::create(password);
+        }
+        LoginResult result;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            result = finishAsyncLogin(username, userId, credential, passwordOk, upgraded);
+        }
+        done(result);
+    });
+}
+
+// Called with stateMutex held, after the expensive hashing
+LoginResult System::finishAsyncLogin(const std::string& username, const std::string& userId,
+                                     const PasswordCredential& checked, bool passwordOk,
+                                     const PasswordCredential& upgraded) {
+    LoginResult result;
+    User* user = passwordOk ? findUserById(userId) : nullptr;
+    if (!user || user->getPasswordCredential().hash != checked.hash) {
+        result.error = ErrorCode::AUTHENTICATION_FAILED;
+        result.message = passwordOk ? "Password changed during login" : "Invalid username or password";
+    } else if (user->getStatus() != UserStatus::ACTIVE) {
+        result.error = ErrorCode::ACCOUNT_INACTIVE;
+        result.message = "Account is suspended";
+    } else {
+        if (upgraded.iterations != 0) {
+            user->setPasswordCredential(upgraded);
+            logUser(*user);
+        }
+        result.success = true;
+        result.userId = userId;
+    }
+
+    if (result.success) {
+        Metrics::increment(MetricCounter::LOGIN_SUCCEEDED);
+        auditAs(userId, AuditOp::LOGIN_SUCCEEDED, userId);
+    } else {
+        Metrics::increment(MetricCounter::LOGIN_FAILED);
+        auditAs("", AuditOp::LOGIN_FAILED, username); // The name tried, as loginUser records it
+    }
+    return result;
+}
+
+void System::setLoginWorkers(size_t count) {
+    loginWorkerCount = count;
+}
+
 void System::logoutUser() {
+    ApiTimer timer(ApiMethod::LOGOUT_USER);
     if (currentUser) {
-        std::cout << "User '" << currentUser->getUsername() << "' logged out." << std::endl;
+        console() << "User '" << currentUser->getUsername() << "' logged out." << std::endl;
+        audit(AuditOp::LOGOUT, currentUser->getUserId());
         currentUser = nullptr;
     } else {
-        std::cout << "No user currently logged in." << std::endl;
+        console() << "No user currently logged in." << std::endl;
     }
 }
 
 User* System::getCurrentUser() const {
+    ApiTimer timer(ApiMethod::GET_CURRENT_USER);
     return currentUser;
 }
 
+bool System::switchToUser(const std::string& userId) {
+    ApiTimer timer(ApiMethod::SWITCH_TO_USER);
+    User* user = userId.empty() ? nullptr : findUserById(userId);
+    if (!user || user->getStatus() != UserStatus::ACTIVE) {
+        currentUser = nullptr; // Never leave the previous session's user in place
+        return userId.empty(); // Suspended users lose their sessions
+    }
+    currentUser = user;
+    return true;
+}
+
 // (Optional) Method to display all users - for debugging or admin purposes
 void System::displayAllUsers() const {
+    ApiTimer timer(ApiMethod::DISPLAY_ALL_USERS);
     if (users.empty()) {
         std::cout << "No users registered in the system." << std::endl;
         return;
@@ -339,52 +1370,76 @@ void System::displayAllUsers() const {
 
 // Personal information management for the current user
 bool System::updateCurrentUserName(const std::string& newName) {
+    ApiTimer timer(ApiMethod::UPDATE_CURRENT_USER_NAME);
     if (currentUser) {
         currentUser->setName(newName);
+        logUser(*currentUser);
+        audit(AuditOp::NAME_CHANGED, currentUser->getUserId());
         return true;
     }
-    std::cout << "Error: No user is currently logged in. Cannot update name." << std::endl;
-    return false;
+    console() << "Error: No user is currently logged in. Cannot update name." << std::endl;
+    return fail(ErrorCode::NOT_LOGGED_IN);
 }
 
 bool System::updateCurrentUserPassword(const std::string& newPassword) {
+    ApiTimer timer(ApiMethod::UPDATE_CURRENT_USER_PASSWORD);
     if (currentUser) {
         currentUser->setPassword(newPassword);
+        logUser(*currentUser);
+        audit(AuditOp::PASSWORD_CHANGED, currentUser->getUserId());
         return true;
     }
-    std::cout << "Error: No user is currently logged in. Cannot update password." << std::endl;
-    return false;
+    console() << "Error: No user is currently logged in. Cannot update password." << std::endl;
+    return fail(ErrorCode::NOT_LOGGED_IN);
 }
 
 // Resource management functions
 bool System::addResource(const Resource& resource) {
+    ApiTimer timer(ApiMethod::ADD_RESOURCE);
     // Check for duplicate resource ID
-    if (findResource(resource.getResourceId())) {
-        std::cout << "Error: Resource with ID '" << resource.getResourceId() << "' already exists." << std::endl;
-        return false;
+    if (findResourceById(resource.getResourceId())) {
+        console() << "Error: Resource with ID '" << resource.getResourceId() << "' already exists." << std::endl;
+        return fail(ErrorCode::ALREADY_EXISTS);
     }
+    recordUndo(UndoOp::RESOURCES_APPENDED, resources.size());
     resources.push_back(resource);
-    std::cout << "Resource '" << resource.getName() << "' added successfully with ID: " << resource.getResourceId() << std::endl;
+    resources.back().setCatalogSequence(++resourcesAppended);
+    resourceIndexById[resource.getResourceId()] = resources.size() - 1;
+    logResource(resources.back());
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::RESOURCE_ADDED, resource.getResourceId());
+        event.newAmount = resource.getPricePerHour();
+        emit(event);
+    }
+    auditChange(AuditOp::RESOURCE_ADDED, resource.getResourceId());
+    console() << "Resource '" << resource.getName() << "' added successfully with ID: " << resource.getResourceId() << std::endl;
     return true;
 }
 
 Resource* System::findResource(const std::string& resourceId) {
-    auto it = std::find_if(resources.begin(), resources.end(),
-                           [&resourceId](const Resource& r) { return r.getResourceId() == resourceId; });
-    if (it != resources.end()) {
-        return &(*it); // Return a pointer to the found resource
+    ApiTimer timer(ApiMethod::FIND_RESOURCE);
+    return findResourceById(resourceId);
+}
+
+// Private helper method to find a resource by ID (not counted in the API metrics)
+Resource* System::findResourceById(const std::string& resourceId) {
+    TRACE_SCOPE("System::findResourceById");
+    auto it = resourceIndexById.find(resourceId);
+    if (it != resourceIndexById.end()) {
+        return &resources[it->second]; // Return a pointer to the found resource
     }
     return nullptr; // Resource not found
 }
 
 void System::displayAllResources() const {
+    ApiTimer timer(ApiMethod::DISPLAY_ALL_RESOURCES);
     if (resources.empty()) {
         std::cout << "No resources available in the system." << std::endl;
         return;
     }
     std::cout << "\n--- All Available Resources ---" << std::endl;
     for (const auto& resource : resources) {
-        resource.displayResourceInfo();
+        if (resource.getStatus() != ResourceStatus::RETIRED) resource.displayResourceInfo();
     }
     std::cout << "-------------------------------" << std::endl;
 }
@@ -398,9 +1453,11 @@ void System::displayAllResources() const {
 // then vector<const Resource*> is better and the method can be const.
 // I'll proceed with vector<Resource*> and non-const method as per the prompt's signature.
 std::vector<Resource*> System::findResourcesByType(ResourceType type) {
+    ApiTimer timer(ApiMethod::FIND_RESOURCES_BY_TYPE);
+    TRACE_SCOPE("System::findResourcesByType");
     std::vector<Resource*> foundResources;
     for (auto& resource : resources) { // Use auto& to allow taking address of non-const
-        if (resource.getType() == type) {
+        if (resource.getType() == type && resource.getStatus() != ResourceStatus::RETIRED) {
             foundResources.push_back(&resource);
         }
     }
@@ -408,72 +1465,405 @@ std::vector<Resource*> System::findResourcesByType(ResourceType type) {
 }
 
 // Rental management functions
+// Quota accounting. Usage counters follow every rental state change, so
+// admission compares a few numbers instead of scanning the user's rentals.
+static uint32_t* usageCounter(QuotaUsage& usage, RentalStatus status) {
+    switch (status) {
+        case RentalStatus::PENDING_APPROVAL: return &usage.pending;
+        case RentalStatus::APPROVED:
+        case RentalStatus::ACTIVE:
+        case RentalStatus::OVERDUE:          return &usage.open;
+        default:                             return nullptr;
+    }
+}
+
+static double rentalHours(const Rental& rental) {
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::hours>(rental.getEndTime() - rental.getStartTime()).count());
+}
+
+const RentalQuota& System::quotaFor(const User& user) const {
+    auto custom = userQuotas.find(user.getUserId());
+    if (custom != userQuotas.end()) return custom->second;
+    return roleQuotas[static_cast<size_t>(user.getRole())];
+}
+
+QuotaUsage* System::admitRental(const User& user, int durationHours) {
+    const RentalQuota& quota = quotaFor(user);
+    QuotaUsage& usage = quotaUsage[user.getUserId()];
+    usage.roll(quota.period, std::chrono::system_clock::now());
+
+    if (quota.requestsPerSecond > 0 &&
+        !usage.requests.take(quota.requestsPerSecond, quota.burst, std::chrono::steady_clock::now())) {
+        Metrics::increment(MetricCounter::RENTALS_RATE_LIMITED);
+        console() << "Error: Too many rental requests from user '" << user.getUsername() << "'. Try again later." << std::endl;
+        lastErrorCode = ErrorCode::RATE_LIMITED;
+        return nullptr;
+    }
+    const char* limit = nullptr;
+    if (quota.maxPending > 0 && usage.pending >= quota.maxPending) {
+        limit = "pending requests";
+    } else if (quota.maxOpenRentals > 0 && usage.pending + usage.open >= quota.maxOpenRentals) {
+        limit = "open rentals";
+    } else if (quota.maxHoursPerPeriod > 0 && usage.periodHours + durationHours > quota.maxHoursPerPeriod) {
+        limit = "rental hours for this period";
+    }
+    if (limit) {
+        Metrics::increment(MetricCounter::RENTALS_OVER_QUOTA);
+        console() << "Error: User '" << user.getUsername() << "' has reached the quota of " << limit << "." << std::endl;
+        lastErrorCode = ErrorCode::QUOTA_EXCEEDED;
+        return nullptr;
+    }
+    return &usage;
+}
+
+static bool isLive(RentalStatus status) {
+    return status == RentalStatus::PENDING_APPROVAL || status == RentalStatus::APPROVED ||
+           status == RentalStatus::ACTIVE || status == RentalStatus::PAUSED || status == RentalStatus::OVERDUE;
+}
+
+// Rentals in the expiry index: running and not found overdue yet
+static bool isExpiring(RentalStatus status) {
+    return status == RentalStatus::APPROVED || status == RentalStatus::ACTIVE;
+}
+
+static void addLive(PooledIndex<LiveRentals>& index, std::vector<size_t>& slots, const std::string& key,
+                    size_t position) {
+    auto live = index.find(key);
+    if (live == index.end()) {
+        live = index.emplace(key, LiveRentals(PoolAllocator<size_t>(index.get_allocator().pool))).first;
+    }
+    if (slots.size() <= position) slots.resize(position + 1);
+    slots[position] = live->second.size();
+    live->second.push_back(position);
+}
+
+// Swap-removes a rental position from a live index (unordered lists), finding
+// it through its slot so heavy accounts do not pay for every rental they hold
+static void removeLive(PooledIndex<LiveRentals>& index, std::vector<size_t>& slots, const std::string& key,
+                       size_t position) {
+    auto live = index.find(key);
+    if (live == index.end() || position >= slots.size()) return;
+    LiveRentals& positions = live->second;
+    size_t slot = slots[position];
+    if (slot < positions.size() && positions[slot] == position) {
+        size_t moved = positions.back();
+        positions[slot] = moved;
+        slots[moved] = slot;
+        positions.pop_back();
+    }
+    if (positions.empty()) index.erase(live);
+}
+
+void System::trackRentalStatus(const Rental& rental, RentalStatus from, RentalStatus to) {
+    if (from == to) return;
+    size_t position = &rental - rentals.data();
+    if (isLive(from) != isLive(to)) {
+        if (isLive(to)) {
+            addLive(liveRentalsByUser, liveSlotByUser, rental.getUserId(), position);
+            addLive(liveRentalsByResource, liveSlotByResource, rental.getResourceId(), position);
+        } else {
+            removeLive(liveRentalsByUser, liveSlotByUser, rental.getUserId(), position);
+            removeLive(liveRentalsByResource, liveSlotByResource, rental.getResourceId(), position);
+        }
+    }
+    if (isExpiring(from) != isExpiring(to)) {
+        if (isExpiring(to)) {
+            rentalsByEndTime.insert(ExpiryKey(rental.getEndTime(), position));
+        } else {
+            rentalsByEndTime.erase(ExpiryKey(rental.getEndTime(), position));
+        }
+    }
+    if (isRunning(from) != isRunning(to)) watchRental(rental, isRunning(to));
+    QuotaUsage& usage = quotaUsage[rental.getUserId()];
+    if (uint32_t* counter = usageCounter(usage, from)) --*counter;
+    if (uint32_t* counter = usageCounter(usage, to)) ++*counter;
+    // Hours of requests that never ran are given back, unless their period is over
+    bool wasWithdrawn = from == RentalStatus::REJECTED || from == RentalStatus::CANCELLED;
+    bool withdrawn = to == RentalStatus::REJECTED || to == RentalStatus::CANCELLED;
+    if (wasWithdrawn != withdrawn && rental.getRequestTime() >= usage.periodStart) {
+        usage.periodHours += withdrawn ? -rentalHours(rental) : rentalHours(rental);
+    }
+}
+
+// A new request counts as a withdrawn one coming back: it takes its hours and its place
+void System::trackNewRental(const Rental& rental) {
+    trackRentalStatus(rental, RentalStatus::CANCELLED, rental.getStatus());
+}
+
+void System::untrackRental(const Rental& rental) {
+    trackRentalStatus(rental, rental.getStatus(), RentalStatus::CANCELLED);
+}
+
+// Low-balance watch. Every change to a running rental or a balance updates the
+// user's projection, so alerts need no scan of users or rentals.
+void System::watchRental(const Rental& rental, bool running) {
+    const Resource* resource = findResourceById(rental.getResourceId());
+    const User* user = findUserById(rental.getUserId());
+    double price = resource ? resource->getPricePerHour() : 0.0;
+    double balance = user ? user->getBalance() : 0.0;
+    if (running) {
+        balanceWatch.addRental(rental.getUserId(), balance, price, rentalHours(rental), rental.getStartTime(),
+                               rental.getTotalCost());
+    } else {
+        balanceWatch.removeRental(rental.getUserId(), balance, price, rentalHours(rental), rental.getStartTime(),
+                                  rental.getTotalCost());
+    }
+    alertLowBalances();
+}
+
+void System::repriceRentals(const Resource& resource, double oldPricePerHour) {
+    auto live = liveRentalsByResource.find(resource.getResourceId());
+    if (live == liveRentalsByResource.end() || resource.getPricePerHour() == oldPricePerHour) return;
+    for (size_t position : live->second) {
+        const Rental& rental = rentals[position];
+        if (!isRunning(rental.getStatus())) continue;
+        balanceWatch.repriceRental(rental.getUserId(), oldPricePerHour, resource.getPricePerHour(),
+                                   rentalHours(rental), rental.getStartTime());
+    }
+    alertLowBalances();
+}
+
+size_t System::alertLowBalances() {
+    if (inTransaction()) return 0; // At the end of the outermost one, so rolled-back changes alert no one
+    auto deadline = std::chrono::system_clock::now() + lowBalanceHorizon;
+    size_t alerted = 0;
+    for (const std::string& userId : balanceWatch.takeDueAlerts(deadline)) {
+        BalanceRisk risk;
+        const User* user = findUserById(userId);
+        if (!user || !balanceWatch.find(userId, risk)) continue;
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(2);
+        if (risk.balance < 0) {
+            message << "Your balance is negative ($" << risk.balance << "). Top up to request new rentals.";
+        } else {
+            message << "Your balance of $" << risk.balance << " does not cover $" << risk.committed
+                    << " of approved rentals and is projected to run out at " << formatTimePoint(risk.depletion) << ".";
+        }
+        notify(userId, message.str(), NotificationPriority::HIGH);
+        Metrics::increment(MetricCounter::LOW_BALANCE_ALERTS);
+        console() << "Warning: Low balance for user '" << user->getUsername() << "': projected balance $"
+                  << std::fixed << std::setprecision(2) << risk.projectedBalance << "." << std::endl;
+        ++alerted;
+    }
+    return alerted;
+}
+
+void System::notify(const std::string& userId, const std::string& message, NotificationPriority priority) {
+    notifications[userId].emplace_back(userId, message, priority);
+}
+
+void System::showImportantNotifications(const User& user) const {
+    auto it = notifications.find(user.getUserId());
+    if (!consoleMessages || it == notifications.end()) return;
+    size_t unread = 0;
+    for (const Notification& notification : it->second) {
+        if (!notification.getIsRead() && notification.getPriority() == NotificationPriority::HIGH) ++unread;
+    }
+    if (unread == 0) return;
+    console() << "You have " << unread << " unread important notification(s):" << std::endl;
+    for (const Notification& notification : it->second) {
+        if (!notification.getIsRead() && notification.getPriority() == NotificationPriority::HIGH) {
+            notification.displayNotification();
+        }
+    }
+}
+
+// An overdue rental has stopped holding its resource: count how long it held
+// it past its end time
+void System::endOverdue(const Rental& rental, std::chrono::system_clock::time_point now) {
+    long long overdueSeconds = std::chrono::duration_cast<std::chrono::seconds>(now - rental.getEndTime()).count();
+    count(MetricCounter::RENTALS_OVERDUE_ENDED);
+    if (overdueSeconds > 0) count(MetricCounter::RENTALS_OVERDUE_SECONDS, static_cast<uint64_t>(overdueSeconds));
+}
+
+// Suspension cascades walk the user's live rentals only, so suspending one
+// account costs time proportional to its open rentals, not to all rentals.
+size_t System::cascadeSuspension(User& user, SuspensionCascade cascade) {
+    auto live = liveRentalsByUser.find(user.getUserId());
+    if (cascade == SuspensionCascade::NONE || live == liveRentalsByUser.end()) return 0;
+    std::vector<size_t> positions(live->second.begin(), live->second.end()); // The status changes below edit the index
+    std::sort(positions.begin(), positions.end()); // Oldest first, for stable bill IDs
+    bool terminate = cascade == SuspensionCascade::TERMINATE;
+    auto now = std::chrono::system_clock::now();
+    size_t changed = 0;
+
+    Transaction transaction(*this);
+    for (size_t position : positions) {
+        Rental& rental = rentals[position];
+        RentalStatus status = rental.getStatus();
+        if (status == RentalStatus::PAUSED && !terminate) continue;
+
+        double billed = 0.0;
+        if (isRunning(status)) {
+            Resource* resource = findResourceById(rental.getResourceId());
+            if (resource) billed = settleRunningRental(rental, user, *resource, now);
+        }
+        RentalStatus next = !terminate ? RentalStatus::PAUSED
+                          : isRunning(status) ? RentalStatus::COMPLETED
+                          : RentalStatus::CANCELLED;
+        setRentalStatus(rental, next);
+        logRental(rental);
+        auditChange(terminate ? AuditOp::RENTAL_TERMINATED : AuditOp::RENTAL_PAUSED, rental.getRentalId(), billed);
+        ++changed;
+    }
+    count(MetricCounter::RENTALS_SUSPENDED, changed);
+    transaction.commit();
+    return changed;
+}
+
+// Bills a rental stopped early for the hours used so far, with the same
+// one-hour minimum as a completion, and frees its resource. Part of the
+// caller's transaction; returns the amount billed.
+double System::settleRunningRental(Rental& rental, User& user, Resource& resource,
+                                   std::chrono::system_clock::time_point now) {
+    long long usedHours = std::chrono::duration_cast<std::chrono::hours>(now - rental.getStartTime()).count();
+    usedHours = std::max(1LL, std::min(usedHours, static_cast<long long>(rentalHours(rental))));
+    double billed = usedHours * resource.getPricePerHour() - rental.getTotalCost();
+    bool overdue = rental.getStatus() == RentalStatus::OVERDUE;
+    if (billed > 0) {
+        logBill(chargeRental(rental, user, billed));
+        logUser(user);
+    } else {
+        billed = 0.0;
+    }
+    setResourceStatus(resource, ResourceStatus::IDLE);
+    logResource(resource);
+    if (overdue) endOverdue(rental, now);
+    return billed;
+}
+
+// Moves a rental's booked period so the hours not billed yet run from `now`.
+// Its start goes back by the hours already billed (a rental paused by a
+// suspension ran for them), so it keeps its length and completion still bills
+// the booked hours less its cost so far. Call before it starts running: the
+// expiry index and the balance watch take its times from then on.
+void System::restartRental(Rental& rental, std::chrono::system_clock::time_point now) {
+    const Resource* resource = findResourceById(rental.getResourceId());
+    double billedHours = resource && resource->getPricePerHour() > 0
+                       ? rental.getTotalCost() / resource->getPricePerHour() : 0.0;
+    billedHours = std::max(0.0, std::min(billedHours, rentalHours(rental)));
+    auto start = now - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                           std::chrono::duration<double, std::ratio<3600>>(billedHours));
+    auto moved = start - rental.getStartTime();
+    if (moved.count() == 0) return;
+    recordUndo(UndoOp::RENTAL_TIMES, &rental - rentals.data(), 0, static_cast<double>(moved.count()));
+    rental.setStartTime(start);
+    rental.setEndTime(rental.getEndTime() + moved);
+}
+
+size_t System::resumeRentals(User& user) {
+    auto live = liveRentalsByUser.find(user.getUserId());
+    if (live == liveRentalsByUser.end()) return 0;
+    std::vector<size_t> positions(live->second.begin(), live->second.end());
+    std::sort(positions.begin(), positions.end());
+    auto now = std::chrono::system_clock::now();
+    size_t resumed = 0;
+    for (size_t position : positions) {
+        Rental& rental = rentals[position];
+        if (rental.getStatus() != RentalStatus::PAUSED) continue;
+        restartRental(rental, now);
+        setRentalStatus(rental, RentalStatus::PENDING_APPROVAL);
+        logRental(rental);
+        auditChange(AuditOp::RENTAL_RESUMED, rental.getRentalId());
+        ++resumed;
+    }
+    return resumed;
+}
+
 bool System::requestResourceRental(const std::string& resourceId, int durationHours) {
+    ApiTimer timer(ApiMethod::REQUEST_RESOURCE_RENTAL);
     if (!currentUser) {
-        std::cout << "Error: No user logged in. Please log in to request a rental." << std::endl;
-        return false;
+        console() << "Error: No user logged in. Please log in to request a rental." << std::endl;
+        return fail(ErrorCode::NOT_LOGGED_IN);
     }
 
     if (currentUser->getStatus() != UserStatus::ACTIVE) {
-        std::cout << "Error: User account '" << currentUser->getUsername() << "' is not active. Cannot request rental." << std::endl;
-        return false;
+        console() << "Error: User account '" << currentUser->getUsername() << "' is not active. Cannot request rental." << std::endl;
+        return fail(ErrorCode::ACCOUNT_INACTIVE);
     }
 
     if (currentUser->getBalance() < 0) {
-        std::cout << "Error: User account '" << currentUser->getUsername() 
+        console() << "Error: User account '" << currentUser->getUsername() 
                   << "' has a negative balance (" << std::fixed << std::setprecision(2) << currentUser->getBalance() 
                   << "). Cannot request new rentals until balance is positive." << std::endl;
-        return false;
+        return fail(ErrorCode::INSUFFICIENT_BALANCE);
     }
 
-    Resource* resourceToRent = findResource(resourceId);
+    Resource* resourceToRent = findResourceById(resourceId);
     if (!resourceToRent) {
-        std::cout << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     if (resourceToRent->getStatus() != ResourceStatus::IDLE) {
-        std::cout << "Error: Resource '" << resourceToRent->getName() << "' is currently not IDLE." << std::endl;
-        return false;
+        console() << "Error: Resource '" << resourceToRent->getName() << "' is currently not IDLE." << std::endl;
+        return fail(ErrorCode::RESOURCE_BUSY);
     }
 
     if (durationHours < 1 || durationHours > 15 * 24) {
-        std::cout << "Error: Duration must be between 1 hour and 15 days (360 hours). Requested: " << durationHours << " hours." << std::endl;
-        return false;
+        console() << "Error: Duration must be between 1 hour and 15 days (360 hours). Requested: " << durationHours << " hours." << std::endl;
+        return fail(ErrorCode::INVALID_ARGUMENT);
     }
 
     auto now = std::chrono::system_clock::now();
-    auto startTime = now; // Simplified: rental starts immediately upon approval (not implemented yet)
+    auto startTime = now; // Moved to the approval time when it is approved (see restartRental)
     auto endTime = startTime + std::chrono::hours(durationHours);
 
-    std::string rentalId = generateUniqueId("rental_", rentals.size());
+    if (!admitRental(*currentUser, durationHours)) return false;
+
+    std::string rentalId = nextId("rental_", rentals.size());
     
+    recordUndo(UndoOp::RENTALS_APPENDED, rentals.size());
     rentals.emplace_back(rentalId, currentUser->getUserId(), resourceId, startTime, endTime);
-    std::cout << "Rental request for resource '" << resourceToRent->getName() << "' by user '" << currentUser->getUsername() << "' submitted successfully. Rental ID: " << rentalId << std::endl;
+    rentalIndexById[rentalId] = rentals.size() - 1;
+    rentalsByUser[currentUser->getUserId()].push_back(rentals.size() - 1);
+    trackNewRental(rentals.back());
+    logRental(rentals.back());
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::RENTAL_CREATED, rentalId);
+        event.userId = currentUser->getUserId();
+        event.relatedId = resourceId;
+        event.newCode = static_cast<uint32_t>(RentalStatus::PENDING_APPROVAL);
+        emit(event);
+    }
+    count(MetricCounter::RENTAL_REQUESTED);
+    auditChange(AuditOp::RENTAL_REQUESTED, rentalId, 0.0, static_cast<uint32_t>(durationHours));
+    console() << "Rental request for resource '" << resourceToRent->getName() << "' by user '" << currentUser->getUsername() << "' submitted successfully. Rental ID: " << rentalId << std::endl;
     // Resource status is not changed here; only upon approval.
     return true;
 }
 
 std::vector<Rental*> System::getUserRentals(const std::string& userId) {
+    ApiTimer timer(ApiMethod::GET_USER_RENTALS);
     std::vector<Rental*> userRentals;
-    for (auto& rental : rentals) {
-        if (rental.getUserId() == userId) {
-            userRentals.push_back(&rental);
+    auto indexIt = rentalsByUser.find(userId);
+    if (indexIt != rentalsByUser.end()) {
+        userRentals.reserve(indexIt->second.size());
+        for (size_t position : indexIt->second) {
+            userRentals.push_back(&rentals[position]);
         }
     }
     return userRentals;
 }
 
 Rental* System::findRental(const std::string& rentalId) {
-    auto it = std::find_if(rentals.begin(), rentals.end(),
-                           [&rentalId](const Rental& r) { return r.getRentalId() == rentalId; });
-    if (it != rentals.end()) {
-        return &(*it);
+    ApiTimer timer(ApiMethod::FIND_RENTAL);
+    return findRentalById(rentalId);
+}
+
+// Private helper method to find a rental by ID (not counted in the API metrics)
+Rental* System::findRentalById(const std::string& rentalId) {
+    TRACE_SCOPE("System::findRentalById");
+    auto it = rentalIndexById.find(rentalId);
+    if (it != rentalIndexById.end()) {
+        return &rentals[it->second];
     }
     return nullptr;
 }
 
 void System::displayUserRentals(const std::string& userId) { // Should be const
+    ApiTimer timer(ApiMethod::DISPLAY_USER_RENTALS);
     std::cout << "\n--- Rental History for User ID: " << userId << " ---" << std::endl;
     std::vector<Rental*> userRentals = getUserRentals(userId); // This part is problematic for const
                                                              // If getUserRentals returns Rental* and this method is const
@@ -491,104 +1881,180 @@ void System::displayUserRentals(const std::string& userId) { // Should be const
 
 // Rental cancellation
 bool System::cancelRentalRequest(const std::string& rentalId) {
+    ApiTimer timer(ApiMethod::CANCEL_RENTAL_REQUEST);
     if (!currentUser) {
-        std::cout << "Error: No user logged in. Please log in to cancel a rental." << std::endl;
-        return false;
+        console() << "Error: No user logged in. Please log in to cancel a rental." << std::endl;
+        return fail(ErrorCode::NOT_LOGGED_IN);
     }
 
-    Rental* rentalToCancel = findRental(rentalId);
+    Rental* rentalToCancel = findRentalById(rentalId);
     if (!rentalToCancel) {
-        std::cout << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Rental with ID '" << rentalId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
     if (rentalToCancel->getUserId() != currentUser->getUserId()) {
-        std::cout << "Error: User '" << currentUser->getUsername() 
+        console() << "Error: User '" << currentUser->getUsername() 
                   << "' does not own rental '" << rentalId << "'. Cannot cancel." << std::endl;
-        return false;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
     if (rentalToCancel->getStatus() != RentalStatus::PENDING_APPROVAL) {
-        std::cout << "Error: Rental '" << rentalId << "' is not in PENDING_APPROVAL state. Current status: " 
+        console() << "Error: Rental '" << rentalId << "' is not in PENDING_APPROVAL state. Current status: " 
                   << rentalToCancel->rentalStatusToString() << ". Cannot cancel." << std::endl;
-        return false;
+        return fail(ErrorCode::INVALID_STATE);
     }
 
-    rentalToCancel->setStatus(RentalStatus::CANCELLED);
-    std::cout << "Rental '" << rentalId << "' cancelled successfully by user '" << currentUser->getUsername() << "'." << std::endl;
+    setRentalStatus(*rentalToCancel, RentalStatus::CANCELLED);
+    logRental(*rentalToCancel);
+    count(MetricCounter::RENTAL_CANCELLED);
+    auditChange(AuditOp::RENTAL_CANCELLED, rentalId);
+    console() << "Rental '" << rentalId << "' cancelled successfully by user '" << currentUser->getUsername() << "'." << std::endl;
     return true;
 }
 
 // Admin Resource Management
 bool System::adminModifyResource(const std::string& resourceId, const std::string& newName, 
                                  const std::map<std::string, std::string>& newSpecs, double newPricePerHour) {
+    ApiTimer timer(ApiMethod::ADMIN_MODIFY_RESOURCE);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to modify resources." << std::endl;
-        if(currentUser) std::cout << "Current user: " << currentUser->getUsername() << " Role: " << static_cast<int>(currentUser->getRole()) << std::endl;
-        else std::cout << "No user logged in." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to modify resources." << std::endl;
+        if(currentUser) console() << "Current user: " << currentUser->getUsername() << " Role: " << static_cast<int>(currentUser->getRole()) << std::endl;
+        else console() << "No user logged in." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
-    Resource* resourceToModify = findResource(resourceId);
+    Resource* resourceToModify = findResourceById(resourceId);
     if (!resourceToModify) {
-        std::cout << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
+    if (inTransaction()) {
+        recordUndo(UndoOp::RESOURCE_IMAGE, resourceToModify - resources.data(), static_cast<uint32_t>(resourceImages.size()));
+        resourceImages.push_back(*resourceToModify);
+    }
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::RESOURCE_MODIFIED, resourceId);
+        event.oldAmount = resourceToModify->getPricePerHour();
+        event.newAmount = newPricePerHour;
+        emit(event);
+    }
+    double oldPricePerHour = resourceToModify->getPricePerHour();
     resourceToModify->setName(newName);
     resourceToModify->setSpecs(newSpecs);
     resourceToModify->setPricePerHour(newPricePerHour);
+    repriceRentals(*resourceToModify, oldPricePerHour);
+    logResource(*resourceToModify);
+    auditChange(AuditOp::RESOURCE_MODIFIED, resourceId, newPricePerHour);
 
-    std::cout << "Resource '" << resourceId << "' modified successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
+    console() << "Resource '" << resourceId << "' modified successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
     return true;
 }
 
 bool System::adminDeleteResource(const std::string& resourceId) {
+    ApiTimer timer(ApiMethod::ADMIN_DELETE_RESOURCE);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to delete resources." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to delete resources." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    if (inTransaction()) { // Removal shifts the positions undo records refer to
+        console() << "Error: Resources cannot be deleted inside a transaction." << std::endl;
+        return fail(ErrorCode::INVALID_STATE);
     }
 
-    Resource* resourceToDelete = findResource(resourceId);
+    Resource* resourceToDelete = findResourceById(resourceId);
     if (!resourceToDelete) {
-        std::cout << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
-        return false;
+        console() << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
-    // Check if the resource is part of any active or pending rental
-    for (const auto& rental : rentals) {
-        if (rental.getResourceId() == resourceId) {
-            RentalStatus status = rental.getStatus();
-            if (status == RentalStatus::ACTIVE || status == RentalStatus::PENDING_APPROVAL || status == RentalStatus::APPROVED) {
-                std::cout << "Error: Resource '" << resourceId << "' cannot be deleted. It is part of an active, approved, or pending rental (Rental ID: " 
-                          << rental.getRentalId() << ", Status: " << rental.rentalStatusToString() << ")." << std::endl;
-                return false;
-            }
-        }
+    // Check if the resource is part of any live (pending, approved, active or paused) rental
+    auto live = liveRentalsByResource.find(resourceId);
+    if (live != liveRentalsByResource.end()) {
+        const Rental& rental = rentals[live->second.front()];
+        console() << "Error: Resource '" << resourceId << "' cannot be deleted. It is part of an active, approved, or pending rental (Rental ID: " 
+                  << rental.getRentalId() << ", Status: " << rental.rentalStatusToString() << ")." << std::endl;
+        return fail(ErrorCode::RESOURCE_BUSY);
     }
-    
-    // If resource is not IDLE but also not in a problematic rental state (e.g. IN_USE but rental is COMPLETED)
-    // For simplicity now, we only strictly require IDLE or that it's not in active/pending rentals.
-    // A more robust check might be: if (resourceToDelete->getStatus() != ResourceStatus::IDLE) { ... }
-    // and then also check rentals. For now, the rental check is primary.
 
-    auto it = std::remove_if(resources.begin(), resources.end(), 
-                             [&resourceId](const Resource& r) { return r.getResourceId() == resourceId; });
+    retireResource(*resourceToDelete);
+    compactResources();
+    audit(AuditOp::RESOURCE_DELETED, resourceId);
+    console() << "Resource '" << resourceId << "' deleted successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
+    return true;
+}
 
-    if (it != resources.end()) {
-        resources.erase(it, resources.end());
-        std::cout << "Resource '" << resourceId << "' deleted successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
-        return true;
+size_t System::adminDecommissionResources(const std::vector<std::string>& resourceIds, bool terminateRunning) {
+    ApiTimer timer(ApiMethod::ADMIN_DECOMMISSION_RESOURCES);
+    TRACE_SCOPE("System::adminDecommissionResources");
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to decommission resources." << std::endl;
+        lastErrorCode = ErrorCode::PERMISSION_DENIED;
+        return 0;
+    }
+    if (inTransaction()) {
+        console() << "Error: Resources cannot be deleted inside a transaction." << std::endl;
+        lastErrorCode = ErrorCode::INVALID_STATE;
+        return 0;
     }
 
-    // Should not happen if findResource found it earlier, but as a fallback:
-    std::cout << "Error: Failed to delete resource '" << resourceId << "' (unexpected error during removal)." << std::endl;
-    return false; 
+    auto now = std::chrono::system_clock::now();
+    size_t removed = 0;
+    for (const std::string& resourceId : resourceIds) {
+        Resource* resource = findResourceById(resourceId);
+        if (!resource) {
+            console() << "Error: Resource with ID '" << resourceId << "' not found." << std::endl;
+            lastErrorCode = ErrorCode::NOT_FOUND;
+            continue;
+        }
+
+        auto live = liveRentalsByResource.find(resourceId);
+        if (live != liveRentalsByResource.end()) {
+            std::vector<size_t> positions(live->second.begin(), live->second.end()); // Drained below
+            if (!terminateRunning) {
+                auto running = std::find_if(positions.begin(), positions.end(), [this](size_t position) {
+                    return isRunning(rentals[position].getStatus());
+                });
+                if (running != positions.end()) {
+                    console() << "Error: Resource '" << resourceId << "' is in use by rental '"
+                              << rentals[*running].getRentalId() << "'. Not decommissioned." << std::endl;
+                    lastErrorCode = ErrorCode::RESOURCE_BUSY;
+                    continue;
+                }
+            }
+            Transaction transaction(*this);
+            for (size_t position : positions) {
+                Rental& rental = rentals[position];
+                double billed = 0.0;
+                bool running = isRunning(rental.getStatus());
+                User* user = findUserById(rental.getUserId());
+                if (running && user) billed = settleRunningRental(rental, *user, *resource, now);
+                setRentalStatus(rental, running ? RentalStatus::COMPLETED : RentalStatus::CANCELLED);
+                logRental(rental);
+                auditChange(AuditOp::RENTAL_TERMINATED, rental.getRentalId(), billed);
+            }
+            transaction.commit();
+        }
+
+        retireResource(*resource);
+        audit(AuditOp::RESOURCE_DELETED, resourceId);
+        ++removed;
+    }
+    compactResources(); // Once for the whole batch
+    console() << removed << " of " << resourceIds.size() << " resource(s) decommissioned by admin '"
+              << currentUser->getUsername() << "'." << std::endl;
+    return removed;
 }
 
 // Admin User Management
 void System::adminDisplayAllUsers() const {
+    ApiTimer timer(ApiMethod::ADMIN_DISPLAY_ALL_USERS);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
         std::cout << "Error: Admin privileges required to display all users." << std::endl;
         return;
     }
@@ -604,69 +2070,418 @@ void System::adminDisplayAllUsers() const {
 }
 
 bool System::adminAddUser(const std::string& username, const std::string& password, UserRole role, const std::string& realName) {
+    ApiTimer timer(ApiMethod::ADMIN_ADD_USER);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to add users." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to add users." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
     if (findUser(username)) {
-        std::cout << "Error: Username '" << username << "' already exists." << std::endl;
-        return false;
+        console() << "Error: Username '" << username << "' already exists." << std::endl;
+        return fail(ErrorCode::ALREADY_EXISTS);
     }
 
-    std::string userId = generateUniqueId("user_", users.size());
-    users.emplace_back(userId, username, password, role, realName);
-    std::cout << "User '" << username << "' added successfully by admin '" << currentUser->getUsername() << "' with ID: " << userId << "." << std::endl;
+    User* newUser = appendUser(username, password, role, realName);
+    count(MetricCounter::USER_REGISTERED);
+    auditChange(AuditOp::USER_ADDED, newUser->getUserId());
+    console() << "User '" << username << "' added successfully by admin '" << currentUser->getUsername() << "' with ID: " << newUser->getUserId() << "." << std::endl;
     return true;
 }
 
 bool System::adminModifyUser(const std::string& targetUsername, const std::string& newRealName, 
-                             UserRole newRole, UserStatus newStatus, double newBalance) {
+                             UserRole newRole, UserStatus newStatus, double newBalance,
+                             SuspensionCascade cascade) {
+    ApiTimer timer(ApiMethod::ADMIN_MODIFY_USER);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to modify users." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to modify users." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
     User* userToModify = findUser(targetUsername);
     if (!userToModify) {
-        std::cout << "Error: User '" << targetUsername << "' not found." << std::endl;
-        return false;
+        console() << "Error: User '" << targetUsername << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
+    if (inTransaction()) {
+        recordUndo(UndoOp::USER_IMAGE, userToModify - users.data(), static_cast<uint32_t>(userImages.size()));
+        userImages.push_back(*userToModify);
+    }
+    UserStatus oldStatus = userToModify->getStatus();
+    if (eventStream) {
+        ChangeEvent event(ChangeEventType::USER_MODIFIED, userToModify->getUserId());
+        event.oldCode = static_cast<uint32_t>(userToModify->getStatus());
+        event.newCode = static_cast<uint32_t>(newStatus);
+        event.oldAmount = userToModify->getBalance();
+        event.newAmount = newBalance;
+        emit(event);
+    }
     userToModify->setName(newRealName);
     userToModify->setRole(newRole);
     userToModify->setStatus(newStatus);
     userToModify->setBalance(newBalance);
+    balanceWatch.setBalance(userToModify->getUserId(), newBalance);
+    alertLowBalances();
+    logUser(*userToModify);
+    auditChange(AuditOp::USER_MODIFIED, userToModify->getUserId(), newBalance, static_cast<uint32_t>(newStatus));
 
-    std::cout << "User '" << targetUsername << "' modified successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
-
-    if (newStatus == UserStatus::SUSPENDED) {
-        std::cout << "Note: User '" << targetUsername << "' has been suspended. Their active rentals may need to be managed (e.g., paused or terminated)." << std::endl;
-        // Future implementation: Iterate userToModify->getActiveRentals() and update their status.
-    }
+    console() << "User '" << targetUsername << "' modified successfully by admin '" << currentUser->getUsername() << "'." << std::endl;
+    applyStatusCascade(*userToModify, oldStatus, cascade);
     return true;
 }
 
-bool System::adminSetUserStatus(const std::string& targetUsername, UserStatus newStatus) {
+bool System::adminSetUserStatus(const std::string& targetUsername, UserStatus newStatus,
+                                SuspensionCascade cascade) {
+    ApiTimer timer(ApiMethod::ADMIN_SET_USER_STATUS);
     if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
-        std::cout << "Error: Admin privileges required to set user status." << std::endl;
-        return false;
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to set user status." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
 
     User* userToModify = findUser(targetUsername);
     if (!userToModify) {
-        std::cout << "Error: User '" << targetUsername << "' not found." << std::endl;
-        return false;
+        console() << "Error: User '" << targetUsername << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
     }
 
-    userToModify->setStatus(newStatus);
-    std::cout << "Status of user '" << targetUsername << "' set to " 
+    UserStatus oldStatus = userToModify->getStatus();
+    setUserStatus(*userToModify, newStatus);
+    logUser(*userToModify);
+    auditChange(AuditOp::USER_STATUS_CHANGED, userToModify->getUserId(), 0.0, static_cast<uint32_t>(newStatus));
+    console() << "Status of user '" << targetUsername << "' set to " 
               << (newStatus == UserStatus::ACTIVE ? "ACTIVE" : "SUSPENDED") 
               << " by admin '" << currentUser->getUsername() << "'." << std::endl;
+    applyStatusCascade(*userToModify, oldStatus, cascade);
+    return true;
+}
+
+// Rentals follow a change of their user's status
+void System::applyStatusCascade(User& user, UserStatus oldStatus, SuspensionCascade cascade) {
+    if (user.getStatus() == oldStatus) return;
+    if (user.getStatus() == UserStatus::SUSPENDED) {
+        size_t changed = cascadeSuspension(user, cascade);
+        if (changed > 0) {
+            console() << changed << " rental(s) of user '" << user.getUsername() << "' "
+                      << (cascade == SuspensionCascade::TERMINATE ? "terminated" : "paused")
+                      << "; resources they held are IDLE again. Balance: $"
+                      << std::fixed << std::setprecision(2) << user.getBalance() << "." << std::endl;
+        }
+    } else {
+        size_t resumed = resumeRentals(user);
+        if (resumed > 0) {
+            console() << resumed << " paused rental(s) of user '" << user.getUsername()
+                      << "' are pending approval again." << std::endl;
+        }
+    }
+}
+
+// Quotas
+bool System::adminSetRoleQuota(UserRole role, const RentalQuota& quota) {
+    ApiTimer timer(ApiMethod::ADMIN_SET_ROLE_QUOTA);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to set quotas." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    roleQuotas[static_cast<size_t>(role)] = quota;
+    return true;
+}
+
+bool System::adminSetUserQuota(const std::string& username, const RentalQuota& quota) {
+    ApiTimer timer(ApiMethod::ADMIN_SET_USER_QUOTA);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to set quotas." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    User* user = findUser(username);
+    if (!user) {
+        console() << "Error: User '" << username << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
+    }
+    userQuotas[user->getUserId()] = quota;
+    return true;
+}
+
+bool System::adminClearUserQuota(const std::string& username) {
+    ApiTimer timer(ApiMethod::ADMIN_CLEAR_USER_QUOTA);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to set quotas." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    User* user = findUser(username);
+    if (!user) {
+        console() << "Error: User '" << username << "' not found." << std::endl;
+        return fail(ErrorCode::NOT_FOUND);
+    }
+    userQuotas.erase(user->getUserId());
+    return true;
+}
+
+bool System::getQuotaUsage(const std::string& userId, QuotaUsage& usage) const {
+    ApiTimer timer(ApiMethod::GET_QUOTA_USAGE);
+    if (!currentUser) return fail(ErrorCode::NOT_LOGGED_IN);
+    if (currentUser->getUserId() != userId && currentUser->getRole() != UserRole::ADMIN) {
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    auto it = quotaUsage.find(userId);
+    usage = it != quotaUsage.end() ? it->second : QuotaUsage();
+    return true;
+}
+
+// Low-balance watch and notifications
+bool System::adminSetLowBalanceHorizon(std::chrono::hours horizon) {
+    ApiTimer timer(ApiMethod::ADMIN_SET_LOW_BALANCE_HORIZON);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to set the low-balance horizon." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    if (horizon.count() < 0) return fail(ErrorCode::INVALID_ARGUMENT);
+    lowBalanceHorizon = horizon;
+    alertLowBalances(); // A longer horizon may bring users within it now
+    return true;
+}
+
+std::vector<BalanceRisk> System::adminUsersGoingNegative(std::chrono::hours within) {
+    ApiTimer timer(ApiMethod::ADMIN_USERS_GOING_NEGATIVE);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to view users going negative." << std::endl;
+        lastErrorCode = ErrorCode::PERMISSION_DENIED;
+        return std::vector<BalanceRisk>();
+    }
+    return balanceWatch.atRiskBefore(std::chrono::system_clock::now() + within);
+}
+
+size_t System::checkLowBalanceAlerts() {
+    ApiTimer timer(ApiMethod::CHECK_LOW_BALANCE_ALERTS);
+    return alertLowBalances();
+}
+
+std::vector<Notification> System::readNotifications() {
+    ApiTimer timer(ApiMethod::READ_NOTIFICATIONS);
+    if (!currentUser) {
+        lastErrorCode = ErrorCode::NOT_LOGGED_IN;
+        return std::vector<Notification>();
+    }
+    auto it = notifications.find(currentUser->getUserId());
+    if (it == notifications.end()) return std::vector<Notification>();
+    std::vector<Notification> unread(it->second); // As they were before this read
+    for (Notification& notification : it->second) notification.markRead();
+    return unread;
+}
+
+size_t System::clearNotifications() {
+    ApiTimer timer(ApiMethod::CLEAR_NOTIFICATIONS);
+    if (!currentUser) {
+        lastErrorCode = ErrorCode::NOT_LOGGED_IN;
+        return 0;
+    }
+    auto it = notifications.find(currentUser->getUserId());
+    if (it == notifications.end()) return 0;
+    std::vector<Notification>& inbox = it->second;
+    size_t before = inbox.size();
+    inbox.erase(std::remove_if(inbox.begin(), inbox.end(),
+                               [](const Notification& notification) { return notification.getIsRead(); }),
+                inbox.end());
+    size_t cleared = before - inbox.size();
+    if (inbox.empty()) notifications.erase(it);
+    return cleared;
+}
+
+// Overdue rentals. The expiry index holds running rentals by end time, so a
+// check pops the overdue ones off its front instead of scanning rentals.
+bool System::adminSetOverdueAutoComplete(bool enabled) {
+    ApiTimer timer(ApiMethod::ADMIN_SET_OVERDUE_AUTO_COMPLETE);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to change the overdue policy." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    autoCompleteOverdue = enabled;
+    return true;
+}
+
+size_t System::checkOverdueRentals(std::chrono::system_clock::time_point asOf) {
+    ApiTimer timer(ApiMethod::CHECK_OVERDUE_RENTALS);
+    // Only an admin may look ahead: anyone else could end rentals early
+    auto now = std::chrono::system_clock::now();
+    if (asOf > now && (!currentUser || currentUser->getRole() != UserRole::ADMIN)) asOf = now;
+    size_t found = 0;
+    while (!rentalsByEndTime.empty() && rentalsByEndTime.begin()->first <= asOf) {
+        Rental& rental = rentals[rentalsByEndTime.begin()->second];
+        setRentalStatus(rental, RentalStatus::OVERDUE); // Takes it out of the index
+        logRental(rental);
+        count(MetricCounter::RENTALS_OVERDUE);
+        auditChange(AuditOp::RENTAL_OVERDUE, rental.getRentalId());
+        ++found;
+
+        Resource* resource = findResourceById(rental.getResourceId());
+        User* user = findUserById(rental.getUserId());
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(2) << "Your rental '" << rental.getRentalId()
+                << "' of resource '" << rental.getResourceId() << "' ended at "
+                << formatTimePoint(rental.getEndTime());
+        if (autoCompleteOverdue && resource && user) {
+            double cost = completeRental(rental, *resource, *user, now).getAmount();
+            message << " and was completed automatically. Bill: $" << cost << ".";
+            notify(rental.getUserId(), message.str(), NotificationPriority::NORMAL);
+            console() << "Rental '" << rental.getRentalId() << "' was overdue and has been completed. Resource '"
+                      << rental.getResourceId() << "' is available again." << std::endl;
+        } else {
+            message << ". Complete it to release the resource.";
+            notify(rental.getUserId(), message.str(), NotificationPriority::HIGH);
+            console() << "Warning: Rental '" << rental.getRentalId() << "' is overdue since "
+                      << formatTimePoint(rental.getEndTime()) << ". Resource '" << rental.getResourceId()
+                      << "' is still in use." << std::endl;
+        }
+    }
+    return found;
+}
+
+// Paginated listings
+Page<Rental> System::listUserRentals(const std::string& userId, const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::LIST_USER_RENTALS);
+    if (!currentUser || (currentUser->getUserId() != userId && currentUser->getRole() != UserRole::ADMIN)) {
+        return Page<Rental>();
+    }
+    auto indexIt = rentalsByUser.find(userId);
+    if (indexIt == rentalsByUser.end()) {
+        return Page<Rental>();
+    }
+    const std::vector<size_t>& positions = indexIt->second;
+    return buildPage<Rental>(positions.size(), request,
+                             [this, &positions](size_t i) { return &rentals[positions[i]]; });
+}
+
+Page<Bill> System::listUserBills(const std::string& userId, const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::LIST_USER_BILLS);
+    if (!currentUser || (currentUser->getUserId() != userId && currentUser->getRole() != UserRole::ADMIN)) {
+        return Page<Bill>();
+    }
+    auto indexIt = billsByUser.find(userId);
+    if (indexIt == billsByUser.end()) {
+        return Page<Bill>();
+    }
+    // Bill cursors hold ledger sequences, so archiving does not shift them
+    const std::vector<size_t>& positions = indexIt->second;
+    return buildSequencedPage<Bill>(positions.size(), request,
+                                    [this, &positions](size_t i) { return &bills[positions[i]]; },
+                                    [this, &positions](size_t i) { return bills[positions[i]].getLedgerSequence(); });
+}
+
+// Resource cursors hold catalog sequences, so compaction does not shift them
+Page<Resource> System::listResources(const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::LIST_RESOURCES);
+    return buildSequencedPage<Resource>(resources.size(), request,
+        [this](size_t i) { return resources[i].getStatus() != ResourceStatus::RETIRED ? &resources[i] : nullptr; },
+        [this](size_t i) { return resources[i].getCatalogSequence(); });
+}
+
+Page<User> System::adminListUsers(const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::ADMIN_LIST_USERS);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        return Page<User>();
+    }
+    return buildPage<User>(users.size(), request, [this](size_t i) { return &users[i]; });
+}
+
+Page<Rental> System::adminListRentals(const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::ADMIN_LIST_RENTALS);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        return Page<Rental>();
+    }
+    return buildPage<Rental>(rentals.size(), request, [this](size_t i) { return &rentals[i]; });
+}
+
+Page<Bill> System::adminListBills(const PageRequest& request) const {
+    ApiTimer timer(ApiMethod::ADMIN_LIST_BILLS);
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        return Page<Bill>();
+    }
+    return buildSequencedPage<Bill>(bills.size(), request, [this](size_t i) { return &bills[i]; },
+                                    [this](size_t i) { return bills[i].getLedgerSequence(); });
+}
+
+// Operation metrics
+bool System::adminGetMetrics(MetricsSnapshot& snapshot) const {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to view metrics." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    snapshot = Metrics::snapshot();
+    return true;
+}
 
-    if (newStatus == UserStatus::SUSPENDED) {
-        std::cout << "Note: User '" << targetUsername << "' has been suspended. Their active rentals may need to be managed (e.g., paused or terminated)." << std::endl;
-        // Future implementation: Iterate userToModify->getActiveRentals() and update their status.
+bool System::adminWriteMetrics(std::ostream& out) const {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to view metrics." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    Metrics::writePrometheus(out);
+    return true;
+}
+
+bool System::adminStartMetricsDump(const std::string& path, std::chrono::milliseconds interval) {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to configure metrics dumps." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
     }
+    if (interval.count() <= 0) {
+        console() << "Error: Metrics dump interval must be positive." << std::endl;
+        return fail(ErrorCode::INVALID_ARGUMENT);
+    }
+    metricsDumper.reset(); // Stops a previous dumper first
+    metricsDumper.reset(new MetricsDumper(path, interval));
+    console() << "Metrics will be written to '" << path << "' every " << interval.count() << " ms." << std::endl;
     return true;
 }
+
+bool System::adminStopMetricsDump() {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to configure metrics dumps." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    if (!metricsDumper) {
+        console() << "No metrics dump is running." << std::endl;
+        return fail(ErrorCode::INVALID_STATE);
+    }
+    metricsDumper.reset(); // Writes a final dump
+    console() << "Metrics dump stopped." << std::endl;
+    return true;
+}
+
+// Tracing
+bool System::adminSetTracing(bool enabled) {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to configure tracing." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    if (enabled && !Trace::compiledIn()) {
+        console() << "Warning: Tracing is not compiled in (rebuild with TRACE=1); no spans will be recorded." << std::endl;
+    }
+    Trace::setEnabled(enabled);
+    return true;
+}
+
+bool System::adminWriteTrace(std::ostream& out) const {
+    if (!currentUser || currentUser->getRole() != UserRole::ADMIN) {
+        Metrics::increment(MetricCounter::PERMISSION_DENIED);
+        console() << "Error: Admin privileges required to view traces." << std::endl;
+        return fail(ErrorCode::PERMISSION_DENIED);
+    }
+    return Trace::writeChromeJson(out);
+}
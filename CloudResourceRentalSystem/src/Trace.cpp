@@ -0,0 +1,181 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct TraceEvent {
+    const char* name;
+    uint64_t startNanos;
+    uint64_t durationNanos;
+};
+
+// One thread's spans. The owner appends under the (uncontended) buffer mutex;
+// the writer takes it only while copying the buffer out.
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events; // Ring of RING_CAPACITY entries, allocated on first use
+    uint64_t written;               // Total spans recorded; the next slot is written % capacity
+    int threadId;
+
+    explicit TraceBuffer(int id) : written(0), threadId(id) {}
+};
+
+struct RetiredTraceEvent {
+    TraceEvent event;
+    int threadId;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers; // Of running threads
+    std::vector<RetiredTraceEvent> retired; // Ring of the most recent spans of exited threads
+    uint64_t retiredWritten;
+    int nextThreadId;
+    std::chrono::steady_clock::time_point epoch;
+
+    TraceRegistry() : retiredWritten(0), nextThreadId(1), epoch(std::chrono::steady_clock::now()) {}
+};
+
+static TraceRegistry& traceRegistry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+static std::atomic<bool> tracingEnabled(false);
+
+// Moves the spans of an exiting thread into the retired ring and drops its buffer
+static void retireBuffer(const std::shared_ptr<TraceBuffer>& buffer) {
+    TraceRegistry& registry = traceRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        uint64_t count = std::min<uint64_t>(buffer->written, buffer->events.size());
+        if (count > 0 && registry.retired.empty()) registry.retired.resize(Trace::RING_CAPACITY);
+        for (uint64_t i = buffer->written - count; i < buffer->written; ++i) {
+            RetiredTraceEvent& slot = registry.retired[registry.retiredWritten++ % Trace::RING_CAPACITY];
+            slot.event = buffer->events[i % Trace::RING_CAPACITY];
+            slot.threadId = buffer->threadId;
+        }
+    }
+    registry.buffers.erase(std::find(registry.buffers.begin(), registry.buffers.end(), buffer));
+}
+
+// Registers the thread's buffer on first use and retires it when the thread exits
+struct LocalTraceBuffer {
+    std::shared_ptr<TraceBuffer> buffer;
+
+    ~LocalTraceBuffer() {
+        if (buffer) retireBuffer(buffer);
+    }
+};
+
+static TraceBuffer& localBuffer() {
+    thread_local LocalTraceBuffer local;
+    if (!local.buffer) {
+        TraceRegistry& registry = traceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        local.buffer = std::make_shared<TraceBuffer>(registry.nextThreadId++);
+        registry.buffers.push_back(local.buffer);
+    }
+    return *local.buffer;
+}
+
+bool Trace::compiledIn() {
+#ifdef CRRS_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Trace::isEnabled() {
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace::setEnabled(bool enabled) {
+    traceRegistry(); // Fix the epoch before the first span
+    tracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t Trace::nowNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - traceRegistry().epoch).count());
+}
+
+void Trace::record(const char* name, uint64_t startNanos, uint64_t endNanos) {
+    TraceBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.empty()) {
+        buffer.events.resize(RING_CAPACITY);
+    }
+    TraceEvent& event = buffer.events[buffer.written % RING_CAPACITY];
+    event.name = name;
+    event.startNanos = startNanos;
+    event.durationNanos = endNanos - startNanos;
+    ++buffer.written;
+}
+
+static void writeEvent(std::ostream& out, const TraceEvent& event, int threadId, bool& first) {
+    // Span names are string literals chosen in the code, so no JSON escaping is needed
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%s\n{\"name\":\"%s\",\"cat\":\"crrs\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                  first ? "" : ",", event.name, threadId, event.startNanos / 1000.0,
+                  event.durationNanos / 1000.0);
+    out << line;
+    first = false;
+}
+
+bool Trace::writeChromeJson(std::ostream& out) {
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::vector<RetiredTraceEvent> retired;
+    {
+        TraceRegistry& registry = traceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffers = registry.buffers;
+        uint64_t count = std::min<uint64_t>(registry.retiredWritten, registry.retired.size());
+        retired.reserve(count);
+        for (uint64_t i = registry.retiredWritten - count; i < registry.retiredWritten; ++i) {
+            retired.push_back(registry.retired[i % RING_CAPACITY]);
+        }
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto& entry : retired) {
+        writeEvent(out, entry.event, entry.threadId, first);
+    }
+    std::vector<TraceEvent> events;
+    for (const auto& buffer : buffers) {
+        int threadId;
+        {
+            // Copy out so the owning thread is only blocked for a memcpy
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            uint64_t count = std::min<uint64_t>(buffer->written, buffer->events.size());
+            events.clear();
+            for (uint64_t i = buffer->written - count; i < buffer->written; ++i) {
+                events.push_back(buffer->events[i % RING_CAPACITY]);
+            }
+            threadId = buffer->threadId;
+        }
+        for (const auto& event : events) {
+            writeEvent(out, event, threadId, first);
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return static_cast<bool>(out);
+}
+
+void Trace::clear() {
+    TraceRegistry& registry = traceRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retiredWritten = 0;
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->written = 0;
+    }
+}
@@ -0,0 +1,22 @@
+#include "Transaction.h"
+#include "System.h"
+
+Transaction::Transaction(System& sys) : system(sys), open(true) {
+    system.openSavepoint();
+}
+
+Transaction::~Transaction() {
+    if (open) system.rollbackSavepoint();
+}
+
+void Transaction::commit() {
+    if (!open) return;
+    open = false;
+    system.commitSavepoint();
+}
+
+void Transaction::rollback() {
+    if (!open) return;
+    open = false;
+    system.rollbackSavepoint();
+}
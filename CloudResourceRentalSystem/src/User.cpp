@@ -1,33 +1,27 @@
 #include "User.h"
+#include "Trace.h"
 #include <iostream>
 #include <iomanip> // For std::fixed and std::setprecision
-
-// Helper function for password hashing (simple XOR hash)
-// This function is defined in the header for inline usage or can be made static in .cpp
-// For this implementation, I'll keep its definition within the .cpp and make it a static helper
-// or a free function if it doesn't need class member access.
-// Since it's already in the header as a private member, I'll implement it as part of the class.
-std::string User::xorHash(const std::string& input) const {
-    std::string hashed = input;
-    char key = 'K'; // Simple key, should be more complex or managed securely
-    for (char &c : hashed) {
-        c ^= key;
-    }
-    return hashed;
-}
+#include <utility> // For std::move
 
 // Constructor
 User::User(std::string id, std::string uname, std::string passwd, UserRole r, std::string realName)
-    : userId(id), username(uname), role(r), name(realName), balance(0.0), status(UserStatus::ACTIVE) {
-    this->passwordHash = xorHash(passwd);
+    : userId(std::move(id)), username(std::move(uname)), role(r), name(std::move(realName)), balance(0.0), status(UserStatus::ACTIVE) {
+    this->password = PasswordHasher::create(passwd);
+}
+
+// Constructor for an already hashed password, e.g. a user copied from another System
+User::User(std::string id, std::string uname, const PasswordCredential& credential, UserRole r, std::string realName)
+    : userId(std::move(id)), username(std::move(uname)), password(credential), role(r), balance(0.0),
+      status(UserStatus::ACTIVE), name(std::move(realName)) {
 }
 
 // Getters
-std::string User::getUserId() const {
+const std::string& User::getUserId() const {
     return userId;
 }
 
-std::string User::getUsername() const {
+const std::string& User::getUsername() const {
     return username;
 }
 
@@ -43,13 +37,13 @@ UserStatus User::getStatus() const {
     return status;
 }
 
-std::string User::getName() const {
+const std::string& User::getName() const {
     return name;
 }
 
 // Setters
 void User::setPassword(const std::string& newPassword) {
-    this->passwordHash = xorHash(newPassword);
+    this->password = PasswordHasher::create(newPassword);
 }
 
 void User::setBalance(double newBalance) {
@@ -70,11 +64,24 @@ void User::setRole(UserRole newRole) {
 
 // Password checking
 bool User::checkPassword(const std::string& passwd) const {
-    return xorHash(passwd) == this->passwordHash;
+    return PasswordHasher::verify(this->password, passwd);
+}
+
+bool User::passwordNeedsRehash() const {
+    return password.iterations != PasswordHasher::defaultIterations();
+}
+
+const PasswordCredential& User::getPasswordCredential() const {
+    return password;
+}
+
+void User::setPasswordCredential(const PasswordCredential& credential) {
+    this->password = credential;
 }
 
 // Display user information
 void User::displayUserInfo() const {
+    TRACE_SCOPE("User::displayUserInfo");
     std::cout << "----------------------------------------" << std::endl;
     std::cout << "User ID: " << userId << std::endl;
     std::cout << "Username: " << username << std::endl;
@@ -1,4 +1,5 @@
 #include "Utils.h"
+#include "Trace.h"
 #include <string>
 #include <chrono>
 #include <iomanip> // For std::put_time
@@ -10,8 +11,53 @@ std::string generateUniqueId(const std::string& prefix, int currentSize) {
     return prefix + std::to_string(currentSize + 1);
 }
 
+// Function to parse the numeric part back out of an ID generated by generateUniqueId
+bool parseUniqueId(const std::string& id, const std::string& prefix, long long& number) {
+    if (id.size() <= prefix.size() || id.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    if (id.size() - prefix.size() > 18) { // Would overflow long long
+        return false;
+    }
+    if (id[prefix.size()] == '0' && id.size() - prefix.size() > 1) { // "bill_01" would not round-trip
+        return false;
+    }
+    long long value = 0;
+    for (size_t i = prefix.size(); i < id.size(); ++i) {
+        if (id[i] < '0' || id[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (id[i] - '0');
+    }
+    number = value;
+    return true;
+}
+
+std::vector<std::string> splitCommandLine(const std::string& line) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) ++i;
+        if (i >= line.size()) break;
+        size_t end;
+        if (line[i] == '"') {
+            end = line.find('"', i + 1);
+            if (end == std::string::npos) end = line.size();
+            words.push_back(line.substr(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            end = line.find_first_of(" \t\r", i);
+            if (end == std::string::npos) end = line.size();
+            words.push_back(line.substr(i, end - i));
+            i = end;
+        }
+    }
+    return words;
+}
+
 // Function to format a time_point to a string
 std::string formatTimePoint(const std::chrono::system_clock::time_point& tp, const std::string& format) {
+    TRACE_SCOPE("formatTimePoint");
     std::time_t tt = std::chrono::system_clock::to_time_t(tp);
     // Using std::localtime which is not thread-safe. For production, consider alternatives.
     // For Windows, localtime_s; for POSIX, localtime_r.
@@ -3,13 +3,85 @@
 #include "Resource.h" // For Resource and ResourceType
 #include "Rental.h"   // For Rental and RentalStatus
 #include "Bill.h"     // For Bill
+#include "BulkImporter.h" // For bulk provisioning
+#include "Exporter.h"     // For analytics export
+#include "AuditLog.h"     // For the audit trail in logs.dat
+#include "BatchRunner.h"  // For --batch scripts
+#include "Replica.h"      // For the read replica
+#include "ShardedSystem.h" // For the partitioned deployment
 #include <iostream>
 #include <iomanip>   // For std::fixed and std::setprecision
 #include <map>     // For resource specs
 #include <chrono>  // For std::chrono for time manipulations in main (if needed)
+#include <sstream> // For in-memory import data
+#include <fstream> // For batch scripts
 
-int main() {
+// Runs a command script instead of the demo:
+//   CloudResourceRentalSystem --batch FILE|- [--verbose] [--stop-on-error]
+// See BatchRunner.h for the command language. The timing summary goes to stderr.
+static int runBatchMode(int argc, char* argv[]) {
+    std::string scriptPath;
+    BatchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) scriptPath = argv[++i];
+        else if (arg == "--verbose") options.echoSystemOutput = true;
+        else if (arg == "--stop-on-error") options.stopOnError = true;
+        else scriptPath.clear(), i = argc;
+    }
+    if (scriptPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--batch FILE|- [--verbose] [--stop-on-error]]" << std::endl;
+        return 2;
+    }
+    std::ifstream file;
+    if (scriptPath != "-") {
+        file.open(scriptPath.c_str());
+        if (!file) {
+            std::cerr << "Cannot open " << scriptPath << std::endl;
+            return 2;
+        }
+    }
+    std::ios::sync_with_stdio(false); // Listing output is buffered instead of written per line
+
+    AuditLog auditLog;
     System sys;
+    sys.attachAuditLog(&auditLog);
+    BatchRunner runner(sys, std::cout, std::cerr, options);
+    BatchReport report = runner.run(scriptPath == "-" ? std::cin : file);
+    BatchRunner::printReport(report, std::cerr);
+    return report.failed == 0 ? 0 : 1;
+}
+
+// Totals an admin report would show, for comparing a replica with its primary.
+// An admin must be logged in.
+static std::string reportTotals(System& system) {
+    PageRequest everything(1000000);
+    std::vector<Bill> allBills = system.findBillsByDate(std::chrono::system_clock::time_point::min(),
+                                                        std::chrono::system_clock::time_point::max());
+    double billed = 0.0;
+    for (const Bill& bill : allBills) {
+        billed += bill.getAmount();
+    }
+    std::ostringstream totals;
+    totals << system.adminListUsers(everything).items.size() << " users, "
+           << system.listResources(everything).items.size() << " resources, "
+           << system.adminListRentals(everything).items.size() << " rentals, "
+           << allBills.size() << " bills ($" << std::fixed << std::setprecision(2) << billed << ")";
+    return totals.str();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runBatchMode(argc, argv);
+    }
+
+    // Keeps the demo quick; real deployments keep PasswordHasher::DEFAULT_ITERATIONS
+    PasswordHasher::setDefaultIterations(1000);
+    AuditLog auditLog; // Appends to logs.dat in the working directory
+    ChangeLogWriter changeLog; // Recreates changes.wal in the working directory, read in Test Case 11
+    System sys;
+    sys.attachAuditLog(&auditLog);
+    sys.attachChangeLog(&changeLog);
 
     std::cout << "--- Initial User and Resource Setup for Billing Tests ---" << std::endl;
     // Register users
@@ -147,6 +219,454 @@ int main() {
         std::cout << "Admin login failed for displaying all bills." << std::endl;
     }
     
+    std::cout << "\n--- Test Case 4: Admin Archives Old Bills ---" << std::endl;
+    admin_login = sys.loginUser("admin01", "adminPass");
+    if (admin_login) {
+        // Everything billed so far counts as "old" for this test
+        auto cutoff = std::chrono::system_clock::now() + std::chrono::seconds(1);
+        size_t archived = sys.adminArchiveBillsBefore(cutoff);
+        std::cout << "Archived bills: " << archived << " (Expected: 2)" << std::endl;
+
+        auto from = std::chrono::system_clock::now() - std::chrono::hours(24);
+        std::vector<Bill> aliceBills = sys.findUserBills("user_1", from, cutoff);
+        std::cout << "Alice's bills found after archiving: " << aliceBills.size() << " (Expected: 1)" << std::endl;
+        if (!aliceBills.empty()) {
+            std::cout << "Archived amount: $" << std::fixed << std::setprecision(2) << aliceBills[0].getAmount()
+                      << " (Expected: $20.00)" << std::endl;
+        }
+        sys.adminDisplayAllBills();
+        sys.logoutUser();
+    } else {
+        std::cout << "Admin login failed for archiving bills." << std::endl;
+    }
+
+    std::cout << "\n--- Test Case 5: Paginated Rental Listing ---" << std::endl;
+    admin_login = sys.loginUser("admin01", "adminPass");
+    if (admin_login) {
+        // Walk all rentals newest first, one per page, following the continuation cursor
+        PageRequest request(1, PageOrder::NEWEST_FIRST);
+        int pages = 0;
+        do {
+            Page<Rental> page = sys.adminListRentals(request);
+            for (const Rental* rental : page.items) {
+                std::cout << "Page " << ++pages << ": " << rental->getRentalId() << std::endl;
+            }
+            request.cursor = page.nextCursor;
+        } while (!request.cursor.empty());
+        std::cout << "Pages read: " << pages << " (Expected: 2)" << std::endl;
+        sys.logoutUser();
+    } else {
+        std::cout << "Admin login failed for paginated listing." << std::endl;
+    }
+
+    std::cout << "\n--- Test Case 6: Bulk Import of Users and Resources ---" << std::endl;
+    admin_login = sys.loginUser("admin01", "adminPass");
+    if (admin_login) {
+        BulkImporter importer(sys);
+        std::istringstream userCsv(
+            "username,password,role,realName,balance\n"
+            "carol_s,pw1,student,Carol Student,20\n"
+            "dave_t,pw2,teacher,\"Dave, Teacher\",100\n"
+            "carol_s,pw3,student,Duplicate Carol,0\n"
+            "eve_x,pw4,janitor,Bad Role,0\n");
+        ImportReport userReport = importer.importUsers(userCsv, ImportFormat::CSV);
+        std::cout << "Users imported: " << userReport.rowsImported << " of " << userReport.rowsRead
+                  << " (Expected: 2 of 4)" << std::endl;
+        for (const auto& error : userReport.errors) {
+            std::cout << "  Line " << error.line << ": " << error.message << std::endl;
+        }
+
+        std::istringstream resourceJsonl(
+            "{\"resourceId\": \"gpu_bulk_01\", \"type\": \"gpu\", \"name\": \"Bulk GPU 1\", \"pricePerHour\": 30, \"specs\": {\"Memory\": \"16GB\"}}\n"
+            "{\"resourceId\": \"cpu_bill_01\", \"type\": \"cpu\", \"name\": \"Clash\", \"pricePerHour\": 1}\n");
+        ImportReport resourceReport = importer.importResources(resourceJsonl, ImportFormat::JSONL);
+        std::cout << "Resources imported: " << resourceReport.rowsImported << " of " << resourceReport.rowsRead
+                  << " (Expected: 1 of 2)" << std::endl;
+        for (const auto& error : resourceReport.errors) {
+            std::cout << "  Line " << error.line << ": " << error.message << std::endl;
+        }
+        sys.logoutUser();
+
+        User* dave = sys.loginUser("dave_t", "pw2");
+        if (dave) {
+            std::cout << "Imported user " << dave->getName() << " balance: $" << dave->getBalance()
+                      << " (Expected: $100.00)" << std::endl;
+            sys.logoutUser();
+        }
+        Resource* bulkGpu = sys.findResource("gpu_bulk_01");
+        std::cout << "Imported resource spec Memory: " << (bulkGpu ? bulkGpu->getSpec("Memory") : "missing")
+                  << " (Expected: 16GB)" << std::endl;
+    } else {
+        std::cout << "Admin login failed for bulk import." << std::endl;
+    }
+
+    std::cout << "\n--- Test Case 7: Export Rentals and Bills ---" << std::endl;
+    {
+        Exporter exporter(sys);
+        std::ostringstream ignored;
+        ExportReport refused = exporter.exportRentals(ignored, ExportFormat::CSV);
+        std::cout << "Export without an admin: " << refused.error << ", " << errorCodeName(sys.lastError())
+                  << " (Expected: permission_denied)" << std::endl;
+    }
+    if (sys.loginUser("admin01", "adminPass")) {
+        Exporter exporter(sys);
+        ExportFilter completedOnly;
+        completedOnly.filterRentalStatus = true;
+        completedOnly.rentalStatus = RentalStatus::COMPLETED;
+        ExportReport rentalReport = exporter.exportRentals(std::cout, ExportFormat::CSV, completedOnly);
+        std::cout << "Rentals exported: " << rentalReport.records << " (Expected: 2)" << std::endl;
+
+        ExportReport billReport = exporter.exportBills(std::cout, ExportFormat::JSONL);
+        std::cout << "Bills exported: " << billReport.records << " (Expected: 2)" << std::endl;
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 8: Operation Metrics ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        MetricsSnapshot metrics;
+        if (sys.adminGetMetrics(metrics)) {
+            std::cout << "Rentals completed: " << metrics.counter(MetricCounter::RENTAL_COMPLETED)
+                      << " (Expected: 2)" << std::endl;
+            std::cout << "Bills created: " << metrics.counter(MetricCounter::BILL_CREATED)
+                      << " (Expected: 2)" << std::endl;
+            std::cout << "processRentalCompletion calls: "
+                      << metrics.latency(ApiMethod::PROCESS_RENTAL_COMPLETION).count << " (Expected: 2)" << std::endl;
+        }
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 9: Audit Log ---" << std::endl;
+    auditLog.flush();
+    std::cout << "Audit records written to logs.dat: " << auditLog.recordsWritten()
+              << ", dropped: " << auditLog.recordsDropped() << " (Expected: 0 dropped)" << std::endl;
+
+    std::cout << "\n--- Test Case 10: Asynchronous Login ---" << std::endl;
+    {
+        // The demo holds no lock, so waiting on the futures here is safe
+        std::future<LoginResult> good = sys.loginUserAsync("alice_b", "pass123");
+        std::future<LoginResult> bad = sys.loginUserAsync("alice_b", "wrongPass");
+        LoginResult goodResult = good.get();
+        LoginResult badResult = bad.get();
+        std::cout << "Correct password: " << (goodResult.success ? "accepted" : "rejected")
+                  << " (Expected: accepted)" << std::endl;
+        std::cout << "Wrong password: " << (badResult.success ? "accepted" : "rejected")
+                  << " (Expected: rejected)" << std::endl;
+        if (goodResult.success && sys.switchToUser(goodResult.userId)) {
+            std::cout << "Session switched to " << sys.getCurrentUser()->getUsername() << std::endl;
+            sys.logoutUser();
+        }
+    }
+
+    std::cout << "\n--- Test Case 11: Read Replica ---" << std::endl;
+    {
+        changeLog.flush(); // A running replica would see the records within a few milliseconds anyway
+        System replicaSys;
+        Replica replica(replicaSys, "changes.wal");
+        if (!replica.catchUp()) {
+            std::string reason;
+            replica.failed(reason);
+            std::cout << "Replication failed: " << reason << std::endl;
+        } else {
+            std::cout << "Replica applied the change log up to record " << replica.sequence() << std::endl;
+            // Accounts are replicated with their password hashes, so the admin logs in on the replica too
+            if (sys.loginUser("admin01", "adminPass") && replicaSys.loginUser("admin01", "adminPass")) {
+                std::string primaryTotals = reportTotals(sys);
+                std::string replicaTotals = reportTotals(replicaSys);
+                std::cout << "Primary: " << primaryTotals << std::endl;
+                std::cout << "Replica: " << replicaTotals << std::endl;
+                std::cout << "Reports match: " << (primaryTotals == replicaTotals ? "yes" : "no")
+                          << " (Expected: yes)" << std::endl;
+                sys.logoutUser();
+                replicaSys.logoutUser();
+            }
+            std::cout << "Replication lag under one second: " << (replica.lagMicros() < 1000000 ? "yes" : "no")
+                      << " (Expected: yes)" << std::endl;
+        }
+    }
+
+    std::cout << "\n--- Test Case 12: Sharded Deployment ---" << std::endl;
+    {
+        ShardedSystem sharded(4);
+        sharded.registerUser("root", "rootPass", UserRole::ADMIN, "Shard Admin");
+        const char* students[] = {"frank_s", "grace_s", "heidi_s", "ivan_s"};
+        for (const char* name : students) {
+            sharded.registerUser(name, "pw", UserRole::STUDENT, name);
+        }
+        std::string rootSession;
+        if (sharded.login("root", "rootPass", rootSession)) {
+            sharded.addResource(rootSession, Resource("cpu_shard_01", ResourceType::CPU, "Shard CPU 1", {{"Cores", "4"}}, 5.0));
+            for (const char* name : students) {
+                sharded.modifyUser(rootSession, name, name, UserRole::STUDENT, UserStatus::ACTIVE, 40.0);
+            }
+
+            // Every student asks for the same CPU; only one rental can hold it,
+            // whichever shards the students and the CPU landed on
+            std::vector<std::string> rentalIds;
+            for (const char* name : students) {
+                std::string session, rentalId;
+                if (sharded.login(name, "pw", session) && sharded.requestRental(session, "cpu_shard_01", 1, rentalId)) {
+                    rentalIds.push_back(rentalId);
+                }
+            }
+            int approved = 0;
+            for (const std::string& rentalId : rentalIds) {
+                if (sharded.approveRental(rootSession, rentalId)) ++approved;
+            }
+            std::cout << "Requests: " << rentalIds.size() << ", approved: " << approved << " (Expected: 4, 1)" << std::endl;
+
+            ShardedPage<Rental> rentals = sharded.adminListRentals(rootSession, PageRequest(100));
+            for (const Rental& rental : rentals.items) {
+                if (rental.getStatus() == RentalStatus::APPROVED) sharded.completeRental(rootSession, rental.getRentalId());
+            }
+            Resource cpu("", ResourceType::CPU, "", {}, 0.0);
+            if (sharded.findResource("cpu_shard_01", cpu)) {
+                std::cout << "Shard CPU status after completion: "
+                          << (cpu.getStatus() == ResourceStatus::IDLE ? "Idle" : "In Use") << " (Expected: Idle)" << std::endl;
+            }
+
+            // Admin listings span every shard, two items per page
+            size_t users = 0;
+            PageRequest request(2);
+            do {
+                ShardedPage<User> page = sharded.adminListUsers(rootSession, request);
+                users += page.items.size();
+                request.cursor = page.nextCursor;
+            } while (!request.cursor.empty());
+            std::cout << "Users listed across " << sharded.shardCount() << " shards: " << users
+                      << " (Expected: 5)" << std::endl;
+            ShardedPage<Bill> bills = sharded.adminListBills(rootSession, PageRequest(100));
+            std::cout << "Bills across shards: " << bills.items.size() << " (Expected: 1)" << std::endl;
+        }
+    }
+
+    std::cout << "\n--- Test Case 13: Error Codes ---" << std::endl;
+    {
+        // Callers that branch on the cause do not need the console messages
+        sys.setConsoleMessages(false);
+        if (!sys.loginUser("dave_t", "wrongPass")) {
+            std::cout << "Wrong password: " << errorCodeName(sys.lastError()) << " (Expected: authentication_failed)" << std::endl;
+        }
+        if (sys.loginUser("dave_t", "pw2")) {
+            sys.requestResourceRental("no_such_cpu", 1);
+            std::cout << "Unknown resource: " << errorCodeName(sys.lastError()) << " (Expected: not_found)" << std::endl;
+            sys.requestResourceRental("gpu_bulk_01", 1000);
+            std::cout << "1000 hours: " << errorCodeName(sys.lastError()) << " (Expected: invalid_argument)" << std::endl;
+            sys.adminApproveRental("rental_1");
+            std::cout << "Approval by a teacher: " << errorCodeName(sys.lastError()) << " (Expected: permission_denied)" << std::endl;
+            sys.logoutUser();
+        }
+        sys.setConsoleMessages(true);
+    }
+
+    std::cout << "\n--- Test Case 14: Snapshot Reads ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.enableSnapshots();
+        std::unique_ptr<Snapshot> snapshot = sys.adminOpenSnapshot();
+        if (snapshot) {
+            // Changes after the snapshot was opened are not visible through it
+            sys.adminSetUserStatus("dave_t", UserStatus::SUSPENDED);
+            std::unique_ptr<Snapshot> later = sys.adminOpenSnapshot();
+            auto countSuspended = [](const Snapshot& view) {
+                int suspended = 0;
+                view.forEachUser([&](const User& user) {
+                    if (user.getStatus() == UserStatus::SUSPENDED) ++suspended;
+                });
+                return suspended;
+            };
+            std::cout << "Suspended users in first snapshot: " << countSuspended(*snapshot) << " (Expected: 0)" << std::endl;
+            std::cout << "Suspended users in later snapshot: " << countSuspended(*later) << " (Expected: 1)" << std::endl;
+            sys.adminSetUserStatus("dave_t", UserStatus::ACTIVE);
+        }
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 15: Transactions ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        Resource* gpu = sys.findResource("gpu_bulk_01");
+        double oldPrice = gpu->getPricePerHour();
+        // Both changes are undone together
+        sys.beginTransaction();
+        sys.adminModifyResource("gpu_bulk_01", "Renamed GPU", gpu->getAllSpecs(), 99.0);
+        sys.adminSetUserStatus("dave_t", UserStatus::SUSPENDED);
+        sys.rollbackTransaction();
+        std::cout << "Price after rollback: " << gpu->getPricePerHour() << " (Expected: " << oldPrice << ")" << std::endl;
+        std::unique_ptr<Snapshot> snapshot = sys.adminOpenSnapshot();
+        int suspended = 0;
+        snapshot->forEachUser([&](const User& user) {
+            if (user.getStatus() == UserStatus::SUSPENDED) ++suspended;
+        });
+        std::cout << "Suspended users after rollback: " << suspended << " (Expected: 0)" << std::endl;
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 16: Change Events ---" << std::endl;
+    {
+        ChangeEventStream events;
+        std::unique_ptr<ChangeEventSubscription> subscription = events.subscribe();
+        sys.attachEventStream(&events);
+        std::vector<ChangeEvent> received;
+        if (sys.loginUser("dave_t", "pw2")) {
+            sys.requestResourceRental("gpu_bulk_01", 2);
+            subscription->poll(received);
+            if (!received.empty()) sys.cancelRentalRequest(received.back().entityId);
+            sys.logoutUser();
+        }
+        subscription->poll(received);
+        for (const auto& event : received) {
+            std::cout << "Event " << event.sequence << ": " << changeEventTypeName(event.type)
+                      << " " << event.entityId << std::endl;
+        }
+        std::cout << "Events received: " << received.size() << " (Expected: 2)" << std::endl;
+        sys.attachEventStream(nullptr);
+    }
+
+    std::cout << "\n--- Test Case 17: Rental Quotas ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        RentalQuota quota;
+        quota.maxPending = 1;
+        quota.requestsPerSecond = 0.01; // One request per 100 seconds after the first two
+        quota.burst = 2;
+        sys.adminSetUserQuota("dave_t", quota);
+        sys.logoutUser();
+    }
+    std::string daveId;
+    if (sys.loginUser("dave_t", "pw2")) {
+        daveId = sys.getCurrentUser()->getUserId();
+        sys.requestResourceRental("gpu_bulk_01", 2);
+        sys.requestResourceRental("gpu_bulk_01", 2);
+        std::cout << "Second pending request: " << errorCodeName(sys.lastError()) << " (Expected: quota_exceeded)" << std::endl;
+        sys.requestResourceRental("gpu_bulk_01", 2);
+        std::cout << "Third request in a row: " << errorCodeName(sys.lastError()) << " (Expected: rate_limited)" << std::endl;
+        QuotaUsage usage;
+        if (sys.getQuotaUsage(sys.getCurrentUser()->getUserId(), usage)) {
+            std::cout << "Pending: " << usage.pending << ", hours this period: " << usage.periodHours
+                      << " (Expected: 1, 2.00)" << std::endl;
+        }
+        sys.logoutUser();
+    }
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.adminClearUserQuota("dave_t");
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 18: Cascading Suspension ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        std::string pendingId = sys.getUserRentals(daveId).back()->getRentalId(); // Left pending by Test Case 17
+        sys.adminApproveRental(pendingId);
+        sys.adminSetUserStatus("dave_t", UserStatus::SUSPENDED); // Pauses by default
+        Rental* paused = sys.findRental(pendingId);
+        std::cout << "Rental status: " << paused->rentalStatusToString() << ", billed $" << paused->getTotalCost()
+                  << " (Expected: Paused, 1 hour); resource IDLE: "
+                  << (sys.findResource("gpu_bulk_01")->getStatus() == ResourceStatus::IDLE ? "yes" : "no") << std::endl;
+        sys.adminSetUserStatus("dave_t", UserStatus::ACTIVE);
+        std::cout << "After reactivation: " << paused->rentalStatusToString() << " (Expected: Pending Approval)" << std::endl;
+        sys.adminSetUserStatus("dave_t", UserStatus::SUSPENDED, SuspensionCascade::TERMINATE);
+        std::cout << "After termination: " << paused->rentalStatusToString() << " (Expected: Cancelled)" << std::endl;
+        sys.adminSetUserStatus("dave_t", UserStatus::ACTIVE);
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 19: Decommissioning Resources ---" << std::endl;
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.addResource(Resource("gpu_rack_01", ResourceType::GPU, "Rack GPU 1", {{"Memory", "8GB"}}, 12.0));
+        sys.addResource(Resource("gpu_rack_02", ResourceType::GPU, "Rack GPU 2", {{"Memory", "8GB"}}, 12.0));
+        sys.logoutUser();
+    }
+    if (sys.loginUser("dave_t", "pw2")) {
+        sys.requestResourceRental("gpu_rack_02", 3);
+        sys.logoutUser();
+    }
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.adminDeleteResource("gpu_rack_02");
+        std::cout << "Delete with a pending rental: " << errorCodeName(sys.lastError()) << " (Expected: resource_busy)" << std::endl;
+        std::vector<std::string> rack = { "gpu_rack_01", "gpu_rack_02", "gpu_rack_03" };
+        size_t removed = sys.adminDecommissionResources(rack);
+        std::cout << "Decommissioned " << removed << " (Expected: 2); last error: " << errorCodeName(sys.lastError())
+                  << " (Expected: not_found)" << std::endl;
+        std::cout << "gpu_rack_02 still listed: " << (sys.findResource("gpu_rack_02") ? "yes" : "no") << " (Expected: no)" << std::endl;
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 20: Low-Balance Watch ---" << std::endl;
+    sys.registerUser("erin_w", "pw3", UserRole::STUDENT, "Erin Watch");
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.addResource(Resource("gpu_watch_01", ResourceType::GPU, "Watched GPU", {{"Memory", "8GB"}}, 10.0));
+        sys.adminModifyUser("erin_w", "Erin Watch", UserRole::STUDENT, UserStatus::ACTIVE, 20.0);
+        sys.logoutUser();
+    }
+    std::string erinsRentalId;
+    if (sys.loginUser("erin_w", "pw3")) {
+        sys.requestResourceRental("gpu_watch_01", 5); // $50 against a $20 balance
+        erinsRentalId = sys.getUserRentals(sys.getCurrentUser()->getUserId()).back()->getRentalId();
+        sys.logoutUser();
+    }
+    if (sys.loginUser("admin01", "adminPass")) {
+        sys.adminApproveRental(erinsRentalId); // Runs out in about 2 hours: alerts Erin
+        std::vector<BalanceRisk> risks = sys.adminUsersGoingNegative(std::chrono::hours(24));
+        std::cout << "Users going negative within 24 hours: " << risks.size()
+                  << " (Expected: 2, Bob already negative and then Erin)" << std::endl;
+        for (const BalanceRisk& risk : risks) {
+            std::cout << "  " << risk.userId << ": balance $" << std::fixed << std::setprecision(2) << risk.balance
+                      << ", committed $" << risk.committed << ", projected $" << risk.projectedBalance << std::endl;
+        }
+        std::cout << "Alerts on a second check: " << sys.checkLowBalanceAlerts() << " (Expected: 0)" << std::endl;
+        sys.logoutUser();
+    }
+    if (sys.loginUser("erin_w", "pw3")) { // Shows the alert
+        size_t unread = sys.readNotifications().size();
+        std::cout << "Notifications read: " << unread << ", cleared: " << sys.clearNotifications()
+                  << " (Expected: 1, 1)" << std::endl;
+        sys.logoutUser();
+    }
+
+    std::cout << "\n--- Test Case 21: Overdue Rentals ---" << std::endl;
+    sys.registerUser("fay_p", "pw4", UserRole::STUDENT, "Fay Pause");
+    if (sys.loginUser("admin01", "adminPass")) {
+        auto now = std::chrono::system_clock::now();
+        std::cout << "Overdue now: " << sys.checkOverdueRentals() << " (Expected: 0)" << std::endl;
+        // Six hours on, Erin's 5-hour rental from Test Case 20 has run over
+        size_t overdue = sys.checkOverdueRentals(now + std::chrono::hours(6));
+        Rental* erins = sys.findRental(erinsRentalId);
+        std::cout << "Overdue after 6 hours: " << overdue << "; Erin's rental: " << erins->rentalStatusToString()
+                  << ", gpu_watch_01 still IN_USE: "
+                  << (sys.findResource("gpu_watch_01")->getStatus() == ResourceStatus::IN_USE ? "yes" : "no")
+                  << " (Expected: Overdue, yes)" << std::endl;
+        sys.processRentalCompletion(erinsRentalId);
+
+        sys.requestResourceRental("gpu_watch_01", 2); // The admin's own rental, left to run over
+        sys.adminApproveRental(sys.getUserRentals(sys.getCurrentUser()->getUserId()).back()->getRentalId());
+        sys.adminSetOverdueAutoComplete(true);
+        size_t completed = sys.checkOverdueRentals(now + std::chrono::hours(48));
+        std::cout << "Completed automatically after 48 hours: " << completed << ", gpu_watch_01 IDLE: "
+                  << (sys.findResource("gpu_watch_01")->getStatus() == ResourceStatus::IDLE ? "yes" : "no")
+                  << " (Expected: 1, yes)" << std::endl;
+        sys.adminModifyUser("fay_p", "Fay Pause", UserRole::STUDENT, UserStatus::ACTIVE, 100.0);
+        sys.logoutUser();
+    }
+    std::string faysRentalId;
+    if (sys.loginUser("fay_p", "pw4")) {
+        sys.requestResourceRental("gpu_watch_01", 4); // $10 an hour
+        faysRentalId = sys.getUserRentals(sys.getCurrentUser()->getUserId()).back()->getRentalId();
+        sys.logoutUser();
+    }
+    if (sys.loginUser("admin01", "adminPass")) {
+        // Paused after an hour's bill and resumed: the three hours left run from the re-approval
+        sys.adminApproveRental(faysRentalId);
+        sys.adminSetUserStatus("fay_p", UserStatus::SUSPENDED);
+        sys.adminSetUserStatus("fay_p", UserStatus::ACTIVE);
+        sys.adminApproveRental(faysRentalId);
+        Rental* fays = sys.findRental(faysRentalId);
+        long long minutesLeft = std::chrono::duration_cast<std::chrono::minutes>(
+            fays->getEndTime() - std::chrono::system_clock::now()).count();
+        std::cout << "Resumed rental overdue now: " << sys.checkOverdueRentals() << ", hours left: "
+                  << (minutesLeft + 30) / 60 << ", billed $" << fays->getTotalCost()
+                  << " (Expected: 0, 3, $10.00)" << std::endl;
+        sys.processRentalCompletion(faysRentalId);
+        std::cout << "Billed in total: $" << fays->getTotalCost() << " (Expected: $40.00)" << std::endl;
+        sys.adminSetOverdueAutoComplete(false);
+        sys.logoutUser();
+    }
+
     std::cout << "\n--- Testing Complete ---" << std::endl;
     return 0;
 }
@@ -0,0 +1,133 @@
+// Prints and filters audit log files written by AuditLog.
+//
+// Usage:
+//   AuditLogReader [--user USER_ID] [--op OP_NAME] [--from TIME] [--to TIME] [--csv] [FILE...]
+//
+// --user matches records where the user is either the actor or the target.
+// TIME is "YYYY-MM-DD" or "YYYY-MM-DD HH:MM:SS" in local time; --to is inclusive.
+// Files default to logs.dat; pass rotated files oldest first (logs.dat.2 logs.dat.1 logs.dat).
+
+#include "AuditLog.h"
+#include "Utils.h"
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct ReaderOptions {
+    std::string user;
+    bool filterOp;
+    AuditOp op;
+    int64_t fromMicros;
+    int64_t toMicros;
+    bool csv;
+    std::vector<std::string> files;
+
+    ReaderOptions()
+        : filterOp(false), op(AuditOp::USER_REGISTERED), fromMicros(std::numeric_limits<int64_t>::min()),
+          toMicros(std::numeric_limits<int64_t>::max()), csv(false) {}
+};
+
+// Parses a local date or date-time; a bare date means the whole day
+static bool parseTime(const std::string& text, bool endOfRange, int64_t& micros) {
+    std::tm parts = std::tm();
+    int matched = std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &parts.tm_year, &parts.tm_mon, &parts.tm_mday,
+                              &parts.tm_hour, &parts.tm_min, &parts.tm_sec);
+    if (matched != 3 && matched != 6) return false;
+    parts.tm_year -= 1900;
+    parts.tm_mon -= 1;
+    parts.tm_isdst = -1;
+    std::time_t seconds = std::mktime(&parts);
+    if (seconds == static_cast<std::time_t>(-1)) return false;
+    if (matched == 3 && endOfRange) seconds += 24 * 3600 - 1;
+    micros = static_cast<int64_t>(seconds) * 1000000 + (endOfRange ? 999999 : 0);
+    return true;
+}
+
+static bool parseArguments(int argc, char* argv[], ReaderOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--user" || arg == "--op" || arg == "--from" || arg == "--to") {
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "--user") {
+                options.user = value;
+            } else if (arg == "--op") {
+                if (!AuditLog::opFromName(value, options.op)) {
+                    std::cerr << "Unknown operation '" << value << "'" << std::endl;
+                    return false;
+                }
+                options.filterOp = true;
+            } else if (!parseTime(value, arg == "--to", arg == "--from" ? options.fromMicros : options.toMicros)) {
+                std::cerr << "Bad time '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    if (options.files.empty()) options.files.push_back("logs.dat");
+    return true;
+}
+
+static bool matches(const AuditRecord& record, const ReaderOptions& options) {
+    if (options.filterOp && record.op != static_cast<uint8_t>(options.op)) return false;
+    if (record.timestampMicros < options.fromMicros || record.timestampMicros > options.toMicros) return false;
+    if (!options.user.empty() && record.actorId() != options.user && record.targetId() != options.user) return false;
+    return true;
+}
+
+static void printRecord(const AuditRecord& record, bool csv) {
+    std::chrono::system_clock::time_point time{std::chrono::microseconds(record.timestampMicros)};
+    std::string when = formatTimePoint(time);
+    const char* op = AuditLog::opName(static_cast<AuditOp>(record.op));
+    char amount[32];
+    std::snprintf(amount, sizeof(amount), "%.2f", record.amount);
+    if (csv) {
+        std::cout << when << ',' << op << ',' << record.actorId() << ',' << record.targetId() << ',' << amount << ','
+                  << record.detail << ',' << ((record.flags & AuditRecord::FLAG_TRUNCATED) ? 1 : 0) << '\n';
+        return;
+    }
+    std::string actor = record.actorId();
+    std::cout << when << "  " << op << "  actor=" << (actor.empty() ? "-" : actor);
+    if (record.target[0] != '\0') std::cout << "  target=" << record.targetId();
+    if (record.amount != 0.0) std::cout << "  amount=" << amount;
+    if (record.detail != 0) std::cout << "  detail=" << record.detail;
+    if (record.flags & AuditRecord::FLAG_TRUNCATED) std::cout << "  (IDs truncated)";
+    std::cout << '\n';
+}
+
+int main(int argc, char* argv[]) {
+    ReaderOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--user USER_ID] [--op OP_NAME] [--from TIME] [--to TIME] [--csv] [FILE...]" << std::endl;
+        return 2;
+    }
+
+    if (options.csv) std::cout << "time,op,actor,target,amount,detail,truncated\n";
+    int status = 0;
+    size_t shown = 0;
+    for (const auto& path : options.files) {
+        std::vector<AuditRecord> records;
+        std::string error;
+        if (!AuditLog::readFile(path, records, error)) {
+            std::cerr << "Warning: " << error << std::endl;
+            status = 1; // Records read before the problem are still printed
+        }
+        for (const auto& record : records) {
+            if (matches(record, options)) {
+                printRecord(record, options.csv);
+                ++shown;
+            }
+        }
+    }
+    if (!options.csv) std::cout << shown << " record(s)" << std::endl;
+    return status;
+}
@@ -0,0 +1,498 @@
+// Load driver: runs a synthetic workload, or replays a recorded trace, against
+// one System shared by several client threads, and reports latency and throughput.
+//
+// Usage:
+//   LoadDriver [--users N] [--resources N] [--ops N] [--threads N] [--seed N]
+//              [--mix login:browse:request:approve:complete] [--zipf S] [--rate OPS_PER_SEC]
+//              [--record trace.txt] [--replay trace.txt] [--realtime] [--json report.jsonl]
+//              [--metrics metrics.prom] [--trace trace.json] [--audit logs.dat] [--kdf-iterations N]
+//
+// Trace format: a "# users N resources M" header, then one operation per line:
+//   <offset_us> login <username>
+//   <offset_us> browse <resourceId>
+//   <offset_us> request <username> <resourceId> <hours>
+//   <offset_us> approve        (approves the oldest rental requested during the run)
+//   <offset_us> complete       (completes the oldest approved rental)
+// Users are named load_user_<i> (password "pw") and resources load_res_<i>.
+// Without --realtime operations run back to back; with it each one waits for its offset.
+// --metrics writes the System's own counters and latency histograms after the run.
+// --trace writes Chrome trace-event JSON of the run (spans require a TRACE=1 build).
+// --audit attaches an AuditLog writing to the given file.
+// --kdf-iterations sets the password hashing cost (default 1000, far below production)
+// so setup and logins do not dominate the run. Logins use loginUserAsync, so the
+// hashing happens on the login pool without holding the System lock.
+
+#include "System.h"
+#include "BulkImporter.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+enum OpType { OP_LOGIN, OP_BROWSE, OP_REQUEST, OP_APPROVE, OP_COMPLETE, OP_TYPE_COUNT };
+
+static const char* const opNames[OP_TYPE_COUNT] = { "login", "browse", "request", "approve", "complete" };
+
+struct Operation {
+    uint64_t offsetMicros; // Time since the start of the run at which the operation is issued
+    OpType type;
+    size_t user;
+    size_t resource;
+    int hours;
+};
+
+struct DriverConfig {
+    size_t users;
+    size_t resources;
+    size_t ops;
+    size_t threads;
+    unsigned long long seed;
+    double mix[OP_TYPE_COUNT];
+    double zipfExponent;
+    double rate; // Ops/sec used for offsets of synthesized operations, 0 = all at once
+    std::string recordPath;
+    std::string replayPath;
+    std::string jsonPath;
+    std::string metricsPath;
+    std::string tracePath;
+    std::string auditPath;
+    uint32_t kdfIterations;
+    bool realtime;
+
+    DriverConfig()
+        : users(1000), resources(1000), ops(100000), threads(4), seed(1), zipfExponent(0.99), rate(0.0),
+          kdfIterations(1000), realtime(false) {
+        double defaults[OP_TYPE_COUNT] = { 20, 40, 20, 10, 10 };
+        std::copy(defaults, defaults + OP_TYPE_COUNT, mix);
+    }
+};
+
+static std::string userName(size_t index) { return "load_user_" + std::to_string(index); }
+static std::string resourceName(size_t index) { return "load_res_" + std::to_string(index); }
+
+// Samples ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s
+class ZipfSampler {
+private:
+    std::vector<double> cdf;
+
+public:
+    ZipfSampler(size_t n, double exponent) : cdf(n) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+            cdf[i] = sum;
+        }
+        for (auto& value : cdf) value /= sum;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(rank, cdf.size() - 1);
+    }
+};
+
+static std::vector<Operation> synthesize(const DriverConfig& config) {
+    std::mt19937_64 rng(config.seed);
+    std::discrete_distribution<int> pickType(config.mix, config.mix + OP_TYPE_COUNT);
+    std::uniform_int_distribution<size_t> pickUser(0, config.users - 1);
+    std::uniform_int_distribution<int> pickHours(1, 24);
+    ZipfSampler pickResource(config.resources, config.zipfExponent);
+
+    std::vector<Operation> ops(config.ops);
+    for (size_t i = 0; i < ops.size(); ++i) {
+        Operation& op = ops[i];
+        op.offsetMicros = config.rate > 0 ? static_cast<uint64_t>(i * 1e6 / config.rate) : 0;
+        op.type = static_cast<OpType>(pickType(rng));
+        op.user = pickUser(rng);
+        op.resource = pickResource(rng);
+        op.hours = pickHours(rng);
+    }
+    return ops;
+}
+
+static bool writeTrace(const std::string& path, const DriverConfig& config, const std::vector<Operation>& ops) {
+    std::ofstream out(path.c_str());
+    if (!out) return false;
+    out << "# users " << config.users << " resources " << config.resources << "\n";
+    for (const auto& op : ops) {
+        out << op.offsetMicros << ' ' << opNames[op.type];
+        switch (op.type) {
+            case OP_LOGIN:   out << ' ' << userName(op.user); break;
+            case OP_BROWSE:  out << ' ' << resourceName(op.resource); break;
+            case OP_REQUEST: out << ' ' << userName(op.user) << ' ' << resourceName(op.resource) << ' ' << op.hours; break;
+            default: break;
+        }
+        out << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+static bool readTrace(const std::string& path, DriverConfig& config, std::vector<Operation>& ops, std::string& error) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        error = "Cannot open trace '" + path + "'";
+        return false;
+    }
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        if (line[0] == '#') {
+            std::string word;
+            while (fields >> word) {
+                if (word == "users") fields >> config.users;
+                else if (word == "resources") fields >> config.resources;
+            }
+            continue;
+        }
+        Operation op = Operation();
+        std::string type, user, resource;
+        long long number = 0;
+        fields >> op.offsetMicros >> type;
+        size_t typeIndex = std::find(opNames, opNames + OP_TYPE_COUNT, type) - opNames;
+        if (!fields || typeIndex == OP_TYPE_COUNT) {
+            error = "Line " + std::to_string(lineNumber) + ": unknown operation";
+            return false;
+        }
+        op.type = static_cast<OpType>(typeIndex);
+        if (op.type == OP_LOGIN || op.type == OP_REQUEST) {
+            fields >> user;
+            if (!parseUniqueId(user, "load_user_", number)) {
+                error = "Line " + std::to_string(lineNumber) + ": bad username";
+                return false;
+            }
+            op.user = static_cast<size_t>(number);
+        }
+        if (op.type == OP_BROWSE || op.type == OP_REQUEST) {
+            fields >> resource;
+            if (!parseUniqueId(resource, "load_res_", number)) {
+                error = "Line " + std::to_string(lineNumber) + ": bad resource ID";
+                return false;
+            }
+            op.resource = static_cast<size_t>(number);
+        }
+        if (op.type == OP_REQUEST && !(fields >> op.hours)) {
+            error = "Line " + std::to_string(lineNumber) + ": missing hours";
+            return false;
+        }
+        ops.push_back(op);
+    }
+    for (const auto& op : ops) {
+        if (op.user >= config.users || op.resource >= config.resources) {
+            error = "Trace refers to more users or resources than its header declares";
+            return false;
+        }
+    }
+    config.ops = ops.size();
+    return true;
+}
+
+// Everything the client threads share. All members are guarded by system.getMutex().
+struct SharedState {
+    System system;
+    std::string adminId;
+    std::vector<std::string> userIds;
+    std::deque<std::string> pendingRentals;
+    std::deque<std::string> approvedRentals;
+};
+
+static bool setup(SharedState& state, const DriverConfig& config, std::string& error) {
+    state.system.registerUser("load_admin", "pw", UserRole::ADMIN, "Load Admin");
+    User* admin = state.system.loginUser("load_admin", "pw");
+    state.adminId = admin->getUserId();
+
+    std::stringstream users;
+    for (size_t i = 0; i < config.users; ++i) {
+        users << userName(i) << ",pw," << (i % 5 == 0 ? "teacher" : "student") << ",Load User " << i << ",1000000000\n";
+    }
+    static const char* const types[] = { "cpu", "gpu", "storage" };
+    std::stringstream resources;
+    for (size_t i = 0; i < config.resources; ++i) {
+        resources << resourceName(i) << ',' << types[i % 3] << ",Load Resource " << i << ',' << (1 + i % 10) << "\n";
+    }
+
+    BulkImporter importer(state.system);
+    ImportReport userReport = importer.importUsers(users, ImportFormat::CSV);
+    ImportReport resourceReport = importer.importResources(resources, ImportFormat::CSV);
+    if (userReport.errorCount || resourceReport.errorCount) {
+        error = "Setup import failed";
+        return false;
+    }
+    state.userIds.reserve(config.users);
+    for (size_t i = 0; i < config.users; ++i) {
+        state.userIds.push_back(generateUniqueId("user_", static_cast<int>(i + 1))); // user_1 is the admin
+    }
+    state.system.logoutUser();
+    return true;
+}
+
+// Executes one operation other than login while holding the System lock.
+// Returns 1 on success, 0 on failure, -1 if there was nothing to do (empty approve/complete queue).
+static int execute(SharedState& state, const Operation& op) {
+    System& system = state.system;
+    switch (op.type) {
+        case OP_BROWSE: {
+            system.switchToUser(state.userIds[op.user]);
+            Page<Resource> firstPage = system.listResources(PageRequest(20));
+            return system.findResource(resourceName(op.resource)) != nullptr && !firstPage.items.empty();
+        }
+        case OP_REQUEST: {
+            const std::string& userId = state.userIds[op.user];
+            if (!system.switchToUser(userId) || !system.requestResourceRental(resourceName(op.resource), op.hours)) {
+                return 0;
+            }
+            Page<Rental> newest = system.listUserRentals(userId, PageRequest(1, PageOrder::NEWEST_FIRST));
+            state.pendingRentals.push_back(newest.items.front()->getRentalId());
+            return 1;
+        }
+        case OP_APPROVE: {
+            if (state.pendingRentals.empty()) return -1;
+            std::string rentalId = state.pendingRentals.front();
+            state.pendingRentals.pop_front();
+            system.switchToUser(state.adminId);
+            if (!system.adminApproveRental(rentalId)) return 0;
+            state.approvedRentals.push_back(rentalId);
+            return 1;
+        }
+        case OP_COMPLETE: {
+            if (state.approvedRentals.empty()) return -1;
+            std::string rentalId = state.approvedRentals.front();
+            state.approvedRentals.pop_front();
+            return system.processRentalCompletion(rentalId);
+        }
+        default:
+            return 0;
+    }
+}
+
+struct OpStats {
+    std::vector<uint64_t> latencies; // Nanoseconds, includes waiting for the lock
+    size_t succeeded;
+    size_t failed;
+    size_t skipped;
+
+    OpStats() : succeeded(0), failed(0), skipped(0) {}
+};
+
+static void runClient(SharedState& state, const DriverConfig& config, const std::vector<Operation>& ops,
+                      std::atomic<size_t>& next, Clock::time_point runStart, std::vector<OpStats>& stats) {
+    for (size_t i = next.fetch_add(1); i < ops.size(); i = next.fetch_add(1)) {
+        const Operation& op = ops[i];
+        if (config.realtime) {
+            std::this_thread::sleep_until(runStart + std::chrono::microseconds(op.offsetMicros));
+        }
+        Clock::time_point started = Clock::now();
+        int outcome = 0;
+        {
+            TRACE_SCOPE(opNames[op.type]);
+            std::future<LoginResult> login;
+            {
+                std::unique_lock<std::mutex> lock(state.system.getMutex(), std::defer_lock);
+                {
+                    TRACE_SCOPE("LoadDriver::waitForLock");
+                    lock.lock();
+                }
+                if (op.type == OP_LOGIN) {
+                    login = state.system.loginUserAsync(userName(op.user), "pw");
+                } else {
+                    outcome = execute(state, op);
+                }
+            }
+            if (login.valid()) {
+                TRACE_SCOPE("LoadDriver::waitForLogin");
+                outcome = login.get().success ? 1 : 0; // The worker needs the lock, so wait after releasing it
+            }
+        }
+        OpStats& s = stats[op.type];
+        s.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count());
+        if (outcome > 0) ++s.succeeded;
+        else if (outcome == 0) ++s.failed;
+        else ++s.skipped;
+    }
+}
+
+static double percentileMicros(const std::vector<uint64_t>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction));
+    return sorted[index] / 1000.0;
+}
+
+static bool parseArguments(int argc, char* argv[], DriverConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--realtime") { config.realtime = true; continue; }
+        if (!hasValue) return false;
+        std::string value = argv[++i];
+        if (arg == "--users") config.users = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--resources") config.resources = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--ops") config.ops = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") config.threads = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--zipf") config.zipfExponent = std::atof(value.c_str());
+        else if (arg == "--rate") config.rate = std::atof(value.c_str());
+        else if (arg == "--record") config.recordPath = value;
+        else if (arg == "--replay") config.replayPath = value;
+        else if (arg == "--json") config.jsonPath = value;
+        else if (arg == "--metrics") config.metricsPath = value;
+        else if (arg == "--trace") config.tracePath = value;
+        else if (arg == "--audit") config.auditPath = value;
+        else if (arg == "--kdf-iterations") config.kdfIterations = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--mix") {
+            std::istringstream parts(value);
+            std::string part;
+            for (int k = 0; k < OP_TYPE_COUNT; ++k) {
+                if (!std::getline(parts, part, ':')) return false;
+                config.mix[k] = std::atof(part.c_str());
+            }
+        } else {
+            return false;
+        }
+    }
+    return config.users > 0 && config.resources > 0 && config.threads > 0 && config.kdfIterations > 0;
+}
+
+int main(int argc, char* argv[]) {
+    DriverConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        std::cerr << "Usage: " << argv[0] << " [--users N] [--resources N] [--ops N] [--threads N] [--seed N]\n"
+                  << "       [--mix login:browse:request:approve:complete] [--zipf S] [--rate OPS_PER_SEC]\n"
+                  << "       [--record trace.txt] [--replay trace.txt] [--realtime] [--json report.jsonl]\n"
+                  << "       [--metrics metrics.prom] [--trace trace.json] [--audit logs.dat] [--kdf-iterations N]"
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<Operation> ops;
+    std::string error;
+    if (!config.replayPath.empty()) {
+        if (!readTrace(config.replayPath, config, ops, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    } else {
+        ops = synthesize(config);
+    }
+    if (!config.recordPath.empty() && !writeTrace(config.recordPath, config, ops)) {
+        std::cerr << "Cannot write trace '" << config.recordPath << "'" << std::endl;
+        return 1;
+    }
+
+    // System prints to std::cout on every call; the report goes to the real stdout buffer
+    std::ostream report(std::cout.rdbuf());
+    NullStreamBuffer nullBuffer;
+    ScopedCoutRedirect silence(&nullBuffer);
+
+    PasswordHasher::setDefaultIterations(config.kdfIterations);
+    SharedState state;
+    std::unique_ptr<AuditLog> auditLog;
+    if (!config.auditPath.empty()) {
+        auditLog.reset(new AuditLog(AuditLogOptions(config.auditPath)));
+        state.system.attachAuditLog(auditLog.get());
+    }
+    if (!setup(state, config, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (!config.tracePath.empty()) {
+        if (!Trace::compiledIn()) {
+            std::cerr << "Warning: tracing is not compiled in (rebuild with TRACE=1), the trace will be empty" << std::endl;
+        }
+        Trace::setEnabled(true);
+    }
+
+    std::vector<std::vector<OpStats>> perThread(config.threads, std::vector<OpStats>(OP_TYPE_COUNT));
+    for (auto& threadStats : perThread) {
+        for (auto& s : threadStats) s.latencies.reserve(ops.size() / config.threads + 1);
+    }
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> clients;
+    Clock::time_point runStart = Clock::now();
+    for (size_t t = 0; t < config.threads; ++t) {
+        clients.emplace_back(runClient, std::ref(state), std::cref(config), std::cref(ops), std::ref(next), runStart,
+                             std::ref(perThread[t]));
+    }
+    for (auto& client : clients) client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+    if (auditLog) {
+        auditLog->flush();
+        report << "Audit records written: " << auditLog->recordsWritten() << ", dropped: " << auditLog->recordsDropped()
+               << std::endl;
+    }
+
+    std::ofstream json;
+    if (!config.jsonPath.empty()) json.open(config.jsonPath.c_str(), std::ios::app);
+
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%zu ops, %zu threads, %zu users, %zu resources, %u KDF iterations: %.3f s, %.0f ops/sec",
+                  ops.size(), config.threads, config.users, config.resources, config.kdfIterations, seconds,
+                  ops.size() / seconds);
+    report << line << std::endl;
+    std::snprintf(line, sizeof(line), "%-10s %9s %9s %9s %9s %10s %10s %10s %10s",
+                  "op", "count", "ok", "failed", "skipped", "p50 us", "p90 us", "p99 us", "max us");
+    report << line << std::endl;
+    for (int type = 0; type < OP_TYPE_COUNT; ++type) {
+        OpStats merged;
+        for (const auto& threadStats : perThread) {
+            const OpStats& s = threadStats[type];
+            merged.latencies.insert(merged.latencies.end(), s.latencies.begin(), s.latencies.end());
+            merged.succeeded += s.succeeded;
+            merged.failed += s.failed;
+            merged.skipped += s.skipped;
+        }
+        std::sort(merged.latencies.begin(), merged.latencies.end());
+        double maxMicros = merged.latencies.empty() ? 0.0 : merged.latencies.back() / 1000.0;
+        std::snprintf(line, sizeof(line), "%-10s %9zu %9zu %9zu %9zu %10.1f %10.1f %10.1f %10.1f",
+                      opNames[type], merged.latencies.size(), merged.succeeded, merged.failed, merged.skipped,
+                      percentileMicros(merged.latencies, 0.50), percentileMicros(merged.latencies, 0.90),
+                      percentileMicros(merged.latencies, 0.99), maxMicros);
+        report << line << std::endl;
+        if (json.is_open()) {
+            std::snprintf(line, sizeof(line),
+                          "{\"op\":\"%s\",\"threads\":%zu,\"count\":%zu,\"ok\":%zu,\"failed\":%zu,\"skipped\":%zu,"
+                          "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"run_ops_per_sec\":%.1f}",
+                          opNames[type], config.threads, merged.latencies.size(), merged.succeeded, merged.failed,
+                          merged.skipped, percentileMicros(merged.latencies, 0.50),
+                          percentileMicros(merged.latencies, 0.90), percentileMicros(merged.latencies, 0.99),
+                          maxMicros, ops.size() / seconds);
+            json << line << std::endl;
+        }
+    }
+
+    if (!config.tracePath.empty()) {
+        std::ofstream trace(config.tracePath.c_str());
+        if (!Trace::writeChromeJson(trace)) {
+            std::cerr << "Cannot write trace '" << config.tracePath << "'" << std::endl;
+            return 1;
+        }
+    }
+    if (!config.metricsPath.empty()) {
+        std::ofstream metrics(config.metricsPath.c_str());
+        Metrics::writePrometheus(metrics);
+        if (!metrics) {
+            std::cerr << "Cannot write metrics '" << config.metricsPath << "'" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Command-line client for RentalServer.
+//
+// Usage:
+//   RentalClient (--unix PATH | --tcp PORT) [--window N] < commands.txt
+//
+// Reads one request per line, "<op> <arg>...", with op names as in
+// requestOpName() (login, list_resources, admin_approve_rental, ...). Arguments
+// containing spaces are written in double quotes; enum arguments are numbers
+// (role 0=student 1=teacher 2=admin, resource type 0=cpu 1=gpu 2=storage,
+// user status 0=active 1=suspended). Up to --window requests (default 64) are
+// pipelined before waiting for responses, which are printed in order.
+
+#include "Protocol.h"
+#include "Utils.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <vector>
+
+// Field layouts: s=string b=u8 u=u32 d=double; [..] is a u32 count followed by that many records
+struct OpLayout {
+    const char* arguments;
+    const char* results;
+};
+
+// Indexed by RequestOp value - 1, layouts as documented in Protocol.h
+static const OpLayout layouts[] = {
+    { "", "" },                       // ping
+    { "ssbs", "" },                   // register_user
+    { "ss", "s" },                    // login
+    { "", "" },                       // logout
+    { "", "ssbbd" },                  // whoami
+    { "s", "" },                      // update_name
+    { "s", "" },                      // update_password
+    { "s", "sbsdb" },                 // find_resource
+    { "su", "[sbsdb]s" },             // list_resources
+    { "su", "s" },                    // request_rental
+    { "s", "" },                      // cancel_rental
+    { "su", "[ssbd]s" },              // list_my_rentals
+    { "su", "[ssdb]s" },              // list_my_bills
+    { "sbsd", "" },                   // admin_add_resource
+    { "s", "" },                      // admin_delete_resource
+    { "sb", "" },                     // admin_set_user_status
+    { "s", "" },                      // admin_approve_rental
+    { "ss", "" },                     // admin_reject_rental
+    { "s", "" },                      // admin_complete_rental
+    { "", "s" },                      // admin_metrics
+    { "su", "[ssbd]s" },              // admin_list_rentals
+    { "su", "[ssdb]s" },              // admin_list_bills
+};
+
+static_assert(sizeof(layouts) / sizeof(layouts[0]) == static_cast<size_t>(RequestOp::COUNT) - 1,
+              "layouts must list every RequestOp");
+
+// Builds a request frame from a command line; returns false with a message on bad input
+static bool encodeRequest(const std::vector<std::string>& tokens, uint32_t requestId, std::string& frame,
+                          RequestOp& op, std::string& error) {
+    if (!requestOpFromName(tokens[0], op)) {
+        error = "unknown op '" + tokens[0] + "'";
+        return false;
+    }
+    const char* layout = layouts[static_cast<size_t>(op) - 1].arguments;
+    if (tokens.size() - 1 != std::strlen(layout)) {
+        error = tokens[0] + " takes " + std::to_string(std::strlen(layout)) + " argument(s)";
+        return false;
+    }
+    WireWriter request;
+    request.u32(requestId).u8(static_cast<uint8_t>(op));
+    for (size_t i = 0; layout[i]; ++i) {
+        const std::string& value = tokens[i + 1];
+        switch (layout[i]) {
+            case 's': request.str(value); break;
+            case 'b': request.u8(static_cast<uint8_t>(std::atoi(value.c_str()))); break;
+            case 'u': request.u32(static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10))); break;
+            case 'd': request.f64(std::atof(value.c_str())); break;
+        }
+    }
+    frame = request.frame();
+    return true;
+}
+
+// Prints fields following a layout, one line per record of a [..] list
+static void printFields(WireReader& in, const char* layout, std::ostream& out) {
+    while (*layout) {
+        char kind = *layout++;
+        if (kind == '[') {
+            const char* recordEnd = std::strchr(layout, ']');
+            std::string record(layout, recordEnd);
+            uint32_t count = in.u32();
+            out << "\n  " << count << " item(s)";
+            for (uint32_t i = 0; i < count && in.ok(); ++i) {
+                out << "\n   ";
+                printFields(in, record.c_str(), out);
+            }
+            layout = recordEnd + 1;
+            if (*layout) out << "\n  next:";
+            continue;
+        }
+        switch (kind) {
+            case 's': out << " \"" << in.str() << '"'; break;
+            case 'b': out << ' ' << static_cast<int>(in.u8()); break;
+            case 'u': out << ' ' << in.u32(); break;
+            case 'd': out << ' ' << in.f64(); break;
+        }
+    }
+}
+
+static void printResponse(const std::string& payload, RequestOp op) {
+    WireReader in(payload.data(), payload.size());
+    uint32_t requestId = in.u32();
+    ResponseStatus status = static_cast<ResponseStatus>(in.u8());
+    std::cout << '#' << requestId << ' ' << requestOpName(op);
+    if (status == ResponseStatus::OK) {
+        std::cout << " OK";
+        printFields(in, layouts[static_cast<size_t>(op) - 1].results, std::cout);
+    } else {
+        std::cout << " ERROR " << in.str();
+    }
+    if (!in.ok()) std::cout << " (truncated response)";
+    std::cout << std::endl;
+}
+
+static int connectTo(const std::string& unixPath, int tcpPort) {
+    int fd;
+    if (!unixPath.empty()) {
+        sockaddr_un address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, unixPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) return fd;
+    } else {
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(tcpPort));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) return fd;
+    }
+    if (fd >= 0) {
+        int connectError = errno;
+        close(fd);
+        errno = connectError;
+    }
+    return -1;
+}
+
+static bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool receiveExactly(int fd, char* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n <= 0) return false;
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool receiveResponse(int fd, std::string& payload) {
+    char header[4];
+    if (!receiveExactly(fd, header, sizeof(header))) return false;
+    uint32_t length = readU32(header);
+    if (length > PROTOCOL_MAX_FRAME) return false;
+    payload.resize(length);
+    return length == 0 || receiveExactly(fd, &payload[0], length);
+}
+
+int main(int argc, char* argv[]) {
+    std::string unixPath;
+    int tcpPort = -1;
+    size_t window = 64;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--unix") unixPath = argv[i + 1];
+        else if (arg == "--tcp") tcpPort = std::atoi(argv[i + 1]);
+        else if (arg == "--window") window = std::strtoul(argv[i + 1], nullptr, 10);
+        else tcpPort = -2;
+    }
+    if (argc % 2 == 0 || tcpPort == -2 || window == 0 || (unixPath.empty() && tcpPort <= 0)) {
+        std::cerr << "Usage: " << argv[0] << " (--unix PATH | --tcp PORT) [--window N] < commands.txt" << std::endl;
+        return 2;
+    }
+
+    int fd = connectTo(unixPath, tcpPort);
+    if (fd < 0) {
+        std::cerr << "Cannot connect: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::deque<RequestOp> outstanding;
+    uint32_t nextRequestId = 1;
+    int status = 0;
+    std::string line;
+    bool more = true;
+    while (more || !outstanding.empty()) {
+        // Fill the window, then wait for the oldest response
+        while (more && outstanding.size() < window) {
+            if (!std::getline(std::cin, line)) {
+                more = false;
+                break;
+            }
+            std::vector<std::string> tokens = splitCommandLine(line);
+            if (tokens.empty() || tokens[0][0] == '#') continue;
+            std::string frame, error;
+            RequestOp op;
+            if (!encodeRequest(tokens, nextRequestId, frame, op, error)) {
+                std::cerr << "Skipping line: " << error << std::endl;
+                status = 1;
+                continue;
+            }
+            if (!sendAll(fd, frame)) {
+                std::cerr << "Connection lost" << std::endl;
+                return 1;
+            }
+            outstanding.push_back(op);
+            ++nextRequestId;
+        }
+        if (outstanding.empty()) continue;
+        std::string payload;
+        if (!receiveResponse(fd, payload)) {
+            std::cerr << "Connection lost" << std::endl;
+            return 1;
+        }
+        printResponse(payload, outstanding.front());
+        outstanding.pop_front();
+    }
+    close(fd);
+    return status;
+}
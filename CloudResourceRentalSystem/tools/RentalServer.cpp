@@ -0,0 +1,144 @@
+// Runs System as a long-lived service speaking the protocol in include/Protocol.h.
+//
+// Usage:
+//   RentalServer [--unix PATH] [--tcp PORT] [--workers N] [--admin USERNAME:PASSWORD]
+//                [--audit logs.dat] [--kdf-iterations N] [--wal PATH | --replica-of PATH]
+//                [--overdue-check SECONDS]
+//
+// At least one of --unix and --tcp is required; TCP listens on 127.0.0.1 only.
+// The System starts empty. --admin registers an initial admin account, since
+// clients cannot create admins without one. SIGINT or SIGTERM stops the server.
+// Rentals past their end time are marked overdue every --overdue-check seconds
+// (60 by default, 0 for never).
+//
+// Replication: a primary started with --wal writes every change to a change log
+// (recreated on start). A replica started with --replica-of on the same log
+// follows it, refuses requests that change state and reports its lag as
+// crrs_replication_lag_seconds in admin_metrics. Accounts, including the admin,
+// come from the primary, so --admin is not allowed on a replica.
+
+#include "Replica.h"
+#include "Server.h"
+#include "Utils.h"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+static Server* runningServer = nullptr;
+
+static void handleStopSignal(int) {
+    if (runningServer) runningServer->stop();
+}
+
+struct ServerConfig {
+    std::string unixPath;
+    int tcpPort;
+    std::string adminUsername;
+    std::string adminPassword;
+    std::string auditPath;
+    std::string walPath;
+    std::string primaryWalPath;
+    unsigned long kdfIterations;
+    ServerOptions options;
+
+    ServerConfig() : tcpPort(-1), kdfIterations(0) {}
+};
+
+static bool parseArguments(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--unix") config.unixPath = value;
+        else if (arg == "--tcp") config.tcpPort = std::atoi(value.c_str());
+        else if (arg == "--workers") config.options.dispatchWorkers = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--audit") config.auditPath = value;
+        else if (arg == "--kdf-iterations") config.kdfIterations = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--wal") config.walPath = value;
+        else if (arg == "--replica-of") config.primaryWalPath = value;
+        else if (arg == "--overdue-check") config.options.overdueCheckInterval = std::chrono::seconds(std::atol(value.c_str()));
+        else if (arg == "--admin") {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) return false;
+            config.adminUsername = value.substr(0, colon);
+            config.adminPassword = value.substr(colon + 1);
+        } else {
+            return false;
+        }
+    }
+    if (!config.primaryWalPath.empty() && (!config.walPath.empty() || !config.adminUsername.empty())) return false;
+    config.options.readOnly = !config.primaryWalPath.empty();
+    return argc % 2 == 1 && (!config.unixPath.empty() || (config.tcpPort > 0 && config.tcpPort < 65536));
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        std::cerr << "Usage: " << argv[0] << " [--unix PATH] [--tcp PORT] [--workers N] [--admin USERNAME:PASSWORD]\n"
+                  << "       [--audit logs.dat] [--kdf-iterations N] [--wal PATH | --replica-of PATH]\n"
+                  << "       [--overdue-check SECONDS]" << std::endl;
+        return 2;
+    }
+    if (config.kdfIterations > 0) PasswordHasher::setDefaultIterations(static_cast<uint32_t>(config.kdfIterations));
+
+    // System's console messages are captured per request by the server; anything else is dropped
+    NullStreamBuffer nullBuffer;
+    ScopedCoutRedirect silence(&nullBuffer);
+
+    std::unique_ptr<AuditLog> auditLog;
+    std::unique_ptr<ChangeLogWriter> changeLog;
+    System system;
+    std::unique_ptr<Replica> replica; // Applies to system, so it is destroyed first
+    if (!config.auditPath.empty()) {
+        auditLog.reset(new AuditLog(AuditLogOptions(config.auditPath)));
+        system.attachAuditLog(auditLog.get());
+    }
+    if (!config.walPath.empty()) {
+        changeLog.reset(new ChangeLogWriter(ChangeLogOptions(config.walPath)));
+        if (!changeLog->isOpen()) {
+            std::cerr << "Cannot create change log '" << config.walPath << "'" << std::endl;
+            return 1;
+        }
+        system.attachChangeLog(changeLog.get());
+    }
+    if (!config.primaryWalPath.empty()) {
+        replica.reset(new Replica(system, config.primaryWalPath));
+        replica->start();
+    }
+    if (!config.adminUsername.empty() &&
+        !system.registerUser(config.adminUsername, config.adminPassword, UserRole::ADMIN, "Administrator")) {
+        std::cerr << "Cannot create admin '" << config.adminUsername << "'" << std::endl;
+        return 1;
+    }
+
+    Server server(system, config.options);
+    std::string error;
+    if (!config.unixPath.empty() && !server.listenUnix(config.unixPath, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (config.tcpPort > 0 && !server.listenTcp("127.0.0.1", static_cast<uint16_t>(config.tcpPort), error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    std::cerr << "Listening" << (config.unixPath.empty() ? "" : " on " + config.unixPath)
+              << (config.tcpPort > 0 ? " on 127.0.0.1:" + std::to_string(config.tcpPort) : "") << std::endl;
+    server.run();
+    runningServer = nullptr;
+
+    ServerStats stats = server.stats();
+    std::cerr << "Stopped after " << stats.connectionsAccepted << " connection(s), " << stats.requestsHandled
+              << " request(s), " << stats.protocolErrors << " protocol error(s)" << std::endl;
+    if (replica) {
+        std::string reason;
+        std::cerr << "Replica applied the change log up to record " << replica->sequence() << std::endl;
+        if (replica->failed(reason)) std::cerr << "Replication stopped: " << reason << std::endl;
+    }
+    if (auditLog) auditLog->flush();
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Loopback check for Server: serves a System on a Unix socket from this process
+// and drives it over the wire the way RentalClient does, with the server's
+// limits turned down so clients run past them.
+//
+// Usage:
+//   ServerCheck [--unix PATH]    (default /tmp/crrs_server_check.sock)
+//
+// Checks that
+//   - a client pipelining far more requests than maxPipelined, with more
+//     response bytes than maxOutputBytes, gets every response back in order;
+//   - a request pipelined right behind a login runs in the session it set;
+//   - logins on more connections than there are dispatch workers do not hold
+//     up another connection's requests while their passwords are hashed;
+//   - the overdue-rental check runs on its timer.
+// Prints one line per check on stderr (the server redirects std::cout while it
+// runs requests) and exits with 1 if any fails. `make check` runs it.
+
+#include "Server.h"
+#include "Utils.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const size_t MAX_PIPELINED = 8;
+static const size_t MAX_OUTPUT_BYTES = 64 * 1024;
+static const size_t DISPATCH_WORKERS = 2;
+static const size_t RESOURCES = 1000;
+static const size_t WINDOW = 600;         // Requests a client keeps outstanding, as RentalClient --window
+static const size_t LIST_REQUESTS = WINDOW - 2; // With the login and whoami, one full window
+static const size_t LOGIN_CLIENTS = 4;    // More than DISPATCH_WORKERS
+static const uint32_t KDF_ITERATIONS = 200000; // Slow enough that a login is still hashing when a ping returns
+static const std::chrono::seconds OVERDUE_CHECK_INTERVAL(1);
+
+static int failures = 0;
+
+static void report(bool ok, const std::string& check, const std::string& detail = std::string()) {
+    std::cerr << (ok ? "ok      " : "FAILED  ") << check << (detail.empty() ? "" : ": " + detail) << std::endl;
+    if (!ok) ++failures;
+}
+
+static int connectTo(const std::string& path) {
+    sockaddr_un address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    timeval timeout = timeval();
+    timeout.tv_sec = 30; // A server that stops answering fails the check instead of hanging it
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool receiveExactly(int fd, char* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n <= 0) return false;
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool receiveResponse(int fd, std::string& payload) {
+    char header[4];
+    if (!receiveExactly(fd, header, sizeof(header))) return false;
+    uint32_t length = readU32(header);
+    if (length > PROTOCOL_MAX_FRAME) return false;
+    payload.resize(length);
+    return length == 0 || receiveExactly(fd, &payload[0], length);
+}
+
+static std::string requestFrame(uint32_t requestId, RequestOp op, const WireWriter& arguments = WireWriter()) {
+    WireWriter payload;
+    payload.u32(requestId).u8(static_cast<uint8_t>(op));
+    WireWriter prefix;
+    prefix.u32(static_cast<uint32_t>(payload.data().size() + arguments.data().size()));
+    return prefix.data() + payload.data() + arguments.data();
+}
+
+// Sends the frames keeping up to WINDOW unanswered, like RentalClient, and returns the
+// payloads received; fewer than frames.size() if the connection failed or timed out.
+// Like RentalClient it fills the window before reading, so responses back up on the server,
+// but it reads instead of blocking in send: a client stuck in send while the server waits
+// for its output to drain before reading more would deadlock.
+static std::vector<std::string> exchange(int fd, const std::vector<std::string>& frames) {
+    std::vector<std::string> responses;
+    std::string output, input;
+    size_t queued = 0, inputOffset = 0;
+    bool paused = false;
+    while (responses.size() < frames.size()) {
+        while (queued < frames.size() && queued - responses.size() < WINDOW) output += frames[queued++];
+        if (!paused && output.empty() && queued - responses.size() == WINDOW) {
+            // Stay away once with nothing more to send, so the server's output backs up while
+            // requests it has read but not queued wait for the ones in flight. No new request
+            // wakes the server up afterwards: it must queue them as its responses come back
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            paused = true;
+        }
+        pollfd ready = pollfd();
+        ready.fd = fd;
+        ready.events = static_cast<short>(POLLIN | (output.empty() ? 0 : POLLOUT));
+        if (poll(&ready, 1, 30 * 1000) <= 0) break; // A server that stops answering fails the check
+        if (ready.revents & POLLOUT) {
+            ssize_t sent = send(fd, output.data(), output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+            if (sent > 0) output.erase(0, static_cast<size_t>(sent));
+        } else if (ready.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buffer[64 * 1024];
+            ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) break;
+            if (received > 0) input.append(buffer, static_cast<size_t>(received));
+            while (input.size() - inputOffset >= 4) {
+                uint32_t length = readU32(input.data() + inputOffset);
+                if (input.size() - inputOffset - 4 < length) break;
+                responses.push_back(input.substr(inputOffset + 4, length));
+                inputOffset += 4 + length;
+            }
+            input.erase(0, inputOffset);
+            inputOffset = 0;
+        }
+    }
+    return responses;
+}
+
+// Reads a response header; false unless it answers requestId with OK
+static bool readOk(WireReader& in, uint32_t requestId) {
+    uint32_t answered = in.u32();
+    ResponseStatus status = static_cast<ResponseStatus>(in.u8());
+    return in.ok() && answered == requestId && status == ResponseStatus::OK;
+}
+
+static void checkPipelining(const std::string& path) {
+    int fd = connectTo(path);
+    if (fd < 0) {
+        report(false, "pipelining", std::string("cannot connect: ") + std::strerror(errno));
+        return;
+    }
+    std::vector<std::string> frames;
+    uint32_t requestId = 0;
+    WireWriter login;
+    login.str("admin").str("secret");
+    frames.push_back(requestFrame(++requestId, RequestOp::LOGIN, login));
+    frames.push_back(requestFrame(++requestId, RequestOp::WHOAMI));
+    for (size_t i = 0; i < LIST_REQUESTS; ++i) {
+        WireWriter page;
+        page.str("").u32(100); // About 5 KB per response, so unsent output backs up on the server
+        frames.push_back(requestFrame(++requestId, RequestOp::LIST_RESOURCES, page));
+    }
+    std::vector<std::string> responses = exchange(fd, frames);
+    close(fd);
+
+    report(responses.size() == frames.size(), "pipelining past maxPipelined and maxOutputBytes",
+           std::to_string(responses.size()) + " of " + std::to_string(frames.size()) + " responses");
+    size_t failed = 0;
+    std::string loginUserId, sessionUserId;
+    for (size_t i = 0; i < responses.size(); ++i) {
+        WireReader in(responses[i].data(), responses[i].size());
+        if (!readOk(in, static_cast<uint32_t>(i + 1))) {
+            ++failed;
+        } else if (i == 0) {
+            loginUserId = in.str();
+        } else if (i == 1) {
+            sessionUserId = in.str();
+        } else if (in.u32() != 100) {
+            ++failed;
+        }
+    }
+    report(failed == 0, "responses in request order and successful", std::to_string(failed) + " failed");
+    report(!loginUserId.empty() && sessionUserId == loginUserId, "request behind a login runs in its session",
+           "login \"" + loginUserId + "\", whoami \"" + sessionUserId + "\"");
+}
+
+static void checkConcurrentLogins(const std::string& path) {
+    std::vector<int> logins;
+    for (size_t i = 0; i < LOGIN_CLIENTS; ++i) {
+        int fd = connectTo(path);
+        WireWriter login;
+        login.str("check_user_" + std::to_string(i)).str("pw");
+        if (fd >= 0 && !sendAll(fd, requestFrame(1, RequestOp::LOGIN, login))) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0) {
+            report(false, "concurrent logins", std::string("cannot connect: ") + std::strerror(errno));
+            for (int open : logins) close(open);
+            return;
+        }
+        logins.push_back(fd);
+    }
+    // Let the server pick up every login before the ping
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    int pinger = connectTo(path);
+    std::string payload;
+    bool pinged = pinger >= 0 && sendAll(pinger, requestFrame(1, RequestOp::PING)) && receiveResponse(pinger, payload);
+    size_t answered = 0;
+    for (int fd : logins) {
+        char byte;
+        if (recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) > 0) ++answered;
+    }
+    report(pinged && answered == 0, "ping answered while logins are hashing",
+           std::to_string(answered) + " of " + std::to_string(LOGIN_CLIENTS) + " logins answered first");
+
+    size_t succeeded = 0;
+    for (int fd : logins) {
+        if (receiveResponse(fd, payload)) {
+            WireReader in(payload.data(), payload.size());
+            if (readOk(in, 1)) ++succeeded;
+        }
+        close(fd);
+    }
+    if (pinger >= 0) close(pinger);
+    report(succeeded == LOGIN_CLIENTS, "concurrent logins succeed",
+           std::to_string(succeeded) + " of " + std::to_string(LOGIN_CLIENTS));
+}
+
+static void checkOverdueTimer() {
+    uint64_t before = Metrics::snapshot().latency(ApiMethod::CHECK_OVERDUE_RENTALS).count;
+    std::this_thread::sleep_for(OVERDUE_CHECK_INTERVAL + std::chrono::milliseconds(500));
+    uint64_t after = Metrics::snapshot().latency(ApiMethod::CHECK_OVERDUE_RENTALS).count;
+    report(after > before, "overdue check runs on its timer", std::to_string(after - before) + " run(s)");
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = "/tmp/crrs_server_check.sock";
+    if (argc == 3 && std::string(argv[1]) == "--unix") {
+        path = argv[2];
+    } else if (argc != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--unix PATH]" << std::endl;
+        return 2;
+    }
+    PasswordHasher::setDefaultIterations(KDF_ITERATIONS);
+
+    System system;
+    system.setConsoleMessages(false);
+    system.setLoginWorkers(1); // Logins queue up behind each other, so the ping check has time to run
+    system.registerUser("admin", "secret", UserRole::ADMIN, "Administrator");
+    for (size_t i = 0; i < LOGIN_CLIENTS; ++i) {
+        system.registerUser("check_user_" + std::to_string(i), "pw", UserRole::STUDENT, "Check user");
+    }
+    for (size_t i = 0; i < RESOURCES; ++i) {
+        system.addResource(Resource("check_res_" + std::to_string(i), ResourceType::CPU,
+                                    "Check resource " + std::to_string(i), {}, 1.0));
+    }
+
+    ServerOptions options;
+    options.dispatchWorkers = DISPATCH_WORKERS;
+    options.maxPipelined = MAX_PIPELINED;
+    options.maxOutputBytes = MAX_OUTPUT_BYTES;
+    options.overdueCheckInterval = OVERDUE_CHECK_INTERVAL;
+    Server server(system, options);
+    std::string error;
+    if (!server.listenUnix(path, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::thread loop(&Server::run, &server);
+
+    checkPipelining(path);
+    checkConcurrentLogins(path);
+    checkOverdueTimer();
+
+    server.stop();
+    loop.join();
+    std::cerr << (failures == 0 ? "All server checks passed" : std::to_string(failures) + " server check(s) failed")
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}